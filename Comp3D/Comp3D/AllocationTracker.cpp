@@ -0,0 +1,283 @@
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include "AllocationTracker.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#else
+#include <execinfo.h>
+#include <dlfcn.h>
+#endif
+
+
+// Allocations made by the tracker itself, or while it prints, are not counted
+static thread_local bool bInside = false;
+
+
+AllocationTracker::AllocationTracker()
+{
+	for (Site& site : sites)
+	{
+		site.hash = 0;
+		site.bReady = false;
+		site.numFrames = 0;
+		site.count = 0;
+		site.bytes = 0;
+		site.lastCount = 0;
+		site.lastBytes = 0;
+	}
+	frameAllocations = 0;
+	frameBytes = 0;
+	totalAllocations = 0;
+	totalFrees = 0;
+	lastAllocations = 0;
+	lastBytes = 0;
+	numViolations = 0;
+	bExpectNone = false;
+}
+
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef COMP3D_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+void AllocationTracker::beginFrame()
+{
+	bInside = true;
+
+	lastAllocations = frameAllocations.exchange(0);
+	lastBytes = frameBytes.exchange(0);
+	for (Site& site : sites)
+	{
+		if (site.hash == 0)
+			continue;
+		site.lastCount = site.count.exchange(0);
+		site.lastBytes = site.bytes.exchange(0);
+	}
+
+	if (bExpectNone && lastAllocations > 0)
+	{
+		numViolations++;
+		cerr << "Frame allocated " << lastAllocations << " times (" << lastBytes << " bytes) in the steady state" << endl;
+		print(cerr);
+	}
+
+	bInside = false;
+}
+
+void AllocationTracker::expectNoAllocations(bool bExpect)
+{
+	bExpectNone = bExpect;
+}
+
+
+AllocationTracker::Stats AllocationTracker::getStats() const
+{
+	Stats stats;
+
+	stats.frameAllocations = lastAllocations;
+	stats.frameBytes = lastBytes;
+	stats.totalAllocations = totalAllocations;
+	stats.totalFrees = totalFrees;
+	stats.numViolations = numViolations;
+
+	return stats;
+}
+
+void AllocationTracker::print(ostream& out) const
+{
+	bool bWasInside = bInside;
+	vector<int> active;
+
+	bInside = true;
+
+	for (int i = 0; i < ALLOCATION_TRACKER_SITES; i++)
+		if (sites[i].bReady && sites[i].lastCount > 0)
+			active.push_back(i);
+	sort(active.begin(), active.end(), [this](int a, int b) { return sites[a].lastCount > sites[b].lastCount; });
+	if (active.size() > ALLOCATION_TRACKER_REPORTED)
+		active.resize(ALLOCATION_TRACKER_REPORTED);
+
+	for (int i : active)
+	{
+		const Site& site = sites[i];
+		out << "  " << site.lastCount << " allocations, " << site.lastBytes << " bytes" << endl;
+		for (int f = 0; f < site.numFrames; f++)
+			printFrame(out, site.frames[f]);
+	}
+
+	bInside = bWasInside;
+}
+
+
+void AllocationTracker::recordAllocation(size_t bytes)
+{
+	void* frames[ALLOCATION_TRACKER_DEPTH];
+	unsigned long long hash = 14695981039346656037ull;
+
+	if (bInside)
+		return;
+	bInside = true;
+
+	frameAllocations++;
+	frameBytes += bytes;
+	totalAllocations++;
+
+	// The call stack is the call site, told apart by its hash
+	int numFrames = captureStack(frames, ALLOCATION_TRACKER_DEPTH);
+	for (int f = 0; f < numFrames; f++)
+		hash = (hash ^ (unsigned long long)(uintptr_t)frames[f]) * 1099511628211ull;
+	if (hash == 0)
+		hash = 1;
+
+	for (int probe = 0; probe < ALLOCATION_TRACKER_SITES; probe++)
+	{
+		Site& site = sites[(hash + probe) & (ALLOCATION_TRACKER_SITES - 1)];
+		unsigned long long expected = 0;
+
+		if (site.hash.compare_exchange_strong(expected, hash))
+		{
+			copy(frames, frames + numFrames, site.frames);
+			site.numFrames = numFrames;
+			site.bReady = true;
+		}
+		else if (expected != hash)
+			continue;
+		site.count++;
+		site.bytes += bytes;
+		break;
+	}
+
+	bInside = false;
+}
+
+void AllocationTracker::recordFree()
+{
+	if (!bInside)
+		totalFrees++;
+}
+
+
+// Frames above the caller of operator new are skipped
+
+int AllocationTracker::captureStack(void** frames, int depth)
+{
+#ifdef _WIN32
+	return CaptureStackBackTrace(3, depth, frames, NULL);
+#else
+	void* stack[ALLOCATION_TRACKER_DEPTH + 3];
+	int numFrames = backtrace(stack, depth + 3) - 3;
+
+	numFrames = max(numFrames, 0);
+	copy(stack + 3, stack + 3 + numFrames, frames);
+	return numFrames;
+#endif
+}
+
+void AllocationTracker::printFrame(ostream& out, void* frame)
+{
+#ifdef _WIN32
+	static bool bSymbols = false;
+	HANDLE process = GetCurrentProcess();
+	char buffer[sizeof(SYMBOL_INFO) + 256];
+	SYMBOL_INFO* symbol = (SYMBOL_INFO*)buffer;
+	IMAGEHLP_LINE64 line;
+	DWORD64 offset = 0;
+	DWORD lineOffset = 0;
+
+	if (!bSymbols)
+		bSymbols = SymInitialize(process, NULL, TRUE) != FALSE;
+
+	symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+	symbol->MaxNameLen = 255;
+	line.SizeOfStruct = sizeof(line);
+	out << "    " << frame;
+	if (bSymbols && SymFromAddr(process, DWORD64(frame), &offset, symbol))
+		out << " " << symbol->Name << "+" << offset;
+	if (bSymbols && SymGetLineFromAddr64(process, DWORD64(frame), &lineOffset, &line))
+		out << " (" << line.FileName << ":" << line.LineNumber << ")";
+	out << endl;
+#else
+	Dl_info info;
+
+	out << "    " << frame;
+	if (dladdr(frame, &info) && info.dli_sname != NULL)
+		out << " " << info.dli_sname << "+" << (char*)frame - (char*)info.dli_saddr;
+	out << endl;
+#endif
+}
+
+
+#ifdef COMP3D_TRACK_ALLOCATIONS
+
+void* operator new(size_t bytes)
+{
+	AllocationTracker::instance().recordAllocation(bytes);
+
+	void* memory = malloc(bytes > 0 ? bytes : 1);
+	if (memory == NULL)
+		throw bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t bytes)
+{
+	return operator new(bytes);
+}
+
+void* operator new(size_t bytes, const nothrow_t&) noexcept
+{
+	AllocationTracker::instance().recordAllocation(bytes);
+
+	return malloc(bytes > 0 ? bytes : 1);
+}
+
+void* operator new[](size_t bytes, const nothrow_t&) noexcept
+{
+	return operator new(bytes, nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (memory == NULL)
+		return;
+	AllocationTracker::instance().recordFree();
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, const nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+#endif // COMP3D_TRACK_ALLOCATIONS
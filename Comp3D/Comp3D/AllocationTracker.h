@@ -0,0 +1,93 @@
+#ifndef _ALLOCATION_TRACKER_INCLUDE
+#define _ALLOCATION_TRACKER_INCLUDE
+
+
+#include <atomic>
+#include <ostream>
+
+
+using namespace std;
+
+
+#define ALLOCATION_TRACKER_SITES 4096		// Call stacks told apart, must be a power of two
+#define ALLOCATION_TRACKER_DEPTH 8			// Frames kept of every call stack
+#define ALLOCATION_TRACKER_REPORTED 10		// Call sites printed by a report
+
+
+// AllocationTracker counts every heap allocation of the program, and for
+// every call stack that allocates how many times it did it in the last
+// frame. It is only compiled in with COMP3D_TRACK_ALLOCATIONS defined,
+// which replaces the global operator new and delete; without it nothing
+// is counted and isEnabled returns false.
+//
+// The game loop must not allocate once a level is running. After
+// expectNoAllocations(true) every frame that allocates is a violation, its
+// call stacks are printed when the frame ends and counted.
+
+
+class AllocationTracker
+{
+
+private:
+	AllocationTracker();
+
+public:
+	struct Stats
+	{
+		int frameAllocations;			// Last complete frame
+		size_t frameBytes;
+		long long totalAllocations, totalFrees;
+		int numViolations;				// Frames that allocated when they should not
+	};
+
+	static AllocationTracker& instance()
+	{
+		static AllocationTracker T;
+
+		return T;
+	}
+
+	static bool isEnabled();
+
+	// Closes the frame, the main loop calls it once per frame
+	void beginFrame();
+	void expectNoAllocations(bool bExpect);
+
+	Stats getStats() const;
+	// Call stacks of the last frame, the ones that allocated most first
+	void print(ostream& out) const;
+
+	// Called by operator new and delete
+	void recordAllocation(size_t bytes);
+	void recordFree();
+
+private:
+	struct Site
+	{
+		atomic<unsigned long long> hash;			// 0 while the slot is free
+		atomic<bool> bReady;						// frames are written
+		void* frames[ALLOCATION_TRACKER_DEPTH];
+		int numFrames;
+		atomic<int> count;							// This frame
+		atomic<size_t> bytes;
+		int lastCount;								// Last complete frame
+		size_t lastBytes;
+	};
+
+	static int captureStack(void** frames, int depth);
+	static void printFrame(ostream& out, void* frame);
+
+private:
+	Site sites[ALLOCATION_TRACKER_SITES];
+	atomic<int> frameAllocations;
+	atomic<size_t> frameBytes;
+	atomic<long long> totalAllocations, totalFrees;
+	int lastAllocations;
+	size_t lastBytes;
+	int numViolations;
+	bool bExpectNone;
+
+};
+
+
+#endif // _ALLOCATION_TRACKER_INCLUDE
@@ -3,10 +3,15 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "AssimpModel.h"
+#include "ModelBounds.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
 
 
 AssimpModel::AssimpModel()
 {
+	meshBytes = arrayBytes = bufferBytes = 0;
 }
 
 AssimpModel::~AssimpModel()
@@ -17,6 +22,33 @@ AssimpModel::~AssimpModel()
 
 bool AssimpModel::loadFromFile(const string &filename, ShaderProgram &program)
 {
+	bool retCode = parseFile(filename);
+
+	upload(program);
+
+	return retCode;
+
+
+	if (!floor.loadFromFile("images/wood.jpeg", TEXTURE_PIXEL_FORMAT_RGB))
+		cout << "Could not load floor texture!!!" << endl;
+}
+
+bool AssimpModel::parseFile(const string &filename)
+{
+	PROFILE_ZONE("AssimpModel::parseFile");
+	this->filename = filename;
+
+#ifdef COMP3D_HEADLESS
+	// Nothing is drawn, the bounding box is all that is needed
+	if (ModelBounds::instance().find(filename, center, size))
+	{
+		clear();
+		bbox[0] = center - size / 2.f;
+		bbox[1] = center + size / 2.f;
+		return true;
+	}
+	cerr << "No cached bounds for '" << filename << "', run Comp3D --cache-bounds" << endl;
+#endif
 	bool retCode = false;
 	Assimp::Importer Importer;
 	const aiScene *pScene;
@@ -27,14 +59,26 @@ bool AssimpModel::loadFromFile(const string &filename, ShaderProgram &program)
 		retCode = initFromScene(pScene, filename);
 	else
 		cerr << "Error parsing '" << filename << "': '" << Importer.GetErrorString() << std::endl;
+	MemoryAccounting::instance().allocate(MemoryAccounting::MODELS, MemoryAccounting::CPU, filename, meshBytes);
 	computeBoundingBox();
-	prepareArrays(program);
+	buildArrays();
 
 	return retCode;
+}
 
+void AssimpModel::upload(ShaderProgram &program)
+{
+	PROFILE_ZONE("AssimpModel::upload");
 
-	if (!floor.loadFromFile("images/wood.jpeg", TEXTURE_PIXEL_FORMAT_RGB))
-		cout << "Could not load floor texture!!!" << endl;
+#ifndef COMP3D_HEADLESS
+	for (unsigned int i = 0; i < textures.size(); i++)
+		if (textures[i] != NULL)
+			textures[i]->upload();
+	prepareArrays(program);
+#else
+	// Models without cached bounds were read, their vertices are not needed
+	releaseArrays();
+#endif
 }
 
 glm::vec3 AssimpModel::getSize() const
@@ -63,11 +107,11 @@ void AssimpModel::render(ShaderProgram &program) const
 		}
 		else
 			glDisable(GL_TEXTURE_2D);
-		glBindVertexArray(VAOs[index]);
+		RenderStats::instance().bindVertexArray(VAOs[index]);
 		glEnableVertexAttribArray(posLocations[index]);
 		glEnableVertexAttribArray(normalLocations[index]);
 		glEnableVertexAttribArray(texCoordLocations[index]);
-		glDrawArrays(GL_TRIANGLES, 0, meshes[index]->triangles.size());
+		RenderStats::instance().drawArrays(GL_TRIANGLES, 0, meshes[index]->triangles.size());
 	}
 	glDisable(GL_TEXTURE_2D);
 }
@@ -80,6 +124,24 @@ void AssimpModel::clear()
 	for (vector<Texture *>::iterator itTexture = textures.begin(); itTexture != textures.end(); itTexture++)
 		delete *itTexture;
 	textures.clear();
+	MemoryAccounting::instance().release(MemoryAccounting::MODELS, MemoryAccounting::CPU, filename, meshBytes);
+	meshBytes = 0;
+	releaseArrays();
+
+	// Only uploaded models have buffers, and they are uploaded and
+	// destroyed in the main thread
+	if (!VBOs.empty())
+	{
+		glDeleteBuffers(GLsizei(VBOs.size()), VBOs.data());
+		glDeleteVertexArrays(GLsizei(VAOs.size()), VAOs.data());
+		MemoryAccounting::instance().release(MemoryAccounting::MODELS, MemoryAccounting::GPU, filename, bufferBytes);
+	}
+	VBOs.clear();
+	VAOs.clear();
+	posLocations.clear();
+	normalLocations.clear();
+	texCoordLocations.clear();
+	bufferBytes = 0;
 }
 
 bool AssimpModel::initFromScene(const aiScene *pScene, const string &filename)
@@ -126,6 +188,10 @@ void AssimpModel::initMesh(int index, const aiMesh *paiMesh)
 		meshes[index]->triangles.push_back(Face.mIndices[1]);
 		meshes[index]->triangles.push_back(Face.mIndices[2]);
 	}
+
+	const Mesh &mesh = *meshes[index];
+	meshBytes += sizeof(Mesh) + mesh.vertices.capacity() * sizeof(glm::vec3) + mesh.normals.capacity() * sizeof(glm::vec3)
+		+ mesh.texCoords.capacity() * sizeof(glm::vec2) + mesh.triangles.capacity() * sizeof(unsigned int);
 }
 
 bool AssimpModel::initMaterials(const aiScene *pScene, const string &filename)
@@ -157,7 +223,7 @@ bool AssimpModel::initMaterials(const aiScene *pScene, const string &filename)
 				strcpy_s(fullPath, sFullPath.c_str());
 
 				textures[i] = new Texture();
-				if (!textures[i]->loadFromFile(fullPath, TEXTURE_PIXEL_FORMAT_RGB))
+				if (!textures[i]->decodeFile(fullPath, TEXTURE_PIXEL_FORMAT_RGB))
 				{
 					cerr << "Error loading texture '" << fullPath << "'" << endl;
 					delete textures[i];
@@ -187,18 +253,22 @@ void AssimpModel::computeBoundingBox()
 	size = bbox[1] - bbox[0];
 }
 
-void AssimpModel::prepareArrays(ShaderProgram &program)
+// Interleaved position, normal and texture coordinates of every triangle
+// vertex, one array per mesh
+
+void AssimpModel::buildArrays()
 {
 	unsigned int index;
 	glm::vec3 vertex, normal;
 	glm::vec2 texCoord;
-	vector<float> vertices;
-	GLuint vao, vbo;
-	GLint posLocation, normalLocation, texCoordLocation;
 
+	arrays.resize(meshes.size());
 	for (unsigned int i = 0; i<meshes.size(); i++)
 	{
-		// Array for submesh i
+		vector<float> &vertices = arrays[i];
+
+		vertices.clear();
+		vertices.reserve(8 * meshes[i]->triangles.size());
 		for (unsigned int j = 0; j<meshes[i]->triangles.size(); j++)
 		{
 			index = meshes[i]->triangles[j];
@@ -209,14 +279,26 @@ void AssimpModel::prepareArrays(ShaderProgram &program)
 			vertices.push_back(normal.x); vertices.push_back(normal.y); vertices.push_back(normal.z);
 			vertices.push_back(texCoord.s); vertices.push_back(texCoord.t);
 		}
+		arrayBytes += vertices.size() * sizeof(float);
+	}
+	MemoryAccounting::instance().allocate(MemoryAccounting::MODELS, MemoryAccounting::CPU, filename, arrayBytes);
+}
 
+void AssimpModel::prepareArrays(ShaderProgram &program)
+{
+	GLuint vao, vbo;
+	GLint posLocation, normalLocation, texCoordLocation;
+
+	for (unsigned int i = 0; i<arrays.size(); i++)
+	{
 		glGenVertexArrays(1, &vao);
 		VAOs.push_back(vao);
-		glBindVertexArray(vao);
+		RenderStats::instance().bindVertexArray(vao);
 		glGenBuffers(1, &vbo);
 		VBOs.push_back(vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, 8 * meshes[i]->triangles.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+		RenderStats::instance().bufferData(GL_ARRAY_BUFFER, arrays[i].size() * sizeof(float), arrays[i].data(), GL_STATIC_DRAW);
+		bufferBytes += arrays[i].size() * sizeof(float);
 		posLocation = program.bindVertexAttribute("position", 3, 8 * sizeof(float), 0);
 		posLocations.push_back(posLocation);
 		normalLocation = program.bindVertexAttribute("normal", 3, 8 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -224,5 +306,16 @@ void AssimpModel::prepareArrays(ShaderProgram &program)
 		texCoordLocation = program.bindVertexAttribute("texCoord", 2, 8 * sizeof(float), (void *)(6 * sizeof(float)));
 		texCoordLocations.push_back(texCoordLocation);
 	}
+
+	MemoryAccounting::instance().allocate(MemoryAccounting::MODELS, MemoryAccounting::GPU, filename, bufferBytes);
+
+	// The GPU has its own copy now
+	releaseArrays();
 }
 
+void AssimpModel::releaseArrays()
+{
+	arrays.clear();
+	MemoryAccounting::instance().release(MemoryAccounting::MODELS, MemoryAccounting::CPU, filename, arrayBytes);
+	arrayBytes = 0;
+}
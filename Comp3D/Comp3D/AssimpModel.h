@@ -15,6 +15,15 @@
 using namespace std;
 
 
+// AssimpModel loads a model with Assimp and prepares a VAO for each mesh.
+// Loading can be done in two steps: parseFile reads the model and decodes
+// its textures without OpenGL, so it can run in any thread, then upload
+// creates the buffers and textures in the main thread.
+// The headless build never uploads, and takes the bounding box from
+// ModelBounds when it can instead of reading the model.
+// MemoryAccounting counts the meshes, the vertex arrays and the buffers.
+
+
 class AssimpModel
 {
 public:
@@ -22,6 +31,8 @@ public:
 	~AssimpModel();
 
 	bool loadFromFile(const string &filename, ShaderProgram &program);
+	bool parseFile(const string &filename);
+	void upload(ShaderProgram &program);
 	void render(ShaderProgram &program) const;
 
 	glm::vec3 getCenter() const;
@@ -33,13 +44,18 @@ private:
 	void initMesh(int index, const aiMesh *paiMesh);
 	bool initMaterials(const aiScene *pScene, const string &filename);
 	void computeBoundingBox();
+	void buildArrays();
 	void prepareArrays(ShaderProgram &program);
+	void releaseArrays();
 
 private:
+	string filename;
 	glm::vec3 size;
 	glm::vec3 center, bbox[2];
 	vector<Mesh *> meshes;
 	vector<Texture *> textures;
+	vector<vector<float>> arrays;		// Vertex data waiting for upload
+	size_t meshBytes, arrayBytes, bufferBytes;
 
 	vector<GLuint> VAOs;
 	vector<GLuint> VBOs;
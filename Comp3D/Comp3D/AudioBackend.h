@@ -0,0 +1,69 @@
+#ifndef _AUDIO_BACKEND_INCLUDE
+#define _AUDIO_BACKEND_INCLUDE
+
+
+#include <string>
+#include <stdint.h>
+
+
+using namespace std;
+
+
+// A sound loaded by a backend, each backend extends it with its own data
+struct AudioSound
+{
+	virtual ~AudioSound() {}
+};
+
+// Voices are handles. 0 is no voice, and the handle of a voice that has
+// finished is simply ignored, so they can be kept around safely.
+typedef uintptr_t AudioVoice;
+
+
+// AudioBackend is what SoundManager plays sounds with. FmodBackend is the
+// one the game ships with, NullAudioBackend plays nothing, and
+// SoftwareMixer mixes in the game itself to a WAV file or to nowhere,
+// which needs no audio device or FMOD library. Backends only load and
+// play; sharing sounds and limiting voices is done by SoundManager.
+
+
+class AudioBackend
+{
+
+public:
+	enum State
+	{
+		LOADING,
+		READY,
+		FAILED
+	};
+
+	virtual ~AudioBackend() {}
+
+	// realVoices of the maxVoices are mixed, the rest are virtual
+	virtual bool init(int maxVoices, int realVoices) = 0;
+	virtual void shutdown() = 0;
+	// Called once per simulation step
+	virtual void update(int deltaTime) = 0;
+
+	// Loads never block, the sound can be played once it is READY.
+	// Streams are decoded while they play instead of when they load.
+	virtual AudioSound* createSound(const string& file, bool bStream, bool bLoop) = 0;
+	virtual void releaseSound(AudioSound* sound) = 0;
+	virtual State getState(AudioSound* sound) = 0;
+	// Decoded bytes held in memory, 0 for streams
+	virtual unsigned int getSampleBytes(AudioSound* sound) = 0;
+
+	// Priority goes from 0 (most important) to 256
+	virtual AudioVoice play(AudioSound* sound, int priority) = 0;
+	virtual void stop(AudioVoice voice) = 0;
+	virtual void setVolume(AudioVoice voice, float volume) = 0;
+	virtual bool isPlaying(AudioVoice voice) = 0;
+
+	virtual void getVoices(int& numVoices, int& numRealVoices) = 0;
+	virtual int getMemoryBytes() = 0;
+
+};
+
+
+#endif // _AUDIO_BACKEND_INCLUDE
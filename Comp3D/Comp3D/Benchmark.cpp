@@ -0,0 +1,1333 @@
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <ctime>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include "Benchmark.h"
+#include "Json.h"
+#include "SpatialHash.h"
+#include "JobSystem.h"
+#include "SoftwareMixer.h"
+#include "ParticleSystem.h"
+#include "GpuParticleSystem.h"
+#include "EntitySystems.h"
+#include "Sweep.h"
+#include "LevelArena.h"
+#include "AllocationTracker.h"
+#include "FrameScratch.h"
+#include "RenderSnapshot.h"
+#include "TileMap.h"
+#include "Billboard.h"
+#include "ModelBounds.h"
+#include "NullAudioBackend.h"
+#include "SoundManager.h"
+#include "Game.h"
+#include "RenderStats.h"
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+#define BENCH_WORLD_SIZE 1024			// Tiles per side of the synthetic level
+#define BENCH_FRAMES 200
+#define BENCH_QUERIES_PER_FRAME 8		// Two axis passes of four entity types
+#define BENCH_JOB_ELEMENTS (1 << 18)
+#define BENCH_JOB_GRAIN 1024
+#define BENCH_AUDIO_STEPS 1250			// 10 s of audio in simulation steps
+#define BENCH_AUDIO_STEP 8
+#define BENCH_PARTICLE_FRAMES 100
+#define BENCH_PARTICLE_STEP 0.008f		// s, one simulation step
+#define BENCH_ENTITIES 10000
+#define BENCH_ENTITY_AREA 256			// Tiles per side where they are placed
+#define BENCH_ENTITY_STEP 8
+#define BENCH_ENTITY_MODEL_BYTES 2048	// Stand-in for the model each old entity loaded
+#define BENCH_ARENA_LEVELS 50
+#define BENCH_ARENA_OBJECTS 5000
+#define BENCH_ARENA_OBJECT_FLOATS 24
+#define BENCH_ARENA_TILES (512 * 512)
+#define BENCH_STEADY_LEVEL 1
+#define BENCH_STEADY_STEP 8				// ms, a simulation step as in the game
+#define BENCH_STEADY_TAP 300			// ms between presses of the space bar
+#define BENCH_STEADY_WARMUP 120			// Frames that may allocate, as ZERO_ALLOC_WARMUP
+#define BENCH_STEADY_FRAMES 2000
+#define BENCH_LEVELS 6					// levels/level01.txt to level06.txt, the last is the ending
+#define BENCH_LEVEL_LOADS 10
+#define BENCH_LARGE_LEVEL_SIZE 1024		// Tiles per side, over TILEMAP_PAGED_MIN_TILES
+#define BENCH_LARGE_LEVEL_FILE "bench_large_level.txt"
+#define BENCH_COLLISION_PASSES 20		// Over every position of the level
+#define BENCH_COLLISION_DELTA 0.25f		// Tiles, what a fast wall moves in a step
+#define BENCH_MODEL_LOADS 3
+#define BENCH_BILLBOARDS 10000
+
+
+// Thousands of walls moving around a big level. Every frame all of them
+// move and the player looks for the ones it could collide with, once
+// through the spatial hash and once testing every wall.
+
+static void benchSpatialHash(Benchmark& bench)
+{
+	const int numWalls[] = { 1000, 5000, 20000 };
+
+	for (int n : numWalls)
+	{
+		vector<glm::vec2> position(n), velocity(n), size(n);
+		vector<int> proxies(n), nearby;
+		SpatialHash spatialHash;
+		glm::vec2 player = glm::vec2(BENCH_WORLD_SIZE / 2), playerSize = glm::vec2(1.f);
+		long long found = 0, bruteFound = 0;
+
+		srand(n);
+		for (int i = 0; i < n; i++)
+		{
+			bool bVertical = rand() % 2 == 0;
+			position[i] = glm::vec2(rand() % BENCH_WORLD_SIZE, rand() % BENCH_WORLD_SIZE);
+			size[i] = bVertical ? glm::vec2(1.f, 4.f) : glm::vec2(4.f, 1.f);
+			velocity[i] = bVertical ? glm::vec2(0.f, 0.05f) : glm::vec2(0.05f, 0.f);
+			proxies[i] = spatialHash.insert(SpatialHash::WALL, i, position[i], position[i] + size[i]);
+		}
+
+		vector<glm::vec2> startPosition = position, startVelocity = velocity;
+
+		// Spatial hash, moving walls update their proxy
+		double start = Benchmark::now();
+		for (int frame = 0; frame < BENCH_FRAMES; frame++)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				position[i] += velocity[i];
+				if (position[i].x < 0 || position[i].y < 0 || position[i].x > BENCH_WORLD_SIZE || position[i].y > BENCH_WORLD_SIZE)
+					velocity[i] = -velocity[i];
+				spatialHash.update(proxies[i], position[i], position[i] + size[i]);
+			}
+			player.x = BENCH_WORLD_SIZE / 2 + 200 * sin(frame * 0.05f);
+			for (int q = 0; q < BENCH_QUERIES_PER_FRAME; q++)
+			{
+				spatialHash.query(SpatialHash::WALL, player - 1.f, player + playerSize + 1.f, nearby);
+				found += nearby.size();
+			}
+		}
+		bench.report("spatial_hash/hash/" + to_string(n), Benchmark::now() - start, BENCH_FRAMES);
+
+		// Brute force, the way the player used to check every wall
+		position = startPosition;
+		velocity = startVelocity;
+		start = Benchmark::now();
+		for (int frame = 0; frame < BENCH_FRAMES; frame++)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				position[i] += velocity[i];
+				if (position[i].x < 0 || position[i].y < 0 || position[i].x > BENCH_WORLD_SIZE || position[i].y > BENCH_WORLD_SIZE)
+					velocity[i] = -velocity[i];
+			}
+			player.x = BENCH_WORLD_SIZE / 2 + 200 * sin(frame * 0.05f);
+			for (int q = 0; q < BENCH_QUERIES_PER_FRAME; q++)
+				for (int i = 0; i < n; i++)
+				{
+					glm::vec2 minCorner = player - 1.f, maxCorner = player + playerSize + 1.f;
+					if (position[i].x < maxCorner.x && minCorner.x < position[i].x + size[i].x &&
+						position[i].y < maxCorner.y && minCorner.y < position[i].y + size[i].y)
+						bruteFound++;
+				}
+		}
+		bench.report("spatial_hash/brute/" + to_string(n), Benchmark::now() - start, BENCH_FRAMES);
+
+		// The hash returns candidates, never less than the real overlaps
+		if (found < bruteFound)
+			bench.fail("spatial_hash: the hash missed candidates");
+	}
+}
+
+
+// The same parallel-for with 1 to N threads. Every element does a bit of
+// math, like an entity update, so that the scaling and not the scheduling
+// overhead is what is measured.
+
+static void benchJobScaling(Benchmark& bench)
+{
+	int maxThreads = max(1, int(thread::hardware_concurrency()));
+	vector<float> values(BENCH_JOB_ELEMENTS);
+	double singleThread = 0.0;
+
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads++)
+	{
+		JobSystem::instance().init(numThreads - 1);
+
+		double start = Benchmark::now();
+		for (int iteration = 0; iteration < 10; iteration++)
+		{
+			JobSystem::instance().parallelFor(BENCH_JOB_ELEMENTS, BENCH_JOB_GRAIN, [&values, iteration](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					float x = float(i + iteration);
+					for (int k = 0; k < 32; k++)
+						x = sin(x) * 0.5f + cos(x * 0.25f);
+					values[i] = x;
+				}
+			});
+		}
+		double elapsed = Benchmark::now() - start;
+
+		if (numThreads == 1)
+			singleThread = elapsed;
+		bench.report("jobs/parallel_for/threads:" + to_string(numThreads), elapsed, 10);
+		cout << "  speedup " << fixed << setprecision(2) << singleThread / elapsed << "x" << endl;
+	}
+
+	JobSystem::instance().init();
+}
+
+
+// The software mixer with more and more looping voices, the last count
+// above the real voices so that some of them are virtual. The mix is
+// discarded, only the mixing is timed.
+
+static void benchAudioMix(Benchmark& bench)
+{
+	const int numVoices[] = { 1, 8, 32, 128 };
+	vector<float> frames(2 * MIXER_RATE);
+
+	for (unsigned int i = 0; i < frames.size(); i++)
+		frames[i] = 0.25f * sin(i * 0.01f);
+
+	for (int n : numVoices)
+	{
+		SoftwareMixer mixer;
+		mixer.init(n, 32);
+		AudioSound* sound = mixer.createSound(frames, true);
+		for (int v = 0; v < n; v++)
+			mixer.setVolume(mixer.play(sound, v % 256), 1.f / n);
+
+		double start = Benchmark::now();
+		for (int step = 0; step < BENCH_AUDIO_STEPS; step++)
+			mixer.update(BENCH_AUDIO_STEP);
+		double elapsed = Benchmark::now() - start;
+
+		const SoftwareMixer::Stats& stats = mixer.getStats();
+		bench.report("audio_mix/voices:" + to_string(n), elapsed, BENCH_AUDIO_STEPS);
+		cout << "  " << fixed << setprecision(3) << 1e6 * stats.mixTime / max(1LL, stats.voiceFrames) << " ns per voice frame, "
+			<< setprecision(2) << double(BENCH_AUDIO_STEPS * BENCH_AUDIO_STEP) / max(elapsed, 1e-6) << "x real time" << endl;
+
+		mixer.releaseSound(sound);
+		mixer.shutdown();
+	}
+}
+
+
+// Pools of 100 to 1M particles kept full, from the trail of the player
+// to the biggest fireworks: every frame integrates
+// them all and respawns the ones that died. The same work is done the way
+// the particles used to be stored, one struct per particle compacted by
+// copying, to see what the layout buys.
+
+static void benchParticles(Benchmark& bench)
+{
+	const int numParticles[] = { 100, 1000, 10000, 100000, 1000000 };
+
+	for (int n : numParticles)
+	{
+		ParticleSystem system(n);
+		ParticleSystem::Particle particle;
+		long long spawned = 0;
+
+		system.seed(n);
+		while (system.size() < n)
+		{
+			particle.lifetime = 0.5f + system.random();
+			particle.position = glm::vec3(system.random(), system.random(), 0.f);
+			particle.speed = glm::vec3(system.random() - 0.5f, system.random(), 0.f);
+			system.addParticle(particle);
+		}
+
+		double start = Benchmark::now();
+		for (int frame = 0; frame < BENCH_PARTICLE_FRAMES; frame++)
+		{
+			system.update(BENCH_PARTICLE_STEP);
+			while (system.size() < n)
+			{
+				particle.lifetime = 0.5f + system.random();
+				particle.position = glm::vec3(system.random(), system.random(), 0.f);
+				particle.speed = glm::vec3(system.random() - 0.5f, system.random(), 0.f);
+				system.addParticle(particle);
+				spawned++;
+			}
+		}
+		double elapsed = Benchmark::now() - start;
+		bench.report("particles/soa/" + to_string(n), elapsed, BENCH_PARTICLE_FRAMES);
+		cout << "  " << fixed << setprecision(2) << 1e6 * elapsed / (double(n) * BENCH_PARTICLE_FRAMES) << " ns per particle, "
+			<< spawned / BENCH_PARTICLE_FRAMES << " respawned per frame" << endl;
+
+		// Array of structs, growing with push_back and spawning with rand
+		vector<ParticleSystem::Particle> particles;
+		srand(n);
+		for (int i = 0; i < n; i++)
+		{
+			particle.lifetime = 0.5f + float(rand()) / RAND_MAX;
+			particle.position = glm::vec3(float(rand()) / RAND_MAX, float(rand()) / RAND_MAX, 0.f);
+			particle.speed = glm::vec3(float(rand()) / RAND_MAX - 0.5f, float(rand()) / RAND_MAX, 0.f);
+			particles.push_back(particle);
+		}
+
+		start = Benchmark::now();
+		for (int frame = 0; frame < BENCH_PARTICLE_FRAMES; frame++)
+		{
+			unsigned int j = 0;
+			for (unsigned int i = 0; i < particles.size(); i++)
+			{
+				particles[i].lifetime -= BENCH_PARTICLE_STEP;
+				if (particles[i].lifetime > 0.f)
+				{
+					particles[j] = particles[i];
+					particles[j].position += particles[j].speed * BENCH_PARTICLE_STEP;
+					j++;
+				}
+			}
+			particles.resize(j);
+			while (int(particles.size()) < n)
+			{
+				particle.lifetime = 0.5f + float(rand()) / RAND_MAX;
+				particle.position = glm::vec3(float(rand()) / RAND_MAX, float(rand()) / RAND_MAX, 0.f);
+				particle.speed = glm::vec3(float(rand()) / RAND_MAX - 0.5f, float(rand()) / RAND_MAX, 0.f);
+				particles.push_back(particle);
+			}
+		}
+		elapsed = Benchmark::now() - start;
+		bench.report("particles/aos/" + to_string(n), elapsed, BENCH_PARTICLE_FRAMES);
+	}
+}
+
+
+// Cases that need an OpenGL context share a small window, opened by the
+// first one; under Xvfb with Mesa llvmpipe they run headless.
+
+static int benchWindow = 0;
+
+static void openWindow()
+{
+	int argc = 1;
+	char name[] = "Comp3D", *argv[] = { name, NULL };
+
+	if (benchWindow != 0)
+		return;
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+	glutInitWindowSize(64, 64);
+	benchWindow = glutCreateWindow(argv[0]);
+	glewExperimental = GL_TRUE;
+	glewInit();
+}
+
+// The program the scene draws the level with, see Scene::initShaders
+
+static bool initTexProgram(ShaderProgram& program)
+{
+	Shader vShader, fShader;
+
+	openWindow();
+	vShader.initFromFile(VERTEX_SHADER, "shaders/texture.vert");
+	fShader.initFromFile(FRAGMENT_SHADER, "shaders/texture.frag");
+	if (!vShader.isCompiled() || !fShader.isCompiled())
+		return false;
+	program.init();
+	program.addShader(vShader);
+	program.addShader(fShader);
+	program.link();
+	vShader.free();
+	fShader.free();
+	if (!program.isLinked())
+		return false;
+	program.bindFragmentOutput("outColor");
+
+	return true;
+}
+
+
+// The same bursts on the CPU and on the GPU. This case needs an OpenGL
+// context. While the pool is not full both must keep exactly the same
+// particles, which makes it the test of the GPU path too.
+
+static void benchGpuParticles(Benchmark& bench)
+{
+	const int numParticles[] = { 100000, 1000000 };
+
+	openWindow();
+	if (!GpuParticleSystem::isSupported())
+	{
+		cout << "gpu_particles: skipped, " << glGetString(GL_RENDERER) << " cannot run them" << endl;
+		return;
+	}
+
+	for (int n : numParticles)
+	{
+		GpuParticleSystem gpu;
+		ParticleSystem cpu(n);
+		ParticleSystem::Particle particle;
+		bool bMatch = true;
+
+		if (!gpu.init(glm::vec2(0.3f, 0.3f), "images/original_particle.png", 6.f, 1.f, n))
+		{
+			bench.fail("gpu_particles: could not initialize");
+			break;
+		}
+
+		// A fifth of the pool every 20 frames, lifetimes short enough that it never fills
+		double gpuTime = 0, cpuTime = 0;
+		cpu.seed(n);
+		for (int frame = 0; frame < BENCH_PARTICLE_FRAMES; frame++)
+		{
+			if (frame % 20 == 0)
+				for (int i = 0; i < n / 5; i++)
+				{
+					particle.lifetime = 0.1f + 0.5f * cpu.random();
+					particle.position = glm::vec3(cpu.random(), cpu.random(), 0.f);
+					particle.speed = glm::vec3(cpu.random() - 0.5f, cpu.random(), 0.f);
+					cpu.addParticle(particle);
+					gpu.addParticle(particle);
+				}
+
+			double start = Benchmark::now();
+			cpu.update(BENCH_PARTICLE_STEP);
+			cpuTime += Benchmark::now() - start;
+
+			start = Benchmark::now();
+			gpu.update(BENCH_PARTICLE_STEP);
+			gpu.simulate();
+			glFinish();
+			gpuTime += Benchmark::now() - start;
+
+			if (frame % 20 == 19 && gpu.countParticles(true) != cpu.size())
+				bMatch = false;
+		}
+		bench.report("gpu_particles/gpu/" + to_string(n), gpuTime, BENCH_PARTICLE_FRAMES);
+		bench.report("gpu_particles/cpu/" + to_string(n), cpuTime, BENCH_PARTICLE_FRAMES);
+		if (!bMatch)
+			bench.fail("gpu_particles: the GPU and the CPU particles differ");
+	}
+}
+
+
+// Last level cache misses of the calling thread between start and stop.
+// Only Linux lets a process count them; elsewhere, or without permission,
+// stop returns -1.
+
+static int startCacheMisses()
+{
+#ifdef __linux__
+	perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	int counter = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+	if (counter >= 0)
+	{
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	return counter;
+#else
+	return -1;
+#endif
+}
+
+static long long stopCacheMisses(int counter)
+{
+	long long misses = -1;
+
+#ifdef __linux__
+	if (counter >= 0)
+	{
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counter, &misses, sizeof(misses)) != sizeof(misses))
+			misses = -1;
+		close(counter);
+	}
+#endif
+	return misses;
+}
+
+static void printCacheMisses(long long misses)
+{
+	if (misses < 0)
+		cout << "  cache misses n/a" << endl;
+	else
+		cout << "  " << misses / BENCH_FRAMES << " cache misses per frame" << endl;
+}
+
+
+// Walls, ball spikes and switchs the way they were stored before the
+// EntityStore: one object per entity, allocated next to its models and
+// reached through a vector of pointers.
+
+struct HeapSwitch
+{
+	void* models[2];
+	void* map;
+	glm::vec3 position, size;
+	bool activated;
+};
+
+struct HeapWall
+{
+	void* model;
+	void* map;
+	glm::vec3 position, prevPosition, size;
+	float velocity;
+	int followDist;
+	int state;
+	bool bVertical;
+	int type;
+	vector<int> nearby;
+};
+
+struct HeapBallSpike
+{
+	void* model;
+	void* map;
+	glm::vec3 position, prevPosition, size, axis;
+	float velocity;
+	int currentTime;
+	float stopTime;
+	int state;
+	bool bVertical;
+};
+
+// The old Wall::update in an open level
+
+static void updateHeapWall(HeapWall* wall, const EntitySystems::Context& context, const vector<HeapSwitch*>& switchs)
+{
+	wall->prevPosition = wall->position;
+
+	glm::vec2 centerPlayer = glm::vec2(context.posPlayer.x + context.sizePlayer.x / 2, context.posPlayer.y + context.sizePlayer.y / 2);
+	glm::vec2 centerWall = glm::vec2(wall->position.x + wall->size.x / 2, wall->position.y + wall->size.y / 2);
+
+	int distX = abs(centerPlayer.x - centerWall.x);
+	int distY = abs(centerPlayer.y - centerWall.y);
+	int distPlayer = wall->bVertical ? distX : distY;
+
+	if (distX > context.movementCamera.x + 2 || distY > context.movementCamera.y + 2)
+		wall->state = EntityStore::OUT;
+	else if (distPlayer > wall->followDist)
+	{
+		if (wall->state == EntityStore::FOLLOW)
+			wall->velocity *= 0.5;
+		else if (wall->state == EntityStore::OUT)
+			wall->velocity = 0.005;
+		wall->state = EntityStore::STATIC;
+	}
+	else
+	{
+		if (wall->state == EntityStore::STATIC)
+			wall->velocity *= 2;
+		else if (wall->state == EntityStore::OUT)
+			wall->velocity = 0.01;
+		wall->state = EntityStore::FOLLOW;
+	}
+	if (wall->state == EntityStore::OUT)
+		return;
+
+	int axis = wall->bVertical ? 1 : 0;
+	if (wall->state == EntityStore::FOLLOW)
+		wall->velocity = (centerPlayer[axis] < centerWall[axis]) ? -abs(wall->velocity) : abs(wall->velocity);
+
+	float margin = abs(context.deltaTime * wall->velocity) + 1.f;
+	context.spatialHash->query(SpatialHash::SWITCH, glm::vec2(wall->position) - margin, glm::vec2(wall->position + wall->size) + margin, wall->nearby);
+
+	for (int k = 0; k < wall->nearby.size(); ++k)
+	{
+		HeapSwitch* switx = switchs[wall->nearby[k]];
+		if (switx->activated && switx->position.x < wall->position.x + wall->size.x && wall->position.x < switx->position.x + switx->size.x &&
+			switx->position.y < wall->position.y + wall->size.y && wall->position.y < switx->position.y + switx->size.y)
+		{
+			if (switx->position[axis] < wall->position[axis])
+				wall->position[axis] += ceil(wall->position[axis]) - wall->position[axis];
+			else
+				wall->position[axis] -= (wall->position[axis] + wall->size[axis]) - floor(wall->position[axis] + wall->size[axis]);
+			if (wall->state == EntityStore::STATIC)
+				wall->velocity = -wall->velocity;
+		}
+	}
+
+	float delta = context.deltaTime * wall->velocity;
+	glm::vec2 minWall = glm::vec2(wall->position), maxWall = glm::vec2(wall->position + wall->size);
+	glm::vec2 movement(0.f), normal(0.f);
+	SweepHit hit;
+	float travel = 1.f;
+	bool bBounce = false;
+
+	movement[axis] = delta;
+	if (sweepAABB(minWall, maxWall, movement, context.posPlayer, context.posPlayer + context.sizePlayer, hit))
+		travel = hit.time;
+	for (int k = 0; k < wall->nearby.size(); ++k)
+	{
+		HeapSwitch* switx = switchs[wall->nearby[k]];
+		if (!switx->activated)
+			continue;
+		if (sweepAABB(minWall, maxWall, movement, glm::vec2(switx->position), glm::vec2(switx->position + switx->size), hit) && hit.time < travel)
+		{
+			travel = hit.time;
+			normal = hit.normal;
+			bBounce = true;
+		}
+	}
+	wall->position[axis] += delta * travel;
+	if (bBounce && wall->state == EntityStore::STATIC)
+		wall->velocity = normal[axis] * abs(wall->velocity);
+}
+
+// The old BallSpike::update in an open level
+
+static void updateHeapBallSpike(HeapBallSpike* ballSpike, const EntitySystems::Context& context)
+{
+	ballSpike->currentTime += context.deltaTime;
+	ballSpike->prevPosition = ballSpike->position;
+
+	int distX = abs(context.posPlayer.x - ballSpike->position.x);
+	int distY = abs(context.posPlayer.y - ballSpike->position.y);
+
+	if (distX > context.movementCamera.x + 2 || distY > context.movementCamera.y + 2)
+		ballSpike->state = EntityStore::OUT;
+	else if (ballSpike->stopTime >= 0)
+	{
+		ballSpike->stopTime -= context.deltaTime;
+		ballSpike->state = EntityStore::STATIC;
+	}
+	else
+		ballSpike->state = EntityStore::MOVE;
+
+	if (ballSpike->state == EntityStore::MOVE)
+		ballSpike->position[ballSpike->bVertical ? 1 : 0] += context.deltaTime * ballSpike->velocity;
+}
+
+// A stress level of 10k entities around the player, all of them in range.
+// The walls and ball spikes are updated the way the old classes did it and
+// by the entity systems, single threaded so that only the layout changes.
+// Both must end in the same place.
+
+static void benchEntities(Benchmark& bench)
+{
+	EntityStore store;
+	SpatialHash spatialHash;
+	EntitySystems::Context context;
+	vector<HeapWall*> heapWalls;
+	vector<HeapBallSpike*> heapBallSpikes;
+	vector<HeapSwitch*> heapSwitchs;
+	vector<char*> heapModels;
+	vector<int> wallIndices, ballSpikeIndices;
+	int modelVertical = store.addModelSize(glm::vec3(1.f, 4.f, 1.f)), modelHorizontal = store.addModelSize(glm::vec3(4.f, 1.f, 1.f));
+	int modelBall = store.addModelSize(glm::vec3(1.f)), modelSwitch = store.addModelSize(glm::vec3(1.f));
+
+	context.deltaTime = BENCH_ENTITY_STEP;
+	context.posPlayer = glm::vec2(BENCH_ENTITY_AREA / 2);
+	context.sizePlayer = glm::vec2(1.f);
+	context.movementCamera = glm::vec2(BENCH_ENTITY_AREA);
+	context.map = NULL;
+	context.spatialHash = &spatialHash;
+
+	// Every heap object gets a model allocated next to it, as the old classes did
+	srand(BENCH_ENTITIES);
+	for (int i = 0; i < BENCH_ENTITIES; i++)
+	{
+		glm::vec2 tile = glm::vec2(rand() % BENCH_ENTITY_AREA, rand() % BENCH_ENTITY_AREA);
+		bool bVertical = rand() % 2 == 0;
+		heapModels.push_back(new char[BENCH_ENTITY_MODEL_BYTES]);
+
+		if (i % 10 == 0)
+		{
+			HeapSwitch* switx = new HeapSwitch();
+			switx->position = glm::vec3(tile, 0.f);
+			switx->size = glm::vec3(1.f);
+			switx->activated = bVertical;
+			heapSwitchs.push_back(switx);
+			int index = store.addSwitch(tile, bVertical, modelSwitch, modelSwitch);
+			spatialHash.insert(SpatialHash::SWITCH, index, tile, tile + store.switchs.size[index]);
+		}
+		else if (i % 2 == 0)
+		{
+			int index = store.addWall(tile, bVertical, rand() % 3, bVertical ? modelVertical : modelHorizontal);
+			HeapWall* wall = new HeapWall();
+			wall->position = wall->prevPosition = glm::vec3(store.walls.position[index], 0.f);
+			wall->size = glm::vec3(store.walls.size[index], 1.f);
+			wall->velocity = store.walls.velocity[index];
+			wall->followDist = int(store.walls.followDist[index]);
+			wall->state = store.walls.state[index];
+			wall->bVertical = bVertical;
+			heapWalls.push_back(wall);
+			wallIndices.push_back(index);
+		}
+		else
+		{
+			int index = store.addBallSpike(tile, bVertical, modelBall);
+			HeapBallSpike* ballSpike = new HeapBallSpike();
+			ballSpike->position = ballSpike->prevPosition = glm::vec3(tile, 0.f);
+			ballSpike->size = glm::vec3(1.f);
+			ballSpike->velocity = store.ballSpikes.velocity[index];
+			ballSpike->currentTime = 0;
+			ballSpike->stopTime = 0;
+			ballSpike->state = EntityStore::STATIC;
+			ballSpike->bVertical = bVertical;
+			heapBallSpikes.push_back(ballSpike);
+			ballSpikeIndices.push_back(index);
+		}
+	}
+
+	int counter = startCacheMisses();
+	double start = Benchmark::now();
+	for (int frame = 0; frame < BENCH_FRAMES; frame++)
+	{
+		for (HeapWall* wall : heapWalls)
+			updateHeapWall(wall, context, heapSwitchs);
+		for (HeapBallSpike* ballSpike : heapBallSpikes)
+			updateHeapBallSpike(ballSpike, context);
+	}
+	double elapsed = Benchmark::now() - start;
+	long long misses = stopCacheMisses(counter);
+	bench.report("entities/heap/" + to_string(BENCH_ENTITIES), elapsed, BENCH_FRAMES);
+	printCacheMisses(misses);
+
+	counter = startCacheMisses();
+	start = Benchmark::now();
+	for (int frame = 0; frame < BENCH_FRAMES; frame++)
+	{
+		EntitySystems::updateWalls(store, context, wallIndices.data(), int(wallIndices.size()));
+		EntitySystems::updateBallSpikes(store, context, ballSpikeIndices.data(), int(ballSpikeIndices.size()));
+	}
+	elapsed = Benchmark::now() - start;
+	misses = stopCacheMisses(counter);
+	bench.report("entities/packed/" + to_string(BENCH_ENTITIES), elapsed, BENCH_FRAMES);
+	printCacheMisses(misses);
+
+	bool bMatch = true;
+	for (unsigned int i = 0; i < heapWalls.size(); i++)
+		if (glm::vec2(heapWalls[i]->position) != store.walls.position[i])
+			bMatch = false;
+	for (unsigned int i = 0; i < heapBallSpikes.size(); i++)
+		if (glm::vec2(heapBallSpikes[i]->position) != store.ballSpikes.position[i])
+			bMatch = false;
+	if (!bMatch)
+		bench.fail("entities: the packed entities moved differently");
+
+	for (HeapWall* wall : heapWalls)
+		delete wall;
+	for (HeapBallSpike* ballSpike : heapBallSpikes)
+		delete ballSpike;
+	for (HeapSwitch* switx : heapSwitchs)
+		delete switx;
+	for (char* model : heapModels)
+		delete[] model;
+}
+
+
+// Loading and tearing down a level made of a few thousand objects and a
+// big tile buffer, once with new and delete and once from the LevelArena.
+// Objects of the level are not all the same size, like models and entities.
+
+struct BenchLevelObject
+{
+	float data[BENCH_ARENA_OBJECT_FLOATS];
+	int size;
+
+	BenchLevelObject(int size) : size(size) { data[0] = float(size); }
+	~BenchLevelObject() { data[0] = 0.f; }
+};
+
+static void benchLevelArena(Benchmark& bench)
+{
+	vector<BenchLevelObject*> objects(BENCH_ARENA_OBJECTS);
+	vector<char*> buffers(BENCH_ARENA_OBJECTS);
+	LevelArena& arena = LevelArena::instance();
+
+	arena.reset();
+
+	double start = Benchmark::now();
+	for (int level = 0; level < BENCH_ARENA_LEVELS; level++)
+	{
+		char* tiles = new char[BENCH_ARENA_TILES];
+		for (int i = 0; i < BENCH_ARENA_OBJECTS; i++)
+		{
+			objects[i] = new BenchLevelObject(i);
+			buffers[i] = new char[16 + (i % 64) * 16];
+		}
+		for (int i = 0; i < BENCH_ARENA_OBJECTS; i++)
+		{
+			delete objects[i];
+			delete[] buffers[i];
+		}
+		delete[] tiles;
+	}
+	bench.report("level_arena/heap", Benchmark::now() - start, BENCH_ARENA_LEVELS);
+
+	start = Benchmark::now();
+	for (int level = 0; level < BENCH_ARENA_LEVELS; level++)
+	{
+		char* tiles = arena.createArray<char>(BENCH_ARENA_TILES);
+		for (int i = 0; i < BENCH_ARENA_OBJECTS; i++)
+		{
+			objects[i] = arena.create<BenchLevelObject>(i);
+			buffers[i] = arena.createArray<char>(16 + (i % 64) * 16);
+		}
+		if (tiles == NULL || arena.getStats().numObjects != BENCH_ARENA_OBJECTS)
+			bench.fail("level_arena: the objects of the level are missing");
+		arena.reset();
+	}
+	bench.report("level_arena/arena", Benchmark::now() - start, BENCH_ARENA_LEVELS);
+
+	LevelArena::Stats stats = arena.getStats();
+	cout << "  " << stats.numBlocks << " blocks (" << stats.reservedBytes / 1024 << " KB) kept for the next level" << endl;
+}
+
+
+// The game itself, as the main loop runs it without the simulation thread:
+// the first level loaded through Game and PlayGameState, one simulation
+// step and one frame drawn per loop, the space bar tapped every
+// BENCH_STEADY_TAP ms so that the player moves, bounces and dies. As with
+// --zero-alloc, once a level has warmed up not one of its frames may touch
+// the heap, and a level that starts again warms up again. The allocations
+// are only seen when the tracker is compiled in (Debug builds).
+
+static void benchSteadyState(Benchmark& bench)
+{
+	AllocationTracker& tracker = AllocationTracker::instance();
+	int numLevels = -1, warmupFrames = 0, numFrames = 0, numViolations;
+	bool bKeyDown = false;
+	double elapsed = 0.0;
+
+	if (!AllocationTracker::isEnabled())
+	{
+		cout << left << setw(40) << "steady_state" << right << setw(15) << "skipped" << endl;
+		cout << "  build with COMP3D_TRACK_ALLOCATIONS to count the allocations" << endl;
+		return;
+	}
+
+	// What Game::init does, without its second SoundManager::init
+	openWindow();
+	glEnable(GL_DEPTH_TEST);
+	SoundManager::instance().setBackend(new SoftwareMixer());
+	SoundManager::instance().init();
+	JobSystem::instance().init();
+	Game::instance().setBplay(true);
+	Game::instance().setInterpolation(1.f);
+	Game::instance().startGame(BENCH_STEADY_LEVEL);
+	PlayGameState::instance().setLastLevel(BENCH_STEADY_LEVEL);
+
+	numViolations = tracker.getStats().numViolations;
+	for (int step = 0; step < BENCH_STEADY_WARMUP + BENCH_STEADY_FRAMES; step++)
+	{
+		double start = Benchmark::now();
+
+		LevelArena::instance().beginFrame();
+		FrameScratch::instance().reset();
+		tracker.beginFrame();
+		int level = LevelArena::instance().getStats().numLevels;
+		if (level != numLevels)
+		{
+			numLevels = level;
+			warmupFrames = 0;
+			tracker.expectNoAllocations(false);
+		}
+		else if (++warmupFrames == BENCH_STEADY_WARMUP)
+			tracker.expectNoAllocations(true);
+		JobSystem::instance().runMainThreadJobs();
+
+		// Keys are released the step after they are pressed
+		if (bKeyDown)
+		{
+			Game::instance().keyReleased(' ');
+			bKeyDown = false;
+		}
+		else if (step * BENCH_STEADY_STEP % BENCH_STEADY_TAP < BENCH_STEADY_STEP)
+		{
+			Game::instance().keyPressed(' ');
+			bKeyDown = true;
+		}
+
+		// The level ended, what comes next is not the gameplay loop
+		if (!Game::instance().update(BENCH_STEADY_STEP) || !Game::instance().supportsSnapshots())
+			break;
+		Game::instance().render();
+		glutSwapBuffers();
+		Game::instance().framePresented();
+		RenderStats::instance().beginFrame();
+
+		if (warmupFrames >= BENCH_STEADY_WARMUP)
+		{
+			elapsed += Benchmark::now() - start;
+			numFrames++;
+		}
+	}
+	tracker.beginFrame();
+	tracker.expectNoAllocations(false);
+	bench.report("steady_state/frame", elapsed, numFrames);
+
+	numViolations = tracker.getStats().numViolations - numViolations;
+	cout << "  " << numViolations << " of " << numFrames << " frames allocated" << endl;
+	if (numViolations > 0)
+		bench.fail("steady_state: frames allocated after the warm-up");
+
+	LevelArena::instance().reset();
+}
+
+
+// Levels of the game are loaded from their text name, see Scene::init
+
+static string levelName(int level)
+{
+	return "level0" + to_string(level);
+}
+
+static string levelFile(int level)
+{
+	return "levels/" + levelName(level) + ".txt";
+}
+
+static bool findLevel(Benchmark& bench, int level)
+{
+	LevelFile file;
+
+	if (file.open(LevelFile::binaryPath(levelFile(level)), levelFile(level)) || file.open(levelFile(level)))
+		return true;
+	bench.fail("Could not open '" + levelFile(level) + "'");
+
+	return false;
+}
+
+// The previous level is freed first, as PlayGameState does
+
+static TileMap* loadLevel(int level, ShaderProgram& program)
+{
+	LevelArena::instance().reset();
+
+	return TileMap::createTileMap(levelFile(level), glm::vec2(0, 0), program);
+}
+
+// Tile maps need the texture program for their models, the jobs to parse
+// them and an audio backend for their sounds
+
+static bool initLevels(Benchmark& bench, ShaderProgram& program, const string& name)
+{
+	if (!initTexProgram(program))
+	{
+		bench.fail(name + ": could not build the shader program");
+		return false;
+	}
+	SoundManager::instance().setBackend(new NullAudioBackend());
+	SoundManager::instance().init();
+	JobSystem::instance().init();
+
+	return true;
+}
+
+
+// A level too big to be kept in memory, rooms of the size of the game ones
+// with a floor in each, so that the tile map pages it from disk
+
+static bool writeLargeLevel(const string& textFile)
+{
+	ofstream fout(textFile.c_str(), ios::out | ios::trunc);
+	string line(BENCH_LARGE_LEVEL_SIZE, ' ');
+
+	if (!fout.is_open())
+		return false;
+	fout << "TILEMAP" << endl;
+	fout << BENCH_LARGE_LEVEL_SIZE << " " << BENCH_LARGE_LEVEL_SIZE << endl;
+	fout << "20 15" << endl << "10 -7.5 18.1" << endl << "17 14" << endl << "5 6 0" << endl << "0" << endl;
+	for (int j = 0; j < BENCH_LARGE_LEVEL_SIZE; j++)
+	{
+		for (int i = 0; i < BENCH_LARGE_LEVEL_SIZE; i++)
+		{
+			bool bBorder = (i % 20 == 0 && j % 15 != 7) || (j % 15 == 0 && i % 20 != 10);
+			bool bFloor = j % 15 == 10 && i % 20 >= 4 && i % 20 < 12;
+			line[i] = (bBorder || bFloor) ? '1' : ' ';
+		}
+		fout << line << endl;
+	}
+
+	return fout.good();
+}
+
+// Every level of the game loaded as PlayGameState does, the tiles and the
+// entities from the binary file and the models of its style parsed by the
+// jobs and uploaded. Models are not shared between levels, every load
+// parses them again. A large synthetic level, written and converted for
+// the run, measures the paged tile maps.
+
+static void benchLevelLoad(Benchmark& bench)
+{
+	ShaderProgram program;
+
+	if (!initLevels(bench, program, "level_load"))
+		return;
+
+	for (int level = 1; level <= BENCH_LEVELS; level++)
+	{
+		double elapsed = 0;
+
+		if (!findLevel(bench, level))
+			continue;
+		for (int i = 0; i < BENCH_LEVEL_LOADS; i++)
+		{
+			LevelArena::instance().reset();
+			double start = Benchmark::now();
+			TileMap::createTileMap(levelFile(level), glm::vec2(0, 0), program);
+			elapsed += Benchmark::now() - start;
+		}
+		bench.report("level_load/" + levelName(level), elapsed, BENCH_LEVEL_LOADS);
+	}
+
+	string largeFile = BENCH_LARGE_LEVEL_FILE;
+	if (writeLargeLevel(largeFile) && LevelFile::convert(largeFile, LevelFile::binaryPath(largeFile)))
+	{
+		double elapsed = 0;
+
+		for (int i = 0; i < BENCH_LEVEL_LOADS; i++)
+		{
+			LevelArena::instance().reset();
+			double start = Benchmark::now();
+			TileMap::createTileMap(largeFile, glm::vec2(0, 0), program);
+			elapsed += Benchmark::now() - start;
+		}
+		bench.report("level_load/large_paged", elapsed, BENCH_LEVEL_LOADS);
+	}
+	else
+		bench.fail("level_load: could not write the large level");
+	LevelArena::instance().reset();
+	remove(largeFile.c_str());
+	remove(LevelFile::binaryPath(largeFile).c_str());
+
+	program.free();
+}
+
+
+// The collision tests of the tiles at every position of each level where
+// the box fits: the four axis tests, the sweeps both ways and the line
+// tests. The footprint of the player or a wall is one tile, the worst one
+// is a box as big as a room, whose columns and rows are long scans and
+// whose sweeps cross the whole room. They test as walls do (type 0), so
+// the level does not change; treatCollision runs on every tile they stop at.
+
+static void benchCollision(Benchmark& bench)
+{
+	ShaderProgram program;
+	SweepHit hit;
+
+	if (!initLevels(bench, program, "collision"))
+		return;
+
+	for (int level = 1; level <= BENCH_LEVELS; level++)
+	{
+		if (!findLevel(bench, level))
+			continue;
+		TileMap* map = loadLevel(level, program);
+
+		glm::ivec2 mapSize = map->getMapSize();
+		const struct
+		{
+			const char* name;
+			glm::ivec3 size;
+			float delta;
+		} footprints[] =
+		{
+			{ "tile", glm::ivec3(1, 1, 0), BENCH_COLLISION_DELTA },
+			{ "room", glm::ivec3(glm::ivec2(map->getRoomSize()), 0), map->getRoomSize().x },
+		};
+
+		for (const auto& footprint : footprints)
+		{
+			glm::vec3 size = glm::vec3(footprint.size);
+			long long numTests = 0, numHits = 0;
+
+			double start = Benchmark::now();
+			for (int pass = 0; pass < BENCH_COLLISION_PASSES; pass++)
+				for (int y = 0; y + footprint.size.y < mapSize.y; y++)
+					for (int x = 0; x + footprint.size.x < mapSize.x; x++)
+					{
+						glm::ivec3 pos(x, y, 0);
+						glm::vec3 linePos;
+
+						numHits += map->collisionMoveLeft(pos, footprint.size) + map->collisionMoveRight(pos, footprint.size);
+						numHits += map->collisionMoveUp(pos, footprint.size) + map->collisionMoveDown(pos, footprint.size);
+						numHits += map->sweepX(glm::vec3(pos), size, footprint.delta, hit) + map->sweepX(glm::vec3(pos), size, -footprint.delta, hit);
+						numHits += map->sweepY(glm::vec3(pos), size, footprint.delta, hit) + map->sweepY(glm::vec3(pos), size, -footprint.delta, hit);
+						linePos = glm::vec3(pos);
+						numHits += map->lineCollision(linePos, size, false);
+						linePos = glm::vec3(pos);
+						numHits += map->lineCollision(linePos, size, true);
+						numTests += 10;
+					}
+			double elapsed = Benchmark::now() - start;
+
+			if (numTests == 0)
+				continue;
+			bench.report("collision/" + levelName(level) + "/" + footprint.name, elapsed, BENCH_COLLISION_PASSES);
+			cout << "  " << fixed << setprecision(2) << 1e6 * elapsed / numTests << " ns per test, "
+				<< 100.0 * numHits / numTests << "% hit" << endl;
+		}
+	}
+
+	LevelArena::instance().reset();
+	program.free();
+}
+
+
+// Every model in models/, as listed by ModelBounds: read by Assimp, which
+// is initMesh, the materials and the vertex arrays, and then uploaded,
+// which is prepareArrays. The first is what the jobs do when a level
+// loads, the second what the main thread does.
+
+static void benchModels(Benchmark& bench)
+{
+	ShaderProgram program;
+	vector<string> modelFiles;
+
+	if (!initTexProgram(program))
+	{
+		bench.fail("models: could not build the shader program");
+		return;
+	}
+	ModelBounds::instance().load();
+	ModelBounds::instance().getModels(modelFiles);
+	if (modelFiles.empty())
+		bench.fail("models: no model in '" MODEL_BOUNDS_FILE "'");
+
+	for (const string& modelFile : modelFiles)
+	{
+		string name = modelFile.substr(modelFile.find_last_of('/') + 1);
+		double parseTime = 0, uploadTime = 0;
+		bool bParsed = true;
+
+		for (int i = 0; i < BENCH_MODEL_LOADS && bParsed; i++)
+		{
+			AssimpModel model;
+
+			double start = Benchmark::now();
+			bParsed = model.parseFile(modelFile);
+			double parsed = Benchmark::now();
+			model.upload(program);
+			glFinish();
+			parseTime += parsed - start;
+			uploadTime += Benchmark::now() - parsed;
+		}
+		if (!bParsed)
+		{
+			bench.fail("models: could not parse '" + modelFile + "'");
+			continue;
+		}
+		bench.report("models/parse/" + name, parseTime, BENCH_MODEL_LOADS);
+		bench.report("models/upload/" + name, uploadTime, BENCH_MODEL_LOADS);
+	}
+
+	program.free();
+}
+
+
+// What a frame costs to describe before anything is drawn: the matrix
+// chain of every tile around the player (TileMap::addToSnapshot), with
+// the player at each position of the level in turn.
+
+static void benchTileMatrices(Benchmark& bench)
+{
+	ShaderProgram program;
+	RenderSnapshot snapshot;
+
+	if (!initLevels(bench, program, "tile_matrices"))
+		return;
+
+	for (int level = 1; level <= BENCH_LEVELS; level++)
+	{
+		if (!findLevel(bench, level))
+			continue;
+		TileMap* map = loadLevel(level, program);
+
+		glm::ivec2 mapSize = map->getMapSize();
+		double start = Benchmark::now();
+		for (int y = 0; y < mapSize.y; y++)
+			for (int x = 0; x < mapSize.x; x++)
+			{
+				snapshot.clear();
+				map->addToSnapshot(snapshot, glm::ivec3(x, y, 0));
+			}
+		bench.report("tile_matrices/" + levelName(level), Benchmark::now() - start, mapSize.x * mapSize.y);
+	}
+
+	snapshot.clear();
+	LevelArena::instance().reset();
+	program.free();
+}
+
+
+// Billboards facing a camera that turns around them, both kinds. Every
+// render builds the quad on the CPU and updates its buffer before drawing.
+
+static void benchBillboards(Benchmark& bench)
+{
+	const struct
+	{
+		const char* name;
+		BillboardType type;
+	} kinds[] =
+	{
+		{ "y_axis", BILLBOARD_Y_AXIS },
+		{ "center", BILLBOARD_CENTER },
+	};
+	ShaderProgram program;
+
+	if (!initTexProgram(program))
+	{
+		bench.fail("billboards: could not build the shader program");
+		return;
+	}
+	program.use();
+
+	for (const auto& kind : kinds)
+	{
+		Billboard* billboard = Billboard::createBillboard(glm::vec2(0.3f, 0.3f), program, "images/original_particle.png", kind.type);
+
+		double start = Benchmark::now();
+		for (int i = 0; i < BENCH_BILLBOARDS; i++)
+		{
+			float angle = 0.001f * i;
+			glm::vec3 eye(10.f * sin(angle), 2.f, 10.f * cos(angle));
+			billboard->render(glm::vec3(i % 100, (i / 100) % 100, 0.f), eye);
+		}
+		glFinish();
+		bench.report(string("billboards/") + kind.name, Benchmark::now() - start, BENCH_BILLBOARDS);
+
+		billboard->free();
+		delete billboard;
+	}
+
+	program.free();
+}
+
+
+static const struct
+{
+	const char* name;
+	Benchmark::Case function;
+} cases[] =
+{
+	{ "spatial_hash", benchSpatialHash },
+	{ "jobs", benchJobScaling },
+	{ "audio_mix", benchAudioMix },
+	{ "particles", benchParticles },
+	{ "gpu_particles", benchGpuParticles },
+	{ "entities", benchEntities },
+	{ "level_arena", benchLevelArena },
+	{ "steady_state", benchSteadyState },
+	{ "level_load", benchLevelLoad },
+	{ "collision", benchCollision },
+	{ "models", benchModels },
+	{ "tile_matrices", benchTileMatrices },
+	{ "billboards", benchBillboards },
+};
+
+
+int Benchmark::run(const string& filter, const string& jsonFile)
+{
+	int numRun = 0;
+
+	for (const auto& c : cases)
+	{
+		if (string(c.name).compare(0, filter.size(), filter) != 0)
+			continue;
+		c.function(*this);
+		numRun++;
+	}
+
+	if (numRun == 0)
+	{
+		cerr << "No benchmark matches '" << filter << "'" << endl;
+		return 1;
+	}
+	if (benchWindow != 0)
+		glutDestroyWindow(benchWindow);
+	if (!jsonFile.empty() && !writeJson(jsonFile))
+	{
+		cerr << "Could not write '" << jsonFile << "'" << endl;
+		return 1;
+	}
+	return (numFailed == 0) ? 0 : 1;
+}
+
+void Benchmark::report(const string& name, double totalMs, int iterations)
+{
+	Result result;
+
+	// An average over nothing would be written as nan or inf
+	if (iterations <= 0 || !isfinite(totalMs))
+	{
+		fail(name + ": no valid iterations to report");
+		return;
+	}
+	result.name = name;
+	result.iterations = iterations;
+	result.ms = totalMs / iterations;
+	results.push_back(result);
+	cout << left << setw(40) << name << right << setw(12) << fixed << setprecision(4) << result.ms << " ms" << endl;
+}
+
+void Benchmark::fail(const string& message)
+{
+	cerr << message << endl;
+	failures.push_back(message);
+	numFailed++;
+}
+
+
+bool Benchmark::writeJson(const string& filename) const
+{
+	ofstream fout(filename.c_str(), ios::out | ios::trunc);
+
+	if (!fout.is_open())
+		return false;
+
+	fout << "{" << endl;
+	fout << "\t\"context\": {" << endl;
+	fout << "\t\t\"date\": " << time(NULL) << "," << endl;
+	fout << "\t\t\"num_cpus\": " << thread::hardware_concurrency() << "," << endl;
+#ifdef _DEBUG
+	fout << "\t\t\"library_build_type\": \"debug\"" << endl;
+#else
+	fout << "\t\t\"library_build_type\": \"release\"" << endl;
+#endif
+	fout << "\t}," << endl;
+
+	fout << "\t\"benchmarks\": [" << endl;
+	fout << setprecision(9);
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		fout << "\t\t{ \"name\": " << jsonString(results[i].name) << ", \"iterations\": " << results[i].iterations
+			<< ", \"real_time\": " << results[i].ms << ", \"time_unit\": \"ms\" }" << ((i + 1 < results.size()) ? "," : "") << endl;
+	}
+	fout << "\t]," << endl;
+
+	fout << "\t\"failures\": [" << endl;
+	for (unsigned int i = 0; i < failures.size(); i++)
+		fout << "\t\t" << jsonString(failures[i]) << ((i + 1 < failures.size()) ? "," : "") << endl;
+	fout << "\t]" << endl;
+	fout << "}" << endl;
+
+	return fout.good();
+}
+
+double Benchmark::now()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,68 @@
+#ifndef _BENCHMARK_INCLUDE
+#define _BENCHMARK_INCLUDE
+
+
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+
+// Benchmark runs the performance cases of the game from the command line
+// (Comp3D --bench [name]). Cases do not need a window, they exercise the
+// game systems with synthetic data and print the time per iteration.
+// Cases also check their results, and any failure makes the exit code 1.
+// The ones that need OpenGL (the GPU particles, levels, models and
+// billboards) open a small window.
+//
+// With --json file the results are also written as JSON, one entry per
+// line reported with its name, iterations and time per iteration, in the
+// layout of Google Benchmark so that runs of two releases can be compared.
+
+
+class Benchmark
+{
+
+private:
+	Benchmark() : numFailed(0) {}
+
+public:
+	typedef void (*Case)(Benchmark& bench);
+
+	static Benchmark& instance()
+	{
+		static Benchmark B;
+
+		return B;
+	}
+
+	// Runs every case whose name starts with filter, returns the exit code.
+	// The results go to jsonFile too unless it is empty.
+	int run(const string& filter, const string& jsonFile = "");
+
+	void report(const string& name, double totalMs, int iterations);
+	void fail(const string& message);
+
+	// Milliseconds from an arbitrary origin, with sub-microsecond resolution
+	static double now();
+
+private:
+	struct Result
+	{
+		string name;
+		int iterations;
+		double ms;						// Per iteration
+	};
+
+	bool writeJson(const string& filename) const;
+
+private:
+	vector<Result> results;
+	vector<string> failures;
+	int numFailed;
+
+};
+
+
+#endif // _BENCHMARK_INCLUDE
@@ -1,6 +1,7 @@
 #include <iostream>
-#include <vector>
 #include "Billboard.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
 
 
 Billboard *Billboard::createBillboard(const glm::vec2 &quadSize, ShaderProgram &program, const string &textureFile, BillboardType billboardType)
@@ -32,11 +33,11 @@ void Billboard::render(const glm::vec3 &position, const glm::vec3 &eye)
 	glEnable(GL_TEXTURE_2D);
 
 	texture.use();
-	glBindVertexArray(vao);
+	RenderStats::instance().bindVertexArray(vao);
 	glEnableVertexAttribArray(posLocation);
 	glEnableVertexAttribArray(normalLocation);
 	glEnableVertexAttribArray(texCoordLocation);
-	glDrawArrays(GL_QUADS, 0, 4);
+	RenderStats::instance().drawArrays(GL_QUADS, 0, 4);
 
 	glDisable(GL_TEXTURE_2D);
 }
@@ -45,43 +46,47 @@ void Billboard::free()
 {
 	glDeleteBuffers(1, &vbo);
 	glDeleteVertexArrays(1, &vao);
+	MemoryAccounting::instance().release(MemoryAccounting::PARTICLES, MemoryAccounting::GPU, texture.getFilename(), 32 * sizeof(float));
 }
 
 
 void Billboard::prepareArrays(ShaderProgram &program)
 {
-	vector<float> vertices;
+	float quad[32], *vertices = quad;
 
 	// Floor
-	vertices.push_back(-size.x / 2.f); vertices.push_back(0.f); vertices.push_back(0.f);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(1.f);
+	*vertices++ = -size.x / 2.f; *vertices++ = 0.f; *vertices++ = 0.f;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 1.f;
 
-	vertices.push_back(size.x / 2.f); vertices.push_back(0.f); vertices.push_back(0.f);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(1.f);
+	*vertices++ = size.x / 2.f; *vertices++ = 0.f; *vertices++ = 0.f;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 1.f;
 
-	vertices.push_back(size.x / 2.f); vertices.push_back(size.y); vertices.push_back(0.f);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(0.f);
+	*vertices++ = size.x / 2.f; *vertices++ = size.y; *vertices++ = 0.f;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 0.f;
 
-	vertices.push_back(-size.x / 2.f); vertices.push_back(size.y); vertices.push_back(0.f);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(0.f);
+	*vertices++ = -size.x / 2.f; *vertices++ = size.y; *vertices++ = 0.f;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 0.f;
 
 	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	RenderStats::instance().bindVertexArray(vao);
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 32 * sizeof(float), &vertices[0], GL_DYNAMIC_DRAW);
+	RenderStats::instance().bufferData(GL_ARRAY_BUFFER, 32 * sizeof(float), quad, GL_DYNAMIC_DRAW);
+	MemoryAccounting::instance().allocate(MemoryAccounting::PARTICLES, MemoryAccounting::GPU, texture.getFilename(), 32 * sizeof(float));
 	posLocation = program.bindVertexAttribute("position", 3, 8 * sizeof(float), 0);
 	normalLocation = program.bindVertexAttribute("normal", 3, 8 * sizeof(float), (void *)(3 * sizeof(float)));
 	texCoordLocation = program.bindVertexAttribute("texCoord", 2, 8 * sizeof(float), (void *)(6 * sizeof(float)));
 }
 
+// Called for every billboard drawn, the quad is built on the stack
+
 void Billboard::updateArrays(const glm::vec3 &position, const glm::vec3 &eye)
 {
-	vector<float> vertices;
+	float vertices[32];
 
 	switch (type)
 	{
@@ -92,39 +97,39 @@ void Billboard::updateArrays(const glm::vec3 &position, const glm::vec3 &eye)
 		prepareBillboardCenter(position, eye, vertices);
 		break;
 	}
-	glBindVertexArray(vao);
+	RenderStats::instance().bindVertexArray(vao);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, 32 * sizeof(float), &vertices[0]);
+	RenderStats::instance().bufferSubData(GL_ARRAY_BUFFER, 0, 32 * sizeof(float), vertices);
 }
 
-void Billboard::prepareBillboardYAxis(const glm::vec3 &position, const glm::vec3 &eye, vector<float> &vertices)
+void Billboard::prepareBillboardYAxis(const glm::vec3 &position, const glm::vec3 &eye, float *vertices)
 {
 	glm::vec3 xVector, P;
 
 	xVector = glm::normalize(glm::vec3(eye.z - position.z, 0.f, -(eye.x - position.x)));
 
 	P = position - size.x / 2.f * xVector - glm::vec3(0.f, size.y / 2.f, 0.f);
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(1.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 1.f;
 
 	P = position + size.x / 2.f * xVector - glm::vec3(0.f, size.y / 2.f, 0.f);
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(1.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 1.f;
 
 	P = position + size.x / 2.f * xVector + glm::vec3(0.f, size.y / 2.f, 0.f);
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(0.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 0.f;
 
 	P = position - size.x / 2.f * xVector + glm::vec3(0.f, size.y / 2.f, 0.f);
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(0.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 0.f;
 }
 
-void Billboard::prepareBillboardCenter(const glm::vec3 &position, const glm::vec3 &eye, vector<float> &vertices)
+void Billboard::prepareBillboardCenter(const glm::vec3 &position, const glm::vec3 &eye, float *vertices)
 {
 	glm::vec3 xVector, yVector, P;
 
@@ -132,24 +137,24 @@ void Billboard::prepareBillboardCenter(const glm::vec3 &position, const glm::vec
 	yVector = glm::normalize(glm::cross(eye - position, xVector));
 
 	P = position - size.x / 2.f * xVector - size.y / 2.f * yVector;
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(1.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 1.f;
 
 	P = position + size.x / 2.f * xVector - size.y / 2.f * yVector;
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(1.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 1.f;
 
 	P = position + size.x / 2.f * xVector + size.y / 2.f * yVector;
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(1.f); vertices.push_back(0.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 1.f; *vertices++ = 0.f;
 
 	P = position - size.x / 2.f * xVector + size.y / 2.f * yVector;
-	vertices.push_back(P.x); vertices.push_back(P.y); vertices.push_back(P.z);
-	vertices.push_back(0.f); vertices.push_back(0.f); vertices.push_back(1.f);
-	vertices.push_back(0.f); vertices.push_back(0.f);
+	*vertices++ = P.x; *vertices++ = P.y; *vertices++ = P.z;
+	*vertices++ = 0.f; *vertices++ = 0.f; *vertices++ = 1.f;
+	*vertices++ = 0.f; *vertices++ = 0.f;
 }
 
 void Billboard::setType(BillboardType billboardType)
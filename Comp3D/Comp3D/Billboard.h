@@ -36,8 +36,8 @@ private:
 	void prepareArrays(ShaderProgram &program);
 	void updateArrays(const glm::vec3 &position, const glm::vec3 &eye);
 
-	void prepareBillboardYAxis(const glm::vec3 &position, const glm::vec3 &eye, vector<float> &vertices);
-	void prepareBillboardCenter(const glm::vec3 &position, const glm::vec3 &eye, vector<float> &vertices);
+	void prepareBillboardYAxis(const glm::vec3 &position, const glm::vec3 &eye, float *vertices);
+	void prepareBillboardCenter(const glm::vec3 &position, const glm::vec3 &eye, float *vertices);
 
 private:
 	BillboardType type;
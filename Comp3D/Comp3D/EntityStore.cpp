@@ -0,0 +1,178 @@
+#include "EntityStore.h"
+#include "TileMap.h"
+#include "LevelArena.h"
+
+
+#define NUM_STYLES 5
+
+
+// Models of every style, in the order of TileMap::getStyle
+
+static const char* wallModels[NUM_STYLES][2] =
+{
+	{ "models/cube40_v.obj", "models/cube40_h.obj" },
+	{ "models/water_wall_v.obj", "models/water_wall_h.obj" },
+	{ "models/box_wall.obj", "models/box_wall_h.obj" },
+	{ "models/mario_wall_v.obj", "models/mario_wall_h.obj" },
+	{ "models/minecraft_wall_v.obj", "models/minecraft_wall_h.obj" }
+};
+
+static const char* ballSpikeModels[NUM_STYLES] =
+{
+	"models/ballSpike.obj",
+	"models/water_ballSpike.obj",
+	"models/box_ballSpike.obj",
+	"models/mario_ballSpike.obj",
+	"models/minecraft_ballSpike.obj"
+};
+
+static const char* switchModels[NUM_STYLES][2] =
+{
+	{ "models/switch_yes4.obj", "models/switch_no.obj" },
+	{ "models/water_switch_yes.obj", "models/water_switch_no.obj" },
+	{ "models/box_switch_yes.obj", "models/box_switch_no.obj" },
+	{ "models/mario_switch_yes.obj", "models/mario_switch_no.obj" },
+	{ "models/minecraft_switch_yes.obj", "models/minecraft_switch_no.obj" }
+};
+
+
+EntityStore::EntityStore()
+{
+}
+
+EntityStore::~EntityStore()
+{
+	clear();
+}
+
+
+void EntityStore::load(TileMap& map, ShaderProgram& program)
+{
+	int style = map.getStyle();
+
+	clear();
+
+	const vector<TileMap::Wall> &levelWalls = map.getWalls();
+	for (const TileMap::Wall& wall : levelWalls)
+		addWall(wall.position, wall.bVertical, wall.type, addModel(wallModels[style][wall.bVertical ? 0 : 1], program));
+
+	const vector<pair<bool, glm::vec2>> &levelBallSpikes = map.getBallSpikes();
+	for (const pair<bool, glm::vec2>& ballSpike : levelBallSpikes)
+		addBallSpike(ballSpike.second, ballSpike.first, addModel(ballSpikeModels[style], program));
+
+	const vector<tuple<bool, glm::vec2, int>> &levelButtons = map.getButtons();
+	for (const tuple<bool, glm::vec2, int>& button : levelButtons)
+		addButton(get<1>(button), get<2>(button), get<0>(button), addModel("models/button_up_pressed.obj", program), addModel("models/button_up.obj", program));
+
+	const vector<pair<bool, glm::vec2>> &levelSwitchs = map.getSwitchs();
+	for (const pair<bool, glm::vec2>& switx : levelSwitchs)
+		addSwitch(switx.second, switx.first, addModel(switchModels[style][0], program), addModel(switchModels[style][1], program));
+}
+
+void EntityStore::clear()
+{
+	walls = Walls();
+	ballSpikes = BallSpikes();
+	buttons = Buttons();
+	switchs = Switchs();
+
+	// The models belong to the level arena
+	models.clear();
+	modelSizes.clear();
+	modelHandles.clear();
+}
+
+
+int EntityStore::addModel(const string& file, ShaderProgram& program)
+{
+	unordered_map<string, int>::iterator it = modelHandles.find(file);
+
+	if (it != modelHandles.end())
+		return it->second;
+
+	AssimpModel* model = LevelArena::instance().create<AssimpModel>();
+	model->loadFromFile(file, program);
+	models.push_back(model);
+	modelSizes.push_back(model->getSize());
+	modelHandles[file] = int(models.size()) - 1;
+
+	return int(models.size()) - 1;
+}
+
+int EntityStore::addModelSize(const glm::vec3& size)
+{
+	models.push_back(NULL);
+	modelSizes.push_back(size);
+
+	return int(models.size()) - 1;
+}
+
+
+int EntityStore::addWall(const glm::vec2& tile, bool bVertical, int type, int model)
+{
+	glm::vec2 size = getModelSize(model);
+	glm::vec2 position;
+	const float followDist[] = { 4.f, 6.f, 8.f };
+
+	// Centered on the tile along its axis
+	if (bVertical)
+		position = glm::vec2(tile.x, tile.y - (size.y / 2) + 0.5);
+	else
+		position = glm::vec2(tile.x - (size.x / 2) + 0.5, tile.y);
+
+	walls.position.push_back(position);
+	walls.prevPosition.push_back(position);
+	walls.size.push_back(size);
+	walls.velocity.push_back(0.005f);
+	walls.followDist.push_back((type >= 0 && type <= 2) ? followDist[type] : 0.f);
+	walls.state.push_back(STATIC);
+	walls.bVertical.push_back(bVertical);
+	walls.type.push_back((unsigned char)type);
+	walls.model.push_back(model);
+
+	return walls.count() - 1;
+}
+
+int EntityStore::addBallSpike(const glm::vec2& tile, bool bVertical, int model)
+{
+	ballSpikes.position.push_back(tile);
+	ballSpikes.prevPosition.push_back(tile);
+	ballSpikes.size.push_back(getModelSize(model));
+	ballSpikes.velocity.push_back(0.005f);
+	ballSpikes.stopTime.push_back(0.f);
+	ballSpikes.time.push_back(0.f);
+	ballSpikes.state.push_back(STATIC);
+	ballSpikes.bVertical.push_back(bVertical);
+	ballSpikes.model.push_back(model);
+
+	return ballSpikes.count() - 1;
+}
+
+int EntityStore::addButton(const glm::vec2& tile, int orientation, bool bPressed, int modelPressed, int modelReleased)
+{
+	buttons.position.push_back(tile);
+	buttons.size.push_back(getModelSize(modelPressed));
+	buttons.orientation.push_back((unsigned char)orientation);
+	buttons.bPressed.push_back(bPressed);
+	buttons.modelPressed.push_back(modelPressed);
+	buttons.modelReleased.push_back(modelReleased);
+
+	return buttons.count() - 1;
+}
+
+int EntityStore::addSwitch(const glm::vec2& tile, bool bActivated, int modelOn, int modelOff)
+{
+	switchs.position.push_back(tile);
+	switchs.size.push_back(getModelSize(modelOn));
+	switchs.bActivated.push_back(bActivated);
+	switchs.modelOn.push_back(modelOn);
+	switchs.modelOff.push_back(modelOff);
+
+	return switchs.count() - 1;
+}
+
+
+glm::vec2 EntityStore::getModelSize(int model) const
+{
+	return glm::vec2(modelSizes[model]);
+}
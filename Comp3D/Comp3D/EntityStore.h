@@ -0,0 +1,129 @@
+#ifndef _ENTITY_STORE_INCLUDE
+#define _ENTITY_STORE_INCLUDE
+
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "AssimpModel.h"
+#include "ShaderProgram.h"
+
+
+using namespace std;
+
+
+class TileMap;
+
+
+// EntityStore keeps the walls, ball spikes, buttons and switchs of a level.
+// Every type is packed in its own arrays, one per component (position,
+// velocity, size, state and the model to draw), and an entity is just an
+// index into them. EntitySystems updates and draws them going through the
+// arrays in order, instead of following a pointer per entity.
+//
+// Models are render handles into a table where every file is loaded once,
+// so all the walls of a level share the same two models. They come from
+// the LevelArena and go away with the level.
+
+
+class EntityStore
+{
+
+public:
+	enum State
+	{
+		STATIC,
+		MOVE,							// Ball spikes rolling
+		FOLLOW,							// Walls chasing the player
+		OUT								// Too far from the player to be updated or drawn
+	};
+
+	struct Walls
+	{
+		vector<glm::vec2> position, prevPosition;	// Current and previous simulation step
+		vector<glm::vec2> size;
+		vector<float> velocity;
+		vector<float> followDist;
+		vector<unsigned char> state;
+		vector<unsigned char> bVertical;
+		vector<unsigned char> type;					// 2 stops the player even in god mode
+		vector<int> model;
+
+		int count() const { return int(position.size()); }
+	};
+
+	struct BallSpikes
+	{
+		vector<glm::vec2> position, prevPosition;
+		vector<glm::vec2> size;
+		vector<float> velocity;
+		vector<float> stopTime;						// ms left before it rolls again
+		vector<float> time;							// ms since the level started, spins the model
+		vector<unsigned char> state;
+		vector<unsigned char> bVertical;
+		vector<int> model;
+
+		int count() const { return int(position.size()); }
+	};
+
+	struct Buttons
+	{
+		vector<glm::vec2> position;
+		vector<glm::vec2> size;
+		vector<unsigned char> orientation;			// Side of the tile it is attached to
+		vector<unsigned char> bPressed;
+		vector<int> modelPressed, modelReleased;
+
+		int count() const { return int(position.size()); }
+	};
+
+	struct Switchs
+	{
+		vector<glm::vec2> position;
+		vector<glm::vec2> size;
+		vector<unsigned char> bActivated;
+		vector<int> modelOn, modelOff;
+
+		int count() const { return int(position.size()); }
+	};
+
+public:
+	EntityStore();
+	~EntityStore();
+
+	// Creates the entities of the level with the models of its style
+	void load(TileMap& map, ShaderProgram& program);
+	void clear();
+
+	// Returns the handle of the model, loading it only the first time
+	int addModel(const string& file, ShaderProgram& program);
+	const AssimpModel* getModel(int model) const { return models[model]; }
+
+	// tile is where the level file puts them, walls are centered on it
+	int addWall(const glm::vec2& tile, bool bVertical, int type, int model);
+	int addBallSpike(const glm::vec2& tile, bool bVertical, int model);
+	int addButton(const glm::vec2& tile, int orientation, bool bPressed, int modelPressed, int modelReleased);
+	int addSwitch(const glm::vec2& tile, bool bActivated, int modelOn, int modelOff);
+
+	// Only the size of the model, for entities that are never drawn (benchmarks)
+	int addModelSize(const glm::vec3& size);
+
+public:
+	Walls walls;
+	BallSpikes ballSpikes;
+	Buttons buttons;
+	Switchs switchs;
+
+private:
+	glm::vec2 getModelSize(int model) const;
+
+private:
+	vector<AssimpModel*> models;
+	vector<glm::vec3> modelSizes;
+	unordered_map<string, int> modelHandles;
+
+};
+
+
+#endif // _ENTITY_STORE_INCLUDE
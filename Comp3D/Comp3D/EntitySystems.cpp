@@ -0,0 +1,394 @@
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include "EntitySystems.h"
+#include "TileMap.h"
+#include "Sweep.h"
+#include "Profiler.h"
+
+
+#define PI 3.14159265358979323846
+#define NEARBY_CAPACITY 256 // Query results every thread has room for, any job can land on any thread
+
+
+void EntitySystems::updateWalls(EntityStore& store, const Context& context, const int* indices, int count)
+{
+	PROFILE_ZONE("EntitySystems::updateWalls");
+	EntityStore::Walls& walls = store.walls;
+	// Switchs around the wall being updated, one list per job
+	static thread_local vector<int> nearby;
+
+	nearby.reserve(NEARBY_CAPACITY);
+	glm::vec2 centerPlayer = context.posPlayer + context.sizePlayer / 2.f;
+
+	for (int k = 0; k < count; k++)
+	{
+		int i = indices[k];
+		glm::vec2& position = walls.position[i];
+		glm::vec2 size = walls.size[i];
+		float& velocity = walls.velocity[i];
+		unsigned char& state = walls.state[i];
+
+		walls.prevPosition[i] = position;
+
+		glm::vec2 centerWall = position + size / 2.f;
+
+		int distX = abs(centerPlayer.x - centerWall.x);
+		int distY = abs(centerPlayer.y - centerWall.y);
+
+		int distPlayer = walls.bVertical[i] ? distX : distY;
+
+		if (distX > context.movementCamera.x + 2 || distY > context.movementCamera.y + 2)
+		{
+			state = EntityStore::OUT;
+		}
+		else if (distPlayer > walls.followDist[i])
+		{
+			if (state == EntityStore::FOLLOW)
+				velocity *= 0.5;
+			else if (state == EntityStore::OUT)
+				velocity = 0.005;
+			state = EntityStore::STATIC;
+		}
+		else
+		{
+			if (state == EntityStore::STATIC)
+				velocity *= 2;
+			else if (state == EntityStore::OUT)
+				velocity = 0.01;
+			state = EntityStore::FOLLOW;
+		}
+
+		if (state == EntityStore::OUT)
+			continue;
+
+		// Following walls go towards the player
+		int axis = walls.bVertical[i] ? 1 : 0;
+		if (state == EntityStore::FOLLOW)
+			velocity = (centerPlayer[axis] < centerWall[axis]) ? -abs(velocity) : abs(velocity);
+
+		// Only the switchs around the wall can stop it
+		float margin = abs(context.deltaTime * velocity) + 1.f;
+		context.spatialHash->query(SpatialHash::SWITCH, position - margin, position + size + margin, nearby);
+
+		if (walls.bVertical[i])
+		{
+			glm::vec3 aux_size = glm::vec3(size.x - 0.0001, size.y, 0.f);
+			if (context.map != NULL && context.map->collisionMoveUp(glm::vec3(position, 0.f), aux_size))
+			{
+				position.y += ceil(position.y) - position.y;
+				if (state == EntityStore::STATIC)
+					velocity = abs(velocity);
+			}
+			else if (context.map != NULL && context.map->collisionMoveDown(glm::vec3(position, 0.f), aux_size))
+			{
+				position.y -= (position.y + size.y) - floor(position.y + size.y);
+				if (state == EntityStore::STATIC)
+					velocity = -abs(velocity);
+			}
+			for (int n : nearby) {
+				if (collideSwitch(store, i, n)) {
+					if (store.switchs.position[n].y < position.y)
+						position.y += ceil(position.y) - position.y;
+					else
+						position.y -= (position.y + size.y) - floor(position.y + size.y);
+					if (state == EntityStore::STATIC)
+						velocity = -velocity;
+				}
+			}
+
+			moveWall(store, i, context, context.deltaTime * velocity, aux_size, nearby);
+		}
+		else   //horizontal
+		{
+			glm::vec3 aux_size = glm::vec3(size.x, size.y - 0.0001, 0.f);
+			if (context.map != NULL && context.map->collisionMoveRight(glm::vec3(position, 0.f), aux_size))
+			{
+				position.x -= (position.x + size.x) - floor(position.x + size.x);
+				if (state == EntityStore::STATIC)
+					velocity = -abs(velocity);
+			}
+			else if (context.map != NULL && context.map->collisionMoveLeft(glm::vec3(position, 0.f), aux_size))
+			{
+				position.x += ceil(position.x) - position.x;
+				if (state == EntityStore::STATIC)
+					velocity = abs(velocity);
+			}
+			for (int n : nearby) {
+				if (collideSwitch(store, i, n)) {
+					if (store.switchs.position[n].x < position.x)
+						position.x += ceil(position.x) - position.x;
+					else
+						position.x -= (position.x + size.x) - floor(position.x + size.x);
+					if (state == EntityStore::STATIC)
+						velocity = -velocity;
+				}
+			}
+
+			moveWall(store, i, context, context.deltaTime * velocity, aux_size, nearby);
+		}
+	}
+}
+
+// Moves the wall along its axis until it touches a tile, an activated switch
+// or the player. Boxes are swept so a long frame cannot go through a tile.
+// Walls that are not following the player bounce against tiles and switchs.
+
+void EntitySystems::moveWall(EntityStore& store, int i, const Context& context, float delta, const glm::vec3& collisionSize, const vector<int>& nearby)
+{
+	EntityStore::Walls& walls = store.walls;
+	glm::vec2& position = walls.position[i];
+	int axis = walls.bVertical[i] ? 1 : 0;
+	glm::vec2 minWall = position, maxWall = position + walls.size[i];
+	glm::vec2 movement(0.f), normal(0.f);
+	SweepHit hit;
+	float travel = 1.f;
+	bool bBounce = false;
+
+	movement[axis] = delta;
+
+	// The player stops the wall without making it bounce
+	if (sweepAABB(minWall, maxWall, movement, context.posPlayer, context.posPlayer + context.sizePlayer, hit))
+		travel = hit.time;
+
+	for (int n : nearby) {
+		if (!store.switchs.bActivated[n])
+			continue;
+		glm::vec2 minSwitch = store.switchs.position[n];
+		if (sweepAABB(minWall, maxWall, movement, minSwitch, minSwitch + store.switchs.size[n], hit) && hit.time < travel) {
+			travel = hit.time;
+			normal = hit.normal;
+			bBounce = true;
+		}
+	}
+
+	if (context.map != NULL) {
+		glm::vec3 position3 = glm::vec3(position, 0.f);
+		bool bTile = walls.bVertical[i] ? context.map->sweepY(position3, collisionSize, delta * travel, hit) : context.map->sweepX(position3, collisionSize, delta * travel, hit);
+		if (bTile) {
+			travel *= hit.time;
+			normal = hit.normal;
+			bBounce = true;
+		}
+	}
+
+	position[axis] += delta * travel;
+	if (bBounce && walls.state[i] == EntityStore::STATIC)
+		walls.velocity[i] = normal[axis] * abs(walls.velocity[i]);
+}
+
+bool EntitySystems::collideSwitch(const EntityStore& store, int wall, int switx)
+{
+	if (!store.switchs.bActivated[switx])
+		return false;
+
+	glm::vec2 minSwitch = store.switchs.position[switx], maxSwitch = minSwitch + store.switchs.size[switx];
+	glm::vec2 minWall = store.walls.position[wall], maxWall = minWall + store.walls.size[wall];
+
+	return (minSwitch.x < maxWall.x && minWall.x < maxSwitch.x) && (minSwitch.y < maxWall.y && minWall.y < maxSwitch.y);
+}
+
+
+void EntitySystems::updateBallSpikes(EntityStore& store, const Context& context, const int* indices, int count)
+{
+	PROFILE_ZONE("EntitySystems::updateBallSpikes");
+	EntityStore::BallSpikes& ballSpikes = store.ballSpikes;
+	glm::vec3 aux_size = glm::vec3(1);
+
+	for (int k = 0; k < count; k++)
+	{
+		int i = indices[k];
+		glm::vec2& position = ballSpikes.position[i];
+		glm::vec2 size = ballSpikes.size[i];
+		float& velocity = ballSpikes.velocity[i];
+		float& stopTime = ballSpikes.stopTime[i];
+		unsigned char& state = ballSpikes.state[i];
+
+		ballSpikes.time[i] += context.deltaTime;
+		ballSpikes.prevPosition[i] = position;
+
+		int distX = abs(context.posPlayer.x - position.x);
+		int distY = abs(context.posPlayer.y - position.y);
+
+		if (distX > context.movementCamera.x + 2 || distY > context.movementCamera.y + 2)
+		{
+			state = EntityStore::OUT;
+		}
+		else if (stopTime >= 0)
+		{
+			stopTime -= context.deltaTime;
+			state = EntityStore::STATIC;
+		}
+		else
+		{
+			state = EntityStore::MOVE;
+		}
+
+		if (state != EntityStore::MOVE)
+			continue;
+
+		if (context.map != NULL)
+		{
+			glm::vec3 position3 = glm::vec3(position, 0.f);
+			if (ballSpikes.bVertical[i])
+			{
+				if (context.map->collisionMoveUp(position3, aux_size))
+				{
+					stopTime = 2000;
+					position.y += ceil(position.y) - position.y;
+					velocity = abs(velocity);
+				}
+				else if (context.map->collisionMoveDown(position3, aux_size))
+				{
+					stopTime = 2000;
+					position.y -= (position.y + size.y) - floor(position.y + size.y);
+					velocity = -abs(velocity);
+				}
+			}
+			else   //horizontal
+			{
+				if (context.map->collisionMoveRight(position3, aux_size))
+				{
+					stopTime = 2000;
+					position.x -= (position.x + size.x) - floor(position.x + size.x);
+					velocity = -abs(velocity);
+				}
+				else if (context.map->collisionMoveLeft(position3, aux_size))
+				{
+					stopTime = 2000;
+					position.x += ceil(position.x) - position.x;
+					velocity = abs(velocity);
+				}
+			}
+		}
+		moveBallSpike(store, i, context, context.deltaTime * velocity);
+	}
+}
+
+// Moves the ball along its axis with a swept box, so a long frame cannot
+// take it through a tile. When it hits one it stops for a while.
+
+void EntitySystems::moveBallSpike(EntityStore& store, int i, const Context& context, float delta)
+{
+	EntityStore::BallSpikes& ballSpikes = store.ballSpikes;
+	glm::vec2& position = ballSpikes.position[i];
+	int axis = ballSpikes.bVertical[i] ? 1 : 0;
+	glm::vec3 aux_size = glm::vec3(1);
+	SweepHit hit;
+
+	bool bTile = false;
+	if (context.map != NULL)
+	{
+		glm::vec3 position3 = glm::vec3(position, 0.f);
+		bTile = ballSpikes.bVertical[i] ? context.map->sweepY(position3, aux_size, delta, hit) : context.map->sweepX(position3, aux_size, delta, hit);
+	}
+	if (!bTile)
+	{
+		position[axis] += delta;
+		return;
+	}
+
+	position[axis] += delta * hit.time;
+	ballSpikes.stopTime[i] = 2000;
+	ballSpikes.velocity[i] = hit.normal[axis] * abs(ballSpikes.velocity[i]);
+}
+
+
+void EntitySystems::toggleSwitchs(EntityStore& store)
+{
+	for (unsigned char& bActivated : store.switchs.bActivated)
+		bActivated = !bActivated;
+}
+
+void EntitySystems::releaseButtons(EntityStore& store)
+{
+	for (unsigned char& bPressed : store.buttons.bPressed)
+		bPressed = false;
+}
+
+void EntitySystems::buttonBox(const EntityStore& store, int button, glm::vec2& minCorner, glm::vec2& maxCorner)
+{
+	glm::vec2 buttonSize = store.buttons.size[button];
+	int orientation = store.buttons.orientation[button];
+
+	if (orientation == 1 || orientation == 3)
+		buttonSize = glm::vec2(buttonSize.y, buttonSize.x);
+
+	minCorner = store.buttons.position[button];
+	if (orientation == 1)
+		minCorner.x += 0.5;
+	if (orientation == 0)
+		minCorner.y += 0.5;
+	maxCorner = minCorner + buttonSize;
+}
+
+
+void EntitySystems::addWallsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot, const int* indices, int count, float interpolation)
+{
+	const EntityStore::Walls& walls = store.walls;
+
+	for (int k = 0; k < count; k++)
+	{
+		int i = indices[k];
+		if (walls.state[i] == EntityStore::OUT)
+			continue;
+
+		glm::vec2 pos = glm::mix(walls.prevPosition[i], walls.position[i], interpolation);
+		glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(pos.x, -pos.y, 0));
+		snapshot.addModel(store.getModel(walls.model[i]), modelMatrix);
+	}
+}
+
+void EntitySystems::addBallSpikesToSnapshot(const EntityStore& store, RenderSnapshot& snapshot, const int* indices, int count, float interpolation)
+{
+	const EntityStore::BallSpikes& ballSpikes = store.ballSpikes;
+
+	for (int k = 0; k < count; k++)
+	{
+		int i = indices[k];
+		if (ballSpikes.state[i] == EntityStore::OUT)
+			continue;
+
+		const AssimpModel* model = store.getModel(ballSpikes.model[i]);
+		glm::vec2 pos = glm::mix(ballSpikes.prevPosition[i], ballSpikes.position[i], interpolation);
+		glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(pos.x, -pos.y, 0));
+
+		if (ballSpikes.state[i] == EntityStore::MOVE)
+		{
+			glm::vec3 axis = ballSpikes.bVertical[i] ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+			modelMatrix = glm::translate(modelMatrix, model->getCenter());
+			modelMatrix = glm::rotate(modelMatrix, (ballSpikes.time[i] * 0.01f), axis);
+			modelMatrix = glm::translate(modelMatrix, -model->getCenter());
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(snapshot.getView() * modelMatrix)));
+			snapshot.addModel(model, modelMatrix, normalMatrix);
+		}
+		else
+			snapshot.addModel(model, modelMatrix);
+	}
+}
+
+void EntitySystems::addButtonsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot)
+{
+	const EntityStore::Buttons& buttons = store.buttons;
+
+	for (int i = 0; i < buttons.count(); i++)
+	{
+		glm::mat4 modelMatrix;
+		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(buttons.position[i].x, -buttons.position[i].y, 0));
+		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, 0.5));
+		modelMatrix = glm::rotate(modelMatrix, float((PI / 2.0f) * buttons.orientation[i]), glm::vec3(0, 0, 1));
+		modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, -0.5));
+
+		snapshot.addModel(store.getModel(buttons.bPressed[i] ? buttons.modelPressed[i] : buttons.modelReleased[i]), modelMatrix);
+	}
+}
+
+void EntitySystems::addSwitchsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot)
+{
+	const EntityStore::Switchs& switchs = store.switchs;
+
+	for (int i = 0; i < switchs.count(); i++)
+	{
+		glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(switchs.position[i].x, -switchs.position[i].y, 0));
+		snapshot.addModel(store.getModel(switchs.bActivated[i] ? switchs.modelOn[i] : switchs.modelOff[i]), modelMatrix);
+	}
+}
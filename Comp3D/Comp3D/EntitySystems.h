@@ -0,0 +1,68 @@
+#ifndef _ENTITY_SYSTEMS_INCLUDE
+#define _ENTITY_SYSTEMS_INCLUDE
+
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "EntityStore.h"
+#include "SpatialHash.h"
+#include "RenderSnapshot.h"
+
+
+using namespace std;
+
+
+class TileMap;
+
+
+// EntitySystems is the behaviour of the entities of an EntityStore. Every
+// system goes through the arrays of one type in order. Updates take a
+// list of indices, sorted, so that only the active entities are visited
+// and the list can be split between jobs: an entity only writes its own
+// components and reads the others.
+//
+// Walls follow the player along their axis when it comes close and
+// otherwise bounce between tiles and activated switchs. Ball spikes roll
+// along their axis and stop for a while every time they hit a tile.
+//
+// Without a tile map the level is open space, nothing but the entities
+// and the player stops them.
+
+
+class EntitySystems
+{
+
+public:
+	struct Context
+	{
+		int deltaTime;
+		glm::vec2 posPlayer, sizePlayer;
+		glm::vec2 movementCamera;			// Entities further than this (plus 2 tiles) are OUT
+		TileMap* map;
+		const SpatialHash* spatialHash;
+	};
+
+	static void updateWalls(EntityStore& store, const Context& context, const int* indices, int count);
+	static void updateBallSpikes(EntityStore& store, const Context& context, const int* indices, int count);
+
+	// What the player does when it presses a button
+	static void toggleSwitchs(EntityStore& store);
+	static void releaseButtons(EntityStore& store);
+
+	// Buttons are thinner than a tile and stick to the side they are attached to
+	static void buttonBox(const EntityStore& store, int button, glm::vec2& minCorner, glm::vec2& maxCorner);
+
+	static void addWallsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot, const int* indices, int count, float interpolation);
+	static void addBallSpikesToSnapshot(const EntityStore& store, RenderSnapshot& snapshot, const int* indices, int count, float interpolation);
+	static void addButtonsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot);
+	static void addSwitchsToSnapshot(const EntityStore& store, RenderSnapshot& snapshot);
+
+private:
+	static void moveWall(EntityStore& store, int i, const Context& context, float delta, const glm::vec3& collisionSize, const vector<int>& nearby);
+	static bool collideSwitch(const EntityStore& store, int wall, int switx);
+	static void moveBallSpike(EntityStore& store, int i, const Context& context, float delta);
+
+};
+
+
+#endif // _ENTITY_SYSTEMS_INCLUDE
@@ -0,0 +1,39 @@
+#include <cstddef>
+#include "EventBus.h"
+
+
+EventBus::EventBus()
+{
+	events.reserve(EVENT_BUS_CAPACITY);
+}
+
+
+void EventBus::emit(GameEvent::Type type, int tile, int index)
+{
+	GameEvent event;
+
+	event.type = type;
+	event.sound = NULL;
+	event.volume = 0.f;
+	event.tile = tile;
+	event.index = index;
+	events.push_back(event);
+}
+
+void EventBus::playSound(AudioSound* sound, float volume)
+{
+	GameEvent event;
+
+	event.type = GameEvent::SOUND;
+	event.sound = sound;
+	event.volume = volume;
+	event.tile = -1;
+	event.index = -1;
+	events.push_back(event);
+}
+
+void EventBus::clear()
+{
+	// Keeps the capacity, the same buffer is filled every step
+	events.clear();
+}
@@ -0,0 +1,69 @@
+#ifndef _EVENT_BUS_INCLUDE
+#define _EVENT_BUS_INCLUDE
+
+
+#include <vector>
+
+
+using namespace std;
+
+
+#define EVENT_BUS_CAPACITY 64			// Events of a step before the buffer grows
+
+
+struct AudioSound;
+
+
+// GameEvent is what gameplay code reports instead of acting on it. It is
+// plain data, so events can be copied, recorded or thrown away for free.
+
+struct GameEvent
+{
+	enum Type
+	{
+		SOUND,							// sound played at volume
+		DEATH,							// The player touched a spike
+		CHECKPOINT,						// tile is the new checkpoint
+		KEY,							// tile held the key, the doors are open
+		BUTTON,							// index is the button pressed
+		LEVEL_END						// The final block was taken
+	};
+
+	Type type;
+	AudioSound* sound;
+	float volume;
+	int tile;							// Position in the tile map, -1 if none
+	int index;							// Entity, -1 if none
+};
+
+
+// EventBus collects the events of a simulation step. Collisions and the
+// player only append to it, which is cheap enough for their inner loops,
+// and the scene dispatches the whole batch once the step is over: the
+// sounds are played, the player dies or the level ends. Repeated events
+// (two spikes hit in the same step) are merged when dispatched.
+//
+// Whoever does not want the side effects, like a headless run, can read
+// the events of the step and clear them without dispatching.
+
+
+class EventBus
+{
+
+public:
+	EventBus();
+
+	void emit(GameEvent::Type type, int tile = -1, int index = -1);
+	void playSound(AudioSound* sound, float volume = 1.f);
+
+	const vector<GameEvent>& getEvents() const { return events; }
+	bool empty() const { return events.empty(); }
+	void clear();
+
+private:
+	vector<GameEvent> events;
+
+};
+
+
+#endif // _EVENT_BUS_INCLUDE
@@ -0,0 +1,153 @@
+#ifndef COMP3D_NO_FMOD
+
+
+#include <stdio.h>
+#include "FmodBackend.h"
+
+
+FmodBackend::FmodBackend()
+{
+	system = NULL;
+}
+
+
+bool FmodBackend::init(int maxVoices, int realVoices)
+{
+	FMOD_RESULT result;
+
+	result = FMOD::System_Create(&system);      // Create the main system object.
+	if (result != FMOD_OK)
+	{
+		printf("FMOD error! (%d) %s\n", result, FMOD_ErrorString(result));
+		system = NULL;
+		return false;
+	}
+
+	system->setSoftwareChannels(realVoices);
+	result = system->init(maxVoices, FMOD_INIT_VOL0_BECOMES_VIRTUAL, 0);    // Initialize FMOD.
+	if (result != FMOD_OK)
+	{
+		printf("FMOD error! (%d) %s\n", result, FMOD_ErrorString(result));
+		system->release();
+		system = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+void FmodBackend::shutdown()
+{
+	if (system != NULL)
+		system->release();
+	system = NULL;
+}
+
+void FmodBackend::update(int deltaTime)
+{
+	system->update();
+}
+
+
+AudioSound* FmodBackend::createSound(const string& file, bool bStream, bool bLoop)
+{
+	FMOD_MODE mode = (bLoop ? FMOD_LOOP_NORMAL : FMOD_DEFAULT) | FMOD_NONBLOCKING;
+	FMOD::Sound* sound = NULL;
+
+	mode |= bStream ? FMOD_CREATESTREAM : FMOD_CREATESAMPLE;
+	if (system->createSound(file.c_str(), mode, NULL, &sound) != FMOD_OK)
+		return NULL;
+
+	FmodSound* fmodSound = new FmodSound();
+	fmodSound->sound = sound;
+	fmodSound->bStream = bStream;
+
+	return fmodSound;
+}
+
+void FmodBackend::releaseSound(AudioSound* sound)
+{
+	FmodSound* fmodSound = static_cast<FmodSound*>(sound);
+
+	fmodSound->sound->release();
+	delete fmodSound;
+}
+
+AudioBackend::State FmodBackend::getState(AudioSound* sound)
+{
+	FMOD_OPENSTATE state;
+
+	if (static_cast<FmodSound*>(sound)->sound->getOpenState(&state, NULL, NULL, NULL) != FMOD_OK)
+		return FAILED;
+	// A stream that is playing is ready too
+	if (state == FMOD_OPENSTATE_READY || state == FMOD_OPENSTATE_PLAYING)
+		return READY;
+	if (state == FMOD_OPENSTATE_ERROR)
+		return FAILED;
+	return LOADING;
+}
+
+unsigned int FmodBackend::getSampleBytes(AudioSound* sound)
+{
+	FmodSound* fmodSound = static_cast<FmodSound*>(sound);
+	unsigned int bytes;
+
+	if (fmodSound->bStream || getState(sound) != READY || fmodSound->sound->getLength(&bytes, FMOD_TIMEUNIT_PCMBYTES) != FMOD_OK)
+		return 0;
+	return bytes;
+}
+
+
+AudioVoice FmodBackend::play(AudioSound* sound, int priority)
+{
+	FMOD::Channel* channel = NULL;
+
+	// Started paused so that it never plays a sample at the default priority
+	if (system->playSound(static_cast<FmodSound*>(sound)->sound, NULL, true, &channel) != FMOD_OK)
+		return 0;
+	channel->setPriority(priority);
+	channel->setPaused(false);
+
+	return reinterpret_cast<AudioVoice>(channel);
+}
+
+void FmodBackend::stop(AudioVoice voice)
+{
+	if (voice != 0)
+		channelOf(voice)->stop();
+}
+
+void FmodBackend::setVolume(AudioVoice voice, float volume)
+{
+	if (voice != 0)
+		channelOf(voice)->setVolume(volume);
+}
+
+bool FmodBackend::isPlaying(AudioVoice voice)
+{
+	bool bPlaying = false;
+
+	// Handles of finished voices are not valid any more, that is not playing either
+	if (voice == 0 || channelOf(voice)->isPlaying(&bPlaying) != FMOD_OK)
+		return false;
+	return bPlaying;
+}
+
+
+void FmodBackend::getVoices(int& numVoices, int& numRealVoices)
+{
+	if (system->getChannelsPlaying(&numVoices, &numRealVoices) != FMOD_OK)
+		numVoices = numRealVoices = 0;
+}
+
+int FmodBackend::getMemoryBytes()
+{
+	int current, max;
+
+	if (FMOD::Memory_GetStats(&current, &max, false) != FMOD_OK)
+		return 0;
+	return current;
+}
+
+
+#endif // COMP3D_NO_FMOD
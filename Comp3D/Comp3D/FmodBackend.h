@@ -0,0 +1,55 @@
+#ifndef _FMOD_BACKEND_INCLUDE
+#define _FMOD_BACKEND_INCLUDE
+
+
+#include "fmod.hpp"
+#include "fmod_errors.h"
+#include "AudioBackend.h"
+
+
+// FmodBackend plays the sounds with FMOD. Sounds open with
+// FMOD_NONBLOCKING, effects are decoded samples and streams are
+// FMOD_CREATESTREAM. FMOD chooses the virtual voices by priority and
+// volume, and voices at volume 0 become virtual.
+
+
+class FmodBackend : public AudioBackend
+{
+
+public:
+	FmodBackend();
+
+	bool init(int maxVoices, int realVoices);
+	void shutdown();
+	void update(int deltaTime);
+
+	AudioSound* createSound(const string& file, bool bStream, bool bLoop);
+	void releaseSound(AudioSound* sound);
+	State getState(AudioSound* sound);
+	unsigned int getSampleBytes(AudioSound* sound);
+
+	AudioVoice play(AudioSound* sound, int priority);
+	void stop(AudioVoice voice);
+	void setVolume(AudioVoice voice, float volume);
+	bool isPlaying(AudioVoice voice);
+
+	void getVoices(int& numVoices, int& numRealVoices);
+	int getMemoryBytes();
+
+private:
+	struct FmodSound : public AudioSound
+	{
+		FMOD::Sound* sound;
+		bool bStream;
+	};
+
+	// FMOD channels are already handles that FMOD validates
+	static FMOD::Channel* channelOf(AudioVoice voice) { return reinterpret_cast<FMOD::Channel*>(voice); }
+
+private:
+	FMOD::System* system;
+
+};
+
+
+#endif // _FMOD_BACKEND_INCLUDE
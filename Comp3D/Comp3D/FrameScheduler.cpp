@@ -0,0 +1,155 @@
+#include <GL/glew.h>
+#ifdef _WIN32
+#include <GL/wglew.h>
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <GL/glxew.h>
+#endif
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include "FrameScheduler.h"
+
+
+using namespace std;
+
+
+FrameScheduler::FrameScheduler()
+{
+	framePeriod = 0.0;
+	nextDeadline = lastFrameStart = 0.0;
+	bUncapped = bVsync = false;
+	bTimerPeriod = false;
+	numSamples = nextSample = 0;
+}
+
+FrameScheduler::~FrameScheduler()
+{
+#ifdef _WIN32
+	if (bTimerPeriod)
+		timeEndPeriod(1);
+#endif
+}
+
+
+void FrameScheduler::init(double framesPerSecond)
+{
+#ifdef _WIN32
+	// By default Windows sleeps in steps of 15.6 ms
+	if (!bTimerPeriod)
+		bTimerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+	framePeriod = 1000.0 / framesPerSecond;
+	lastFrameStart = now();
+	nextDeadline = lastFrameStart + framePeriod;
+	numSamples = nextSample = 0;
+}
+
+void FrameScheduler::setUncapped(bool b)
+{
+	bUncapped = b;
+}
+
+bool FrameScheduler::setVsync(bool b)
+{
+#ifdef _WIN32
+	if (!WGLEW_EXT_swap_control)
+		return false;
+	wglSwapIntervalEXT(b ? 1 : 0);
+#else
+	if (GLXEW_EXT_swap_control)
+		glXSwapIntervalEXT(glXGetCurrentDisplay(), glXGetCurrentDrawable(), b ? 1 : 0);
+	else if (GLXEW_MESA_swap_control)
+		glXSwapIntervalMESA(b ? 1 : 0);
+	else
+		return false;
+#endif
+	bVsync = b;
+
+	return true;
+}
+
+
+double FrameScheduler::waitNextFrame()
+{
+	double workEnd = now();
+	double busy = workEnd - lastFrameStart;
+
+	if (!bUncapped && !bVsync)
+	{
+		// After a long frame start again from now instead of rushing
+		// several frames to catch up
+		if (nextDeadline < workEnd - framePeriod)
+			nextDeadline = workEnd;
+		sleepUntil(nextDeadline);
+		nextDeadline += framePeriod;
+	}
+
+	double frameStart = now();
+	double frameTime = frameStart - lastFrameStart;
+
+	frameTimes[nextSample] = frameTime;
+	busyTimes[nextSample] = busy;
+	nextSample = (nextSample + 1) % FRAME_STATS_WINDOW;
+	if (numSamples < FRAME_STATS_WINDOW)
+		numSamples++;
+	lastFrameStart = frameStart;
+
+	return frameTime;
+}
+
+
+double FrameScheduler::getCpuUtilisation() const
+{
+	double busy = 0.0, total = 0.0;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		busy += busyTimes[i];
+		total += frameTimes[i];
+	}
+
+	return (total > 0.0) ? busy / total : 0.0;
+}
+
+double FrameScheduler::getJitter() const
+{
+	double average = getAverageFrameTime(), variance = 0.0;
+
+	if (numSamples == 0)
+		return 0.0;
+	for (int i = 0; i < numSamples; i++)
+		variance += (frameTimes[i] - average) * (frameTimes[i] - average);
+
+	return sqrt(variance / numSamples);
+}
+
+double FrameScheduler::getAverageFrameTime() const
+{
+	double total = 0.0;
+
+	if (numSamples == 0)
+		return 0.0;
+	for (int i = 0; i < numSamples; i++)
+		total += frameTimes[i];
+
+	return total / numSamples;
+}
+
+
+double FrameScheduler::now()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameScheduler::sleepUntil(double deadline)
+{
+	// Sleeping can overshoot by about a timer tick, the end is spent yielding
+	double remaining = deadline - now();
+
+	if (remaining > FRAME_SPIN_MARGIN)
+		this_thread::sleep_for(chrono::microseconds((long long)((remaining - FRAME_SPIN_MARGIN) * 1000.0)));
+	while (now() < deadline)
+		this_thread::yield();
+}
@@ -0,0 +1,58 @@
+#ifndef _FRAME_SCHEDULER_INCLUDE
+#define _FRAME_SCHEDULER_INCLUDE
+
+
+#define FRAME_SPIN_MARGIN 1.5		// ms before a deadline spent yielding instead of sleeping
+#define FRAME_STATS_WINDOW 120		// Frames used for the statistics
+
+
+// FrameScheduler paces the main loop. Instead of polling the clock it
+// sleeps until the next frame is due, and only the last FRAME_SPIN_MARGIN
+// milliseconds are spent yielding to hit the deadline precisely. With vsync
+// the buffer swap already blocks, so it only measures. Uncapped mode never
+// waits, it is meant for benchmarks.
+//
+// It keeps the CPU utilisation (time working / frame time) and the jitter
+// (standard deviation of the frame time) of the last frames.
+
+
+class FrameScheduler
+{
+
+public:
+	FrameScheduler();
+	~FrameScheduler();
+
+	void init(double framesPerSecond);
+
+	void setUncapped(bool b);
+	// Needs a current OpenGL context, returns false if the driver cannot do it
+	bool setVsync(bool b);
+
+	// Waits until the next frame is due and returns the time since the
+	// previous one in ms
+	double waitNextFrame();
+
+	double getCpuUtilisation() const;
+	double getJitter() const;
+	double getAverageFrameTime() const;
+
+	// Monotonic clock in ms with sub-microsecond resolution
+	static double now();
+
+private:
+	void sleepUntil(double deadline);
+
+private:
+	double framePeriod;
+	double nextDeadline, lastFrameStart;
+	bool bUncapped, bVsync;
+	bool bTimerPeriod;
+
+	double frameTimes[FRAME_STATS_WINDOW], busyTimes[FRAME_STATS_WINDOW];
+	int numSamples, nextSample;
+
+};
+
+
+#endif // _FRAME_SCHEDULER_INCLUDE
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "FrameScratch.h"
+
+
+FrameScratch::FrameScratch()
+{
+	buffer.resize(FRAME_SCRATCH_SIZE);
+	used = 0;
+	peak = 0;
+}
+
+FrameScratch::~FrameScratch()
+{
+	reset();
+}
+
+
+void* FrameScratch::allocate(size_t bytes, size_t alignment)
+{
+	uintptr_t start = uintptr_t(buffer.data()) + used;
+	uintptr_t aligned = (start + alignment - 1) & ~uintptr_t(alignment - 1);
+	size_t end = used + (aligned - start) + bytes;
+
+	if (end <= buffer.size())
+	{
+		used = end;
+		peak = max(peak, used);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// Counted as if it fitted, so that the next reset makes room for it
+	used += bytes + alignment;
+	peak = max(peak, used);
+
+	void* memory = malloc(bytes + alignment);
+	if (memory == NULL)
+		throw bad_alloc();
+	overflow.push_back(memory);
+	aligned = (uintptr_t(memory) + alignment - 1) & ~uintptr_t(alignment - 1);
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+void FrameScratch::reset()
+{
+	for (void* memory : overflow)
+		free(memory);
+	overflow.clear();
+
+	if (peak > buffer.size())
+		buffer.resize(peak);
+	used = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef _FRAME_SCRATCH_INCLUDE
+#define _FRAME_SCRATCH_INCLUDE
+
+
+#include <vector>
+#include <type_traits>
+
+
+using namespace std;
+
+
+#define FRAME_SCRATCH_SIZE (64 * 1024)		// Bytes per thread to start with
+#define FRAME_SCRATCH_ALIGNMENT 16
+
+
+// FrameScratch hands out memory for data that does not outlive the frame,
+// like lists built and thrown away while updating. Every thread has its
+// own, and the thread resets it when its frame starts; allocating is
+// moving a pointer forward. Nothing given out survives the reset.
+//
+// A frame that needs more than there is gets it from the heap, and the
+// next reset grows the buffer to what that frame used, so after a few
+// frames the scratch memory never touches the heap again.
+
+
+class FrameScratch
+{
+
+private:
+	FrameScratch();
+
+public:
+	// The scratch memory of the calling thread
+	static FrameScratch& instance()
+	{
+		static thread_local FrameScratch S;
+
+		return S;
+	}
+
+	~FrameScratch();
+
+	void* allocate(size_t bytes, size_t alignment = FRAME_SCRATCH_ALIGNMENT);
+
+	template<class T>
+	T* allocate(int count)
+	{
+		static_assert(is_trivially_destructible<T>::value, "Scratch memory is never destroyed");
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	void reset();
+
+	size_t getCapacity() const { return buffer.size(); }
+	size_t getPeak() const { return peak; }		// Bytes in the busiest frame so far
+
+private:
+	vector<char> buffer;
+	size_t used, peak;
+	vector<void*> overflow;						// Heap blocks of this frame
+
+};
+
+
+#endif // _FRAME_SCRATCH_INCLUDE
@@ -1,52 +1,107 @@
 #include <GL/glew.h>
 #include <GL/glut.h>
+#include <algorithm>
 #include "Game.h"
 #include "SoundManager.h"
-
-void Game::init()
+#include "FrameScheduler.h"
+#include "SimulationThread.h"
+#include "InputLatency.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
+
+void Game::init(int firstLevel)
 {
 	bPlay = true;
+	interpolation = 1.f;
+	currentInputTime = 0;
+	frameInputTime = 0;
+#ifndef COMP3D_HEADLESS
 	glEnable(GL_DEPTH_TEST);
 	glClearColor(0.f, 0.f, 0.f, 1.0f);
+#endif
 
 	SoundManager::instance().init();
 
-	currentGameState = &MenuGameState::instance();
-	currentGameState->init();
+	// There is no menu without a window
+#ifdef COMP3D_HEADLESS
+	startGame(max(firstLevel, 1));
+#else
+	if (firstLevel > 0)
+		startGame(firstLevel);
+	else
+	{
+		MenuGameState::instance().init();
+		currentGameState = &MenuGameState::instance();
+	}
+#endif
 }
 
 bool Game::update(int deltaTime)
 {
-	SoundManager::instance().update();
-	currentGameState->update(deltaTime);
+	PROFILE_ZONE("Game::update");
+
+	processInput();
+	SoundManager::instance().update(deltaTime);
+	currentGameState.load()->update(deltaTime);
+
+	// A replay ends with the last step it recorded
+	if (Replay::instance().isFinished())
+		bPlay = false;
 	return bPlay;
 }
 
 void Game::render()
 {
+	PROFILE_ZONE("Game::render");
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	currentGameState.load()->render();
+	frameInputTime = InputLatency::instance().takeReflected();
+}
+
+bool Game::supportsSnapshots() const
+{
+	return currentGameState.load()->supportsSnapshots();
+}
+
+void Game::buildSnapshot(RenderSnapshot& snapshot)
+{
+	if (supportsSnapshots())
+	{
+		currentGameState.load()->buildSnapshot(snapshot);
+		snapshot.setInputTime(InputLatency::instance().takeReflected());
+	}
+}
+
+void Game::render(const RenderSnapshot& snapshot)
+{
+	PROFILE_ZONE("Game::render");
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	currentGameState->render();
+	snapshot.render();
+	frameInputTime = snapshot.getInputTime();
 }
 
 void Game::keyPressed(int key)
 {
-	currentGameState->keyPressed(key);
-	keys[key] = true;
+	queueInput(InputEvent::KEY_DOWN, key);
 }
 
 void Game::keyReleased(int key)
 {
-	keys[key] = false;
+	queueInput(InputEvent::KEY_UP, key);
 }
 
 void Game::specialKeyPressed(int key)
 {
-	specialKeys[key] = true;
+	queueInput(InputEvent::SPECIAL_DOWN, key);
 }
 
 void Game::specialKeyReleased(int key)
 {
-	specialKeys[key] = false;
+	queueInput(InputEvent::SPECIAL_UP, key);
 }
 
 void Game::mouseMove(int x, int y)
@@ -74,6 +129,17 @@ void Game::mouseRelease(int button)
 //	scene.reshape(width, height);
 //}
 
+void Game::inputReflected()
+{
+	InputLatency::instance().reflected(currentInputTime);
+}
+
+void Game::framePresented()
+{
+	InputLatency::instance().presented(frameInputTime);
+	frameInputTime = 0;
+}
+
 bool Game::getKey(int key) const
 {
 	return keys[key];
@@ -84,17 +150,98 @@ bool Game::getSpecialKey(int key) const
 	return specialKeys[key];
 }
 
-void Game::startGame() {
+void Game::startGame(int firstLevel) {
+	// The state is switched once it is ready, the simulation thread may pick it up
+	PlayGameState::instance().init(firstLevel);
 	currentGameState = &PlayGameState::instance();
-	currentGameState->init();
 }
 
 void Game::goBackToMenu() {
-	currentGameState = &MenuGameState::instance();
-	currentGameState->init();
+	// Recordings and replays cover a single game, and there is no menu
+	// without a window
+	bool bQuit = Replay::instance().isReplaying();
+	Replay::instance().stop();
+	RenderStats::instance().setLevel(0);
+	MemoryAccounting::instance().setLevel(0);
+#ifdef COMP3D_HEADLESS
+	bQuit = true;
+#endif
+	if (bQuit)
+	{
+		bPlay = false;
+		return;
+	}
+
+	// The menu loads textures and always runs in the main thread
+	SimulationThread::instance().runOnRenderThread([this]() {
+		MenuGameState::instance().init();
+		currentGameState = &MenuGameState::instance();
+	});
 }
 
 void Game::setBplay(bool b)
 {
 	bPlay = b;
 }
+
+void Game::setInterpolation(float alpha)
+{
+	interpolation = alpha;
+}
+
+float Game::getInterpolation() const
+{
+	return interpolation;
+}
+
+void Game::queueInput(InputEvent::Type type, int key)
+{
+	InputEvent event;
+
+	event.type = type;
+	event.key = key;
+	event.time = FrameScheduler::now();
+	input.push(event);
+}
+
+void Game::processInput()
+{
+	InputEvent event;
+
+	// A replay plays instead of the player, what is typed is dropped
+	if (Replay::instance().isReplaying())
+	{
+		while (input.pop(event))
+			;
+		while (Replay::instance().nextInput(event))
+			applyInput(event);
+		return;
+	}
+
+	while (input.pop(event))
+	{
+		Replay::instance().recordInput(event);
+		applyInput(event);
+	}
+}
+
+void Game::applyInput(const InputEvent& event)
+{
+	currentInputTime = event.time;
+	switch (event.type)
+	{
+	case InputEvent::KEY_DOWN:
+		currentGameState.load()->keyPressed(event.key);
+		keys[event.key] = true;
+		break;
+	case InputEvent::KEY_UP:
+		keys[event.key] = false;
+		break;
+	case InputEvent::SPECIAL_DOWN:
+		specialKeys[event.key] = true;
+		break;
+	case InputEvent::SPECIAL_UP:
+		specialKeys[event.key] = false;
+		break;
+	}
+}
@@ -2,15 +2,20 @@
 #define _GAME_INCLUDE
 
 
+#include <atomic>
 #include "GameState.h"
 #include "MenuGameState.h"
 #include "PlayGameState.h"
+#include "InputQueue.h"
 
 #define SCREEN_WIDTH 960
 #define SCREEN_HEIGHT 720
 
 
-// Game is a singleton (a class with a single instance) that represents our whole application
+// Game is a singleton (a class with a single instance) that represents our whole application.
+// Input is not handled in the GLUT callbacks, they queue it and update
+// applies it before the step, in whichever thread runs the game. That is
+// also where Replay records it, or replaces it with a recording.
 
 
 class Game
@@ -27,9 +32,15 @@ public:
 		return G;
 	}
 	
-	void init();
+	// Straight into a level when given one instead of the menu
+	void init(int firstLevel = 0);
 	bool update(int deltaTime);
 	void render();
+
+	// Used when the game runs in a SimulationThread
+	bool supportsSnapshots() const;
+	void buildSnapshot(RenderSnapshot& snapshot);
+	void render(const RenderSnapshot& snapshot);
 	
 	// Input callback methods
 	void keyPressed(int key);
@@ -42,19 +53,37 @@ public:
 
 	//void reshape(int width, int height);
 	
+	// Called while handling an input event that changes what is drawn,
+	// the first frame showing it is measured by InputLatency
+	void inputReflected();
+	void framePresented();
+
 	bool getKey(int key) const;
 	bool getSpecialKey(int key) const;
 
-	void startGame();
+	void startGame(int firstLevel = 1);
 	void goBackToMenu();
 
 	void setBplay(bool b);
 
+	// How far rendering is between the last two simulation steps (0 to 1)
+	void setInterpolation(float alpha);
+	float getInterpolation() const;
+
+private:
+	void queueInput(InputEvent::Type type, int key);
+	void processInput();
+	void applyInput(const InputEvent& event);
+
 private:
 	bool bPlay;                       // Continue to play game?
 	bool keys[256], specialKeys[256]; // Store key states so that we can have access at any time
+	InputQueue input;
+	double currentInputTime;          // Timestamp of the event being handled
+	double frameInputTime;            // Input shown first by the frame being drawn
 
-	GameState* currentGameState;
+	atomic<GameState*> currentGameState;
+	float interpolation;
 };
 
 
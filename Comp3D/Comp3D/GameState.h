@@ -2,6 +2,9 @@
 #define _GAMESTATE_INCLUDE
 
 
+class RenderSnapshot;
+
+
 class GameState
 {
 
@@ -10,6 +13,11 @@ public:
 	virtual void update(int deltaTime) = 0;
 	virtual void render() = 0;
 
+	// States that describe their frames in a snapshot can be simulated
+	// outside the main thread, the rest update and render in it
+	virtual bool supportsSnapshots() const { return false; }
+	virtual void buildSnapshot(RenderSnapshot& snapshot) {}
+
 	// Input callback methods
 	virtual void keyPressed(int key) = 0;
 };
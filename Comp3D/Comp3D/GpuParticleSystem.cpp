@@ -0,0 +1,342 @@
+#include <iostream>
+#include "GpuParticleSystem.h"
+#include "Shader.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
+
+
+GpuParticleSystem::GpuParticleSystem()
+{
+	capacity = 0;
+	g = fadeOut = 0.f;
+	buffers[0] = buffers[1] = 0;
+	feedbacks[0] = feedbacks[1] = 0;
+	updateVaos[0] = updateVaos[1] = 0;
+	renderVaos[0] = renderVaos[1] = 0;
+	spawnBuffer = spawnVao = 0;
+	queries[0] = queries[1] = 0;
+	bQueryPending[0] = bQueryPending[1] = false;
+	current = 0;
+	bCaptured = false;
+	numParticles = 0;
+	pendingTime = 0.f;
+	rng = PARTICLE_RNG_SEED;
+}
+
+GpuParticleSystem::~GpuParticleSystem()
+{
+	free();
+}
+
+
+bool GpuParticleSystem::isSupported()
+{
+	return GLEW_VERSION_3_2 && GLEW_ARB_transform_feedback2;
+}
+
+bool GpuParticleSystem::init(const glm::vec2 &quadSize, const string &textureFile, float gravity, float fadeOut, int capacity)
+{
+	if (!isSupported())
+	{
+		cout << "GPU particles need OpenGL 3.2 and ARB_transform_feedback2" << endl;
+		return false;
+	}
+
+	this->capacity = capacity;
+	g = gravity;
+	this->fadeOut = fadeOut;
+	size = quadSize;
+	spawns.reserve(GPU_PARTICLE_FLOATS * capacity);
+	uploads.reserve(GPU_PARTICLE_FLOATS * capacity);
+
+	if (!texture.loadFromFile(textureFile.c_str(), TEXTURE_PIXEL_FORMAT_RGBA))
+		cout << "Could not load particle texture!!!" << endl;
+	texture.setMagFilter(GL_NEAREST);
+	if (!initPrograms())
+		return false;
+	prepareArrays();
+
+	return true;
+}
+
+void GpuParticleSystem::free()
+{
+	if (queries[0] == 0)
+		return;
+	glDeleteQueries(2, queries);
+	glDeleteTransformFeedbacks(2, feedbacks);
+	glDeleteVertexArrays(2, updateVaos);
+	glDeleteVertexArrays(2, renderVaos);
+	glDeleteVertexArrays(1, &spawnVao);
+	glDeleteBuffers(2, buffers);
+	glDeleteBuffers(1, &spawnBuffer);
+	MemoryAccounting::instance().release(MemoryAccounting::PARTICLES, MemoryAccounting::GPU, texture.getFilename(),
+		3 * size_t(capacity) * GPU_PARTICLE_FLOATS * sizeof(float));
+	updateProgram.free();
+	renderProgram.free();
+	queries[0] = queries[1] = 0;
+}
+
+
+bool GpuParticleSystem::addParticle(const ParticleSystem::Particle &newParticle)
+{
+	lock_guard<mutex> guard(lock);
+
+	// Never grows, the pass could not keep more than capacity anyway
+	if (int(spawns.size()) >= GPU_PARTICLE_FLOATS * capacity)
+		return false;
+	spawns.push_back(newParticle.lifetime);
+	spawns.push_back(newParticle.position.x);
+	spawns.push_back(newParticle.position.y);
+	spawns.push_back(newParticle.position.z);
+	spawns.push_back(newParticle.speed.x);
+	spawns.push_back(newParticle.speed.y);
+	spawns.push_back(newParticle.speed.z);
+
+	return true;
+}
+
+void GpuParticleSystem::update(float deltaTimeInSeconds)
+{
+	lock_guard<mutex> guard(lock);
+
+	pendingTime += deltaTimeInSeconds;
+}
+
+
+void GpuParticleSystem::simulate()
+{
+	float deltaTime;
+	int next = 1 - current;
+
+	{
+		lock_guard<mutex> guard(lock);
+		uploads.swap(spawns);
+		spawns.clear();
+		deltaTime = pendingTime;
+		pendingTime = 0.f;
+	}
+	if (deltaTime <= 0.f && uploads.empty())
+		return;
+
+	if (!uploads.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, spawnBuffer);
+		RenderStats::instance().bufferSubData(GL_ARRAY_BUFFER, 0, uploads.size() * sizeof(float), &uploads[0]);
+	}
+
+	// The count of two passes ago, if it is there, before the query is reused
+	readQuery(next, false);
+
+	updateProgram.use();
+	updateProgram.setUniform1f("deltaTime", deltaTime);
+	updateProgram.setUniform1f("gravity", g);
+
+	// Nothing is drawn, the particles only go through the vertex and geometry shaders
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedbacks[next]);
+	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[next]);
+	glBeginTransformFeedback(GL_POINTS);
+
+	// Live particles first, the spawns are appended after them
+	if (bCaptured)
+	{
+		RenderStats::instance().bindVertexArray(updateVaos[current]);
+		RenderStats::instance().drawTransformFeedback(GL_POINTS, feedbacks[current]);
+	}
+	if (!uploads.empty())
+	{
+		RenderStats::instance().bindVertexArray(spawnVao);
+		RenderStats::instance().drawArrays(GL_POINTS, 0, GLsizei(uploads.size() / GPU_PARTICLE_FLOATS));
+	}
+
+	glEndTransformFeedback();
+	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+	bQueryPending[next] = true;
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	RenderStats::instance().bindVertexArray(0);
+
+	current = next;
+	bCaptured = true;
+	uploads.clear();
+}
+
+void GpuParticleSystem::render(const glm::mat4 &projection, const glm::mat4 &view)
+{
+	glm::mat4 matrix;
+
+	simulate();
+	if (!bCaptured)
+		return;
+
+	renderProgram.use();
+	matrix = projection;
+	renderProgram.setUniformMatrix4f("projection", matrix);
+	matrix = view;
+	renderProgram.setUniformMatrix4f("view", matrix);
+	renderProgram.setUniform2f("quadSize", size.x, size.y);
+	renderProgram.setUniform1f("fadeOut", fadeOut);
+
+	glEnable(GL_TEXTURE_2D);
+	texture.use();
+	RenderStats::instance().bindVertexArray(renderVaos[current]);
+	RenderStats::instance().drawTransformFeedback(GL_POINTS, feedbacks[current]);
+	RenderStats::instance().bindVertexArray(0);
+	glDisable(GL_TEXTURE_2D);
+}
+
+int GpuParticleSystem::countParticles(bool bWait)
+{
+	readQuery(current, bWait);
+
+	return numParticles;
+}
+
+void GpuParticleSystem::readQuery(int buffer, bool bWait)
+{
+	GLuint result;
+	GLint available = GL_FALSE;
+
+	if (!bQueryPending[buffer])
+		return;
+	if (!bWait)
+		glGetQueryObjectiv(queries[buffer], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (bWait || available == GL_TRUE)
+	{
+		glGetQueryObjectuiv(queries[buffer], GL_QUERY_RESULT, &result);
+		numParticles = int(result);
+		bQueryPending[buffer] = false;
+	}
+}
+
+
+void GpuParticleSystem::seed(unsigned int seed)
+{
+	// Xorshift never leaves 0
+	rng = (seed != 0) ? seed : PARTICLE_RNG_SEED;
+}
+
+float GpuParticleSystem::random()
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+
+	// The top 24 bits fit exactly in a float
+	return (rng >> 8) * (1.f / 16777216.f);
+}
+
+
+bool GpuParticleSystem::initPrograms()
+{
+	Shader vShader, gShader, fShader;
+	bool bOk = true;
+
+	// Update, the outputs of the geometry shader are captured
+	vShader.initFromFile(VERTEX_SHADER, "shaders/particle_update.vert");
+	gShader.initFromFile(GEOMETRY_SHADER, "shaders/particle_update.geom");
+	if (!vShader.isCompiled() || !gShader.isCompiled())
+	{
+		cout << "Particle Update Shader Error" << endl;
+		cout << "" << vShader.log() << gShader.log() << endl << endl;
+		bOk = false;
+	}
+	updateProgram.init();
+	updateProgram.addShader(vShader);
+	updateProgram.addShader(gShader);
+	updateProgram.setTransformFeedbackVaryings({ "outLifetime", "outPosition", "outSpeed" });
+	updateProgram.link();
+	if (!updateProgram.isLinked())
+	{
+		cout << "Particle Update Linking Error" << endl;
+		cout << "" << updateProgram.log() << endl << endl;
+		bOk = false;
+	}
+	vShader.free();
+	gShader.free();
+
+	// Render, one quad per particle built by the geometry shader
+	vShader.initFromFile(VERTEX_SHADER, "shaders/particle.vert");
+	gShader.initFromFile(GEOMETRY_SHADER, "shaders/particle.geom");
+	fShader.initFromFile(FRAGMENT_SHADER, "shaders/particle.frag");
+	if (!vShader.isCompiled() || !gShader.isCompiled() || !fShader.isCompiled())
+	{
+		cout << "Particle Shader Error" << endl;
+		cout << "" << vShader.log() << gShader.log() << fShader.log() << endl << endl;
+		bOk = false;
+	}
+	renderProgram.init();
+	renderProgram.addShader(vShader);
+	renderProgram.addShader(gShader);
+	renderProgram.addShader(fShader);
+	renderProgram.link();
+	if (!renderProgram.isLinked())
+	{
+		cout << "Particle Shader Linking Error" << endl;
+		cout << "" << renderProgram.log() << endl << endl;
+		bOk = false;
+	}
+	renderProgram.bindFragmentOutput("outColor");
+	vShader.free();
+	gShader.free();
+	fShader.free();
+
+	return bOk;
+}
+
+void GpuParticleSystem::prepareArrays()
+{
+	GLsizeiptr bytes = GLsizeiptr(capacity) * GPU_PARTICLE_FLOATS * sizeof(float);
+
+	glGenBuffers(2, buffers);
+	glGenTransformFeedbacks(2, feedbacks);
+	glGenVertexArrays(2, updateVaos);
+	glGenVertexArrays(2, renderVaos);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+		RenderStats::instance().bufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+
+		// Each buffer is written through its own feedback object, which remembers how much was written
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedbacks[i]);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[i]);
+
+		RenderStats::instance().bindVertexArray(updateVaos[i]);
+		bindAttributes(updateProgram, true);
+		RenderStats::instance().bindVertexArray(renderVaos[i]);
+		bindAttributes(renderProgram, false);
+	}
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+	// Spawns of one frame, at most a full buffer
+	glGenBuffers(1, &spawnBuffer);
+	glGenVertexArrays(1, &spawnVao);
+	glBindBuffer(GL_ARRAY_BUFFER, spawnBuffer);
+	RenderStats::instance().bufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	// The two particle buffers and the spawns
+	MemoryAccounting::instance().allocate(MemoryAccounting::PARTICLES, MemoryAccounting::GPU, texture.getFilename(), 3 * size_t(bytes));
+	RenderStats::instance().bindVertexArray(spawnVao);
+	bindAttributes(updateProgram, true);
+	RenderStats::instance().bindVertexArray(0);
+
+	glGenQueries(2, queries);
+}
+
+// Same layout as the transform feedback outputs: lifetime, position, speed
+
+void GpuParticleSystem::bindAttributes(ShaderProgram &program, bool bSpeed)
+{
+	GLsizei stride = GPU_PARTICLE_FLOATS * sizeof(float);
+	GLint location;
+
+	location = program.bindVertexAttribute("lifetime", 1, stride, 0);
+	glEnableVertexAttribArray(location);
+	location = program.bindVertexAttribute("position", 3, stride, (void *)(1 * sizeof(float)));
+	glEnableVertexAttribArray(location);
+	if (bSpeed)
+	{
+		location = program.bindVertexAttribute("speed", 3, stride, (void *)(4 * sizeof(float)));
+		glEnableVertexAttribArray(location);
+	}
+}
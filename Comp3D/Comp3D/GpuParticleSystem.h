@@ -0,0 +1,90 @@
+#ifndef _GPU_PARTICLE_SYSTEM_INCLUDE
+#define _GPU_PARTICLE_SYSTEM_INCLUDE
+
+
+#include <vector>
+#include <mutex>
+#include <glm/glm.hpp>
+#include "ShaderProgram.h"
+#include "Texture.h"
+#include "ParticleSystem.h"
+
+
+#define GPU_PARTICLE_DEFAULT_CAPACITY (1 << 16)
+#define GPU_PARTICLE_FLOATS 7			// Lifetime, position and speed
+
+
+// GpuParticleSystem simulates particles on the GPU for bursts too big for
+// ParticleSystem. Particles live in two buffers used in turns: a transform
+// feedback pass reads one, integrates every particle with the same physics
+// as ParticleSystem and writes the live ones packed into the other, so
+// dead particles are compacted without the CPU ever reading them back.
+// Spawns are queued from the CPU and appended to the output of the pass.
+// Particles beyond the capacity are dropped.
+//
+// update and addParticle only queue work and can be called from the
+// simulation thread. The pass runs with the OpenGL context, when the
+// particles are drawn or when simulate is called. Needs OpenGL 3.2 for
+// geometry shaders and ARB_transform_feedback2, which Mesa llvmpipe has.
+
+
+class GpuParticleSystem
+{
+
+public:
+	GpuParticleSystem();
+	~GpuParticleSystem();
+
+	static bool isSupported();
+
+	// Returns false if the GPU cannot run it or the shaders do not build
+	bool init(const glm::vec2 &quadSize, const string &textureFile, float gravity = 0.f, float fadeOut = 0.f, int capacity = GPU_PARTICLE_DEFAULT_CAPACITY);
+	void free();
+
+	// Returns false if the frame already queued as many spawns as fit
+	bool addParticle(const ParticleSystem::Particle &newParticle);
+	void update(float deltaTimeInSeconds);
+
+	// These need the OpenGL context
+	void simulate();
+	void render(const glm::mat4 &projection, const glm::mat4 &view);
+	// Live particles after the last pass. Without bWait it may be a pass late.
+	int countParticles(bool bWait = false);
+
+	void seed(unsigned int seed);
+	// Uniform in [0, 1)
+	float random();
+
+private:
+	bool initPrograms();
+	void prepareArrays();
+	void bindAttributes(ShaderProgram &program, bool bSpeed);
+	void readQuery(int buffer, bool bWait);
+
+private:
+	int capacity;
+	float g, fadeOut;
+	glm::vec2 size;
+	Texture texture;
+	ShaderProgram updateProgram, renderProgram;
+
+	GLuint buffers[2], feedbacks[2];
+	GLuint updateVaos[2], renderVaos[2];
+	GLuint spawnBuffer, spawnVao;
+	GLuint queries[2];					// Particles written into each buffer
+	bool bQueryPending[2];
+	int current;						// Buffer with the live particles
+	bool bCaptured;						// current has been written by a pass
+	int numParticles;
+
+	mutex lock;							// Protects what the simulation queues
+	vector<float> spawns;
+	float pendingTime;
+	vector<float> uploads;
+
+	unsigned int rng;
+
+};
+
+
+#endif // _GPU_PARTICLE_SYSTEM_INCLUDE
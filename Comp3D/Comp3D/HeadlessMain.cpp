@@ -0,0 +1,229 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include "Game.h"
+#include "SoundManager.h"
+#include "NullAudioBackend.h"
+#include "JobSystem.h"
+#include "LevelArena.h"
+#include "FrameScratch.h"
+#include "FrameScheduler.h"
+#include "Replay.h"
+#include "MemoryAccounting.h"
+
+
+// Entry point of Comp3DHeadless, built with COMP3D_HEADLESS and
+// COMP3D_NO_FMOD. It runs the game without a window, OpenGL or audio, as
+// fast as it can, and reports how many simulation steps it did per
+// second. That is the cost of the gameplay logic alone.
+//
+// Comp3DHeadless [--level n] [--game] [--steps n] [--runs n]
+//                [--input file] [--tap ms] [--record file] [--replay file]
+//                [--memory file] [--memory-budget cpu_mb gpu_mb]
+//
+// Only the given level is played unless --game goes on to the next ones.
+// The input is a script with a key press per line, the simulation step it
+// happens at and the key ("space" for the space bar):
+//     125 space
+// --tap presses space every given milliseconds instead. --record and
+// --replay work as in the game, a replay plays every level it recorded and
+// the exit code is 1 if it diverged. Model sizes come from the bounding
+// boxes cached by Comp3D --cache-bounds. --memory writes the memory
+// breakdown as JSON, nothing goes to the GPU here, and the exit code is 1
+// too if the game went over --memory-budget.
+
+
+#define SIMULATION_STEP 8 // ms, as in the game
+#define HEADLESS_MAX_STEPS 75000 // 10 minutes of game when the level does not end before
+
+
+struct ScriptedKey
+{
+	int step;
+	int key;
+};
+
+
+static bool loadScript(const string& filename, vector<ScriptedKey>& script)
+{
+	ifstream fin(filename.c_str());
+	string line, key;
+	ScriptedKey pressed;
+
+	if (!fin.is_open())
+		return false;
+	while (getline(fin, line))
+	{
+		istringstream sstream(line);
+		if (!(sstream >> pressed.step >> key))
+			continue;
+		pressed.key = (key == "space") ? ' ' : key[0];
+		script.push_back(pressed);
+	}
+
+	return true;
+}
+
+// Space bar presses every period ms, for runs without a script
+
+static void tapScript(int period, int maxSteps, vector<ScriptedKey>& script)
+{
+	ScriptedKey pressed;
+
+	pressed.key = ' ';
+	for (int time = period; time / SIMULATION_STEP < maxSteps; time += period)
+	{
+		pressed.step = time / SIMULATION_STEP;
+		script.push_back(pressed);
+	}
+}
+
+// Simulates until the game ends or maxSteps are done. Keys are released
+// the step after they are pressed. Returns the steps simulated and the
+// time it took, loading the first level excluded.
+
+static int runGame(int maxSteps, const vector<ScriptedKey>& script, double& elapsed)
+{
+	unsigned int next = 0, released = 0;
+	int step = 0;
+	double start = FrameScheduler::now();
+	bool bPlaying = true;
+
+	while (step < maxSteps && bPlaying)
+	{
+		LevelArena::instance().beginFrame();
+		FrameScratch::instance().reset();
+
+		for (; released < next && script[released].step < step; released++)
+			Game::instance().keyReleased(script[released].key);
+		for (; next < script.size() && script[next].step <= step; next++)
+			Game::instance().keyPressed(script[next].key);
+		bPlaying = Game::instance().update(SIMULATION_STEP);
+		step++;
+	}
+	elapsed = FrameScheduler::now() - start;
+
+	return step;
+}
+
+
+int main(int argc, char **argv)
+{
+	int level = 1, maxSteps = HEADLESS_MAX_STEPS, runs = 1, tap = 0;
+	bool bWholeGame = false;
+	string recordFile, replayFile, memoryFile;
+	bool bMemoryBudget = false;
+	vector<ScriptedKey> script;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--level" && i + 1 < argc)
+			level = atoi(argv[++i]);
+		else if (arg == "--game")
+			bWholeGame = true;
+		else if (arg == "--steps" && i + 1 < argc)
+			maxSteps = atoi(argv[++i]);
+		else if (arg == "--runs" && i + 1 < argc)
+			runs = atoi(argv[++i]);
+		else if (arg == "--tap" && i + 1 < argc)
+			tap = atoi(argv[++i]);
+		else if (arg == "--record" && i + 1 < argc)
+			recordFile = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			replayFile = argv[++i];
+		else if (arg == "--memory" && i + 1 < argc)
+			memoryFile = argv[++i];
+		else if (arg == "--memory-budget" && i + 2 < argc)
+		{
+			MemoryAccounting::instance().setBudget(MemoryAccounting::CPU, atoll(argv[++i]) << 20);
+			MemoryAccounting::instance().setBudget(MemoryAccounting::GPU, atoll(argv[++i]) << 20);
+			bMemoryBudget = true;
+		}
+		else if (arg == "--input" && i + 1 < argc)
+		{
+			if (!loadScript(argv[++i], script))
+			{
+				cerr << "Could not read the input script '" << argv[i] << "'" << endl;
+				return 1;
+			}
+		}
+		else
+		{
+			cerr << "Unknown argument '" << arg << "'" << endl;
+			return 1;
+		}
+	}
+	if (script.empty() && tap > 0)
+		tapScript(tap, maxSteps, script);
+
+	SoundManager::instance().setBackend(new NullAudioBackend());
+	JobSystem::instance().init();
+
+	int numDivergences = 0;
+	for (int run = 0; run < runs; run++)
+	{
+		// Every run starts the recording or the replay again
+		if (!recordFile.empty() && !Replay::instance().startRecording(recordFile))
+		{
+			cerr << "Could not create the recording '" << recordFile << "'" << endl;
+			return 1;
+		}
+		if (!replayFile.empty())
+		{
+			if (!Replay::instance().startReplay(replayFile))
+			{
+				cerr << "Could not read the recording '" << replayFile << "'" << endl;
+				return 1;
+			}
+			level = Replay::instance().getFirstLevel();
+			bWholeGame = true;
+		}
+
+		if (run == 0)
+			Game::instance().init(level);
+		else
+		{
+			Game::instance().setBplay(true);
+			Game::instance().startGame(level);
+		}
+		if (!bWholeGame)
+			PlayGameState::instance().setLastLevel(level);
+
+		double elapsed;
+		int steps = runGame(maxSteps, script, elapsed);
+		double stepsPerSecond = (elapsed > 0.0) ? 1000.0 * steps / elapsed : 0.0;
+
+		cout << "Level " << level << (bWholeGame ? " onwards: " : ": ") << steps << " steps ("
+			<< steps * SIMULATION_STEP / 1000.0 << " s of game) in " << elapsed << " ms, " << int(stepsPerSecond)
+			<< " steps/s, " << stepsPerSecond * SIMULATION_STEP / 1000.0 << "x real time"
+			<< (steps < maxSteps ? ", finished" : "") << endl;
+
+		if (!replayFile.empty())
+			numDivergences += Replay::instance().getNumDivergences();
+		Replay::instance().stop();
+	}
+	MemoryAccounting::instance().setLevel(0);
+	if (!memoryFile.empty())
+	{
+		MemoryAccounting::instance().print(cout);
+		if (!MemoryAccounting::instance().exportJson(memoryFile))
+			cerr << "Could not write '" << memoryFile << "'" << endl;
+	}
+	LevelArena::instance().reset();
+	if (bMemoryBudget && MemoryAccounting::instance().getNumOverBudget() > 0)
+	{
+		cerr << "Over the memory budget " << MemoryAccounting::instance().getNumOverBudget() << " times" << endl;
+		return 1;
+	}
+
+	if (!replayFile.empty())
+	{
+		cout << "Replay " << (numDivergences == 0 ? "matched the recording" : "diverged from the recording") << endl;
+		return (numDivergences == 0) ? 0 : 1;
+	}
+
+	return 0;
+}
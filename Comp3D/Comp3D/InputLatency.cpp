@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <iomanip>
+#include "InputLatency.h"
+#include "FrameScheduler.h"
+
+
+#define HISTOGRAM_WIDTH 50			// Characters of the longest bar
+
+
+InputLatency::InputLatency()
+{
+	pending = 0;
+	fill(buckets, buckets + INPUT_LATENCY_BUCKETS, 0);
+	numSamples = 0;
+	maxLatency = 0;
+}
+
+
+void InputLatency::reflected(double inputTime)
+{
+	// Several events in the same frame, the oldest one is the one to measure
+	double current = pending;
+	if (current == 0 || inputTime < current)
+		pending = inputTime;
+}
+
+double InputLatency::takeReflected()
+{
+	return pending.exchange(0);
+}
+
+
+void InputLatency::presented(double inputTime)
+{
+	if (inputTime <= 0)
+		return;
+
+	double latency = FrameScheduler::now() - inputTime;
+	int bucket = min(int(latency), INPUT_LATENCY_BUCKETS - 1);
+
+	buckets[max(bucket, 0)]++;
+	numSamples++;
+	maxLatency = max(maxLatency, latency);
+}
+
+
+int InputLatency::getNumSamples() const
+{
+	return numSamples;
+}
+
+double InputLatency::getPercentile(double fraction) const
+{
+	int target = int(fraction * numSamples + 0.5), count = 0;
+
+	// Upper edge of the bucket where the percentile falls
+	for (int b = 0; b < INPUT_LATENCY_BUCKETS; b++)
+	{
+		count += buckets[b];
+		if (count >= max(target, 1))
+			return (b == INPUT_LATENCY_BUCKETS - 1) ? maxLatency : min(double(b + 1), maxLatency);
+	}
+	return maxLatency;
+}
+
+double InputLatency::getMax() const
+{
+	return maxLatency;
+}
+
+
+void InputLatency::print(ostream &out) const
+{
+	int highest = 0;
+
+	out << "Input latency: " << numSamples << " samples";
+	if (numSamples == 0)
+	{
+		out << endl;
+		return;
+	}
+	out << ", median " << getPercentile(0.5) << " ms, 95% " << getPercentile(0.95)
+		<< " ms, max " << maxLatency << " ms" << endl;
+
+	for (int b = 0; b < INPUT_LATENCY_BUCKETS; b++)
+		highest = max(highest, buckets[b]);
+
+	// Empty buckets are skipped, the bounds tell where the gaps are
+	for (int b = 0; b < INPUT_LATENCY_BUCKETS; b++)
+	{
+		if (buckets[b] == 0)
+			continue;
+		out << setw(4) << b;
+		if (b == INPUT_LATENCY_BUCKETS - 1)
+			out << "+   ms ";
+		else
+			out << "-" << setw(3) << left << (b + 1) << right << "ms ";
+		out << string((buckets[b] * HISTOGRAM_WIDTH + highest - 1) / highest, '#') << " " << buckets[b] << endl;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef _INPUT_LATENCY_INCLUDE
+#define _INPUT_LATENCY_INCLUDE
+
+
+#include <atomic>
+#include <ostream>
+
+
+using namespace std;
+
+
+#define INPUT_LATENCY_BUCKETS 100	// 1 ms each, the last one also counts anything slower
+
+
+// InputLatency is a singleton that measures the time from an input event
+// to the first frame on screen that shows its effect. The game marks the
+// events that change what is drawn (see Game::inputReflected), the next
+// frame built carries the oldest marked timestamp, and the main thread
+// adds a sample once that frame has been swapped. Samples are kept as a
+// histogram.
+
+
+class InputLatency
+{
+
+private:
+	InputLatency();
+
+public:
+	static InputLatency &instance()
+	{
+		static InputLatency L;
+
+		return L;
+	}
+
+	// Simulation side
+	void reflected(double inputTime);
+	double takeReflected();
+
+	// Main thread side, after the buffer swap
+	void presented(double inputTime);
+
+	int getNumSamples() const;
+	double getPercentile(double fraction) const;
+	double getMax() const;
+
+	void print(ostream &out) const;
+
+private:
+	atomic<double> pending;				// Oldest input not built into a frame yet, 0 if none
+	int buckets[INPUT_LATENCY_BUCKETS];
+	int numSamples;
+	double maxLatency;
+
+};
+
+
+#endif // _INPUT_LATENCY_INCLUDE
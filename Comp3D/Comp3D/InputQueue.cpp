@@ -0,0 +1,34 @@
+#include "InputQueue.h"
+
+
+InputQueue::InputQueue()
+{
+	head = 0;
+	tail = 0;
+}
+
+
+bool InputQueue::push(const InputEvent &event)
+{
+	unsigned int h = head.load(memory_order_relaxed);
+
+	if (h - tail.load(memory_order_acquire) == INPUT_QUEUE_SIZE)
+		return false;
+	events[h & (INPUT_QUEUE_SIZE - 1)] = event;
+	// The event is written before the consumer can see it
+	head.store(h + 1, memory_order_release);
+
+	return true;
+}
+
+bool InputQueue::pop(InputEvent &event)
+{
+	unsigned int t = tail.load(memory_order_relaxed);
+
+	if (t == head.load(memory_order_acquire))
+		return false;
+	event = events[t & (INPUT_QUEUE_SIZE - 1)];
+	tail.store(t + 1, memory_order_release);
+
+	return true;
+}
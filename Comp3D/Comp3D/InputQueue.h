@@ -0,0 +1,53 @@
+#ifndef _INPUT_QUEUE_INCLUDE
+#define _INPUT_QUEUE_INCLUDE
+
+
+#include <atomic>
+
+
+using namespace std;
+
+
+#define INPUT_QUEUE_SIZE 256		// Must be a power of two
+
+
+struct InputEvent
+{
+	enum Type
+	{
+		KEY_DOWN,
+		KEY_UP,
+		SPECIAL_DOWN,
+		SPECIAL_UP
+	};
+
+	Type type;
+	int key;
+	double time;					// FrameScheduler::now() when it was received
+};
+
+
+// InputQueue is a lock-free ring of input events with a single producer
+// (the GLUT callbacks) and a single consumer (whichever thread updates the
+// game). Only the producer writes head and only the consumer writes tail,
+// so neither side ever waits for the other. When the ring is full new
+// events are dropped, at 256 events per step it never is.
+
+
+class InputQueue
+{
+
+public:
+	InputQueue();
+
+	bool push(const InputEvent &event);
+	bool pop(InputEvent &event);
+
+private:
+	InputEvent events[INPUT_QUEUE_SIZE];
+	atomic<unsigned int> head, tail;
+
+};
+
+
+#endif // _INPUT_QUEUE_INCLUDE
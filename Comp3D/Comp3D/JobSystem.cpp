@@ -0,0 +1,420 @@
+#include <algorithm>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+
+struct JobSystem::Job
+{
+	function<void()> work;
+	atomic<int> pending;					// Submit plus the dependencies not finished
+	atomic<bool> bDone;
+	mutex lock;								// Protects continuations and bDone changes
+	JobHandle continuations[JOB_INLINE_CONTINUATIONS];
+	int numContinuations;
+	vector<JobHandle> moreContinuations;	// Only when the inline ones are taken
+};
+
+
+// Memory of the jobs and their reference counts. All the blocks have the
+// same size and go back to a free list instead of the heap. It is never
+// destroyed, handles may be released after the job system is.
+
+class JobBlocks
+{
+
+public:
+	static JobBlocks &instance()
+	{
+		static JobBlocks *blocks = new JobBlocks();
+
+		return *blocks;
+	}
+
+	void *allocate(size_t bytes)
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			if (bytes == blockSize && !freeBlocks.empty())
+			{
+				void *block = freeBlocks.back();
+				freeBlocks.pop_back();
+				return block;
+			}
+			if (blockSize == 0)
+				blockSize = bytes;
+		}
+		return ::operator new(bytes);
+	}
+
+	void deallocate(void *block, size_t bytes)
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			if (bytes == blockSize)
+			{
+				freeBlocks.push_back(block);
+				return;
+			}
+		}
+		::operator delete(block);
+	}
+
+private:
+	JobBlocks() : blockSize(0) {}
+
+	mutex lock;
+	size_t blockSize;
+	vector<void *> freeBlocks;
+
+};
+
+template<class T>
+class JobAllocator
+{
+
+public:
+	typedef T value_type;
+
+	JobAllocator() {}
+	template<class U> JobAllocator(const JobAllocator<U> &) {}
+
+	T *allocate(size_t n) { return static_cast<T *>(JobBlocks::instance().allocate(n * sizeof(T))); }
+	void deallocate(T *p, size_t n) { JobBlocks::instance().deallocate(p, n * sizeof(T)); }
+
+	template<class U> bool operator==(const JobAllocator<U> &) const { return true; }
+	template<class U> bool operator!=(const JobAllocator<U> &) const { return false; }
+
+};
+
+
+// Queue of the current thread, 0 for the main thread and any thread
+// that is not a worker
+static thread_local int threadIndex = 0;
+
+
+JobSystem::JobSystem()
+{
+	numWorkers = 0;
+	numQueued = 0;
+	bQuit = false;
+	mainThread = this_thread::get_id();
+	for (Queue &queue : queues)
+	{
+		queue.first = 0;
+		queue.count = 0;
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+}
+
+
+void JobSystem::init(int numWorkers)
+{
+	shutdown();
+
+	if (numWorkers < 0)
+		numWorkers = int(thread::hardware_concurrency()) - 1;
+	this->numWorkers = max(0, min(numWorkers, JOB_MAX_THREADS - 1));
+	mainThread = this_thread::get_id();
+	threadIndex = 0;
+
+	// Queues and the free jobs are there before the first frame. How many
+	// jobs are alive at once depends on timing, a frame could otherwise
+	// need one more than any frame before
+	for (int i = 0; i <= this->numWorkers; i++)
+		if (queues[i].jobs.empty())
+			queues[i].jobs.resize(JOB_QUEUE_CAPACITY);
+	{
+		vector<JobHandle> jobs;
+		for (int i = 0; i < JOB_QUEUE_CAPACITY; i++)
+			jobs.push_back(create(function<void()>()));
+	}
+
+	bQuit = false;
+	for (int i = 1; i <= this->numWorkers; i++)
+		workers.push_back(thread(&JobSystem::workerLoop, this, i));
+}
+
+void JobSystem::shutdown()
+{
+	{
+		lock_guard<mutex> guard(sleepLock);
+		bQuit = true;
+	}
+	sleepCondition.notify_all();
+	for (thread &worker : workers)
+		worker.join();
+	workers.clear();
+
+	// Whatever was left runs here
+	while (JobHandle job = findJob())
+		execute(job);
+	numWorkers = 0;
+}
+
+
+JobSystem::JobHandle JobSystem::create(const function<void()> &work)
+{
+	JobHandle job = allocate_shared<Job>(JobAllocator<Job>());
+
+	job->work = work;
+	job->pending = 1;
+	job->bDone = false;
+	job->numContinuations = 0;
+
+	return job;
+}
+
+void JobSystem::addDependency(const JobHandle &job, const JobHandle &dependency)
+{
+	lock_guard<mutex> guard(dependency->lock);
+
+	if (!dependency->bDone)
+	{
+		job->pending++;
+		if (dependency->numContinuations < JOB_INLINE_CONTINUATIONS)
+			dependency->continuations[dependency->numContinuations++] = job;
+		else
+			dependency->moreContinuations.push_back(job);
+	}
+}
+
+void JobSystem::submit(const JobHandle &job)
+{
+	release(job);
+}
+
+JobSystem::JobHandle JobSystem::then(const JobHandle &job, const function<void()> &work)
+{
+	JobHandle continuation = create(work);
+
+	addDependency(continuation, job);
+	submit(continuation);
+
+	return continuation;
+}
+
+
+void JobSystem::wait(const JobHandle &job)
+{
+	while (!job->bDone)
+	{
+		JobHandle other = findJob();
+
+		if (other != NULL)
+			execute(other);
+		else
+		{
+			if (isMainThread())
+				runMainThreadJobs();
+			this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::isDone(const JobHandle &job) const
+{
+	return job->bDone;
+}
+
+
+void JobSystem::parallelFor(int count, int grain, const function<void(int begin, int end)> &body)
+{
+	grain = max(grain, 1);
+	if (count <= grain || numWorkers == 0)
+	{
+		if (count > 0)
+			body(0, count);
+		return;
+	}
+
+	JobHandle done = create(function<void()>());
+	for (int begin = 0; begin < count; begin += grain)
+	{
+		int end = min(begin + grain, count);
+		JobHandle chunk = create([&body, begin, end]() { body(begin, end); });
+
+		addDependency(done, chunk);
+		submit(chunk);
+	}
+	submit(done);
+	wait(done);
+}
+
+
+void JobSystem::runOnMainThread(const function<void()> &work)
+{
+	if (isMainThread())
+	{
+		work();
+		return;
+	}
+
+	lock_guard<mutex> guard(mainLock);
+	mainJobs.push_back(work);
+}
+
+void JobSystem::runMainThreadJobs()
+{
+	vector<function<void()>> jobs;
+
+	{
+		lock_guard<mutex> guard(mainLock);
+		jobs.swap(mainJobs);
+	}
+	for (const function<void()> &work : jobs)
+		work();
+}
+
+bool JobSystem::isMainThread() const
+{
+	return this_thread::get_id() == mainThread;
+}
+
+
+void JobSystem::workerLoop(int index)
+{
+	threadIndex = index;
+	PROFILE_THREAD("jobs");
+
+	while (!bQuit)
+	{
+		JobHandle job = findJob();
+
+		if (job != NULL)
+		{
+			execute(job);
+			continue;
+		}
+
+		// Nothing to steal, sleep until a job is pushed
+		unique_lock<mutex> guard(sleepLock);
+		sleepCondition.wait(guard, [this]() { return numQueued > 0 || bQuit; });
+	}
+}
+
+void JobSystem::push(const JobHandle &job)
+{
+	Queue &queue = queues[threadIndex];
+
+	{
+		lock_guard<mutex> guard(queue.lock);
+		pushBack(queue, job);
+	}
+	numQueued++;
+
+	// Taking the lock makes sure a worker about to sleep sees the job
+	{
+		lock_guard<mutex> guard(sleepLock);
+	}
+	sleepCondition.notify_one();
+}
+
+JobSystem::JobHandle JobSystem::findJob()
+{
+	JobHandle job;
+	int numQueues = numWorkers + 1;
+
+	if (numQueued == 0)
+		return job;
+
+	// Newest job of our own queue, it is the most likely to be in cache
+	{
+		Queue &queue = queues[threadIndex];
+		lock_guard<mutex> guard(queue.lock);
+		if (queue.count > 0)
+		{
+			job = popBack(queue);
+			numQueued--;
+			return job;
+		}
+	}
+
+	// Oldest job of somebody else
+	for (int i = 1; i < numQueues; i++)
+	{
+		Queue &queue = queues[(threadIndex + i) % numQueues];
+		lock_guard<mutex> guard(queue.lock);
+		if (queue.count > 0)
+		{
+			job = popFront(queue);
+			numQueued--;
+			return job;
+		}
+	}
+
+	return job;
+}
+
+void JobSystem::execute(const JobHandle &job)
+{
+	JobHandle continuations[JOB_INLINE_CONTINUATIONS];
+	vector<JobHandle> moreContinuations;
+	int numContinuations;
+
+	if (job->work)
+		job->work();
+
+	{
+		lock_guard<mutex> guard(job->lock);
+		job->bDone = true;
+		numContinuations = job->numContinuations;
+		for (int i = 0; i < numContinuations; i++)
+			continuations[i].swap(job->continuations[i]);
+		moreContinuations.swap(job->moreContinuations);
+	}
+	for (int i = 0; i < numContinuations; i++)
+		release(continuations[i]);
+	for (const JobHandle &continuation : moreContinuations)
+		release(continuation);
+}
+
+void JobSystem::release(const JobHandle &job)
+{
+	if (--job->pending == 0)
+		push(job);
+}
+
+
+void JobSystem::pushBack(Queue &queue, const JobHandle &job)
+{
+	int capacity = int(queue.jobs.size());
+
+	// Full, the jobs are moved in order to a buffer twice as big
+	if (queue.count == capacity)
+	{
+		vector<JobHandle> jobs(max(2 * capacity, JOB_QUEUE_CAPACITY));
+		for (int i = 0; i < queue.count; i++)
+			jobs[i].swap(queue.jobs[(queue.first + i) % capacity]);
+		queue.jobs.swap(jobs);
+		queue.first = 0;
+		capacity = int(queue.jobs.size());
+	}
+
+	queue.jobs[(queue.first + queue.count) % capacity] = job;
+	queue.count++;
+}
+
+JobSystem::JobHandle JobSystem::popBack(Queue &queue)
+{
+	JobHandle job;
+
+	job.swap(queue.jobs[(queue.first + queue.count - 1) % queue.jobs.size()]);
+	queue.count--;
+
+	return job;
+}
+
+JobSystem::JobHandle JobSystem::popFront(Queue &queue)
+{
+	JobHandle job;
+
+	job.swap(queue.jobs[queue.first]);
+	queue.first = (queue.first + 1) % queue.jobs.size();
+	queue.count--;
+
+	return job;
+}
@@ -0,0 +1,125 @@
+#ifndef _JOB_SYSTEM_INCLUDE
+#define _JOB_SYSTEM_INCLUDE
+
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+
+using namespace std;
+
+
+#define JOB_MAX_THREADS 64
+#define JOB_QUEUE_CAPACITY 256		// Jobs per queue before it has to grow
+#define JOB_INLINE_CONTINUATIONS 2	// Continuations kept in the job itself
+
+
+// JobSystem is a singleton that runs jobs in a pool of worker threads.
+// Every thread has its own deque of jobs: it takes the newest job from its
+// own deque and, when it is empty, steals the oldest job of another one.
+// A job can depend on other jobs, it is not started until all of them
+// have finished, which is also how continuations are built.
+//
+// Threads waiting for a job run other jobs in the meantime, so the main
+// thread can wait without losing a core. OpenGL calls must happen in the
+// main thread; jobs queue them with runOnMainThread and the main thread
+// runs them every frame (and while it waits).
+//
+// Jobs and queues reuse their memory, so once they have grown to what a
+// frame needs creating and running jobs does not allocate.
+
+
+class JobSystem
+{
+
+private:
+	JobSystem();
+
+	struct Job;
+
+public:
+	typedef shared_ptr<Job> JobHandle;
+
+	static JobSystem &instance()
+	{
+		static JobSystem J;
+
+		return J;
+	}
+
+	~JobSystem();
+
+	// Starts numWorkers threads, by default one per core besides the main one
+	void init(int numWorkers = -1);
+	void shutdown();
+
+	int getNumThreads() const { return numWorkers + 1; }
+
+	JobHandle create(const function<void()> &work);
+	// Must be called before submitting job
+	void addDependency(const JobHandle &job, const JobHandle &dependency);
+	void submit(const JobHandle &job);
+	// Submits a job that runs work after job has finished
+	JobHandle then(const JobHandle &job, const function<void()> &work);
+
+	void wait(const JobHandle &job);
+	bool isDone(const JobHandle &job) const;
+
+	// Calls body on chunks [begin, end) of at most grain elements in parallel
+	// and returns when all of them are done
+	void parallelFor(int count, int grain, const function<void(int begin, int end)> &body);
+
+	// Lambdas are passed by reference, a function holding a big capture
+	// would be allocated on every call
+	template<class Body>
+	void parallelFor(int count, int grain, const Body &body)
+	{
+		parallelFor(count, grain, function<void(int begin, int end)>(cref(body)));
+	}
+
+	void runOnMainThread(const function<void()> &work);
+	void runMainThreadJobs();
+	bool isMainThread() const;
+
+private:
+	// Ring buffer, newest at the back
+	struct Queue
+	{
+		mutex lock;
+		vector<JobHandle> jobs;
+		int first, count;
+	};
+
+	void workerLoop(int index);
+	void push(const JobHandle &job);
+	JobHandle findJob();
+	void execute(const JobHandle &job);
+	void release(const JobHandle &job);
+
+	static void pushBack(Queue &queue, const JobHandle &job);
+	static JobHandle popBack(Queue &queue);
+	static JobHandle popFront(Queue &queue);
+
+private:
+	int numWorkers;
+	vector<thread> workers;
+	Queue queues[JOB_MAX_THREADS];
+
+	atomic<int> numQueued;
+	atomic<bool> bQuit;
+	mutex sleepLock;
+	condition_variable sleepCondition;
+
+	thread::id mainThread;
+	mutex mainLock;
+	vector<function<void()>> mainJobs;
+
+};
+
+
+#endif // _JOB_SYSTEM_INCLUDE
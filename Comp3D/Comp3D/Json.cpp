@@ -0,0 +1,33 @@
+#include <cstdio>
+#include "Json.h"
+
+
+string jsonString(const string& text)
+{
+	string quoted = "\"";
+	char escaped[8];
+
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (c == '\n')
+			quoted += "\\n";
+		else if (c == '\t')
+			quoted += "\\t";
+		else if (c == '\r')
+			quoted += "\\r";
+		else if ((unsigned char)c < 0x20)
+		{
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+			quoted += escaped;
+		}
+		else
+			quoted += c;
+	}
+
+	return quoted + "\"";
+}
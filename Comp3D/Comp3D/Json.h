@@ -0,0 +1,21 @@
+#ifndef _JSON_INCLUDE
+#define _JSON_INCLUDE
+
+
+#include <string>
+
+
+using namespace std;
+
+
+// Helpers of the JSON files the game writes: the benchmark results, the
+// memory breakdown. There is no reader, the files are for other tools.
+
+
+// text quoted as a JSON string. Quotes, backslashes and every control
+// character are escaped, so names and messages can be anything.
+
+string jsonString(const string& text);
+
+
+#endif // _JSON_INCLUDE
@@ -0,0 +1,158 @@
+#include <cstdint>
+#include <cstdlib>
+#include "LevelArena.h"
+#include "MemoryAccounting.h"
+
+
+LevelArena::LevelArena()
+{
+	currentBlock = 0;
+	destructors = NULL;
+	stats = Stats();
+	frameAllocations = 0;
+	frameBytes = 0;
+	// The objects destroyed with the arena account for what they free, so
+	// it has to be destroyed after the arena
+	MemoryAccounting::instance();
+}
+
+LevelArena::~LevelArena()
+{
+	reset();
+	for (Block& block : blocks)
+	{
+		MemoryAccounting::instance().release(MemoryAccounting::LEVEL, MemoryAccounting::CPU, "level arena", block.size);
+		free(block.memory);
+	}
+}
+
+
+void* LevelArena::allocate(size_t bytes, size_t alignment)
+{
+	lock_guard<mutex> guard(lock);
+
+	stats.levelAllocations++;
+	stats.levelBytes += bytes;
+	frameAllocations++;
+	frameBytes += bytes;
+
+	return allocateUnlocked(bytes, alignment);
+}
+
+void* LevelArena::allocateUnlocked(size_t bytes, size_t alignment)
+{
+	void* memory;
+
+	// Too big to share a block
+	if (bytes + alignment > LEVEL_ARENA_BLOCK / 4)
+	{
+		Block block;
+		block.size = bytes + alignment;
+		block.used = 0;
+		block.memory = static_cast<char*>(malloc(block.size));
+		if (block.memory == NULL)
+			throw bad_alloc();
+		largeBlocks.push_back(block);
+		stats.reservedBytes += block.size;
+		MemoryAccounting::instance().allocate(MemoryAccounting::LEVEL, MemoryAccounting::CPU, "level arena", block.size);
+		return alignIn(largeBlocks.back(), bytes, alignment);
+	}
+
+	// The blocks of previous levels are used before asking for new ones
+	for (; currentBlock < int(blocks.size()); currentBlock++)
+	{
+		memory = alignIn(blocks[currentBlock], bytes, alignment);
+		if (memory != NULL)
+			return memory;
+	}
+
+	Block block;
+	block.size = LEVEL_ARENA_BLOCK;
+	block.used = 0;
+	block.memory = static_cast<char*>(malloc(block.size));
+	if (block.memory == NULL)
+		throw bad_alloc();
+	blocks.push_back(block);
+	stats.reservedBytes += block.size;
+	MemoryAccounting::instance().allocate(MemoryAccounting::LEVEL, MemoryAccounting::CPU, "level arena", block.size);
+	currentBlock = int(blocks.size()) - 1;
+
+	return alignIn(blocks.back(), bytes, alignment);
+}
+
+void* LevelArena::alignIn(Block& block, size_t bytes, size_t alignment)
+{
+	uintptr_t start = uintptr_t(block.memory) + block.used;
+	uintptr_t aligned = (start + alignment - 1) & ~uintptr_t(alignment - 1);
+	size_t used = block.used + (aligned - start) + bytes;
+
+	if (used > block.size)
+		return NULL;
+	block.used = used;
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+void LevelArena::addDestructor(void* object, void (*destroy)(void* object))
+{
+	lock_guard<mutex> guard(lock);
+
+	// The list lives in the arena too
+	Destructor* destructor = static_cast<Destructor*>(allocateUnlocked(sizeof(Destructor), alignof(Destructor)));
+	destructor->destroy = destroy;
+	destructor->object = object;
+	destructor->next = destructors;
+	destructors = destructor;
+	stats.numObjects++;
+}
+
+
+void LevelArena::reset()
+{
+	Destructor* destructor;
+
+	// Destructors may free OpenGL objects or sounds, they run without the lock
+	{
+		lock_guard<mutex> guard(lock);
+		destructor = destructors;
+		destructors = NULL;
+	}
+	for (; destructor != NULL; destructor = destructor->next)
+		destructor->destroy(destructor->object);
+
+	lock_guard<mutex> guard(lock);
+	for (Block& block : largeBlocks)
+	{
+		stats.reservedBytes -= block.size;
+		MemoryAccounting::instance().release(MemoryAccounting::LEVEL, MemoryAccounting::CPU, "level arena", block.size);
+		free(block.memory);
+	}
+	largeBlocks.clear();
+	for (Block& block : blocks)
+		block.used = 0;
+	currentBlock = 0;
+
+	stats.levelAllocations = 0;
+	stats.levelBytes = 0;
+	stats.numObjects = 0;
+	stats.numLevels++;
+}
+
+void LevelArena::beginFrame()
+{
+	lock_guard<mutex> guard(lock);
+
+	stats.frameAllocations = frameAllocations;
+	stats.frameBytes = frameBytes;
+	frameAllocations = 0;
+	frameBytes = 0;
+}
+
+
+LevelArena::Stats LevelArena::getStats()
+{
+	lock_guard<mutex> guard(lock);
+
+	stats.numBlocks = int(blocks.size() + largeBlocks.size());
+	return stats;
+}
@@ -0,0 +1,123 @@
+#ifndef _LEVEL_ARENA_INCLUDE
+#define _LEVEL_ARENA_INCLUDE
+
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+
+using namespace std;
+
+
+#define LEVEL_ARENA_BLOCK (1 << 20)		// Bytes, bigger allocations get a block of their own
+#define LEVEL_ARENA_ALIGNMENT 16
+
+
+// LevelArena is where everything that lives as long as a level comes from:
+// the scene, its tile map and entities, their models and CPU buffers.
+// Allocating is moving a pointer forward inside a block, and nothing is
+// freed on its own. When the level ends reset destroys all the objects,
+// newest first, and the blocks are kept for the next level, so switching
+// levels neither leaks nor fragments the heap.
+//
+// Objects made with create get their destructor called by reset. Memory
+// from allocate and createArray is only given back.
+//
+// The counters tell how much the current level and the last frame asked
+// for. A level should only allocate while it loads.
+
+
+class LevelArena
+{
+
+private:
+	LevelArena();
+
+public:
+	struct Stats
+	{
+		int frameAllocations;			// Last complete frame
+		size_t frameBytes;
+		int levelAllocations;			// Since the last reset
+		size_t levelBytes;
+		int numObjects;					// Waiting for their destructor
+		int numBlocks;
+		size_t reservedBytes;			// In blocks, used or not
+		int numLevels;					// Resets so far
+	};
+
+	static LevelArena& instance()
+	{
+		static LevelArena A;
+
+		return A;
+	}
+
+	~LevelArena();
+
+	void* allocate(size_t bytes, size_t alignment = LEVEL_ARENA_ALIGNMENT);
+
+	template<class T, class... Args>
+	T* create(Args&&... args)
+	{
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+		if (!is_trivially_destructible<T>::value)
+			addDestructor(object, &destroy<T>);
+		return object;
+	}
+
+	template<class T>
+	T* createArray(size_t count)
+	{
+		static_assert(is_trivially_destructible<T>::value, "Arrays are never destroyed");
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Destroys every object and frees the memory for the next level
+	void reset();
+	void beginFrame();
+
+	Stats getStats();
+
+private:
+	struct Block
+	{
+		char* memory;
+		size_t size, used;
+	};
+
+	struct Destructor
+	{
+		void (*destroy)(void* object);
+		void* object;
+		Destructor* next;
+	};
+
+	template<class T>
+	static void destroy(void* object)
+	{
+		static_cast<T*>(object)->~T();
+	}
+
+	void addDestructor(void* object, void (*destroy)(void* object));
+	void* allocateUnlocked(size_t bytes, size_t alignment);
+	static void* alignIn(Block& block, size_t bytes, size_t alignment);
+
+private:
+	mutex lock;
+	vector<Block> blocks;				// LEVEL_ARENA_BLOCK bytes, kept between levels
+	vector<Block> largeBlocks;			// One allocation each, freed by reset
+	int currentBlock;
+	Destructor* destructors;			// Newest first
+	Stats stats;
+	int frameAllocations;
+	size_t frameBytes;
+
+};
+
+
+#endif // _LEVEL_ARENA_INCLUDE
@@ -0,0 +1,460 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
+#include "LevelFile.h"
+
+
+using namespace std;
+
+
+// Same order as TileMap::orientation
+enum { BUTTON_UP, BUTTON_LEFT, BUTTON_DOWN, BUTTON_RIGHT };
+
+
+LevelFile::LevelFile()
+{
+	bBinary = false;
+	nextRow = 0;
+	tiles = tilesEnd = NULL;
+	runTile = ' ';
+	runLeft = 0;
+}
+
+LevelFile::~LevelFile()
+{
+	close();
+}
+
+
+bool LevelFile::open(const string& filename, const string& sourceFile)
+{
+	close();
+	level = LevelData();
+	level.lastCheckpoint = -1;
+	nextRow = 0;
+
+	if (file.open(filename) && file.size() >= 4 && memcmp(file.data(), "C3DL", 4) == 0)
+		return openBinary(filename, sourceFile);
+	file.close();
+
+	return openText(filename);
+}
+
+void LevelFile::close()
+{
+	if (fin.is_open())
+		fin.close();
+	fin.clear();
+	file.close();
+	tiles = tilesEnd = NULL;
+	runLeft = 0;
+	bBinary = false;
+}
+
+const char* LevelFile::readRow()
+{
+	if (nextRow >= level.mapSize.y)
+		return NULL;
+
+	if (bBinary)
+	{
+		// Runs may cross row boundaries
+		for (int i = 0; i < level.mapSize.x;)
+		{
+			if (runLeft == 0)
+			{
+				if (tiles + 2 > tilesEnd)
+					return NULL;
+				runLeft = tiles[0];
+				runTile = char(tiles[1]);
+				tiles += 2;
+			}
+			int n = min(runLeft, level.mapSize.x - i);
+			memset(&row[i], runTile, n);
+			runLeft -= n;
+			i += n;
+		}
+	}
+	else
+	{
+		string line;
+
+		if (!getline(fin, line))
+			return NULL;
+		parseTextRow(line);
+	}
+	nextRow++;
+
+	return &row[0];
+}
+
+
+string LevelFile::binaryPath(const string& textFile)
+{
+	string::size_type dot = textFile.find_last_of('.');
+	string::size_type slash = textFile.find_last_of("/\\");
+
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return textFile + ".lvl";
+	return textFile.substr(0, dot) + ".lvl";
+}
+
+bool LevelFile::convert(const string& textFile, const string& binaryFile)
+{
+	LevelFile text;
+	vector<unsigned char> encoded;
+	const char* tileRow;
+	char tile = ' ';
+	int count = 0;
+
+	if (!text.open(textFile) || text.isBinary())
+		return false;
+
+	// Run-length encode the tile layer as (count, tile) byte pairs
+	while ((tileRow = text.readRow()) != NULL)
+	{
+		for (int i = 0; i < text.level.mapSize.x; i++)
+		{
+			if (count > 0 && (tileRow[i] != tile || count == 255))
+			{
+				encoded.push_back((unsigned char)count);
+				encoded.push_back((unsigned char)tile);
+				count = 0;
+			}
+			tile = tileRow[i];
+			count++;
+		}
+	}
+	if (text.nextRow != text.level.mapSize.y)
+	{
+		cerr << "Level '" << textFile << "' has only " << text.nextRow << " rows" << endl;
+		return false;
+	}
+	if (count > 0)
+	{
+		encoded.push_back((unsigned char)count);
+		encoded.push_back((unsigned char)tile);
+	}
+	text.close();
+
+	const LevelData& level = text.level;
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "C3DL", 4);
+	header.version = LEVEL_FILE_VERSION;
+	header.mapSize[0] = level.mapSize.x;
+	header.mapSize[1] = level.mapSize.y;
+	header.roomSize[0] = level.roomSize.x;
+	header.roomSize[1] = level.roomSize.y;
+	header.centerCamera[0] = level.centerCamera.x;
+	header.centerCamera[1] = level.centerCamera.y;
+	header.centerCamera[2] = level.centerCamera.z;
+	header.movementCamera[0] = level.movementCamera.x;
+	header.movementCamera[1] = level.movementCamera.y;
+	header.checkpointPlayer[0] = level.checkpointPlayer.x;
+	header.checkpointPlayer[1] = level.checkpointPlayer.y;
+	header.checkpointPlayer[2] = level.checkpointPlayer.z;
+	header.style = level.style;
+	header.lastCheckpoint = level.lastCheckpoint;
+	header.numWalls = int32_t(level.walls.size());
+	header.numBallSpikes = int32_t(level.ballSpikes.size());
+	header.numButtons = int32_t(level.buttons.size());
+	header.numSwitchs = int32_t(level.switchs.size());
+	header.numDoors = int32_t(level.doors.size());
+	header.tileBytes = int32_t(encoded.size());
+	if (!hashSource(textFile, header))
+		return false;
+
+	vector<EntityRecord> records;
+	for (const LevelWall& wall : level.walls)
+		records.push_back({ wall.position.x, wall.position.y, wall.bVertical, wall.type });
+	for (const pair<bool, glm::vec2>& ballSpike : level.ballSpikes)
+		records.push_back({ ballSpike.second.x, ballSpike.second.y, ballSpike.first, 0 });
+	for (const tuple<bool, glm::vec2, int>& button : level.buttons)
+		records.push_back({ get<1>(button).x, get<1>(button).y, get<0>(button), get<2>(button) });
+	for (const pair<bool, glm::vec2>& switx : level.switchs)
+		records.push_back({ switx.second.x, switx.second.y, switx.first, 0 });
+
+	ofstream fout(binaryFile.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!fout.is_open())
+		return false;
+	fout.write((const char*)&header, sizeof(header));
+	if (!records.empty())
+		fout.write((const char*)&records[0], records.size() * sizeof(EntityRecord));
+	if (!level.doors.empty())
+		fout.write((const char*)&level.doors[0], level.doors.size() * sizeof(int32_t));
+	if (!encoded.empty())
+		fout.write((const char*)&encoded[0], encoded.size());
+
+	return fout.good();
+}
+
+
+// Size, lines and FNV-1a of the text file without its '\r', so that the
+// line endings a checkout gives it do not matter. Only convert and the
+// Debug check read the whole text.
+
+bool LevelFile::hashSource(const string& textFile, Header& header)
+{
+	MappedFile source;
+	uint64_t hash = 14695981039346656037ULL;
+
+	if (!source.open(textFile))
+		return false;
+	header.sourceSize = header.sourceLines = 0;
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		if (source.data()[i] == '\r')
+			continue;
+		header.sourceSize++;
+		if (source.data()[i] == '\n')
+			header.sourceLines++;
+		hash ^= (unsigned char)source.data()[i];
+		hash *= 1099511628211ULL;
+	}
+	header.sourceHash = hash;
+
+	return true;
+}
+
+// A checkout with CRLF line endings adds a byte per line. Checkouts write
+// both files at about the same time, so the text is only newer than the
+// binary file when it was edited after the conversion.
+
+bool LevelFile::isStale(const string& binaryFile, const string& sourceFile, const Header& header)
+{
+	struct stat source, binary;
+
+	// Shipped without its text
+	if (stat(sourceFile.c_str(), &source) != 0 || stat(binaryFile.c_str(), &binary) != 0)
+		return false;
+	if (source.st_size != header.sourceSize && source.st_size != header.sourceSize + header.sourceLines)
+		return true;
+	if (source.st_mtime > binary.st_mtime)
+		return true;
+#ifdef _DEBUG
+	Header current;
+	if (hashSource(sourceFile, current) && current.sourceHash != header.sourceHash)
+		return true;
+#endif
+
+	return false;
+}
+
+
+bool LevelFile::openText(const string& filename)
+{
+	string line;
+
+	fin.open(filename.c_str());
+	if (!fin.is_open())
+		return false;
+	getline(fin, line);
+	if (line.compare(0, 7, "TILEMAP") != 0)
+		return false;
+
+	// Every header line gets its own stream, the trailing comments are ignored
+	getline(fin, line);
+	istringstream(line) >> level.mapSize.x >> level.mapSize.y;
+	getline(fin, line);
+	istringstream(line) >> level.roomSize.x >> level.roomSize.y;
+	getline(fin, line);
+	istringstream(line) >> level.centerCamera.x >> level.centerCamera.y >> level.centerCamera.z;
+	getline(fin, line);
+	istringstream(line) >> level.movementCamera.x >> level.movementCamera.y;
+	getline(fin, line);
+	istringstream(line) >> level.checkpointPlayer.x >> level.checkpointPlayer.y >> level.checkpointPlayer.z;
+	getline(fin, line);
+	istringstream(line) >> level.style;
+
+	// Tiles are indexed with an int
+	if (!fin || level.mapSize.x <= 0 || level.mapSize.y <= 0 || (long long)level.mapSize.x * level.mapSize.y > INT_MAX)
+		return false;
+	row.resize(level.mapSize.x);
+
+	return true;
+}
+
+bool LevelFile::openBinary(const string& filename, const string& sourceFile)
+{
+	Header header;
+	const char* data = file.data();
+	size_t offset = sizeof(Header);
+
+	if (file.size() < sizeof(Header))
+		return false;
+	memcpy(&header, data, sizeof(Header));
+	if (header.version != LEVEL_FILE_VERSION || header.mapSize[0] <= 0 || header.mapSize[1] <= 0 ||
+		(long long)header.mapSize[0] * header.mapSize[1] > INT_MAX)
+		return false;
+	int numTiles = header.mapSize[0] * header.mapSize[1];
+
+	// Counts are signed in the file, a corrupt one must not wrap the sizes
+	if (header.numWalls < 0 || header.numBallSpikes < 0 || header.numButtons < 0 || header.numSwitchs < 0 ||
+		header.numDoors < 0 || header.tileBytes < 0)
+		return false;
+
+	size_t numRecords = size_t(header.numWalls) + size_t(header.numBallSpikes) + size_t(header.numButtons) + size_t(header.numSwitchs);
+	size_t expected = offset + numRecords * sizeof(EntityRecord) + size_t(header.numDoors) * sizeof(int32_t) + size_t(header.tileBytes);
+	if (file.size() < expected)
+		return false;
+
+	if (!sourceFile.empty() && isStale(filename, sourceFile, header))
+	{
+		cerr << "Level '" << sourceFile << "' changed since it was converted, the binary file is ignored" << endl;
+		return false;
+	}
+
+	level.mapSize = glm::ivec2(header.mapSize[0], header.mapSize[1]);
+	level.roomSize = glm::vec2(header.roomSize[0], header.roomSize[1]);
+	level.centerCamera = glm::vec3(header.centerCamera[0], header.centerCamera[1], header.centerCamera[2]);
+	level.movementCamera = glm::vec2(header.movementCamera[0], header.movementCamera[1]);
+	level.checkpointPlayer = glm::vec3(header.checkpointPlayer[0], header.checkpointPlayer[1], header.checkpointPlayer[2]);
+	level.style = header.style;
+	// Doors and the checkpoint are tile indices that the tile map writes to
+	if (header.lastCheckpoint < -1 || header.lastCheckpoint >= numTiles)
+		return false;
+	level.lastCheckpoint = header.lastCheckpoint;
+
+	vector<EntityRecord> records(numRecords);
+	if (numRecords > 0)
+		memcpy(&records[0], data + offset, numRecords * sizeof(EntityRecord));
+	offset += numRecords * sizeof(EntityRecord);
+
+	const EntityRecord* record = records.empty() ? NULL : &records[0];
+	level.walls.resize(header.numWalls);
+	for (int i = 0; i < header.numWalls; i++, record++)
+	{
+		level.walls[i].position = glm::vec2(record->x, record->y);
+		level.walls[i].bVertical = record->flag != 0;
+		level.walls[i].type = record->value;
+	}
+	for (int i = 0; i < header.numBallSpikes; i++, record++)
+		level.ballSpikes.push_back({ record->flag != 0, glm::vec2(record->x, record->y) });
+	for (int i = 0; i < header.numButtons; i++, record++)
+		level.buttons.push_back(make_tuple(record->flag != 0, glm::vec2(record->x, record->y), int(record->value)));
+	for (int i = 0; i < header.numSwitchs; i++, record++)
+		level.switchs.push_back({ record->flag != 0, glm::vec2(record->x, record->y) });
+
+	level.doors.resize(header.numDoors);
+	if (header.numDoors > 0)
+		memcpy(&level.doors[0], data + offset, header.numDoors * sizeof(int32_t));
+	offset += header.numDoors * sizeof(int32_t);
+	for (int door : level.doors)
+		if (door < 0 || door >= numTiles)
+			return false;
+
+	tiles = (const unsigned char*)data + offset;
+	tilesEnd = tiles + header.tileBytes;
+	runLeft = 0;
+	row.resize(level.mapSize.x);
+	bBinary = true;
+
+	return true;
+}
+
+
+// Converts a row of the text format into tiles. Entities are extracted
+// into their lists and leave an empty tile behind.
+
+void LevelFile::parseTextRow(const string& line)
+{
+	int j = nextRow;
+	char tile;
+
+	for (int i = 0; i < level.mapSize.x; i++)
+	{
+		// Short lines (or a trailing '\r') are padded with empty space
+		tile = (i < int(line.size()) && line[i] != '\r') ? line[i] : ' ';
+
+		switch (tile) {
+
+			case('0'):
+				row[i] = ' ';
+				break;
+
+			case('$'):
+				level.checkpointPlayer = glm::vec3(i, j, 0);
+				row[i] = ' ';
+				break;
+
+			case('v'):			// easy vertical wall
+			case('V'):			// hard vertical wall
+			case('|'):			// impossible vertical wall
+			case('h'):			// easy horizontal wall
+			case('H'):			// hard horizontal wall
+			case('-'): {		// impossible horizontal wall
+				LevelWall wall;
+				wall.position = glm::vec2(i, j);
+				wall.bVertical = (tile == 'v' || tile == 'V' || tile == '|');
+				wall.type = (tile == 'v' || tile == 'h') ? 0 : (tile == 'V' || tile == 'H') ? 1 : 2;
+				level.walls.push_back(wall);
+				row[i] = ' ';
+				break; }
+
+			case('o'):			// easy vertical ballSpike
+				level.ballSpikes.push_back({ true, glm::vec2(i, j) });
+				row[i] = ' ';
+				break;
+
+			case('O'):			// horizontal ballSpike
+				level.ballSpikes.push_back({ false, glm::vec2(i, j) });
+				row[i] = ' ';
+				break;
+
+			case('d'):		// door
+			case('j'):		// chain
+			case('q'):		// lock
+			case('2'):
+			case('3'):
+			case('6'):
+			case('7'):
+			case('8'):
+			case('9'):
+				row[i] = tile;
+				level.doors.push_back(j * level.mapSize.x + i);
+				break;
+
+			case('U'):		// button up
+				level.buttons.push_back(make_tuple(false, glm::vec2(i, j), int(BUTTON_UP)));
+				row[i] = ' ';
+				break;
+
+			case('D'):		// button down
+				level.buttons.push_back(make_tuple(false, glm::vec2(i, j), int(BUTTON_DOWN)));
+				row[i] = ' ';
+				break;
+
+			case('R'):		// button right
+				level.buttons.push_back(make_tuple(false, glm::vec2(i, j), int(BUTTON_RIGHT)));
+				row[i] = ' ';
+				break;
+
+			case('L'):		// button left
+				level.buttons.push_back(make_tuple(false, glm::vec2(i, j), int(BUTTON_LEFT)));
+				row[i] = ' ';
+				break;
+
+			case('y'):		// yes swicth
+				level.switchs.push_back({ true, glm::vec2(i, j) });
+				row[i] = ' ';
+				break;
+
+			case('n'):		// no switch
+				level.switchs.push_back({ false, glm::vec2(i, j) });
+				row[i] = ' ';
+				break;
+
+			case('C'):		// active checkpoint
+				row[i] = tile;
+				level.lastCheckpoint = j * level.mapSize.x + i;
+				break;
+
+			default:
+				row[i] = tile;
+				break;
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#ifndef _LEVEL_FILE_INCLUDE
+#define _LEVEL_FILE_INCLUDE
+
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <stdint.h>
+#include "MappedFile.h"
+
+
+using namespace std;
+
+
+#define LEVEL_FILE_VERSION 3
+
+
+struct LevelWall
+{
+	glm::vec2 position;
+	bool bVertical;
+	int type;
+};
+
+
+// Everything a level file describes except the tiles themselves
+
+struct LevelData
+{
+	glm::ivec2 mapSize;
+	glm::vec2 roomSize;
+	glm::vec3 centerCamera;
+	glm::vec2 movementCamera;
+	glm::vec3 checkpointPlayer;
+	int style;
+
+	vector<LevelWall> walls;
+	vector<pair<bool, glm::vec2>> ballSpikes;
+	vector<tuple<bool, glm::vec2, int>> buttons;
+	vector<pair<bool, glm::vec2>> switchs;
+	vector<int> doors;
+	int lastCheckpoint;
+};
+
+
+// LevelFile reads levels either from the TILEMAP text format (see level01.txt)
+// or from its binary form. The binary file is a fixed header, the entity
+// tables already extracted, and the tile layer run-length encoded, so
+// loading it is a few memcpys instead of parsing the text character by
+// character. Text is what levels are authored in, convert() produces the
+// binary files that ship.
+//
+// Tiles are returned one row at a time so that a map never has to be held
+// in memory twice.
+//
+// The binary file stores the size of the text it was converted from. When
+// the text file is there and its size is different, or it was written after
+// the binary file, the binary file is stale and open fails, so that the
+// caller loads the text instead. Nothing is read from the text file for
+// that; only Debug builds also compare a hash of it, which catches edits
+// that keep the size within the same second.
+
+
+class LevelFile
+{
+
+public:
+	LevelFile();
+	~LevelFile();
+
+	// Header and entity tables are ready after open. With text files the
+	// entities are only complete after the last row has been read.
+	// A binary file is checked against sourceFile when there is one.
+	bool open(const string& filename, const string& sourceFile = "");
+	void close();
+
+	const char* readRow();
+
+	LevelData& getLevel() { return level; }
+	bool isBinary() const { return bBinary; }
+
+	static string binaryPath(const string& textFile);
+	static bool convert(const string& textFile, const string& binaryFile);
+
+private:
+	struct Header
+	{
+		char magic[4];					// "C3DL"
+		int32_t version;
+		int32_t mapSize[2];
+		float roomSize[2];
+		float centerCamera[3];
+		float movementCamera[2];
+		float checkpointPlayer[3];
+		int32_t style;
+		int32_t lastCheckpoint;
+		int32_t numWalls, numBallSpikes, numButtons, numSwitchs, numDoors;
+		int32_t tileBytes;				// Size of the run-length encoded tile layer
+		int64_t sourceSize, sourceLines;	// Of the text file without its '\r'
+		uint64_t sourceHash;			// See hashSource
+	};
+
+	// Walls, ball spikes, buttons and switchs share the same record
+	struct EntityRecord
+	{
+		float x, y;
+		int32_t flag;					// Vertical, pressed or activated
+		int32_t value;					// Wall type or button orientation
+	};
+
+private:
+	static bool hashSource(const string& textFile, Header& header);
+	static bool isStale(const string& binaryFile, const string& sourceFile, const Header& header);
+
+	bool openText(const string& filename);
+	bool openBinary(const string& filename, const string& sourceFile);
+	void parseTextRow(const string& line);
+
+private:
+	LevelData level;
+	bool bBinary;
+	int nextRow;
+	vector<char> row;
+
+	ifstream fin;
+
+	MappedFile file;
+	const unsigned char *tiles, *tilesEnd;
+	char runTile;
+	int runLeft;
+
+};
+
+
+#endif // _LEVEL_FILE_INCLUDE
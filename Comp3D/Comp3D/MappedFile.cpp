@@ -0,0 +1,137 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+
+
+MappedFile::MappedFile()
+{
+	view = NULL;
+	length = 0;
+	bWritable = false;
+#ifdef _WIN32
+	hFile = INVALID_HANDLE_VALUE;
+	hMapping = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open(const string& filename, bool bWritable)
+{
+	close();
+	this->bWritable = bWritable;
+
+#ifdef _WIN32
+	hFile = CreateFileA(filename.c_str(), bWritable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+	length = size_t(fileSize.QuadPart);
+
+	hMapping = CreateFileMappingA(hFile, NULL, bWritable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL)
+	{
+		close();
+		return false;
+	}
+	view = (char*)MapViewOfFile(hMapping, bWritable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+#else
+	fd = ::open(filename.c_str(), bWritable ? O_RDWR : O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	length = size_t(info.st_size);
+
+	void* address = mmap(NULL, length, bWritable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	view = (address == MAP_FAILED) ? NULL : (char*)address;
+#endif
+
+	if (view == NULL)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (view != NULL)
+		UnmapViewOfFile(view);
+	if (hMapping != NULL)
+		CloseHandle(hMapping);
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+	hMapping = NULL;
+	hFile = INVALID_HANDLE_VALUE;
+#else
+	if (view != NULL)
+		munmap(view, length);
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+	view = NULL;
+	length = 0;
+}
+
+
+// Both advise calls are hints. The OS is free to ignore them and the
+// mapped memory stays valid either way.
+
+void MappedFile::adviseWillNeed(size_t offset, size_t len)
+{
+	if (view == NULL || offset >= length)
+		return;
+#ifndef _WIN32
+	size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	size_t begin = offset - offset % pageSize;
+	size_t end = (offset + len < length) ? offset + len : length;
+	madvise(view + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::adviseDontNeed(size_t offset, size_t len)
+{
+	if (view == NULL || offset >= length)
+		return;
+	size_t end = (offset + len < length) ? offset + len : length;
+#ifdef _WIN32
+	// Unlocking pages that are not locked removes them from the working set
+	VirtualUnlock(view + offset, end - offset);
+#else
+	// Only whole pages inside the range are dropped, shared mappings keep
+	// their contents in the file so nothing is lost
+	size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	size_t begin = ((offset + pageSize - 1) / pageSize) * pageSize;
+	end -= end % pageSize;
+	if (begin < end)
+		madvise(view + begin, end - begin, MADV_DONTNEED);
+#endif
+}
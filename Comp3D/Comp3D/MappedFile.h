@@ -0,0 +1,54 @@
+#ifndef _MAPPED_FILE_INCLUDE
+#define _MAPPED_FILE_INCLUDE
+
+
+#include <string>
+#include <cstddef>
+
+
+using namespace std;
+
+
+// MappedFile maps a whole file into the address space of the process.
+// Nothing is read until the memory is touched, so huge files cost no
+// memory until they are used. The advise methods let the owner tell the
+// OS which ranges will be needed soon and which ones can be dropped.
+
+
+class MappedFile
+{
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const string& filename, bool bWritable = false);
+	void close();
+
+	bool isOpen() const { return view != NULL; }
+	char* data() const { return view; }
+	size_t size() const { return length; }
+
+	void adviseWillNeed(size_t offset, size_t len);
+	void adviseDontNeed(size_t offset, size_t len);
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+private:
+	char* view;
+	size_t length;
+	bool bWritable;
+
+#ifdef _WIN32
+	void* hFile;
+	void* hMapping;
+#else
+	int fd;
+#endif
+
+};
+
+
+#endif // _MAPPED_FILE_INCLUDE
@@ -0,0 +1,320 @@
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include "MemoryAccounting.h"
+#include "Json.h"
+#include "Game.h"
+
+
+#define MEMORY_HUD_LINE 15				// Pixels between the lines of the HUD
+#define MEMORY_KB 1024.0
+
+
+static const char* subsystemNames[MemoryAccounting::NUM_SUBSYSTEMS] = { "models", "textures", "sprites", "particles",
+	"sounds", "level" };
+static const char* heapNames[MemoryAccounting::NUM_HEAPS] = { "cpu", "gpu" };
+
+
+MemoryAccounting::MemoryAccounting()
+{
+	memset(subsystems, 0, sizeof(subsystems));
+	memset(total, 0, sizeof(total));
+	memset(&level, 0, sizeof(level));
+	memset(budget, 0, sizeof(budget));
+	memset(bOverBudget, 0, sizeof(bOverBudget));
+	numOverBudget = 0;
+}
+
+
+const char* MemoryAccounting::getSubsystemName(Subsystem subsystem)
+{
+	return subsystemNames[subsystem];
+}
+
+void MemoryAccounting::allocate(Subsystem subsystem, Heap heap, const string& asset, size_t bytes)
+{
+	change(subsystem, heap, asset, (long long)bytes);
+}
+
+void MemoryAccounting::release(Subsystem subsystem, Heap heap, const string& asset, size_t bytes)
+{
+	change(subsystem, heap, asset, -(long long)bytes);
+}
+
+void MemoryAccounting::add(Usage& usage, long long bytes)
+{
+	usage.current += bytes;
+	usage.peak = max(usage.peak, usage.current);
+}
+
+void MemoryAccounting::change(Subsystem subsystem, Heap heap, const string& asset, long long bytes)
+{
+	if (bytes == 0)
+		return;
+
+	lock_guard<mutex> guard(lock);
+	pair<int, string> key(subsystem, asset);
+
+	map<pair<int, string>, Asset>::iterator it = assets.find(key);
+	if (it == assets.end())
+	{
+		Asset entry;
+		entry.subsystem = subsystem;
+		entry.name = asset;
+		memset(entry.usage, 0, sizeof(entry.usage));
+		it = assets.insert(make_pair(key, entry)).first;
+	}
+	add(it->second.usage[heap], bytes);
+	add(subsystems[subsystem][heap], bytes);
+	add(total[heap], bytes);
+
+	if (bytes > 0)
+		level.allocated[heap] += bytes;
+	level.peak[heap] = max(level.peak[heap], total[heap].current);
+
+	if (budget[heap] > 0 && total[heap].current > budget[heap] && !bOverBudget[heap])
+	{
+		cerr << "Over the " << heapNames[heap] << " memory budget in level " << level.level << ": "
+			<< total[heap].current / (MEMORY_KB * MEMORY_KB) << " MB of " << budget[heap] / (MEMORY_KB * MEMORY_KB)
+			<< " MB, loading '" << asset << "'" << endl;
+		bOverBudget[heap] = true;
+		numOverBudget++;
+	}
+}
+
+
+// What is still allocated when a level ends is what the next one starts
+// with, the peak of the next one starts from there.
+
+void MemoryAccounting::setLevel(int newLevel)
+{
+	lock_guard<mutex> guard(lock);
+
+	closeLevel();
+	memset(&level, 0, sizeof(level));
+	level.level = newLevel;
+	for (int heap = 0; heap < NUM_HEAPS; heap++)
+	{
+		level.peak[heap] = total[heap].current;
+		bOverBudget[heap] = false;
+	}
+}
+
+void MemoryAccounting::closeLevel()
+{
+	if (level.level == 0)
+		return;
+	for (int heap = 0; heap < NUM_HEAPS; heap++)
+		level.end[heap] = total[heap].current;
+	levels.push_back(level);
+}
+
+void MemoryAccounting::setBudget(Heap heap, long long bytes)
+{
+	lock_guard<mutex> guard(lock);
+
+	budget[heap] = bytes;
+}
+
+int MemoryAccounting::getNumOverBudget() const
+{
+	lock_guard<mutex> guard(lock);
+
+	return numOverBudget;
+}
+
+MemoryAccounting::Usage MemoryAccounting::getTotal(Heap heap) const
+{
+	lock_guard<mutex> guard(lock);
+
+	return total[heap];
+}
+
+MemoryAccounting::Usage MemoryAccounting::getSubsystem(Subsystem subsystem, Heap heap) const
+{
+	lock_guard<mutex> guard(lock);
+
+	return subsystems[subsystem][heap];
+}
+
+
+// Current and peak of every subsystem and level, in KB
+
+void MemoryAccounting::print(ostream& out) const
+{
+	lock_guard<mutex> guard(lock);
+	char text[128];
+
+	out << "Memory, current / peak KB:" << endl;
+	for (int i = 0; i <= NUM_SUBSYSTEMS; i++)
+	{
+		const Usage* usage = (i < NUM_SUBSYSTEMS) ? subsystems[i] : total;
+		snprintf(text, sizeof(text), "  %-10s cpu %10.1f / %10.1f  gpu %10.1f / %10.1f", (i < NUM_SUBSYSTEMS) ? subsystemNames[i] : "total",
+			usage[CPU].current / MEMORY_KB, usage[CPU].peak / MEMORY_KB, usage[GPU].current / MEMORY_KB, usage[GPU].peak / MEMORY_KB);
+		out << text << endl;
+	}
+	for (const LevelUsage& usage : levels)
+	{
+		snprintf(text, sizeof(text), "  level %-4d cpu %10.1f / %10.1f  gpu %10.1f / %10.1f  at its end", usage.level,
+			usage.end[CPU] / MEMORY_KB, usage.peak[CPU] / MEMORY_KB, usage.end[GPU] / MEMORY_KB, usage.peak[GPU] / MEMORY_KB);
+		out << text << endl;
+	}
+}
+
+
+void MemoryAccounting::writeUsage(ostream& out, const Usage usage[NUM_HEAPS]) const
+{
+	for (int heap = 0; heap < NUM_HEAPS; heap++)
+		out << "\"" << heapNames[heap] << "\": { \"current\": " << usage[heap].current << ", \"peak\": " << usage[heap].peak
+			<< " }" << ((heap + 1 < NUM_HEAPS) ? ", " : "");
+}
+
+// Bytes everywhere. The levels are the finished ones and the one being
+// played, if any.
+
+bool MemoryAccounting::exportJson(const string& filename) const
+{
+	lock_guard<mutex> guard(lock);
+	ofstream fout(filename.c_str(), ios::out | ios::trunc);
+
+	if (!fout.is_open())
+		return false;
+
+	fout << "{" << endl;
+	fout << "\t\"total\": { ";
+	writeUsage(fout, total);
+	fout << " }," << endl;
+	fout << "\t\"budget\": { \"cpu\": " << budget[CPU] << ", \"gpu\": " << budget[GPU] << ", \"exceeded\": " << numOverBudget
+		<< " }," << endl;
+
+	fout << "\t\"subsystems\": [" << endl;
+	for (int i = 0; i < NUM_SUBSYSTEMS; i++)
+	{
+		fout << "\t\t{ \"name\": \"" << subsystemNames[i] << "\", ";
+		writeUsage(fout, subsystems[i]);
+		fout << " }" << ((i + 1 < NUM_SUBSYSTEMS) ? "," : "") << endl;
+	}
+	fout << "\t]," << endl;
+
+	fout << "\t\"assets\": [" << endl;
+	unsigned int index = 0;
+	for (const pair<const pair<int, string>, Asset>& it : assets)
+	{
+		const Asset& asset = it.second;
+		fout << "\t\t{ \"subsystem\": \"" << subsystemNames[asset.subsystem] << "\", \"name\": " << jsonString(asset.name) << ", ";
+		writeUsage(fout, asset.usage);
+		fout << " }" << ((++index < assets.size()) ? "," : "") << endl;
+	}
+	fout << "\t]," << endl;
+
+	vector<LevelUsage> played = levels;
+	if (level.level != 0)
+	{
+		played.push_back(level);
+		for (int heap = 0; heap < NUM_HEAPS; heap++)
+			played.back().end[heap] = total[heap].current;
+	}
+	fout << "\t\"levels\": [" << endl;
+	for (unsigned int i = 0; i < played.size(); i++)
+	{
+		fout << "\t\t{ \"level\": " << played[i].level;
+		for (int heap = 0; heap < NUM_HEAPS; heap++)
+			fout << ", \"" << heapNames[heap] << "\": { \"allocated\": " << played[i].allocated[heap] << ", \"peak\": "
+				<< played[i].peak[heap] << ", \"end\": " << played[i].end[heap] << " }";
+		fout << " }" << ((i + 1 < played.size()) ? "," : "") << endl;
+	}
+	fout << "\t]" << endl;
+	fout << "}" << endl;
+
+	return fout.good();
+}
+
+
+// Drawn like the render stats HUD. The lines go down from position: every
+// subsystem, the total against the budget, and the assets that use most
+// memory right now.
+
+void MemoryAccounting::renderHud(const glm::vec2& position) const
+{
+	char text[128];
+	const Asset* top[MEMORY_HUD_ASSETS];
+	int numTop = 0;
+
+	lock_guard<mutex> guard(lock);
+
+	// Kept sorted while going through the assets, so drawing does not allocate
+	for (const pair<const pair<int, string>, Asset>& it : assets)
+	{
+		long long bytes = it.second.usage[CPU].current + it.second.usage[GPU].current;
+		int i = min(numTop, MEMORY_HUD_ASSETS - 1);
+		if (numTop == MEMORY_HUD_ASSETS && bytes <= top[i]->usage[CPU].current + top[i]->usage[GPU].current)
+			continue;
+		for (; i > 0 && bytes > top[i - 1]->usage[CPU].current + top[i - 1]->usage[GPU].current; i--)
+			top[i] = top[i - 1];
+		top[i] = &it.second;
+		numTop = min(numTop + 1, MEMORY_HUD_ASSETS);
+	}
+	int numLines = NUM_SUBSYSTEMS + 3 + numTop;
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1, 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glColor4f(0.f, 0.f, 0.f, 0.6f);
+	glBegin(GL_QUADS);
+	glVertex2f(position.x - 5.f, position.y - 5.f);
+	glVertex2f(position.x + 395.f, position.y - 5.f);
+	glVertex2f(position.x + 395.f, position.y + MEMORY_HUD_LINE * numLines + 5.f);
+	glVertex2f(position.x - 5.f, position.y + MEMORY_HUD_LINE * numLines + 5.f);
+	glEnd();
+
+	for (int i = 0; i < numLines; i++)
+	{
+		if (i == 0)
+			snprintf(text, sizeof(text), "level %d, current / peak KB", level.level);
+		else if (i <= NUM_SUBSYSTEMS)
+			snprintf(text, sizeof(text), "%-10s cpu %.0f / %.0f  gpu %.0f / %.0f", subsystemNames[i - 1],
+				subsystems[i - 1][CPU].current / MEMORY_KB, subsystems[i - 1][CPU].peak / MEMORY_KB,
+				subsystems[i - 1][GPU].current / MEMORY_KB, subsystems[i - 1][GPU].peak / MEMORY_KB);
+		else if (i == NUM_SUBSYSTEMS + 1)
+			snprintf(text, sizeof(text), "%-10s cpu %.0f / %.0f  gpu %.0f / %.0f", "total", total[CPU].current / MEMORY_KB,
+				total[CPU].peak / MEMORY_KB, total[GPU].current / MEMORY_KB, total[GPU].peak / MEMORY_KB);
+		else if (i == NUM_SUBSYSTEMS + 2)
+			snprintf(text, sizeof(text), "budget     cpu %.0f  gpu %.0f%s", budget[CPU] / MEMORY_KB, budget[GPU] / MEMORY_KB,
+				(bOverBudget[CPU] || bOverBudget[GPU]) ? "  EXCEEDED" : "");
+		else
+		{
+			const Asset* asset = top[i - NUM_SUBSYSTEMS - 3];
+			snprintf(text, sizeof(text), "%.40s  cpu %.0f  gpu %.0f", asset->name.c_str(), asset->usage[CPU].current / MEMORY_KB,
+				asset->usage[GPU].current / MEMORY_KB);
+		}
+		if (i == NUM_SUBSYSTEMS + 1 && (bOverBudget[CPU] || bOverBudget[GPU]))
+			glColor4f(1.f, 0.3f, 0.3f, 1.f);
+		else
+			glColor4f(1.f, 1.f, 1.f, 1.f);
+		glRasterPos2f(position.x, position.y + MEMORY_HUD_LINE * (i + 1) - 3.f);
+		for (const char* c = text; *c != '\0'; c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
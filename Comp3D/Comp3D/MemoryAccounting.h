@@ -0,0 +1,127 @@
+#ifndef _MEMORY_ACCOUNTING_INCLUDE
+#define _MEMORY_ACCOUNTING_INCLUDE
+
+
+#include <map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <ostream>
+#include <glm/glm.hpp>
+
+
+using namespace std;
+
+
+#define MEMORY_HUD_ASSETS 8				// Assets using most memory in the HUD
+
+
+// MemoryAccounting keeps track of where the memory of the game goes. The
+// code that allocates a GPU buffer or texture, or a big CPU buffer (meshes,
+// decoded images and sounds, the level arena), tells it the subsystem, the
+// asset (the file it comes from) and the size, and tells it again when it
+// frees it. Loads run in any thread.
+//
+// It keeps the current and peak bytes on the CPU and on the GPU of every
+// asset, every subsystem and the whole game, and of every level played:
+// what it allocated, its peak and what was still allocated when it ended.
+// The same asset loaded by several levels adds up, it is only shared if
+// the owner shares it. Going over a budget is reported once per level and
+// counted.
+
+
+class MemoryAccounting
+{
+
+private:
+	MemoryAccounting();
+
+public:
+	enum Subsystem
+	{
+		MODELS,
+		TEXTURES,
+		SPRITES,
+		PARTICLES,
+		SOUNDS,
+		LEVEL,
+		NUM_SUBSYSTEMS
+	};
+
+	enum Heap
+	{
+		CPU,
+		GPU,
+		NUM_HEAPS
+	};
+
+	struct Usage
+	{
+		long long current, peak;
+	};
+
+	static MemoryAccounting& instance()
+	{
+		static MemoryAccounting M;
+
+		return M;
+	}
+
+	static const char* getSubsystemName(Subsystem subsystem);
+
+	void allocate(Subsystem subsystem, Heap heap, const string& asset, size_t bytes);
+	void release(Subsystem subsystem, Heap heap, const string& asset, size_t bytes);
+
+	// The level being played, 0 when none. Closes the previous one.
+	void setLevel(int level);
+	// 0 for no budget
+	void setBudget(Heap heap, long long bytes);
+	int getNumOverBudget() const;
+
+	Usage getTotal(Heap heap) const;
+	Usage getSubsystem(Subsystem subsystem, Heap heap) const;
+
+	void print(ostream& out) const;
+	bool exportJson(const string& filename) const;
+	// Fixed pipeline and GLUT fonts, with position the top left corner in
+	// the coordinates of the 2D sprites
+	void renderHud(const glm::vec2& position) const;
+
+private:
+	struct Asset
+	{
+		Subsystem subsystem;
+		string name;
+		Usage usage[NUM_HEAPS];
+	};
+
+	struct LevelUsage
+	{
+		int level;
+		long long allocated[NUM_HEAPS];	// While it was played
+		long long peak[NUM_HEAPS];
+		long long end[NUM_HEAPS];			// Still allocated when it ended
+	};
+
+	static void add(Usage& usage, long long bytes);
+	void change(Subsystem subsystem, Heap heap, const string& asset, long long bytes);
+	void closeLevel();
+	void writeUsage(ostream& out, const Usage usage[NUM_HEAPS]) const;
+
+private:
+	mutable mutex lock;
+	map<pair<int, string>, Asset> assets;		// By subsystem and name
+	Usage subsystems[NUM_SUBSYSTEMS][NUM_HEAPS];
+	Usage total[NUM_HEAPS];
+
+	vector<LevelUsage> levels;				// Finished ones
+	LevelUsage level;						// Level 0 is outside any level
+
+	long long budget[NUM_HEAPS];
+	bool bOverBudget[NUM_HEAPS];			// Already reported in this level
+	int numOverBudget;
+
+};
+
+
+#endif // _MEMORY_ACCOUNTING_INCLUDE
@@ -22,10 +22,14 @@ void MenuGameState::init()
 	projection = glm::ortho(0.f, float(SCREEN_WIDTH - 1), float(SCREEN_HEIGHT - 1), 0.f);
 
 	if (main_theme == NULL)
-		main_theme = SoundManager::instance().loadSound("sounds/main_theme.mp3", FMOD_LOOP_NORMAL);
-
-	channel = SoundManager::instance().playSound(main_theme);
-	channel->setVolume(0.8f);
+		main_theme = SoundManager::instance().loadStream("sounds/main_theme.mp3", SoundManager::LOOP);
+
+	channel = 0;
+	SoundManager::instance().whenReady(main_theme, [this](AudioSound* sound) {
+		channel = SoundManager::instance().playSound(sound);
+		if (channel != 0)
+			SoundManager::instance().setVolume(channel, 0.8f);
+	});
 }
 
 void MenuGameState::update(int deltaTime)
@@ -58,12 +62,14 @@ void MenuGameState::render()
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 		glDisable(GL_BLEND);
 
-		channel->setVolume(alpha);
+		if (channel != 0)
+			SoundManager::instance().setVolume(channel, alpha);
 
 		if (fadeTime >= totalFadeTime) {
 			fadeIn = false;
 			fadeTime = 0;
-			channel->setVolume(1.0f);
+			if (channel != 0)
+				SoundManager::instance().setVolume(channel, 1.0f);
 		}
 	}
 	else if (fadeOut)
@@ -78,11 +84,13 @@ void MenuGameState::render()
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 		glDisable(GL_BLEND);
 
-		channel->setVolume(1 - alpha);
+		if (channel != 0)
+			SoundManager::instance().setVolume(channel, 1 - alpha);
 
 
 		if (fadeTime >= totalFadeTime) {
-			channel->stop();
+			if (channel != 0)
+				SoundManager::instance().stop(channel);
 			Game::instance().startGame();
 		}
 	}
@@ -34,8 +34,8 @@ private:
 	float currentTime;
 	glm::mat4 projection;
 
-	FMOD::Sound* main_theme;
-	FMOD::Channel* channel;
+	AudioSound* main_theme;
+	AudioVoice channel;
 
 	float totalFadeTime;
 	float fadeTime;
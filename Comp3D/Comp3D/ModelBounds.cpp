@@ -0,0 +1,85 @@
+#include <fstream>
+#include <sstream>
+#include "ModelBounds.h"
+
+
+bool ModelBounds::load(const string& filename)
+{
+	lock_guard<mutex> guard(lock);
+
+	return read(filename);
+}
+
+bool ModelBounds::save(const string& filename) const
+{
+	lock_guard<mutex> guard(lock);
+	ofstream fout(filename.c_str(), ios::out | ios::trunc);
+
+	if (!fout.is_open())
+		return false;
+	for (const pair<const string, Bounds>& it : bounds)
+	{
+		const Bounds& box = it.second;
+		fout << it.first << " " << box.center.x << " " << box.center.y << " " << box.center.z
+			<< " " << box.size.x << " " << box.size.y << " " << box.size.z << endl;
+	}
+
+	return bool(fout);
+}
+
+
+void ModelBounds::store(const string& model, const glm::vec3& center, const glm::vec3& size)
+{
+	lock_guard<mutex> guard(lock);
+
+	bounds[model].center = center;
+	bounds[model].size = size;
+}
+
+bool ModelBounds::find(const string& model, glm::vec3& center, glm::vec3& size)
+{
+	lock_guard<mutex> guard(lock);
+	map<string, Bounds>::const_iterator it;
+
+	if (!bLoaded)
+		read(MODEL_BOUNDS_FILE);
+	it = bounds.find(model);
+	if (it == bounds.end())
+		return false;
+	center = it->second.center;
+	size = it->second.size;
+
+	return true;
+}
+
+void ModelBounds::getModels(vector<string>& models) const
+{
+	lock_guard<mutex> guard(lock);
+
+	models.clear();
+	for (const pair<const string, Bounds>& it : bounds)
+		models.push_back(it.first);
+}
+
+
+// Lines are the model file, its center and its size. Whatever cannot be
+// read is skipped.
+
+bool ModelBounds::read(const string& filename)
+{
+	ifstream fin(filename.c_str());
+	string line, model;
+	Bounds box;
+
+	bLoaded = true;
+	if (!fin.is_open())
+		return false;
+	while (getline(fin, line))
+	{
+		istringstream sstream(line);
+		if (sstream >> model >> box.center.x >> box.center.y >> box.center.z >> box.size.x >> box.size.y >> box.size.z)
+			bounds[model] = box;
+	}
+
+	return true;
+}
@@ -0,0 +1,64 @@
+#ifndef _MODEL_BOUNDS_INCLUDE
+#define _MODEL_BOUNDS_INCLUDE
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <glm/glm.hpp>
+
+
+using namespace std;
+
+
+#define MODEL_BOUNDS_FILE "models/bounds.txt"
+
+
+// ModelBounds is a cache of the bounding box (center and size) of every
+// model, kept in a text file with one model per line. Gameplay only needs
+// the size of the models, so the headless build (COMP3D_HEADLESS) takes
+// it from here instead of parsing them. The file is written by
+// Comp3D --cache-bounds, which parses the models again.
+// The models are parsed from the jobs, every call takes the lock.
+
+
+class ModelBounds
+{
+
+private:
+	ModelBounds() : bLoaded(false) {}
+
+public:
+	static ModelBounds& instance()
+	{
+		static ModelBounds M;
+
+		return M;
+	}
+
+	bool load(const string& filename = MODEL_BOUNDS_FILE);
+	bool save(const string& filename = MODEL_BOUNDS_FILE) const;
+
+	void store(const string& model, const glm::vec3& center, const glm::vec3& size);
+	// The file is loaded the first time, false if the model is not in it
+	bool find(const string& model, glm::vec3& center, glm::vec3& size);
+	void getModels(vector<string>& models) const;
+
+private:
+	bool read(const string& filename);
+
+private:
+	struct Bounds
+	{
+		glm::vec3 center, size;
+	};
+
+	mutable mutex lock;
+	map<string, Bounds> bounds;			// Sorted, so the file does not change order
+	bool bLoaded;
+
+};
+
+
+#endif // _MODEL_BOUNDS_INCLUDE
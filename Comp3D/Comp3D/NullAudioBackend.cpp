@@ -0,0 +1,66 @@
+#include "NullAudioBackend.h"
+
+
+bool NullAudioBackend::init(int maxVoices, int realVoices)
+{
+	return true;
+}
+
+void NullAudioBackend::shutdown()
+{
+}
+
+void NullAudioBackend::update(int deltaTime)
+{
+}
+
+
+AudioSound* NullAudioBackend::createSound(const string& file, bool bStream, bool bLoop)
+{
+	return new AudioSound();
+}
+
+void NullAudioBackend::releaseSound(AudioSound* sound)
+{
+	delete sound;
+}
+
+AudioBackend::State NullAudioBackend::getState(AudioSound* sound)
+{
+	return READY;
+}
+
+unsigned int NullAudioBackend::getSampleBytes(AudioSound* sound)
+{
+	return 0;
+}
+
+
+AudioVoice NullAudioBackend::play(AudioSound* sound, int priority)
+{
+	return 0;
+}
+
+void NullAudioBackend::stop(AudioVoice voice)
+{
+}
+
+void NullAudioBackend::setVolume(AudioVoice voice, float volume)
+{
+}
+
+bool NullAudioBackend::isPlaying(AudioVoice voice)
+{
+	return false;
+}
+
+
+void NullAudioBackend::getVoices(int& numVoices, int& numRealVoices)
+{
+	numVoices = numRealVoices = 0;
+}
+
+int NullAudioBackend::getMemoryBytes()
+{
+	return 0;
+}
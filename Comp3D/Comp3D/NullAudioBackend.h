@@ -0,0 +1,36 @@
+#ifndef _NULL_AUDIO_BACKEND_INCLUDE
+#define _NULL_AUDIO_BACKEND_INCLUDE
+
+
+#include "AudioBackend.h"
+
+
+// NullAudioBackend accepts every sound and plays nothing. Sounds are
+// ready right away and no voice is ever started.
+
+
+class NullAudioBackend : public AudioBackend
+{
+
+public:
+	bool init(int maxVoices, int realVoices);
+	void shutdown();
+	void update(int deltaTime);
+
+	AudioSound* createSound(const string& file, bool bStream, bool bLoop);
+	void releaseSound(AudioSound* sound);
+	State getState(AudioSound* sound);
+	unsigned int getSampleBytes(AudioSound* sound);
+
+	AudioVoice play(AudioSound* sound, int priority);
+	void stop(AudioVoice voice);
+	void setVolume(AudioVoice voice, float volume);
+	bool isPlaying(AudioVoice voice);
+
+	void getVoices(int& numVoices, int& numRealVoices);
+	int getMemoryBytes();
+
+};
+
+
+#endif // _NULL_AUDIO_BACKEND_INCLUDE
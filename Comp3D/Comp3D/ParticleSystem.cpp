@@ -1,9 +1,34 @@
 #include "ParticleSystem.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PARTICLE_AVX
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PARTICLE_SSE
+#endif
 
-ParticleSystem::ParticleSystem()
+
+#define PARTICLE_BLOCK 8				// Floats in the widest SIMD register
+
+
+ParticleSystem::ParticleSystem(int capacity)
 {
+	int padded = (capacity + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK * PARTICLE_BLOCK;
+
 	billboard = NULL;
+	g = 0.f;
+	fadeOut = 0.f;
+	numParticles = 0;
+	this->capacity = capacity;
+	lifetime.resize(padded);
+	positionX.resize(padded);
+	positionY.resize(padded);
+	positionZ.resize(padded);
+	speedX.resize(padded);
+	speedY.resize(padded);
+	speedZ.resize(padded);
+	rng = PARTICLE_RNG_SEED;
 }
 
 ParticleSystem::~ParticleSystem()
@@ -14,52 +39,129 @@ ParticleSystem::~ParticleSystem()
 
 void ParticleSystem::init(const glm::vec2 &billboardQuadSize, ShaderProgram &program, const string &billboardTextureName, float gravity, float fadeOut)
 {
+#ifndef COMP3D_HEADLESS
 	billboard = Billboard::createBillboard(billboardQuadSize, program, billboardTextureName, BILLBOARD_CENTER);
+#endif
 	g = gravity;
 	this->fadeOut = fadeOut;
 }
 
-void ParticleSystem::addParticle(Particle &newParticle)
+bool ParticleSystem::addParticle(const Particle &newParticle)
 {
-	particles.push_back(newParticle);
+	if (numParticles == capacity)
+		return false;
+
+	int i = numParticles++;
+	lifetime[i] = newParticle.lifetime;
+	positionX[i] = newParticle.position.x;
+	positionY[i] = newParticle.position.y;
+	positionZ[i] = newParticle.position.z;
+	speedX[i] = newParticle.speed.x;
+	speedY[i] = newParticle.speed.y;
+	speedZ[i] = newParticle.speed.z;
+
+	return true;
 }
 
 
 void ParticleSystem::update(float deltaTimeInSeconds)
 {
-	unsigned int j = 0;
+	// Whole blocks, the padding at the end of the arrays is never read back
+	integrate(0, (numParticles + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK * PARTICLE_BLOCK, deltaTimeInSeconds);
 
-	for (unsigned int i = 0; i < particles.size(); i++)
+	for (int i = 0; i < numParticles; )
 	{
-		particles[i].lifetime -= deltaTimeInSeconds;
-		if (particles[i].lifetime > 0.f)
+		if (lifetime[i] > 0.f)
 		{
-			particles[j] = particles[i];
-			particles[j].speed -= glm::vec3(0.f, g * deltaTimeInSeconds, 0.f);
-			particles[j].position += particles[j].speed * deltaTimeInSeconds;
-			j++;
+			i++;
+			continue;
 		}
+
+		int last = --numParticles;
+		lifetime[i] = lifetime[last];
+		positionX[i] = positionX[last];
+		positionY[i] = positionY[last];
+		positionZ[i] = positionZ[last];
+		speedX[i] = speedX[last];
+		speedY[i] = speedY[last];
+		speedZ[i] = speedZ[last];
 	}
-	particles.resize(j);
 }
 
-void ParticleSystem::render(ShaderProgram& program, const glm::vec3 &eye)
+// Particles that die in this step are integrated too, they are removed right after
+
+void ParticleSystem::integrate(int begin, int end, float deltaTime)
+{
+	int i = begin;
+	float gravity = g * deltaTime;
+
+#if defined(PARTICLE_AVX)
+	__m256 dt = _mm256_set1_ps(deltaTime), dg = _mm256_set1_ps(gravity);
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 vy = _mm256_sub_ps(_mm256_loadu_ps(&speedY[i]), dg);
+		_mm256_storeu_ps(&speedY[i], vy);
+		_mm256_storeu_ps(&lifetime[i], _mm256_sub_ps(_mm256_loadu_ps(&lifetime[i]), dt));
+		_mm256_storeu_ps(&positionX[i], _mm256_add_ps(_mm256_loadu_ps(&positionX[i]), _mm256_mul_ps(_mm256_loadu_ps(&speedX[i]), dt)));
+		_mm256_storeu_ps(&positionY[i], _mm256_add_ps(_mm256_loadu_ps(&positionY[i]), _mm256_mul_ps(vy, dt)));
+		_mm256_storeu_ps(&positionZ[i], _mm256_add_ps(_mm256_loadu_ps(&positionZ[i]), _mm256_mul_ps(_mm256_loadu_ps(&speedZ[i]), dt)));
+	}
+#elif defined(PARTICLE_SSE)
+	__m128 dt = _mm_set1_ps(deltaTime), dg = _mm_set1_ps(gravity);
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 vy = _mm_sub_ps(_mm_loadu_ps(&speedY[i]), dg);
+		_mm_storeu_ps(&speedY[i], vy);
+		_mm_storeu_ps(&lifetime[i], _mm_sub_ps(_mm_loadu_ps(&lifetime[i]), dt));
+		_mm_storeu_ps(&positionX[i], _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(_mm_loadu_ps(&speedX[i]), dt)));
+		_mm_storeu_ps(&positionY[i], _mm_add_ps(_mm_loadu_ps(&positionY[i]), _mm_mul_ps(vy, dt)));
+		_mm_storeu_ps(&positionZ[i], _mm_add_ps(_mm_loadu_ps(&positionZ[i]), _mm_mul_ps(_mm_loadu_ps(&speedZ[i]), dt)));
+	}
+#endif
+	for (; i < end; i++)
+	{
+		lifetime[i] -= deltaTime;
+		speedY[i] -= gravity;
+		positionX[i] += speedX[i] * deltaTime;
+		positionY[i] += speedY[i] * deltaTime;
+		positionZ[i] += speedZ[i] * deltaTime;
+	}
+}
+
+void ParticleSystem::addToSnapshot(RenderSnapshot& snapshot) const
 {
 	if (billboard == NULL)
 		return;
-	for (unsigned int i = 0; i < particles.size(); i++)
+	for (int i = 0; i < numParticles; i++)
 	{
+		float alpha = 1.f;
 		if (fadeOut > 0)
 		{
-			program.setUniform1f("alpha", particles[i].lifetime / fadeOut);	// 1.5 is the max life time
+			alpha = lifetime[i] / fadeOut;	// 1.5 is the max life time
 		}
-		billboard->render(particles[i].position, eye);
+		snapshot.addBillboard(billboard, glm::vec3(positionX[i], positionY[i], positionZ[i]), alpha);
 	}
 }
 
 bool ParticleSystem::empty()
 {
-	return particles.empty();
+	return numParticles == 0;
+}
+
+
+void ParticleSystem::seed(unsigned int seed)
+{
+	// Xorshift never leaves 0
+	rng = (seed != 0) ? seed : PARTICLE_RNG_SEED;
 }
 
+float ParticleSystem::random()
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+
+	// The top 24 bits fit exactly in a float
+	return (rng >> 8) * (1.f / 16777216.f);
+}
 
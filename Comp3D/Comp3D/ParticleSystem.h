@@ -4,6 +4,19 @@
 
 #include <vector>
 #include "Billboard.h"
+#include "RenderSnapshot.h"
+
+
+#define PARTICLE_DEFAULT_CAPACITY 1024
+#define PARTICLE_RNG_SEED 2463534242u
+
+
+// ParticleSystem keeps its particles in a pool of fixed capacity, stored
+// as one array per component so that update integrates them several at a
+// time (AVX, SSE or plain C++, whatever the build has). Spawning never
+// allocates, a particle that does not fit is dropped. Dead particles are
+// replaced by the last one, so the order of the particles is not kept.
+// Every system has its own xorshift generator for spawn randomness.
 
 
 class ParticleSystem
@@ -17,24 +30,38 @@ public:
 	};
 
 public:
-	ParticleSystem();
+	ParticleSystem(int capacity = PARTICLE_DEFAULT_CAPACITY);
 	~ParticleSystem();
 
 	void init(const glm::vec2 &billboardQuadSize, ShaderProgram &program, const string &billboardTextureName, float gravity = 0.f, float fadeOut = 0.f);
-	void addParticle(Particle &newParticle);
+	// Returns false if the pool is full
+	bool addParticle(const Particle &newParticle);
 
 	void update(float deltaTimeInSeconds);
-	void render(ShaderProgram& program, const glm::vec3 &eye);
+	void addToSnapshot(RenderSnapshot& snapshot) const;
 
 	bool empty();
+	int size() const { return numParticles; }
+	int getCapacity() const { return capacity; }
+
+	void seed(unsigned int seed);
+	// Uniform in [0, 1)
+	float random();
+
+private:
+	void integrate(int begin, int end, float deltaTime);
 
 private:
-	int numParticles;
-	vector<Particle> particles;
+	int numParticles, capacity;
+	// Rounded up to whole SIMD blocks
+	vector<float> lifetime;
+	vector<float> positionX, positionY, positionZ;
+	vector<float> speedX, speedY, speedZ;
 	Billboard *billboard;
 	float g;
 
 	float fadeOut;
+	unsigned int rng;
 };
 
 
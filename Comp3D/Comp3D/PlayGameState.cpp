@@ -1,14 +1,29 @@
 #include "Game.h"
 #include "PlayGameState.h"
+#include "SimulationThread.h"
+#include "LevelArena.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
+#include <ctime>
 
 #define NUM_LEVELS 5
 
 
 void PlayGameState::init()
 {
-	currentLevel = 1;
-	scene = new Scene();
-	scene->init(currentLevel);
+	init(1);
+}
+
+void PlayGameState::init(int firstLevel)
+{
+	currentLevel = firstLevel;
+	lastLevel = NUM_LEVELS + 1;
+	nextlevel = false;
+	setLevel = false;
+	// The scene of the last game, if any, goes with its arena
+	loadLevel();
 }
 
 void PlayGameState::update(int deltaTime)
@@ -19,7 +34,8 @@ void PlayGameState::update(int deltaTime)
 
 	if (nextlevel)
 	{
-		nextLevel();
+		// Loading the level needs OpenGL
+		SimulationThread::instance().runOnRenderThread([this]() { nextLevel(); });
 	}
 
 }
@@ -29,6 +45,11 @@ void PlayGameState::render()
 	scene->render();
 }
 
+void PlayGameState::buildSnapshot(RenderSnapshot& snapshot)
+{
+	scene->buildSnapshot(snapshot);
+}
+
 void PlayGameState::keyPressed(int key)
 {
 	if (key == 27) // Escape code
@@ -45,6 +66,14 @@ void PlayGameState::keyPressed(int key)
 	{
 		bGodMode = !bGodMode;
 	}
+	else if (key == 'r' || key == 'R')
+	{
+		bRenderStats = !bRenderStats;
+	}
+	else if (key == 'm' || key == 'M')
+	{
+		bMemoryHud = !bMemoryHud;
+	}
 	else if (key == '1' || key == '2' || key == '3' || key == '4' || key == '5')
 	{
 		scene->setFade(true);
@@ -81,11 +110,8 @@ void PlayGameState::nextLevel()
 		++currentLevel;
 	}
 
-	if (currentLevel <= NUM_LEVELS + 1) {
-		delete scene;
-		scene = new Scene();
-		scene->init(currentLevel);
-	}
+	if (currentLevel <= lastLevel)
+		loadLevel();
 	else
 		Game::instance().goBackToMenu();	
 }
@@ -99,3 +125,26 @@ void PlayGameState::setGodMode(bool b)
 {
 	bGodMode = b;
 }
+
+void PlayGameState::setLastLevel(int level)
+{
+	lastLevel = level;
+}
+
+void PlayGameState::loadLevel()
+{
+	PROFILE_ZONE("PlayGameState::loadLevel");
+	unsigned int seed = unsigned(time(NULL));
+
+	// Recorded games keep the seed and god mode of every level
+	Replay::instance().beginLevel(currentLevel, seed, bGodMode);
+	// Prints the stats of the last one
+	RenderStats::instance().setLevel(currentLevel);
+
+	// The whole level is released at once
+	LevelArena::instance().reset();
+	// What the last level did not give back counts as its own
+	MemoryAccounting::instance().setLevel(currentLevel);
+	scene = LevelArena::instance().create<Scene>();
+	scene->init(currentLevel, seed);
+}
@@ -19,14 +19,23 @@ public:
 	void keyPressed(int key);
 
 	void init();
+	void init(int firstLevel);
 	void update(int deltaTime);
 	void render();
 
+	bool supportsSnapshots() const { return true; }
+	void buildSnapshot(RenderSnapshot& snapshot);
+
 	void startFade();
 	void finalBlockTaken();
 
 	bool getGodMode();
 	void setGodMode(bool b);
+	bool getRenderStats() const { return bRenderStats; }
+	bool getMemoryHud() const { return bMemoryHud; }
+
+	// The game ends after this level instead of going on to the next one
+	void setLastLevel(int level);
 
 private:
 	Scene* scene;
@@ -34,10 +43,14 @@ private:
 	bool nextlevel = false;
 	bool setLevel = false;
 	int numSetLevel;
+	int lastLevel;
 
 	void nextLevel();
+	void loadLevel();
 
 	bool bGodMode = false;
+	bool bRenderStats = false;
+	bool bMemoryHud = false;
 };
 
 #endif
@@ -1,6 +1,9 @@
 #include <iostream>
 #include "Player.h"
 #include "Game.h"
+#include "EntitySystems.h"
+#include "LevelArena.h"
+#include "Profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 #define PI 3.14159f
@@ -11,23 +14,27 @@ Player::Player()
 	model = NULL;
 	particles = NULL;
 	particles_dead = NULL;
-	channel = NULL;
-	line_channel = NULL;
+	channel = 0;
+	events = NULL;
+	line_channel = 0;
+	wall_sound = player_sound = button_sound = NULL;
+	line_sound = death_sound = basic_sound = NULL;
 
 }
 
 Player::~Player()
 {
-	if (model != NULL)
-		delete model;
-	if (particles != NULL)
-		delete particles;
-	if (particles_dead != NULL)
-		delete particles_dead;
-	if (channel != NULL)
-		channel->stop();
-	if (line_channel != NULL)
-		line_channel->stop();
+	// The model and the particles belong to the level arena
+	if (channel != 0)
+		SoundManager::instance().stop(channel);
+	if (line_channel != 0)
+		SoundManager::instance().stop(line_channel);
+	SoundManager::instance().releaseSound(wall_sound);
+	SoundManager::instance().releaseSound(player_sound);
+	SoundManager::instance().releaseSound(button_sound);
+	SoundManager::instance().releaseSound(line_sound);
+	SoundManager::instance().releaseSound(death_sound);
+	SoundManager::instance().releaseSound(basic_sound);
 }
 
 
@@ -36,9 +43,9 @@ void Player::init(ShaderProgram& shaderProgram, TileMap* tileMap)
 	// Init Model and Particles
 	map = tileMap;
 	int style = map->getStyle();
-	model = new AssimpModel();
-	particles = new ParticleSystem();
-	particles_dead = new ParticleSystem();
+	model = LevelArena::instance().create<AssimpModel>();
+	particles = LevelArena::instance().create<ParticleSystem>();
+	particles_dead = LevelArena::instance().create<ParticleSystem>();
 
 	switch (style)
 	{
@@ -76,21 +83,26 @@ void Player::init(ShaderProgram& shaderProgram, TileMap* tileMap)
 	velocity.y = 0.01f;
 
 	// Init Sound
-	wall_sound = SoundManager::instance().loadSound("sounds/wall3.mp3", FMOD_DEFAULT);
-	player_sound = SoundManager::instance().loadSound("sounds/player2.mp3", FMOD_DEFAULT);
-	button_sound = SoundManager::instance().loadSound("sounds/button.mp3", FMOD_DEFAULT);
-	line_sound = SoundManager::instance().loadSound("sounds/line.mp3", FMOD_LOOP_NORMAL);
-	death_sound = SoundManager::instance().loadSound("sounds/death.mp3", FMOD_DEFAULT);
-	basic_sound = SoundManager::instance().loadSound("sounds/basic2.mp3", FMOD_DEFAULT);
+	// Voices, cooldown (ms) and priority. Contacts can fire every step, what the
+	// player does or suffers is more important than what it touches.
+	wall_sound = SoundManager::instance().loadSound("sounds/wall3.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 60, 160));
+	player_sound = SoundManager::instance().loadSound("sounds/player2.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 0, 64));
+	button_sound = SoundManager::instance().loadSound("sounds/button.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 60, 128));
+	line_sound = SoundManager::instance().loadSound("sounds/line.mp3", SoundManager::LOOP, SoundManager::VoiceLimits(1, 0, 96));
+	death_sound = SoundManager::instance().loadSound("sounds/death.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(1, 250, 32));
+	basic_sound = SoundManager::instance().loadSound("sounds/basic2.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 40, 192));
 
 	currentTime = 0.0f;
 }
 
-void Player::update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* ballSpike, vector<Button*>* buttons, vector<Switch*>* switchs)
+void Player::update(int deltaTime, EntityStore* entities, const SpatialHash* spatialHash)
 {
+	PROFILE_ZONE("Player::update");
+
 	// Update Particles
 	//int nParticlesToSpawn = 20 * (int((currentTime + deltaTime) / 100.f) - int(currentTime / 100.f));
 	currentTime += deltaTime;
+	prevPosPlayer = posPlayer;
 
 	if (bDead)
 	{
@@ -115,7 +127,7 @@ void Player::update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* bal
 
 			for (int i = 0; i < nParticlesToSpawn; i++)
 			{
-				angle = 2.f * PI * (i + float(rand()) / RAND_MAX) / nParticlesToSpawn;
+				angle = 2.f * PI * (i + particles->random()) / nParticlesToSpawn;
 				//angle = glm::radians(angle);
 				particle.position = glm::vec3(cos(angle) * 0.25 + (posPlayer.x + 0.5), sin(angle) * 0.25 - (posPlayer.y + 0.5), 0.f);
 
@@ -138,147 +150,16 @@ void Player::update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* bal
 
 
 
-		// Update X direction
-		posPlayer.x += deltaTime * velocity.x;
-
-		if (map->collisionMoveRight(posPlayer, size, 1))
-		{
-			posPlayer.x -= deltaTime * velocity.x;
-			velocity.x = -abs(velocity.x);
-
-			timeScale = 200;
-			eScaleDir = RIGHT;
-			timeRotate = 200;
-		}
-		else if (map->collisionMoveLeft(posPlayer, size, 1))
-		{
-			posPlayer.x -= deltaTime * velocity.x;
-			velocity.x = abs(velocity.x);
-
-			timeScale = 200;
-			eScaleDir = LEFT;
-			timeRotate = 200;
-		}
-
-		for (int i = 0; i < (*walls).size(); ++i) {
-			if (!PlayGameState::instance().getGodMode() || (*walls)[i]->getType() == 2)
-				if (collideWall((*walls)[i])) {
-					posPlayer.x -= deltaTime * velocity.x;
-					velocity.x = -velocity.x;
-					timeRotate = 200;
-					timeScale = 200;
-					if (velocity.x > 0)
-						eScaleDir = LEFT;
-					else
-						eScaleDir = RIGHT;
-					channel = SoundManager::instance().playSound(wall_sound);
-				}
-		}
-		if (!PlayGameState::instance().getGodMode())
-		{
-			for (int i = 0; i < (*ballSpike).size(); ++i) {
-				if (collideBallSpike((*ballSpike)[i])) {
-					map->setPlayerDead(true);
-					channel = SoundManager::instance().playSound(death_sound);
-				}
-			}
-		}
-
-		for (int i = 0; i < (*buttons).size(); ++i) {
-			Button* button = (*buttons)[i];
-			if (collideButton(button)) {
-				posPlayer.x -= deltaTime * velocity.x;
-				velocity.x = -velocity.x;
-				if (!button->getPressed() && (button->getOrientation() == orientation::RIGHT || button->getOrientation() == orientation::LEFT)) {
-					unpressAllButtons(buttons);
-					button->setPressed(true);
-					switchAllSwitchs(switchs);
-					channel = SoundManager::instance().playSound(button_sound);
-				}
-			}
-		}
-
-		for (int i = 0; i < (*switchs).size(); ++i) {
-			if (collideSwitch((*switchs)[i])) {
-				posPlayer.x -= deltaTime * velocity.x;
-				velocity.x = -velocity.x;
-				channel = SoundManager::instance().playSound(basic_sound);
-			}
-		}
-
-		// Update Y direction
-		posPlayer.y += deltaTime * velocity.y;
-
-		if (map->collisionMoveUp(posPlayer, size, 1))
-		{
-			posPlayer.y -= deltaTime * velocity.y;
-			velocity.y = abs(velocity.y);
-
-			timeScale = 200;
-			eScaleDir = UP;
-		}
-
-		else if (map->collisionMoveDown(posPlayer, size, 1))
-		{
-			posPlayer.y -= deltaTime * velocity.y;
-			velocity.y = -abs(velocity.y);
-
-			timeScale = 200;
-			eScaleDir = DOWN;
-		}
-
-		for (int i = 0; i < (*walls).size(); ++i) {
-			if (!PlayGameState::instance().getGodMode() || (*walls)[i]->getType() == 2)
-				if (collideWall((*walls)[i])) {
-					posPlayer.y -= deltaTime * velocity.y;
-					velocity.y = -velocity.y;
-					timeRotate = 200;
-					timeScale = 200;
-					if (velocity.y > 0)
-						eScaleDir = UP;
-					else
-						eScaleDir = DOWN;
-					channel = SoundManager::instance().playSound(wall_sound);
-				}
-		}
-
-		if (!PlayGameState::instance().getGodMode())
-		{
-			for (int i = 0; i < (*ballSpike).size(); ++i) {
-				if (collideBallSpike((*ballSpike)[i])) {
-					map->setPlayerDead(true);
-					channel = SoundManager::instance().playSound(death_sound);
-				}
-			}
-		}
-
-		for (int i = 0; i < (*buttons).size(); ++i) {
-			Button* button = (*buttons)[i];
-			if (collideButton(button)) {
-				posPlayer.y -= deltaTime * velocity.y;
-				velocity.y = -velocity.y;
-				if (!button->getPressed() && (button->getOrientation() == UP || button->getOrientation() == DOWN)) {
-					unpressAllButtons(buttons);
-					button->setPressed(true);
-					switchAllSwitchs(switchs);
-					channel = SoundManager::instance().playSound(button_sound);
-				}
-			}
-		}
-
-		for (int i = 0; i < (*switchs).size(); ++i) {
-			if (collideSwitch((*switchs)[i])) {
-				posPlayer.y -= deltaTime * velocity.y;
-				velocity.y = -velocity.y;
-				channel = SoundManager::instance().playSound(basic_sound);
-			}
-		}
+		// Update X and Y directions
+		move(0, deltaTime * velocity.x, entities, spatialHash);
+		move(1, deltaTime * velocity.y, entities, spatialHash);
 
 		if (map->lineCollision(posPlayer, size, false)) {
 			if (lastVelocity == 0) {
 				lastVelocity = velocity.y;
 				line_channel = SoundManager::instance().playSound(line_sound);
-				line_channel->setVolume(1.5f);
+				if (line_channel != 0)
+					SoundManager::instance().setVolume(line_channel, 1.5f);
 			}
 			velocity.y = 0;
 		}
@@ -286,7 +167,8 @@ void Player::update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* bal
 			if (lastVelocity == 0) {
 				lastVelocity = velocity.x;
 				line_channel = SoundManager::instance().playSound(line_sound);
-				line_channel->setVolume(1.5f);
+				if (line_channel != 0)
+					SoundManager::instance().setVolume(line_channel, 1.5f);
 			}
 			velocity.x = 0;
 		}
@@ -294,23 +176,26 @@ void Player::update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* bal
 			if (velocity.y == 0) {
 				velocity.y = lastVelocity;
 				lastVelocity = 0;
-				line_channel->setVolume(0.f);
+				if (line_channel != 0)
+					SoundManager::instance().setVolume(line_channel, 0.f);
 			}
 			if (velocity.x == 0) {
 				velocity.x = lastVelocity;
 				lastVelocity = 0;
-				line_channel->setVolume(0.f);
+				if (line_channel != 0)
+					SoundManager::instance().setVolume(line_channel, 0.f);
 			}
 		}
 	}
 }
 
-void Player::render(ShaderProgram& program, const glm::vec3& eye, float rotation)
+void Player::addToSnapshot(RenderSnapshot& snapshot, float rotation, float alpha)
 {
 	glm::mat4 modelMatrix;
 	if (!bDead)
 	{
-		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(posPlayer.x, -posPlayer.y, 0));
+		glm::vec3 pos = glm::mix(prevPosPlayer, posPlayer, Game::instance().getInterpolation());
+		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(pos.x, -pos.y, 0));
 
 		if (rotation > 0)
 		{
@@ -359,48 +244,21 @@ void Player::render(ShaderProgram& program, const glm::vec3& eye, float rotation
 		}
 
 
-		program.setUniformMatrix4f("model", modelMatrix);
-		model->render(program);
+		snapshot.addModel(model, modelMatrix, alpha);
 
 		// Render particles
-		if (!particles->empty())
-		{
-			glDepthMask(GL_FALSE);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-			modelMatrix = glm::mat4(1.0f);
-			program.setUniformMatrix4f("model", modelMatrix);
-			particles->render(program, eye);
-			program.setUniform1f("alpha", 1);
-
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-			glDisable(GL_BLEND);
-			glDepthMask(GL_TRUE);
-		}
+		particles->addToSnapshot(snapshot);
 	}
 
 	// Render particles dead
-	else if (!particles_dead->empty())
-	{
-		glDepthMask(GL_FALSE);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		modelMatrix = glm::mat4(1.0f);
-		program.setUniformMatrix4f("model", modelMatrix);
-		particles_dead->render(program, eye);
-		program.setUniform1f("alpha", 1);
-
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-		glDisable(GL_BLEND);
-		glDepthMask(GL_TRUE);
-	}
+	else
+		particles_dead->addToSnapshot(snapshot);
 }
 
 void Player::setPosition(const glm::vec3& position)
 {
 	posPlayer = position;
+	prevPosPlayer = position;
 }
 
 void Player::setVelocity(const glm::vec3& vel)
@@ -418,11 +276,27 @@ glm::vec3 Player::getSize()
 	return size;
 }
 
+glm::vec3 Player::getVelocity() const
+{
+	return velocity;
+}
+
+void Player::seed(unsigned int seed)
+{
+	particles->seed(seed);
+	particles_dead->seed(seed + 1);
+}
+
 void Player::setTileMap(TileMap* tileMap)
 {
 	map = tileMap;
 }
 
+void Player::setEventBus(EventBus* eventBus)
+{
+	events = eventBus;
+}
+
 
 void Player::keyPressed(int key)
 {
@@ -435,155 +309,174 @@ void Player::keyPressed(int key)
 			velocity.y = -velocity.y;
 		bSpace = true;
 		timeRotate = 200.f;
+		Game::instance().inputReflected();
 
 		channel = SoundManager::instance().playSound(player_sound);
 	}
 }
 
-bool Player::collideWall(Wall* wall)
+void Player::setDead(bool b)
 {
-	glm::vec3 wallPos = wall->getPosition();
-	glm::vec3 wallSize = wall->getSize();
-
-	int distX = abs(posPlayer.x - wallPos.x);
-	int distY = abs(posPlayer.y - wallPos.y);
-
-
-	if (distX > wallSize.x+1 || distY > wallSize.y+1)
-		return false;
-	else
+	bDead = b;
+	if (bDead)
 	{
-		float Wxmin = wallPos.x;
-		float Wxmax = wallPos.x + wallSize.x;
-		float Wymin = wallPos.y;
-		float Wymax = wallPos.y + wallSize.y;
+		int nParticlesToSpawn = 50;
+		ParticleSystem::Particle particle;
+		float angle;
+
+		particle.lifetime = 1.f;
 
-		float Pxmin = posPlayer.x;
-		float Pxmax = posPlayer.x + size.x;
-		float Pymin = posPlayer.y;
-		float Pymax = posPlayer.y + size.y;
+		glm::vec3 direction = glm::vec3(-(posPlayer.x + 0.5), (posPlayer.y + 0.5), 0.f);
 
-		return ((Wxmin < Pxmax&& Pxmin < Wxmax) && (Wymin < Pymax&& Pymin < Wymax));
+		for (int i = 0; i < nParticlesToSpawn; i++)
+		{
+			angle = 2.f * PI * (i + particles_dead->random()) / nParticlesToSpawn;
+			particle.position = glm::vec3(cos(angle) * 0.25 + (posPlayer.x + 0.5), sin(angle) * 0.25 - (posPlayer.y + 0.5), 0.f);
+			particle.speed = 30.f * glm::vec3(glm::normalize(particle.position + direction));
+			particles_dead->addParticle(particle);
+		}
 	}
 }
 
-
-bool Player::collideBallSpike(BallSpike* ballSpike)
-{
-	glm::vec3 ballSpikePos = ballSpike->getPosition();
-	glm::vec3 ballSpikeSize = ballSpike->getSize();
-
-	int distX = abs(posPlayer.x - ballSpikePos.x);
-	int distY = abs(posPlayer.y - ballSpikePos.y);
-
-
-	if (distX > ballSpikeSize.x + 2 || distY > ballSpikeSize.y + 2)
-	{
-		return false;
-	}
+void Player::setLineVolume(float lv) {
+	if (line_channel == 0)
+		return;
+	if (lv == 0.f)
+		SoundManager::instance().stop(line_channel);
 	else
-	{
-		float Wxmin = (ballSpikePos.x-0.5);
-		float Wxmax = (ballSpikePos.x-0.5) + ballSpikeSize.x;
-		float Wymin = (ballSpikePos.y-0.5);
-		float Wymax = (ballSpikePos.y-0.5) + ballSpikeSize.y;
-
-		float Pxmin = posPlayer.x;
-		float Pxmax = posPlayer.x + size.x;
-		float Pymin = posPlayer.y;
-		float Pymax = posPlayer.y + size.y;
-
-		return ((Wxmin < Pxmax && Pxmin < Wxmax) && (Wymin < Pymax && Pymin < Wymax));
-	}
+		SoundManager::instance().setVolume(line_channel, lv);
 }
 
+// Moves the player along one axis (0 is X, 1 is Y) until the first thing it
+// hits. Boxes are swept, so a long frame cannot go through anything.
+// The player bounces against tiles, walls, buttons and switchs, and dies
+// if it goes through a ball spike.
 
-bool Player::collideButton(Button* button)
+void Player::move(int axis, float delta, EntityStore* entities, const SpatialHash* spatialHash)
 {
-	glm::vec3 buttonPos = button->getPosition();
-	glm::vec3 buttonSize = button->getSize();
-
-	int orientation = button->getOrientation();
-
-	if (orientation == 1 || orientation == 3)
-		buttonSize = glm::vec3(buttonSize.y, buttonSize.x, buttonSize.z);
-
-	float Bxmin = buttonPos.x;
-	if (orientation == 1)
-		Bxmin += 0.5;
-	float Bxmax = Bxmin + buttonSize.x;
-	float Bymin = buttonPos.y;
-	if (orientation == 0)
-		Bymin += 0.5;
-	float Bymax = Bymin + buttonSize.y;
-
-	float Pxmin = posPlayer.x;
-	float Pxmax = posPlayer.x + size.x;
-	float Pymin = posPlayer.y;
-	float Pymax = posPlayer.y + size.y;
-
-	return ((Bxmin < Pxmax&& Pxmin < Bxmax) && (Bymin < Pymax&& Pymin < Bymax));
-}
-
-bool Player::collideSwitch(Switch* switx)
-{
-	if (switx->getActivated()) {
-		glm::vec3 switchPos = switx->getPosition();
-		glm::vec3 switchSize = switx->getSize();
-
-		float Sxmin = switchPos.x;
-		float Sxmax = switchPos.x + switchSize.x;
-		float Symin = switchPos.y;
-		float Symax = switchPos.y + switchSize.y;
-
-		float Pxmin = posPlayer.x;
-		float Pxmax = posPlayer.x + size.x;
-		float Pymin = posPlayer.y;
-		float Pymax = posPlayer.y + size.y;
+	const EntityStore::Walls& walls = entities->walls;
+	const EntityStore::Switchs& switchs = entities->switchs;
+	const EntityStore::BallSpikes& ballSpikes = entities->ballSpikes;
+	glm::vec2 minPlayer = glm::vec2(posPlayer), maxPlayer = glm::vec2(posPlayer + size);
+	glm::vec2 movement(0.f), minCorner, maxCorner;
+	SweepHit hit, nearest;
+	Contact contact = Contact::NONE;
+	int button = -1;
+	bool bGodMode = PlayGameState::instance().getGodMode();
+
+	// Only the entities around the player can be hit
+	float margin = abs(delta) + 1.f;
+
+	movement[axis] = delta;
+	nearest.time = 1.f;
+
+	queryNearby(spatialHash, SpatialHash::WALL, margin);
+	for (int k = 0; k < nearby.size(); ++k) {
+		int wall = nearby[k];
+		if (bGodMode && walls.type[wall] != 2)
+			continue;
+		minCorner = walls.position[wall];
+		maxCorner = minCorner + walls.size[wall];
+		if (sweepAABB(minPlayer, maxPlayer, movement, minCorner, maxCorner, hit) && hit.time < nearest.time) {
+			nearest = hit;
+			contact = Contact::WALL;
+		}
+	}
 
-		return ((Sxmin < Pxmax&& Pxmin < Sxmax) && (Symin < Pymax&& Pymin < Symax));
+	queryNearby(spatialHash, SpatialHash::BUTTON, margin);
+	for (int k = 0; k < nearby.size(); ++k) {
+		EntitySystems::buttonBox(*entities, nearby[k], minCorner, maxCorner);
+		if (sweepAABB(minPlayer, maxPlayer, movement, minCorner, maxCorner, hit) && hit.time < nearest.time) {
+			nearest = hit;
+			contact = Contact::BUTTON;
+			button = nearby[k];
+		}
 	}
-	else return false;
-}
 
-void Player::switchAllSwitchs(vector<Switch*>* switchs) {
-	for (int i = 0; i < (*switchs).size(); ++i) {
-		(*switchs)[i]->toggle();
+	queryNearby(spatialHash, SpatialHash::SWITCH, margin);
+	for (int k = 0; k < nearby.size(); ++k) {
+		int switx = nearby[k];
+		if (!switchs.bActivated[switx])
+			continue;
+		minCorner = switchs.position[switx];
+		maxCorner = minCorner + switchs.size[switx];
+		if (sweepAABB(minPlayer, maxPlayer, movement, minCorner, maxCorner, hit) && hit.time < nearest.time) {
+			nearest = hit;
+			contact = Contact::SWITCH;
+		}
 	}
-}
 
-void Player::unpressAllButtons(vector<Button*>* buttons) {
-	for (int i = 0; i < (*buttons).size(); ++i) {
-		(*buttons)[i]->setPressed(false);
+	// Tiles last, keys and checkpoints behind an entity must not be touched
+	float travel = nearest.time;
+	bool bTile = (axis == 0) ? map->sweepX(posPlayer, size, delta * travel, hit, 1) : map->sweepY(posPlayer, size, delta * travel, hit, 1);
+	if (bTile) {
+		nearest.time = hit.time * travel;
+		nearest.normal = hit.normal;
+		contact = Contact::TILE;
 	}
-}
 
-void Player::setDead(bool b)
-{
-	bDead = b;
-	if (bDead)
+	posPlayer[axis] += delta * nearest.time;
+
+	if (!bGodMode)
 	{
-		int nParticlesToSpawn = 50;
-		ParticleSystem::Particle particle;
-		float angle;
+		movement[axis] = delta * nearest.time;
+		queryNearby(spatialHash, SpatialHash::BALL_SPIKE, margin);
+		for (int k = 0; k < nearby.size(); ++k) {
+			int spike = nearby[k];
+			minCorner = ballSpikes.position[spike] - 0.5f;
+			maxCorner = minCorner + ballSpikes.size[spike];
+			if (sweepAABB(minPlayer, maxPlayer, movement, minCorner, maxCorner, hit)) {
+				events->emit(GameEvent::DEATH);
+				events->playSound(death_sound);
+			}
+		}
+	}
 
-		particle.lifetime = 1.f;
+	if (contact == Contact::NONE)
+		return;
 
-		glm::vec3 direction = glm::vec3(-(posPlayer.x + 0.5), (posPlayer.y + 0.5), 0.f);
+	// Bounce away from what was hit
+	velocity[axis] = nearest.normal[axis] * abs(velocity[axis]);
 
-		for (int i = 0; i < nParticlesToSpawn; i++)
-		{
-			angle = 2.f * PI * (i + float(rand()) / RAND_MAX) / nParticlesToSpawn;
-			particle.position = glm::vec3(cos(angle) * 0.25 + (posPlayer.x + 0.5), sin(angle) * 0.25 - (posPlayer.y + 0.5), 0.f);
-			particle.speed = 30.f * glm::vec3(glm::normalize(particle.position + direction));
-			particles_dead->addParticle(particle);
+	switch (contact)
+	{
+	case Contact::TILE:
+	case Contact::WALL:
+		timeScale = 200;
+		if (axis == 0)
+			eScaleDir = (nearest.normal.x < 0) ? RIGHT : LEFT;
+		else
+			eScaleDir = (nearest.normal.y > 0) ? UP : DOWN;
+		if (contact == Contact::WALL || axis == 0)
+			timeRotate = 200;
+		if (contact == Contact::WALL)
+			events->playSound(wall_sound);
+		break;
+	case Contact::BUTTON:
+	{
+		int buttonOrientation = entities->buttons.orientation[button];
+		bool bFacing = (axis == 0) ? (buttonOrientation == RIGHT || buttonOrientation == LEFT) : (buttonOrientation == UP || buttonOrientation == DOWN);
+		if (!entities->buttons.bPressed[button] && bFacing) {
+			EntitySystems::releaseButtons(*entities);
+			entities->buttons.bPressed[button] = true;
+			EntitySystems::toggleSwitchs(*entities);
+			events->emit(GameEvent::BUTTON, -1, button);
+			events->playSound(button_sound);
 		}
+		break;
+	}
+	case Contact::SWITCH:
+		events->playSound(basic_sound);
+		break;
+	case Contact::NONE:
+		break;
 	}
 }
 
-void Player::setLineVolume(float lv) {
-	if (lv == 0.f)
-		line_channel->stop();
-	else
-		line_channel->setVolume(lv);
+void Player::queryNearby(const SpatialHash* spatialHash, SpatialHash::Type type, float margin)
+{
+	glm::vec2 minCorner = glm::vec2(posPlayer) - margin;
+	glm::vec2 maxCorner = glm::vec2(posPlayer + size) + margin;
+
+	spatialHash->query(type, minCorner, maxCorner, nearby);
 }
@@ -3,11 +3,9 @@
 
 #include "TileMap.h"
 #include "SoundManager.h"
-#include "Button.h"
-#include "Switch.h"
-#include "Wall.h"
-#include "BallSpike.h"
+#include "EntityStore.h"
 #include "ParticleSystem.h"
+#include "SpatialHash.h"
 
 
 enum orientation
@@ -26,15 +24,20 @@ public:
 	~Player();
 
 	void init(ShaderProgram& shaderProgram, TileMap* tileMap);
-	void update(int deltaTime, vector<Wall*>* walls, vector<BallSpike*>* ballSpike, vector<Button*>* buttons, vector<Switch*>* switchs);
-	void render(ShaderProgram& program, const glm::vec3& eye, float rotation);
+	void update(int deltaTime, EntityStore* entities, const SpatialHash* spatialHash);
+	void addToSnapshot(RenderSnapshot& snapshot, float rotation, float alpha = 1.f);
 
 	void setTileMap(TileMap* tileMap);
+	void setEventBus(EventBus* eventBus);
 	void setPosition(const glm::vec3& pos);
 	void setVelocity(const glm::vec3& vel);
 
 	glm::vec3 getPosition();
 	glm::vec3 getSize();
+	glm::vec3 getVelocity() const;
+
+	// Spawn randomness of the particles, recorded games keep it
+	void seed(unsigned int seed);
 
 	void keyPressed(int key);
 	void setDead(bool b);
@@ -42,25 +45,34 @@ public:
 	void setLineVolume(float lv);
 
 private:
-	bool collideWall(Wall* wall);
-	bool collideBallSpike(BallSpike* blockSpike);
-	bool collideButton(Button* button);
-	bool collideSwitch(Switch* switx);
+	enum class Contact
+	{
+		NONE,
+		TILE,
+		WALL,
+		BUTTON,
+		SWITCH
+	};
+
+	void move(int axis, float delta, EntityStore* entities, const SpatialHash* spatialHash);
 
-	void switchAllSwitchs(vector<Switch*>* switchs);
-	void unpressAllButtons(vector<Button*>* buttons);
+	// Fills nearby with the entities of a type around the player
+	void queryNearby(const SpatialHash* spatialHash, SpatialHash::Type type, float margin);
 
 private:
-	glm::vec3 posPlayer;
+	glm::vec3 posPlayer, prevPosPlayer;	// Current and previous simulation step
 	glm::vec3 size;
 	glm::vec3 velocity = glm::vec3(0);
 	float currentTime;
 
 	TileMap* map;
+	EventBus* events;
 	AssimpModel* model;
 	ParticleSystem* particles;
 	ParticleSystem* particles_dead;
 
+	vector<int> nearby;
+
 
 	float lastVelocity = 0;
 
@@ -71,15 +83,15 @@ private:
 
 
 
-	FMOD::Sound* wall_sound;
-	FMOD::Sound* player_sound;
-	FMOD::Sound* button_sound;
-	FMOD::Sound* line_sound;
-	FMOD::Sound* death_sound;
-	FMOD::Sound* basic_sound;
+	AudioSound* wall_sound;
+	AudioSound* player_sound;
+	AudioSound* button_sound;
+	AudioSound* line_sound;
+	AudioSound* death_sound;
+	AudioSound* basic_sound;
 
-	FMOD::Channel* channel;
-	FMOD::Channel* line_channel;
+	AudioVoice channel;
+	AudioVoice line_channel;
 
 	bool bDead = false;
 	int numDeadRounds = 0;
@@ -0,0 +1,384 @@
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include "Profiler.h"
+
+
+#define PROFILER_GPU_RING PROFILER_THREADS
+#define PROFILER_GRAPH_SCALE 4.0		// Pixels per ms in the frame time graph
+#define PROFILER_GRAPH_HEIGHT 100
+
+
+// Index of the ring of the calling thread, -1 until it records something
+static thread_local int threadIndex = -1;
+
+
+Profiler::Profiler()
+{
+	for (Ring& ring : rings)
+	{
+		ring.head = 0;
+		ring.read = 0;
+		ring.threadName = NULL;
+	}
+	rings[PROFILER_GPU_RING].threadName = "GPU";
+	numThreads = 0;
+	numNames = 0;
+	numFrames = 0;
+	lastFrame = 0;
+	for (int i = 0; i < PROFILER_FRAMES; i++)
+		frameTimes[i] = gpuTimes[i] = 0;
+	gpuFrame = 0;
+	nextFrame = 0;
+	queryHead = queryTail = 0;
+	bGpuZone = false;
+	bGpuChecked = bGpuSupported = false;
+	bOverlay = false;
+}
+
+
+bool Profiler::isEnabled()
+{
+#ifdef COMP3D_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+int Profiler::registerThread()
+{
+	if (threadIndex < 0)
+		threadIndex = min(numThreads.fetch_add(1), PROFILER_THREADS);
+
+	return threadIndex;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+	int index = registerThread();
+
+	if (index < PROFILER_THREADS)
+		rings[index].threadName = name;
+}
+
+// Only the owner writes its ring. A zone is visible to the other threads
+// once the head is moved past it.
+
+void Profiler::addZone(const char* name, double start, double end)
+{
+	int index = registerThread();
+
+	if (index >= PROFILER_THREADS)
+		return;
+
+	Ring& ring = rings[index];
+	unsigned int head = ring.head.load(memory_order_relaxed);
+	Zone& zone = ring.zones[head & (PROFILER_RING_SIZE - 1)];
+	zone.name = name;
+	zone.start = start;
+	zone.end = end;
+	ring.head.store(head + 1, memory_order_release);
+}
+
+
+void Profiler::beginGpuZone(const char* name)
+{
+	if (bGpuZone)
+		endGpuZone();
+
+	// Queries are created the first time, when there is a context
+	if (!bGpuChecked)
+	{
+		bGpuChecked = true;
+		bGpuSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+		for (int i = 0; bGpuSupported && i < PROFILER_GPU_QUERIES; i++)
+			glGenQueries(1, &queries[i].query);
+	}
+	// Every query is still waiting for the GPU, this pass is not timed
+	if (!bGpuSupported || queryHead - queryTail >= PROFILER_GPU_QUERIES)
+		return;
+
+	GpuQuery& query = queries[queryHead & (PROFILER_GPU_QUERIES - 1)];
+	query.name = name;
+	query.start = FrameScheduler::now();
+	glBeginQuery(GL_TIME_ELAPSED, query.query);
+	bGpuZone = true;
+}
+
+void Profiler::endGpuZone()
+{
+	if (!bGpuZone)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	queryHead++;
+	bGpuZone = false;
+}
+
+
+void Profiler::beginFrame()
+{
+	double now = FrameScheduler::now();
+	int last = min(numThreads.load(), PROFILER_THREADS);
+
+	for (int i = 0; i < last; i++)
+		readRing(rings[i]);
+	readQueries();
+
+	frameTimes[nextFrame] = (lastFrame > 0) ? now - lastFrame : 0;
+	gpuTimes[nextFrame] = gpuFrame;
+	nextFrame = (nextFrame + 1) % PROFILER_FRAMES;
+	lastFrame = now;
+	gpuFrame = 0;
+
+	for (int i = 0; i < numNames; i++)
+	{
+		stats[i].total += stats[i].frame;
+		stats[i].worst = max(stats[i].worst, stats[i].frame);
+		stats[i].frame = 0;
+	}
+	if (++numFrames == PROFILER_FRAMES)
+	{
+		for (int i = 0; i < numNames; i++)
+		{
+			stats[i].average = stats[i].total / PROFILER_FRAMES;
+			stats[i].peak = stats[i].worst;
+			stats[i].total = stats[i].worst = 0;
+		}
+		numFrames = 0;
+	}
+}
+
+// Copies count zones from the one with index first. The owner keeps
+// writing meanwhile and may lap the copy: once the head is at newHead it
+// may be writing the slot of zone newHead - PROFILER_RING_SIZE, so that
+// zone and the ones before it can be torn. Returns how many of the first
+// copies must be dropped for that.
+
+unsigned int Profiler::copyZones(const Ring& ring, unsigned int first, unsigned int count, Zone* copied) const
+{
+	for (unsigned int i = 0; i < count; i++)
+		copied[i] = ring.zones[(first + i) & (PROFILER_RING_SIZE - 1)];
+
+	// The copies are read before the head is read again
+	atomic_thread_fence(memory_order_acquire);
+	unsigned int newHead = ring.head.load(memory_order_relaxed);
+	if (newHead - first < PROFILER_RING_SIZE)
+		return 0;
+
+	return min(newHead - first - PROFILER_RING_SIZE + 1, count);
+}
+
+// A thread that records more than PROFILER_RING_SIZE zones between two
+// frames loses the oldest ones
+
+void Profiler::readRing(Ring& ring)
+{
+	Zone copied[PROFILER_COPY_ZONES];
+	unsigned int head = ring.head.load(memory_order_acquire);
+
+	if (head - ring.read > PROFILER_RING_SIZE)
+		ring.read = head - PROFILER_RING_SIZE;
+	while (ring.read != head)
+	{
+		unsigned int count = min(head - ring.read, (unsigned int)PROFILER_COPY_ZONES);
+		unsigned int dropped = copyZones(ring, ring.read, count, copied);
+		for (unsigned int i = dropped; i < count; i++)
+			addToStats(copied[i]);
+		ring.read += count;
+	}
+}
+
+// Results come in the order the queries were sent, the first one that is
+// not ready stops the rest until the next frame
+
+void Profiler::readQueries()
+{
+	Ring& ring = rings[PROFILER_GPU_RING];
+
+	for (; queryTail != queryHead; queryTail++)
+	{
+		const GpuQuery& query = queries[queryTail & (PROFILER_GPU_QUERIES - 1)];
+		GLint bAvailable = 0;
+		GLuint64 elapsed;
+
+		glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (!bAvailable)
+			break;
+		glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+
+		unsigned int head = ring.head.load(memory_order_relaxed);
+		Zone& zone = ring.zones[head & (PROFILER_RING_SIZE - 1)];
+		zone.name = query.name;
+		zone.start = query.start;
+		zone.end = query.start + elapsed / 1e6;
+		ring.head.store(head + 1, memory_order_release);
+		gpuFrame += zone.end - zone.start;
+	}
+	readRing(ring);
+}
+
+void Profiler::addToStats(const Zone& zone)
+{
+	int i;
+
+	// The same literal in two files may have two addresses
+	for (i = 0; i < numNames; i++)
+		if (stats[i].name == zone.name || strcmp(stats[i].name, zone.name) == 0)
+			break;
+	if (i == numNames)
+	{
+		if (numNames == PROFILER_NAMES)
+			return;
+		stats[i].name = zone.name;
+		stats[i].frame = stats[i].total = stats[i].worst = 0;
+		stats[i].average = stats[i].peak = 0;
+		numNames++;
+	}
+	stats[i].frame += zone.end - zone.start;
+}
+
+
+void Profiler::toggleOverlay()
+{
+	bOverlay = !bOverlay;
+}
+
+// Drawn with the fixed pipeline and GLUT fonts over whatever the frame
+// has, so it does not depend on the shaders of the game. The graph has a
+// bar per frame, the frame time in white and the GPU time in green, and
+// a line at 16.7 ms.
+
+void Profiler::renderOverlay()
+{
+	GLint viewport[4];
+	char text[128];
+	int top[PROFILER_NAMES];
+
+	if (!bOverlay)
+		return;
+
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, viewport[2], viewport[3], 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	float left = 10.f, bottom = 10.f + PROFILER_GRAPH_HEIGHT, width = 2.f * PROFILER_FRAMES;
+	glColor4f(0.f, 0.f, 0.f, 0.6f);
+	glBegin(GL_QUADS);
+	glVertex2f(left - 5.f, 5.f);
+	glVertex2f(left + width + 5.f, 5.f);
+	glVertex2f(left + width + 5.f, bottom + 25.f + 15.f * PROFILER_TOP_ZONES);
+	glVertex2f(left - 5.f, bottom + 25.f + 15.f * PROFILER_TOP_ZONES);
+	glEnd();
+
+	glBegin(GL_LINES);
+	for (int i = 0; i < PROFILER_FRAMES; i++)
+	{
+		int frame = (nextFrame + i) % PROFILER_FRAMES;
+		float x = left + 2.f * i;
+		glColor4f(1.f, 1.f, 1.f, 0.8f);
+		glVertex2f(x, bottom);
+		glVertex2f(x, bottom - float(min(frameTimes[frame] * PROFILER_GRAPH_SCALE, double(PROFILER_GRAPH_HEIGHT))));
+		glColor4f(0.f, 1.f, 0.f, 0.8f);
+		glVertex2f(x + 1.f, bottom);
+		glVertex2f(x + 1.f, bottom - float(min(gpuTimes[frame] * PROFILER_GRAPH_SCALE, double(PROFILER_GRAPH_HEIGHT))));
+	}
+	glColor4f(1.f, 0.f, 0.f, 0.8f);
+	glVertex2f(left, bottom - float(1000.0 / 60.0 * PROFILER_GRAPH_SCALE));
+	glVertex2f(left + width, bottom - float(1000.0 / 60.0 * PROFILER_GRAPH_SCALE));
+	glEnd();
+
+	// Zones that took most time per frame
+	for (int i = 0; i < numNames; i++)
+		top[i] = i;
+	int numTop = min(numNames, PROFILER_TOP_ZONES);
+	partial_sort(top, top + numTop, top + numNames, [this](int a, int b) { return stats[a].average > stats[b].average; });
+
+	glColor4f(1.f, 1.f, 1.f, 1.f);
+	int previous = (nextFrame + PROFILER_FRAMES - 1) % PROFILER_FRAMES;
+	snprintf(text, sizeof(text), "frame %.2f ms  gpu %.2f ms", frameTimes[previous], gpuTimes[previous]);
+	glRasterPos2f(left, bottom + 15.f);
+	for (const char* c = text; *c != '\0'; c++)
+		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+	for (int i = 0; i < numTop; i++)
+	{
+		const ZoneStats& zone = stats[top[i]];
+		snprintf(text, sizeof(text), "%-24s %6.3f  max %6.3f ms", zone.name, zone.average, zone.peak);
+		glRasterPos2f(left, bottom + 30.f + 15.f * i);
+		for (const char* c = text; *c != '\0'; c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
+
+
+// The Chrome trace event format: a complete event ("X") per zone, times
+// in microseconds, and the name of every thread as metadata. Zones being
+// written while the trace is exported may come out wrong.
+
+bool Profiler::exportTrace(const string& filename) const
+{
+	ofstream fout(filename.c_str(), ios::out | ios::trunc);
+	bool bFirst = true;
+
+	if (!fout.is_open())
+		return false;
+
+	fout << "{\"traceEvents\":[" << endl << fixed << setprecision(3);
+	int last = min(numThreads.load(), PROFILER_THREADS);
+	for (int i = 0; i < last; i++)
+		writeTrace(fout, rings[i], i, bFirst);
+	writeTrace(fout, rings[PROFILER_GPU_RING], PROFILER_GPU_RING, bFirst);
+	fout << endl << "]}" << endl;
+
+	return fout.good();
+}
+
+void Profiler::writeTrace(ostream& out, const Ring& ring, int tid, bool& bFirst) const
+{
+	Zone copied[PROFILER_COPY_ZONES];
+	unsigned int head = ring.head.load(memory_order_acquire);
+	unsigned int first = (head > PROFILER_RING_SIZE) ? head - PROFILER_RING_SIZE : 0;
+
+	if (ring.threadName != NULL)
+	{
+		out << (bFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"" << ring.threadName << "\"}}";
+		bFirst = false;
+	}
+	while (first != head)
+	{
+		unsigned int count = min(head - first, (unsigned int)PROFILER_COPY_ZONES);
+		unsigned int dropped = copyZones(ring, first, count, copied);
+		for (unsigned int i = dropped; i < count; i++)
+		{
+			const Zone& zone = copied[i];
+			out << (bFirst ? "" : ",\n") << "{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+				<< ",\"ts\":" << 1000.0 * zone.start << ",\"dur\":" << 1000.0 * (zone.end - zone.start) << "}";
+			bFirst = false;
+		}
+		first += count;
+	}
+}
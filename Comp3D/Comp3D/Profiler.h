@@ -0,0 +1,165 @@
+#ifndef _PROFILER_INCLUDE
+#define _PROFILER_INCLUDE
+
+
+#include <atomic>
+#include <string>
+#include <ostream>
+#include "FrameScheduler.h"
+
+
+using namespace std;
+
+
+#define PROFILER_THREADS 16				// Threads that record zones, later ones are ignored
+#define PROFILER_RING_SIZE 4096			// Zones kept per thread, must be a power of two
+#define PROFILER_COPY_ZONES 256			// Zones copied out of a ring at a time
+#define PROFILER_NAMES 64				// Different zones in the overlay
+#define PROFILER_FRAMES 120				// Frames in the graph, and averaged for the top zones
+#define PROFILER_TOP_ZONES 12			// Lines in the overlay
+#define PROFILER_GPU_QUERIES 64			// GPU zones in flight, must be a power of two
+
+
+// Profiler records zones, named intervals of time, from any thread. Code
+// marks them with PROFILE_ZONE("name"), which times the rest of the scope,
+// and the render passes with PROFILE_GPU_BEGIN("name") / PROFILE_GPU_END(),
+// GL_TIME_ELAPSED queries read back a few frames later. GPU zones cannot
+// nest, beginning one ends the previous one.
+//
+// Every thread writes its zones to its own ring, only it moves the head, so
+// recording never locks. Readers copy zones out and then check the head
+// again, dropping the ones the owner may have overwritten meanwhile. The
+// main loop calls beginFrame once per frame to read the new zones and the
+// finished queries: the frame times and the zones that took most time per
+// frame (inclusive, averaged over the last PROFILER_FRAMES frames) are
+// shown by the overlay. exportTrace writes what the rings still hold, the
+// last PROFILER_RING_SIZE zones of every thread, as a Chrome trace
+// (chrome://tracing or Perfetto).
+//
+// It is only compiled in with COMP3D_PROFILE defined; without it the
+// macros expand to nothing and isEnabled returns false. Zone names must be
+// string literals, only their pointer is kept.
+
+
+class Profiler
+{
+
+private:
+	Profiler();
+
+public:
+	static Profiler& instance()
+	{
+		static Profiler P;
+
+		return P;
+	}
+
+	static bool isEnabled();
+
+	// The name of the calling thread in the trace
+	void setThreadName(const char* name);
+	void addZone(const char* name, double start, double end);
+
+	// Main thread, with an OpenGL context
+	void beginGpuZone(const char* name);
+	void endGpuZone();
+
+	// Closes the frame, from the thread that draws
+	void beginFrame();
+
+	void toggleOverlay();
+	void renderOverlay();
+
+	bool exportTrace(const string& filename) const;
+
+private:
+	struct Zone
+	{
+		const char* name;
+		double start, end;				// ms, FrameScheduler::now
+	};
+
+	struct Ring
+	{
+		atomic<unsigned int> head;		// Zones written, only the owner moves it
+		unsigned int read;				// Zones beginFrame has seen
+		const char* threadName;
+		Zone zones[PROFILER_RING_SIZE];
+	};
+
+	struct ZoneStats
+	{
+		const char* name;
+		double frame;					// This frame
+		double total, worst;			// Over the frames being averaged
+		double average, peak;			// Last PROFILER_FRAMES frames, what the overlay shows
+	};
+
+	struct GpuQuery
+	{
+		unsigned int query;
+		const char* name;
+		double start;					// When the pass was sent
+	};
+
+	int registerThread();
+	unsigned int copyZones(const Ring& ring, unsigned int first, unsigned int count, Zone* copied) const;
+	void readRing(Ring& ring);
+	void readQueries();
+	void addToStats(const Zone& zone);
+	void writeTrace(ostream& out, const Ring& ring, int tid, bool& bFirst) const;
+
+private:
+	Ring rings[PROFILER_THREADS + 1];	// The last one holds the GPU zones
+	atomic<int> numThreads;
+
+	ZoneStats stats[PROFILER_NAMES];
+	int numNames;
+	int numFrames;						// Into the ones being averaged
+
+	double lastFrame;
+	double frameTimes[PROFILER_FRAMES], gpuTimes[PROFILER_FRAMES];
+	double gpuFrame;
+	int nextFrame;
+
+	GpuQuery queries[PROFILER_GPU_QUERIES];
+	unsigned int queryHead, queryTail;
+	bool bGpuZone, bGpuChecked, bGpuSupported;
+	bool bOverlay;
+
+};
+
+
+// ProfileZone times its scope, see PROFILE_ZONE
+
+class ProfileZone
+{
+
+public:
+	ProfileZone(const char* name) : name(name), start(FrameScheduler::now()) {}
+	~ProfileZone() { Profiler::instance().addZone(name, start, FrameScheduler::now()); }
+
+private:
+	const char* name;
+	double start;
+
+};
+
+
+#ifdef COMP3D_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_BEGIN(name) Profiler::instance().beginGpuZone(name)
+#define PROFILE_GPU_END() Profiler::instance().endGpuZone()
+#define PROFILE_THREAD(name) Profiler::instance().setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_BEGIN(name)
+#define PROFILE_GPU_END()
+#define PROFILE_THREAD(name)
+#endif
+
+
+#endif // _PROFILER_INCLUDE
@@ -0,0 +1,232 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include "RenderSnapshot.h"
+#include "GpuParticleSystem.h"
+#include "Game.h"
+#include "Profiler.h"
+#include "MemoryAccounting.h"
+
+
+RenderSnapshot::RenderSnapshot()
+{
+	program = NULL;
+	inputTime = 0;
+	modelPass = RenderStats::OTHER;
+	bRenderStats = false;
+	bMemory = false;
+}
+
+
+void RenderSnapshot::clear()
+{
+	// Keeps the capacity, the same snapshots are filled every step
+	draws.clear();
+	program = NULL;
+	inputTime = 0;
+	modelPass = RenderStats::OTHER;
+	bRenderStats = false;
+	bMemory = false;
+}
+
+bool RenderSnapshot::empty() const
+{
+	return program == NULL;
+}
+
+
+void RenderSnapshot::setProgram(ShaderProgram *program)
+{
+	this->program = program;
+}
+
+void RenderSnapshot::setCamera(const glm::mat4 &projection, const glm::mat4 &view, const glm::vec3 &eye)
+{
+	this->projection = projection;
+	this->view = view;
+	this->eye = eye;
+	normalMatrix = glm::transpose(glm::inverse(glm::mat3(view)));
+}
+
+void RenderSnapshot::showRenderStats(const glm::vec2 &position)
+{
+	bRenderStats = true;
+	renderStatsPosition = position;
+}
+
+void RenderSnapshot::showMemory(const glm::vec2 &position)
+{
+	bMemory = true;
+	memoryPosition = position;
+}
+
+
+void RenderSnapshot::addModel(const AssimpModel *model, const glm::mat4 &modelMatrix, float alpha)
+{
+	addModel(model, modelMatrix, normalMatrix, alpha);
+}
+
+void RenderSnapshot::addModel(const AssimpModel *model, const glm::mat4 &modelMatrix, const glm::mat3 &normalMatrix, float alpha)
+{
+	Draw draw;
+
+	draw.kind = Kind::MODEL;
+	draw.model = model;
+	draw.billboard = NULL;
+	draw.sprite = NULL;
+	draw.particles = NULL;
+	draw.modelMatrix = modelMatrix;
+	draw.normalMatrix = normalMatrix;
+	draw.alpha = alpha;
+	draw.bBlend = (alpha < 1.f);
+	draw.pass = modelPass;
+	draws.push_back(draw);
+}
+
+void RenderSnapshot::addBillboard(Billboard *billboard, const glm::vec3 &position, float alpha)
+{
+	Draw draw;
+
+	draw.kind = Kind::BILLBOARD;
+	draw.model = NULL;
+	draw.billboard = billboard;
+	draw.sprite = NULL;
+	draw.particles = NULL;
+	draw.modelMatrix = glm::mat4(1.0f);
+	draw.normalMatrix = normalMatrix;
+	draw.position = position;
+	draw.alpha = alpha;
+	draw.bBlend = true;
+	draw.pass = RenderStats::PARTICLES;
+	draws.push_back(draw);
+}
+
+void RenderSnapshot::addParticles(GpuParticleSystem *particles)
+{
+	Draw draw;
+
+	draw.kind = Kind::PARTICLES;
+	draw.model = NULL;
+	draw.billboard = NULL;
+	draw.sprite = NULL;
+	draw.particles = particles;
+	draw.alpha = 1.f;
+	draw.bBlend = true;
+	draw.pass = RenderStats::PARTICLES;
+	draws.push_back(draw);
+}
+
+void RenderSnapshot::addSprite(const Sprite *sprite, float alpha)
+{
+	Draw draw;
+
+	draw.kind = Kind::SPRITE;
+	draw.model = NULL;
+	draw.billboard = NULL;
+	draw.sprite = sprite;
+	draw.particles = NULL;
+	draw.alpha = alpha;
+	draw.bBlend = (alpha < 1.f);
+	draw.pass = RenderStats::OVERLAY;
+	draws.push_back(draw);
+}
+
+
+// Every run of draws of the same kind is a pass timed on the GPU. What
+// is sent to OpenGL is counted by RenderStats for the pass of each draw,
+// the setup of the frame is "other".
+
+void RenderSnapshot::render() const
+{
+	PROFILE_ZONE("RenderSnapshot::render");
+#ifdef COMP3D_PROFILE
+	static const char* passNames[] = { "GPU models", "GPU billboards", "GPU particles", "GPU sprites" };
+#endif
+	glm::mat4 matrix;
+	glm::mat3 normal;
+	bool bOverlay = false;
+	int pass = -1;
+
+	if (program == NULL)
+		return;
+
+	RenderStats::instance().setPass(RenderStats::OTHER);
+	program->use();
+	program->setUniform1b("bLighting", true);
+	matrix = projection;
+	program->setUniformMatrix4f("projection", matrix);
+	matrix = view;
+	program->setUniformMatrix4f("view", matrix);
+	program->setUniform4f("color", 1.0f, 1.0f, 1.0f, 1.0f);
+
+	for (const Draw &draw : draws)
+	{
+		if (int(draw.kind) != pass)
+		{
+			pass = int(draw.kind);
+			PROFILE_GPU_BEGIN(passNames[pass]);
+		}
+		RenderStats::instance().setPass(draw.pass);
+		program->setUniform1f("alpha", draw.alpha);
+		setBlend(draw.bBlend);
+
+		switch (draw.kind)
+		{
+		case Kind::MODEL:
+			matrix = draw.modelMatrix;
+			normal = draw.normalMatrix;
+			program->setUniformMatrix4f("model", matrix);
+			program->setUniformMatrix3f("normalmatrix", normal);
+			draw.model->render(*program);
+			break;
+		case Kind::BILLBOARD:
+			matrix = draw.modelMatrix;
+			normal = draw.normalMatrix;
+			program->setUniformMatrix4f("model", matrix);
+			program->setUniformMatrix3f("normalmatrix", normal);
+			draw.billboard->render(draw.position, eye);
+			break;
+		case Kind::PARTICLES:
+			// They have their own program, the uniforms of ours are kept
+			draw.particles->render(projection, view);
+			program->use();
+			break;
+		case Kind::SPRITE:
+			// Sprites come last, the 3D camera is not needed any more
+			if (!bOverlay)
+			{
+				matrix = glm::ortho(0.f, float(SCREEN_WIDTH - 1), float(SCREEN_HEIGHT - 1), 0.f);
+				program->setUniformMatrix4f("projection", matrix);
+				matrix = glm::mat4(1.0f);
+				program->setUniformMatrix4f("view", matrix);
+				program->setUniform1b("bLighting", false);
+				bOverlay = true;
+			}
+			draw.sprite->render();
+			break;
+		}
+	}
+	PROFILE_GPU_END();
+	RenderStats::instance().setPass(RenderStats::OTHER);
+	setBlend(false);
+
+	if (bRenderStats)
+		RenderStats::instance().renderHud(renderStatsPosition);
+	if (bMemory)
+		MemoryAccounting::instance().renderHud(memoryPosition);
+}
+
+
+void RenderSnapshot::setBlend(bool bBlend) const
+{
+	if (bBlend)
+	{
+		glDepthMask(GL_FALSE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else
+	{
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		glDisable(GL_BLEND);
+		glDepthMask(GL_TRUE);
+	}
+}
@@ -0,0 +1,108 @@
+#ifndef _RENDER_SNAPSHOT_INCLUDE
+#define _RENDER_SNAPSHOT_INCLUDE
+
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "ShaderProgram.h"
+#include "AssimpModel.h"
+#include "Billboard.h"
+#include "Sprite.h"
+#include "RenderStats.h"
+
+
+using namespace std;
+
+
+class GpuParticleSystem;
+
+
+// RenderSnapshot describes a whole frame of the game: the camera, every
+// model with its transform, the particles and the 2D overlays, in the
+// order they have to be drawn. The simulation fills it and render replays
+// it, which is the only part of a frame that makes OpenGL calls.
+//
+// It only points to resources that do not change while a level is played
+// (models, billboards, sprites, the shader program), so a snapshot can be
+// drawn from another thread while the simulation keeps going.
+
+
+class RenderSnapshot
+{
+
+public:
+	RenderSnapshot();
+
+	void clear();
+	bool empty() const;
+
+	void setProgram(ShaderProgram *program);
+	void setCamera(const glm::mat4 &projection, const glm::mat4 &view, const glm::vec3 &eye);
+
+	const glm::mat4 &getView() const { return view; }
+	const glm::vec3 &getEye() const { return eye; }
+
+	// Pass the models added from now on count for (see RenderStats), the
+	// other draws have their own
+	void setPass(RenderStats::Pass pass) { modelPass = pass; }
+	// Draws the render stats HUD after the frame, position is its bottom left corner
+	void showRenderStats(const glm::vec2 &position);
+	// Draws the MemoryAccounting HUD, position is its top left corner
+	void showMemory(const glm::vec2 &position);
+
+	// Oldest input this frame is the first to show, 0 if none (see InputLatency)
+	void setInputTime(double time) { inputTime = time; }
+	double getInputTime() const { return inputTime; }
+
+	// Draws with alpha below one are blended and do not write depth
+	void addModel(const AssimpModel *model, const glm::mat4 &modelMatrix, float alpha = 1.f);
+	void addModel(const AssimpModel *model, const glm::mat4 &modelMatrix, const glm::mat3 &normalMatrix, float alpha = 1.f);
+	void addBillboard(Billboard *billboard, const glm::vec3 &position, float alpha);
+	// Runs the pending GPU simulation of the particles before drawing them
+	void addParticles(GpuParticleSystem *particles);
+	// Sprites are drawn in screen coordinates after the 3D scene
+	void addSprite(const Sprite *sprite, float alpha = 1.f);
+
+	void render() const;
+
+private:
+	enum class Kind
+	{
+		MODEL,
+		BILLBOARD,
+		PARTICLES,
+		SPRITE
+	};
+
+	struct Draw
+	{
+		Kind kind;
+		const AssimpModel *model;
+		Billboard *billboard;
+		const Sprite *sprite;
+		GpuParticleSystem *particles;
+		glm::mat4 modelMatrix;
+		glm::mat3 normalMatrix;
+		glm::vec3 position;
+		float alpha;
+		bool bBlend;
+		RenderStats::Pass pass;
+	};
+
+	void setBlend(bool bBlend) const;
+
+private:
+	ShaderProgram *program;
+	glm::mat4 projection, view;
+	glm::mat3 normalMatrix;						// Default one, the view without model
+	glm::vec3 eye;
+	vector<Draw> draws;
+	double inputTime;
+	RenderStats::Pass modelPass;
+	bool bRenderStats, bMemory;
+	glm::vec2 renderStatsPosition, memoryPosition;
+
+};
+
+
+#endif // _RENDER_SNAPSHOT_INCLUDE
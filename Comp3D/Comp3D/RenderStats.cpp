@@ -0,0 +1,206 @@
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include "RenderStats.h"
+#include "Game.h"
+
+
+#define RENDER_STATS_LINE 15			// Pixels between the lines of the HUD
+
+
+static const char* passNames[RenderStats::NUM_PASSES] = { "tilemap", "entities", "particles", "overlay", "other" };
+static const char* counterNames[RENDER_STATS_COUNTERS] = { "draws", "triangles", "texture binds", "program binds",
+	"vao binds", "buffer uploads", "upload bytes", "uniforms" };
+
+
+RenderStats::RenderStats()
+{
+	pass = OTHER;
+	memset(frame, 0, sizeof(frame));
+	memset(lastFrame, 0, sizeof(lastFrame));
+	memset(&levelCounters, 0, sizeof(levelCounters));
+	nextLevel = 0;
+	level = 0;
+}
+
+
+const char* RenderStats::getPassName(Pass pass)
+{
+	return passNames[pass];
+}
+
+void RenderStats::toArray(const Counters& counters, int values[RENDER_STATS_COUNTERS])
+{
+	values[0] = counters.drawCalls;
+	values[1] = counters.triangles;
+	values[2] = counters.textureBinds;
+	values[3] = counters.programBinds;
+	values[4] = counters.vertexArrayBinds;
+	values[5] = counters.bufferUploads;
+	values[6] = counters.uploadBytes;
+	values[7] = counters.uniformUploads;
+}
+
+
+// The frames drawn while a level is played count for it, the ones after
+// it ended (the fade out, the menu) do not.
+
+void RenderStats::beginFrame()
+{
+	int values[RENDER_STATS_COUNTERS], frameTotal[RENDER_STATS_COUNTERS];
+
+	if (level != 0)
+	{
+		memset(frameTotal, 0, sizeof(frameTotal));
+		for (int i = 0; i < NUM_PASSES; i++)
+		{
+			toArray(frame[i], values);
+			for (int j = 0; j < RENDER_STATS_COUNTERS; j++)
+			{
+				levelCounters.total[i][j] += values[j];
+				frameTotal[j] += values[j];
+			}
+		}
+		for (int j = 0; j < RENDER_STATS_COUNTERS; j++)
+			levelCounters.peak[j] = max(levelCounters.peak[j], frameTotal[j]);
+		levelCounters.numFrames++;
+	}
+
+	memcpy(lastFrame, frame, sizeof(frame));
+	memset(frame, 0, sizeof(frame));
+
+	int newLevel = nextLevel;
+	if (newLevel != level)
+	{
+		if (level != 0)
+			print(cout);
+		memset(&levelCounters, 0, sizeof(levelCounters));
+		level = newLevel;
+	}
+}
+
+void RenderStats::setLevel(int level)
+{
+	nextLevel = level;
+}
+
+RenderStats::Counters RenderStats::getFrameTotal() const
+{
+	Counters total;
+
+	memset(&total, 0, sizeof(total));
+	for (const Counters& counters : lastFrame)
+	{
+		total.drawCalls += counters.drawCalls;
+		total.triangles += counters.triangles;
+		total.textureBinds += counters.textureBinds;
+		total.programBinds += counters.programBinds;
+		total.vertexArrayBinds += counters.vertexArrayBinds;
+		total.bufferUploads += counters.bufferUploads;
+		total.uploadBytes += counters.uploadBytes;
+		total.uniformUploads += counters.uniformUploads;
+	}
+
+	return total;
+}
+
+
+// Average per frame of every pass, and the worst frame, of the level
+// being played
+
+void RenderStats::print(ostream& out) const
+{
+	char text[128];
+	int numFrames = max(levelCounters.numFrames, 1);
+
+	out << "Render stats of level " << level << ", " << levelCounters.numFrames << " frames, per frame:" << endl;
+	snprintf(text, sizeof(text), "  %-10s", "");
+	out << text;
+	for (int j = 0; j < RENDER_STATS_COUNTERS; j++)
+	{
+		snprintf(text, sizeof(text), " %14s", counterNames[j]);
+		out << text;
+	}
+	out << endl;
+	for (int i = 0; i < NUM_PASSES; i++)
+	{
+		snprintf(text, sizeof(text), "  %-10s", passNames[i]);
+		out << text;
+		for (int j = 0; j < RENDER_STATS_COUNTERS; j++)
+		{
+			snprintf(text, sizeof(text), " %14.1f", double(levelCounters.total[i][j]) / numFrames);
+			out << text;
+		}
+		out << endl;
+	}
+	snprintf(text, sizeof(text), "  %-10s", "peak");
+	out << text;
+	for (int j = 0; j < RENDER_STATS_COUNTERS; j++)
+	{
+		snprintf(text, sizeof(text), " %14d", levelCounters.peak[j]);
+		out << text;
+	}
+	out << endl;
+}
+
+
+// Drawn like the profiler overlay, over the frame, in the coordinates of
+// the 2D sprites. The lines go up from position, a line per pass and the
+// total of the last frame.
+
+void RenderStats::renderHud(const glm::vec2& position) const
+{
+	char text[128];
+	int values[RENDER_STATS_COUNTERS];
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1, 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	float top = position.y - RENDER_STATS_LINE * (NUM_PASSES + 2);
+	glColor4f(0.f, 0.f, 0.f, 0.6f);
+	glBegin(GL_QUADS);
+	glVertex2f(position.x - 5.f, top);
+	glVertex2f(position.x + 455.f, top);
+	glVertex2f(position.x + 455.f, position.y + 5.f);
+	glVertex2f(position.x - 5.f, position.y + 5.f);
+	glEnd();
+
+	glColor4f(1.f, 1.f, 1.f, 1.f);
+	for (int i = 0; i <= NUM_PASSES + 1; i++)
+	{
+		if (i == 0)
+			snprintf(text, sizeof(text), "%-10s %6s %7s %5s %5s %5s %5s %8s %6s", "", "draws", "tris", "tex", "prog",
+				"vao", "upl", "bytes", "unif");
+		else
+		{
+			Counters counters = (i <= NUM_PASSES) ? lastFrame[i - 1] : getFrameTotal();
+			toArray(counters, values);
+			snprintf(text, sizeof(text), "%-10s %6d %7d %5d %5d %5d %5d %8d %6d", (i <= NUM_PASSES) ? passNames[i - 1] : "total",
+				values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7]);
+		}
+		glRasterPos2f(position.x, top + RENDER_STATS_LINE * (i + 1) - 3.f);
+		for (const char* c = text; *c != '\0'; c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,146 @@
+#ifndef _RENDER_STATS_INCLUDE
+#define _RENDER_STATS_INCLUDE
+
+
+#include <GL/glew.h>
+#include <atomic>
+#include <ostream>
+#include <glm/glm.hpp>
+
+
+using namespace std;
+
+
+#define RENDER_STATS_COUNTERS 8			// Fields of Counters
+
+
+// RenderStats counts what the renderer asks OpenGL to do. The engine calls
+// the GL entry points it draws with through it (draws, texture, program
+// and vertex array binds, buffer uploads) and ShaderProgram counts its
+// uniform uploads, all from the main thread. Counts go to the pass being
+// drawn, which RenderSnapshot sets for every draw: the tile map, the
+// entities (player, walls, spikes...), the particles and the 2D overlay.
+// Everything else, like the menu or loading, is "other".
+//
+// beginFrame closes the frame, the HUD shows the last complete one. When a
+// level ends its average and peak per frame are printed.
+
+
+class RenderStats
+{
+
+private:
+	RenderStats();
+
+public:
+	enum Pass
+	{
+		TILEMAP,
+		ENTITIES,
+		PARTICLES,
+		OVERLAY,
+		OTHER,
+		NUM_PASSES
+	};
+
+	struct Counters
+	{
+		int drawCalls;
+		int triangles;					// GL_POINTS draws have none
+		int textureBinds, programBinds, vertexArrayBinds;
+		int bufferUploads;
+		int uploadBytes;
+		int uniformUploads;
+	};
+
+	static RenderStats& instance()
+	{
+		static RenderStats R;
+
+		return R;
+	}
+
+	static const char* getPassName(Pass pass);
+
+	void setPass(Pass pass) { this->pass = pass; }
+
+	// Closes the frame, and prints the level that ended if there is one
+	void beginFrame();
+	// Any thread, 0 when no level is played
+	void setLevel(int level);
+
+	const Counters& getFrame(Pass pass) const { return lastFrame[pass]; }
+	Counters getFrameTotal() const;
+
+	void print(ostream& out) const;
+	// Fixed pipeline and GLUT fonts, with position the top left corner in pixels
+	void renderHud(const glm::vec2& position) const;
+
+	void drawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		glDrawArrays(mode, first, count);
+		frame[pass].drawCalls++;
+		frame[pass].triangles += (mode == GL_TRIANGLES) ? count / 3 : (mode == GL_QUADS) ? count / 2 : 0;
+	}
+
+	void drawTransformFeedback(GLenum mode, GLuint id)
+	{
+		glDrawTransformFeedback(mode, id);
+		frame[pass].drawCalls++;
+	}
+
+	void bindTexture(GLenum target, GLuint texture)
+	{
+		glBindTexture(target, texture);
+		frame[pass].textureBinds++;
+	}
+
+	void useProgram(GLuint program)
+	{
+		glUseProgram(program);
+		frame[pass].programBinds++;
+	}
+
+	void bindVertexArray(GLuint array)
+	{
+		glBindVertexArray(array);
+		frame[pass].vertexArrayBinds++;
+	}
+
+	void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		glBufferData(target, size, data, usage);
+		frame[pass].bufferUploads++;
+		frame[pass].uploadBytes += int(size);
+	}
+
+	void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		glBufferSubData(target, offset, size, data);
+		frame[pass].bufferUploads++;
+		frame[pass].uploadBytes += int(size);
+	}
+
+	void uniformUploaded() { frame[pass].uniformUploads++; }
+
+private:
+	struct LevelCounters
+	{
+		long long total[NUM_PASSES][RENDER_STATS_COUNTERS];	// The Counters, in the same order
+		int peak[RENDER_STATS_COUNTERS];					// Of the whole frame
+		int numFrames;
+	};
+
+	static void toArray(const Counters& counters, int values[RENDER_STATS_COUNTERS]);
+
+private:
+	Pass pass;
+	Counters frame[NUM_PASSES], lastFrame[NUM_PASSES];
+	atomic<int> nextLevel;
+	int level;
+	LevelCounters levelCounters;
+
+};
+
+
+#endif // _RENDER_STATS_INCLUDE
@@ -0,0 +1,284 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include "Replay.h"
+#include "FrameScheduler.h"
+
+
+#define REPLAY_SKIP 0xff					// Record type that only moves the step forward
+#define REPLAY_MAX_DELTA 0xffff
+
+
+void StateHash::add(const void* data, size_t bytes)
+{
+	const unsigned char* bytesData = (const unsigned char*)data;
+
+	for (size_t i = 0; i < bytes; i++)
+	{
+		value ^= bytesData[i];
+		value *= 16777619u;
+	}
+}
+
+
+Replay::Replay()
+{
+	mode = OFF;
+	current = -1;
+	step = 0;
+	nextEvent = 0;
+	hashPeriod = REPLAY_HASH_PERIOD;
+	numDivergences = 0;
+	bDiverged = false;
+}
+
+
+bool Replay::startRecording(const string& filename)
+{
+	ofstream fout(filename.c_str(), ios::out | ios::binary | ios::trunc);
+
+	if (!fout.is_open())
+		return false;
+	this->filename = filename;
+	levels.clear();
+	current = -1;
+	hashPeriod = REPLAY_HASH_PERIOD;
+	mode = RECORDING;
+
+	return true;
+}
+
+bool Replay::startReplay(const string& filename)
+{
+	if (!load(filename))
+		return false;
+	this->filename = filename;
+	current = -1;
+	numDivergences = 0;
+	mode = REPLAYING;
+
+	return true;
+}
+
+void Replay::stop()
+{
+	if (mode == RECORDING && !save())
+		cerr << "Could not write the recording '" << filename << "'" << endl;
+	mode = OFF;
+	current = -1;
+}
+
+
+bool Replay::isFinished() const
+{
+	if (mode != REPLAYING || current < 0)
+		return false;
+	if (current >= int(levels.size()))
+		return true;
+
+	return current == int(levels.size()) - 1 && step >= levels[current].numSteps;
+}
+
+int Replay::getFirstLevel() const
+{
+	return levels.empty() ? 1 : levels[0].level;
+}
+
+
+void Replay::beginLevel(int level, unsigned int& seed, bool& bGodMode)
+{
+	if (mode == OFF)
+		return;
+
+	step = 0;
+	nextEvent = 0;
+	bDiverged = false;
+
+	if (mode == RECORDING)
+	{
+		// What was recorded so far is kept if the game does not quit cleanly
+		if (current >= 0)
+			save();
+		levels.push_back(Level());
+		current = int(levels.size()) - 1;
+		levels[current].level = level;
+		levels[current].seed = seed;
+		levels[current].bGodMode = bGodMode;
+		levels[current].numSteps = 0;
+		levels[current].events.reserve(REPLAY_RESERVE_EVENTS);
+		levels[current].hashes.reserve(REPLAY_RESERVE_HASHES);
+		return;
+	}
+
+	// Past the last recorded level nothing is fed or checked
+	current++;
+	if (current >= int(levels.size()))
+		return;
+	if (levels[current].level != level)
+	{
+		cerr << "Replay diverged, level " << level << " started instead of level " << levels[current].level << endl;
+		numDivergences++;
+		bDiverged = true;
+	}
+	seed = levels[current].seed;
+	bGodMode = levels[current].bGodMode;
+}
+
+
+void Replay::recordInput(const InputEvent& event)
+{
+	if (mode != RECORDING || current < 0)
+		return;
+
+	Event recorded;
+	recorded.step = step;
+	recorded.type = event.type;
+	recorded.key = event.key;
+	levels[current].events.push_back(recorded);
+}
+
+bool Replay::nextInput(InputEvent& event)
+{
+	if (mode != REPLAYING || current < 0 || current >= int(levels.size()))
+		return false;
+
+	const vector<Event>& events = levels[current].events;
+	if (nextEvent >= events.size() || events[nextEvent].step > step)
+		return false;
+	event.type = events[nextEvent].type;
+	event.key = events[nextEvent].key;
+	event.time = FrameScheduler::now();
+	nextEvent++;
+
+	return true;
+}
+
+
+bool Replay::endStep()
+{
+	if (mode == OFF || current < 0 || current >= int(levels.size()))
+		return false;
+
+	step++;
+	if (mode == RECORDING)
+		levels[current].numSteps = step;
+
+	return step % hashPeriod == 0;
+}
+
+void Replay::addHash(unsigned int hash)
+{
+	if (mode == RECORDING)
+	{
+		levels[current].hashes.push_back(hash);
+		return;
+	}
+
+	// Steps the recording did not get to are not checked
+	const vector<unsigned int>& hashes = levels[current].hashes;
+	unsigned int index = step / hashPeriod - 1;
+	if (index < hashes.size() && hashes[index] != hash && !bDiverged)
+	{
+		cerr << "Replay diverged in level " << levels[current].level << " at step " << step << endl;
+		numDivergences++;
+		bDiverged = true;
+	}
+}
+
+
+bool Replay::save() const
+{
+	ofstream fout(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	Header header;
+
+	if (!fout.is_open())
+		return false;
+	memcpy(header.magic, "C3DR", 4);
+	header.version = REPLAY_FILE_VERSION;
+	header.hashPeriod = hashPeriod;
+	header.numLevels = int32_t(levels.size());
+	fout.write((const char*)&header, sizeof(header));
+
+	vector<EventRecord> records;
+	for (const Level& level : levels)
+	{
+		// Events are stored as the steps since the previous one, long
+		// pauses take extra records that only skip steps
+		int previous = 0;
+		records.clear();
+		for (const Event& event : level.events)
+		{
+			int delta = event.step - previous;
+			for (; delta > REPLAY_MAX_DELTA; delta -= REPLAY_MAX_DELTA)
+				records.push_back({ REPLAY_MAX_DELTA, REPLAY_SKIP, 0 });
+			records.push_back({ uint16_t(delta), uint8_t(event.type), uint8_t(event.key) });
+			previous = event.step;
+		}
+
+		LevelHeader levelHeader;
+		levelHeader.level = level.level;
+		levelHeader.seed = level.seed;
+		levelHeader.bGodMode = level.bGodMode;
+		levelHeader.numSteps = level.numSteps;
+		levelHeader.numEvents = int32_t(records.size());
+		levelHeader.numHashes = int32_t(level.hashes.size());
+		fout.write((const char*)&levelHeader, sizeof(levelHeader));
+		if (!records.empty())
+			fout.write((const char*)&records[0], records.size() * sizeof(EventRecord));
+		if (!level.hashes.empty())
+			fout.write((const char*)&level.hashes[0], level.hashes.size() * sizeof(uint32_t));
+	}
+
+	return fout.good();
+}
+
+bool Replay::load(const string& filename)
+{
+	ifstream fin(filename.c_str(), ios::in | ios::binary);
+	Header header;
+
+	if (!fin.is_open())
+		return false;
+	if (!fin.read((char*)&header, sizeof(header)) || memcmp(header.magic, "C3DR", 4) != 0)
+		return false;
+	if (header.version != REPLAY_FILE_VERSION || header.hashPeriod <= 0 || header.numLevels < 0)
+		return false;
+
+	levels.clear();
+	levels.resize(header.numLevels);
+	hashPeriod = header.hashPeriod;
+
+	vector<EventRecord> records;
+	for (Level& level : levels)
+	{
+		LevelHeader levelHeader;
+		if (!fin.read((char*)&levelHeader, sizeof(levelHeader)) || levelHeader.numEvents < 0 || levelHeader.numHashes < 0)
+			return false;
+		level.level = levelHeader.level;
+		level.seed = levelHeader.seed;
+		level.bGodMode = levelHeader.bGodMode != 0;
+		level.numSteps = levelHeader.numSteps;
+
+		records.resize(levelHeader.numEvents);
+		level.hashes.resize(levelHeader.numHashes);
+		if (!records.empty() && !fin.read((char*)&records[0], records.size() * sizeof(EventRecord)))
+			return false;
+		if (!level.hashes.empty() && !fin.read((char*)&level.hashes[0], level.hashes.size() * sizeof(uint32_t)))
+			return false;
+
+		int previous = 0;
+		for (const EventRecord& record : records)
+		{
+			previous += record.delta;
+			if (record.type == REPLAY_SKIP)
+				continue;
+			Event event;
+			event.step = previous;
+			event.type = InputEvent::Type(record.type);
+			event.key = record.key;
+			level.events.push_back(event);
+		}
+	}
+
+	return true;
+}
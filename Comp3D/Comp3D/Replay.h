@@ -0,0 +1,163 @@
+#ifndef _REPLAY_INCLUDE
+#define _REPLAY_INCLUDE
+
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "InputQueue.h"
+
+
+using namespace std;
+
+
+#define REPLAY_FILE_VERSION 1
+#define REPLAY_HASH_PERIOD 25			// Steps between state hashes, 200 ms of game
+#define REPLAY_RESERVE_EVENTS 4096		// Per level, so that recording does not allocate while playing
+#define REPLAY_RESERVE_HASHES 4096		// 13 minutes of game
+
+
+// StateHash is an FNV-1a hash of the bytes of the values added, used to
+// compare the state of two runs of the same level.
+
+class StateHash
+{
+
+public:
+	StateHash() : value(2166136261u) {}
+
+	void add(const void* data, size_t bytes);
+	template<class T> void add(const T& data) { add(&data, sizeof(T)); }
+	template<class T> void add(const vector<T>& data) { if (!data.empty()) add(data.data(), data.size() * sizeof(T)); }
+
+	unsigned int get() const { return value; }
+
+private:
+	unsigned int value;
+
+};
+
+
+// Replay records the input of a game and plays it back. Events are stamped
+// with the simulation step of the level they are applied in, so playing
+// them back does not depend on the frame rate or the wall clock. Every
+// level keeps its number, the seed of its particles and whether god mode
+// was on, and a hash of the game state every REPLAY_HASH_PERIOD steps.
+// A replay checks those hashes as it goes, the first one that differs in
+// a level is reported as a divergence.
+//
+// A recording covers one game, from its first level until it goes back to
+// the menu. The file is a header and then, for every level, a level header,
+// its events (steps since the previous one, type and key, 4 bytes each)
+// and its hashes. It is written when a level starts and when recording
+// stops.
+//
+// Everything is called from whichever thread updates the game.
+
+
+class Replay
+{
+
+private:
+	Replay();
+
+public:
+	enum Mode
+	{
+		OFF,
+		RECORDING,
+		REPLAYING
+	};
+
+	static Replay& instance()
+	{
+		static Replay R;
+
+		return R;
+	}
+
+	bool startRecording(const string& filename);
+	bool startReplay(const string& filename);
+	// Writes what was recorded, a replay is just dropped
+	void stop();
+
+	Mode getMode() const { return mode; }
+	bool isReplaying() const { return mode == REPLAYING; }
+	// The replay has played every level and step it has
+	bool isFinished() const;
+	int getFirstLevel() const;
+	int getNumDivergences() const { return numDivergences; }
+
+	// A level starts. Recording keeps the seed and god mode given,
+	// replaying sets them to the recorded ones.
+	void beginLevel(int level, unsigned int& seed, bool& bGodMode);
+
+	void recordInput(const InputEvent& event);
+	// Recorded events of the current step, one at a time
+	bool nextInput(InputEvent& event);
+
+	// The step is over, true if a state hash is due
+	bool endStep();
+	void addHash(unsigned int hash);
+
+private:
+	struct Event
+	{
+		int step;
+		InputEvent::Type type;
+		int key;
+	};
+
+	struct Level
+	{
+		int level;
+		unsigned int seed;
+		bool bGodMode;
+		int numSteps;
+		vector<Event> events;
+		vector<unsigned int> hashes;
+	};
+
+	struct Header
+	{
+		char magic[4];					// "C3DR"
+		int32_t version;
+		int32_t hashPeriod;
+		int32_t numLevels;
+	};
+
+	struct LevelHeader
+	{
+		int32_t level;
+		uint32_t seed;
+		int32_t bGodMode;
+		int32_t numSteps;
+		int32_t numEvents;				// Records, including the ones that only skip steps
+		int32_t numHashes;
+	};
+
+	struct EventRecord
+	{
+		uint16_t delta;					// Steps since the previous event
+		uint8_t type;					// InputEvent::Type, or REPLAY_SKIP
+		uint8_t key;
+	};
+
+	bool save() const;
+	bool load(const string& filename);
+
+private:
+	Mode mode;
+	string filename;
+	vector<Level> levels;
+	int current;						// Level being recorded or replayed, -1 before the first
+	int step;
+	unsigned int nextEvent;
+	int hashPeriod;
+	int numDivergences;
+	bool bDiverged;						// The current level diverged already
+
+};
+
+
+#endif // _REPLAY_INCLUDE
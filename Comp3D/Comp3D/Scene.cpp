@@ -2,10 +2,16 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp>
 #include "Scene.h"
 #include "Game.h"
+#include "JobSystem.h"
+#include "LevelArena.h"
+#include "FrameScratch.h"
+#include "Replay.h"
+#include "Profiler.h"
 
 
 #define PI 3.14159f
@@ -16,77 +22,77 @@ Scene::Scene()
 {
 	map = NULL;
 	player = NULL;
+	godMode_sprite = NULL;
+	fade_sprite = NULL;
 	crown = NULL;
-	channel = NULL;
-	fireworks_channel = NULL;
+	fireworks_particles = NULL;
+	music = NULL;
+	channel = 0;
+	fireworks = NULL;
+	fireworks_channel = 0;
 	
 }
 
 Scene::~Scene()
 {
-	if (crown != NULL)
-		delete map;
-	if (map != NULL)
-		delete map;
-	if (player != NULL)
-		delete player;
-	for (Wall* obj : walls)
+	// Everything else the level made belongs to the level arena, only the
+	// OpenGL buffers of the sprites and the sounds are given back here
+	if (godMode_sprite != NULL)
+		godMode_sprite->free();
+	if (fade_sprite != NULL)
+		fade_sprite->free();
+	if (channel != 0)
 	{
-		delete obj;
+		SoundManager::instance().stop(channel);
 	}
-	for (BallSpike* obj : ballSpikes)
+	if (fireworks_channel != 0)
 	{
-		delete obj;
-	}
-	for (Button* obj : buttons)
-	{
-		delete obj;
-	}
-	for (Switch* obj : switchs)
-	{
-		delete obj;
-	}
-	if (channel != NULL)
-	{
-		channel->stop();
-	}
-	if (fireworks_channel != NULL)
-	{
-		channel->stop();
+		SoundManager::instance().stop(fireworks_channel);
 	}
+	SoundManager::instance().releaseSound(music);
+	SoundManager::instance().releaseSound(fireworks);
 }
 
 
-void Scene::init(int numLevel)
+void Scene::init(int numLevel, unsigned int seed)
 {
+#ifndef COMP3D_HEADLESS
 	initShaders();
+#endif
 
 	// Initialize TileMap
 	string pathLevel = "levels/level0" + to_string(numLevel) + ".txt";
 	map = TileMap::createTileMap(pathLevel, glm::vec2(0, 0), texProgram);
+	map->setEventBus(&events);
 	roomSize = map->getRoomSize();
+#ifndef COMP3D_HEADLESS
 	glm::vec3 rgb = map->getColorBackground();
 	glClearColor(rgb.x, rgb.y, rgb.z, 1.0f);
+#endif
 	lastLevel = numLevel == NUM_LEVELS + 1;
 
-	//Init Music
+	//Init Music, streamed and started when it is ready so that loading never waits for it
+	musicVolume = 0.f;
+	fireworksVolume = 0.f;
 	if (lastLevel)
 	{
-		fireworks = SoundManager::instance().loadSound("sounds/fireworks.mp3", FMOD_LOOP_NORMAL);
-		fireworks_channel = SoundManager::instance().playSound(fireworks);
-		fireworks_channel->setVolume(0.f);
+		fireworks = SoundManager::instance().loadStream("sounds/fireworks.mp3", SoundManager::LOOP);
+		SoundManager::instance().whenReady(fireworks, [this](AudioSound* sound) {
+			fireworks_channel = SoundManager::instance().playSound(sound);
+			setFireworksVolume(fireworksVolume);
+		});
 
-		music = SoundManager::instance().loadSound("sounds/ending.mp3", FMOD_DEFAULT);
-		channel = SoundManager::instance().playSound(music);
-		channel->setVolume(0.f);
+		music = SoundManager::instance().loadStream("sounds/ending.mp3", SoundManager::ONCE);
 	}
 	else {
 		style = map->getStyle();
 		string theme = themes[style];
-		music = SoundManager::instance().loadSound(theme, FMOD_LOOP_NORMAL);
-		channel = SoundManager::instance().playSound(music);
-		channel->setVolume(0.f);
+		music = SoundManager::instance().loadStream(theme, SoundManager::LOOP);
 	}
+	SoundManager::instance().whenReady(music, [this](AudioSound* sound) {
+		channel = SoundManager::instance().playSound(sound);
+		setMusicVolume(musicVolume);
+	});
 	
 
 	if (lastLevel)
@@ -97,68 +103,36 @@ void Scene::init(int numLevel)
 
 	// Init Camera.
 	camera.position = map->getCenterCamera();
+	camera.prevPosition = camera.position;
 	camera.movement = map->getMovementCamera();
 
 	// Init Player
-	player = new Player();
+	player = LevelArena::instance().create<Player>();
 	player->init(texProgram, map);
+	player->setEventBus(&events);
+	player->seed(seed);
 	player->setPosition(map->getCheckPointPlayer());
 
 	// Init CheckPoint (player/camera)
 	checkpoint.posCamera = map->getCenterCamera();
 	checkpoint.posPlayer = map->getCheckPointPlayer();
 
-	// Init Walls
-	vector<TileMap::Wall> pos_walls = map->getWalls();
-	for (int i = 0; i < pos_walls.size(); ++i)
-	{ 
-		Wall* wall = new Wall();
-		wall->init(texProgram, pos_walls[i].bVertical, static_cast<Wall::Type>(pos_walls[i].type), map);
-		wall->setPosition(glm::vec3(pos_walls[i].position,0));
-		walls.push_back(wall);
-	}
+	// Init Walls, BallSpikes, Buttons and Switchs
+	entities.load(*map, texProgram);
 
-	// Init BallSpikes
-	vector<pair<bool, glm::vec2>> pos_ballSpikes = map->getBallSpikes();
-	for (int i = 0; i < pos_ballSpikes.size(); ++i)
-	{
-		BallSpike* ballSpike = new BallSpike();
-		ballSpike->init(texProgram, pos_ballSpikes[i].first, map);
-		ballSpike->setPosition(glm::vec3(pos_ballSpikes[i].second, 0));
-		ballSpikes.push_back(ballSpike);
-	}
-
-	// Init Buttons
-	vector<tuple<bool, glm::vec2, int>> pos_buttons = map->getButtons();
-	for (int i = 0; i < pos_buttons.size(); ++i)
-	{
-		Button* button = new Button();
-		button->init(texProgram, get<0>(pos_buttons[i]));
-		button->setPosition(glm::vec3(get<1>(pos_buttons[i]), 0));
-		button->setOrientation(get<2>(pos_buttons[i]));
-		button->setTileMap(map);
-		buttons.push_back(button);
-	}
-
-	// Init Switchs
-	vector<pair<bool, glm::vec2>> pos_switchs = map->getSwitchs();
-	for (int i = 0; i < pos_switchs.size(); ++i)
-	{
-		Switch* switx = new Switch();
-		switx->init(texProgram, pos_switchs[i].first, map);
-		switx->setPosition(glm::vec3(pos_switchs[i].second, 0));
-		switchs.push_back(switx);
-	}
+	initSpatialHash();
 
+#ifndef COMP3D_HEADLESS
 	// Init God Mode Sprite
 	godMode_spritesheet.loadFromFile("images/godmode.png", TEXTURE_PIXEL_FORMAT_RGBA);
-	godMode_sprite = Sprite::createSprite(glm::ivec2(128, 16), glm::vec2(1.f, 1.f), &godMode_spritesheet, &texProgram);
+	godMode_sprite = LevelArena::instance().create<Sprite>(glm::ivec2(128, 16), glm::vec2(1.f, 1.f), &godMode_spritesheet, &texProgram);
 	godMode_sprite->setPosition(glm::vec2(50, 690));
 
 	// Init Fade
 	fade_spritesheet.loadFromFile("images/fade.png", TEXTURE_PIXEL_FORMAT_RGBA);
-	fade_sprite = Sprite::createSprite(glm::ivec2(12800, 12800), glm::vec2(1.f, 1.f), &fade_spritesheet, &texProgram);
+	fade_sprite = LevelArena::instance().create<Sprite>(glm::ivec2(12800, 12800), glm::vec2(1.f, 1.f), &fade_spritesheet, &texProgram);
 	fade_sprite->setPosition(glm::vec2(0, 0));
+#endif
 	totalFadeTime = 750;
 	fadeTime = 0;
 	fadeIn = true;
@@ -173,11 +147,23 @@ void Scene::init(int numLevel)
 	if (lastLevel)
 	{
 		// Init Crown
-		crown = new AssimpModel();
+		crown = LevelArena::instance().create<AssimpModel>();
 		crown->loadFromFile("models/crown.obj", texProgram);
+
+#ifndef COMP3D_HEADLESS
+		// Fireworks, only where the GPU can simulate them
+		fireworks_particles = LevelArena::instance().create<GpuParticleSystem>();
+		if (!fireworks_particles->init(glm::vec2(0.3f, 0.3f), "images/original_particle.png", 6.f, 1.f, FIREWORKS_CAPACITY))
+			fireworks_particles = NULL;
+		else
+			fireworks_particles->seed(seed);
+#endif
+		nextFirework = 0;
 	}
 	
 	bDead = false;
+	bPlayerDead = false;
+	bNewCheckPoint = false;
 
 	rotation = 0.f;
 	victoryTime = 0.f;
@@ -187,7 +173,10 @@ void Scene::init(int numLevel)
 
 void Scene::update(int deltaTime)
 {
+	PROFILE_ZONE("Scene::update");
+
 	currentTime += deltaTime;
+	camera.prevPosition = camera.position;
 
 	if (bDead)
 	{
@@ -199,6 +188,7 @@ void Scene::update(int deltaTime)
 
 			player->setPosition(checkpoint.posPlayer);
 			camera.position = checkpoint.posCamera;
+			camera.prevPosition = camera.position;
 			eCamMove = CamMove::STATIC;
 		}
 
@@ -212,28 +202,31 @@ void Scene::update(int deltaTime)
 
 	if (fadeIn) {
 		fadeTime += deltaTime;
-		channel->setVolume((fadeTime / totalFadeTime)*maxMusicVolume);
-		if (lastLevel) fireworks_channel->setVolume(fadeTime / totalFadeTime);
+		setMusicVolume((fadeTime / totalFadeTime)*maxMusicVolume);
+		if (lastLevel) setFireworksVolume(fadeTime / totalFadeTime);
 
 		if (fadeTime >= totalFadeTime) {
 			fadeIn = false;
 			fadeTime = 0;
-			channel->setVolume(maxMusicVolume);
-			if (lastLevel) fireworks_channel->setVolume(1.0f);
+			setMusicVolume(maxMusicVolume);
+			if (lastLevel) setFireworksVolume(1.0f);
 		}
 	}
 	else if (fadeOut) {
+		if (!lastLevel) player->setVelocity(glm::vec3(0.f, 0.f, 0.f));
+
 		fadeTime += deltaTime;
-		channel->setVolume(maxMusicVolume*(1.0f - fadeTime / totalFadeTime));
+		setMusicVolume(maxMusicVolume*(1.0f - fadeTime / totalFadeTime));
 		player->setLineVolume(maxMusicVolume * (1.0f - fadeTime / totalFadeTime));
-		if (lastLevel) fireworks_channel->setVolume(1.0f - fadeTime / totalFadeTime);
+		if (lastLevel) setFireworksVolume(1.0f - fadeTime / totalFadeTime);
 
 		if (fadeTime >= totalFadeTime) {
-			channel->stop();
+			if (channel != 0)
+				SoundManager::instance().stop(channel);
 			player->setLineVolume(0.f);
 
-			if (lastLevel)
-				fireworks_channel->stop();
+			if (lastLevel && fireworks_channel != 0)
+				SoundManager::instance().stop(fireworks_channel);
 
 			if (escape)
 				Game::instance().goBackToMenu();
@@ -244,19 +237,19 @@ void Scene::update(int deltaTime)
 	
 	if (!fadeIn && !fadeOut || lastLevel)
 	{
-		if (map->getNewCheckPoint() && eCamMove == CamMove::STATIC)
+		if (bNewCheckPoint && eCamMove == CamMove::STATIC)
 		{
 			checkpoint.posPlayer = map->getCheckPointPlayer();
 			checkpoint.posCamera = camera.position;
-			map->setNewCheckPoint(false);
+			bNewCheckPoint = false;
 		}
 
-		if (map->getPlayerDead())
+		if (bPlayerDead)
 		{
 			bDead = true;
 			timeDead = 1000;
 			player->setDead(true);
-			map->setPlayerDead(false);
+			bPlayerDead = false;
 		}
 
 		glm::vec3 posPlayer = player->getPosition();
@@ -330,21 +323,57 @@ void Scene::update(int deltaTime)
 			break;
 		}
 
-		player->update(deltaTime, &walls, &ballSpikes, &buttons, &switchs);
-
-		for (int i = 0; i < walls.size(); ++i)
+		player->update(deltaTime, &entities, &spatialHash);
+
+		// Walls and ball spikes that go out of the camera stop being updated.
+		// They do not depend on each other, so they are updated in parallel
+		// and the spatial hash is updated afterwards.
+		posPlayer = player->getPosition();
+
+		EntitySystems::Context context;
+		context.deltaTime = deltaTime;
+		context.posPlayer = glm::vec2(posPlayer);
+		context.sizePlayer = glm::vec2(sizePlayer);
+		context.movementCamera = map->getMovementCamera();
+		context.map = map;
+		context.spatialHash = &spatialHash;
+
+		updateActive(SpatialHash::WALL, activeWalls);
+		JobSystem::instance().parallelFor(activeWalls.size(), SCENE_JOB_GRAIN, [&](int begin, int end) {
+			EntitySystems::updateWalls(entities, context, &activeWalls[begin], end - begin);
+		});
+		const EntityStore::Walls& walls = entities.walls;
+		int numActive = 0;
+		for (int k = 0; k < activeWalls.size(); ++k)
 		{
-			walls[i]->update(deltaTime, player->getPosition(), player->getSize(), &switchs);
+			int i = activeWalls[k];
+			spatialHash.update(wallProxies[i], walls.position[i], walls.position[i] + walls.size[i]);
+			if (walls.state[i] != EntityStore::OUT)
+				activeWalls[numActive++] = i;
 		}
+		activeWalls.resize(numActive);
 
 		//update BallSpikes
-		for (int i = 0; i < ballSpikes.size(); ++i)
+		updateActive(SpatialHash::BALL_SPIKE, activeBallSpikes);
+		JobSystem::instance().parallelFor(activeBallSpikes.size(), SCENE_JOB_GRAIN, [&](int begin, int end) {
+			EntitySystems::updateBallSpikes(entities, context, &activeBallSpikes[begin], end - begin);
+		});
+		const EntityStore::BallSpikes& ballSpikes = entities.ballSpikes;
+		numActive = 0;
+		for (int k = 0; k < activeBallSpikes.size(); ++k)
 		{
-			ballSpikes[i]->update(deltaTime, player->getPosition());
+			int i = activeBallSpikes[k];
+			glm::vec2 corner = ballSpikes.position[i] - 0.5f;
+			spatialHash.update(ballSpikeProxies[i], corner, corner + ballSpikes.size[i]);
+			if (ballSpikes.state[i] != EntityStore::OUT)
+				activeBallSpikes[numActive++] = i;
 		}
+		activeBallSpikes.resize(numActive);
 
 	}
+	map->setFocus(glm::ivec2(camera.position.x, -camera.position.y));
 	map->update(deltaTime);
+	dispatchEvents();
 
 	if (lastLevel) {
 		rotation += deltaTime / 2.0f;
@@ -354,79 +383,86 @@ void Scene::update(int deltaTime)
 		victoryTime += deltaTime;
 		if (victoryTime > 21250)
 			fadeOut = true;
+
+		if (fireworks_particles != NULL)
+		{
+			nextFirework -= deltaTime;
+			if (nextFirework <= 0)
+			{
+				launchFirework();
+				nextFirework += FIREWORKS_PERIOD;
+			}
+			fireworks_particles->update(deltaTime / 1000.f);
+		}
 	}
+
+	// Recorded and replayed games compare their state every few steps
+	if (Replay::instance().endStep())
+		Replay::instance().addHash(getStateHash());
+}
+
+// Everything that decides how the level goes on: the player, the camera,
+// the last checkpoint and the entities. Particles and sounds are left out.
+
+unsigned int Scene::getStateHash() const
+{
+	StateHash hash;
+
+	hash.add(player->getPosition());
+	hash.add(player->getVelocity());
+	hash.add(bDead);
+	hash.add(camera.position);
+	hash.add(int(eCamMove));
+	hash.add(checkpoint.posPlayer);
+	hash.add(entities.walls.position);
+	hash.add(entities.walls.state);
+	hash.add(entities.ballSpikes.position);
+	hash.add(entities.ballSpikes.state);
+	hash.add(entities.buttons.bPressed);
+	hash.add(entities.switchs.bActivated);
+
+	return hash.get();
 }
 
 void Scene::render()
 {
-	glm::mat4 modelMatrix, viewMatrix;
-	glm::mat3 normalMatrix;
+	PROFILE_ZONE("Scene::render");
 
+	frameSnapshot.clear();
+	buildSnapshot(frameSnapshot);
+	frameSnapshot.render();
+}
+
+void Scene::buildSnapshot(RenderSnapshot& snapshot)
+{
+	PROFILE_ZONE("Scene::buildSnapshot");
+	glm::mat4 modelMatrix, viewMatrix;
 
-	texProgram.use();
-	texProgram.setUniform1b("bLighting", true);	//si es fals, no se ven sombras
-	texProgram.setUniformMatrix4f("projection", projection);
-	texProgram.setUniform4f("color", 1.0f, 1.0f, 1.0f, 1.0f);
 
+	snapshot.setProgram(&texProgram);
 
-	// Camera position
+	// Camera position, between the last two simulation steps
+	glm::vec3 eye = glm::mix(camera.prevPosition, camera.position, Game::instance().getInterpolation());
 	viewMatrix = glm::mat4(1.0f);
-	viewMatrix = glm::translate(viewMatrix, -camera.position);
+	viewMatrix = glm::translate(viewMatrix, -eye);
 	/*if (lastLevel) viewMatrix = glm::rotate(viewMatrix, glm::radians(15.f), glm::vec3(0, 1, 0));*/
-	texProgram.setUniformMatrix4f("view", viewMatrix);
-
-	// Init matrix
-	modelMatrix = glm::mat4(1.0f);
-	normalMatrix = glm::transpose(glm::inverse(glm::mat3(viewMatrix * modelMatrix)));
-	texProgram.setUniformMatrix3f("normalmatrix", normalMatrix);
-
+	snapshot.setCamera(projection, viewMatrix, eye);
 
 
 	// Render TileMap
-	map->render(texProgram, player->getPosition());
-
-	// Render Player
-	if (PlayGameState::instance().getGodMode()) {
-		glDepthMask(GL_FALSE);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		texProgram.setUniform1f("alpha", 0.3);
-	}
-	player->render(texProgram, camera.position, rotation);
-	if (PlayGameState::instance().getGodMode()) {
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-		glDisable(GL_BLEND);
-		glDepthMask(GL_TRUE);
-	}
+	snapshot.setPass(RenderStats::TILEMAP);
+	map->addToSnapshot(snapshot, player->getPosition());
 
-	// Render Walls
-	for (int i = 0; i < walls.size(); ++i)
-	{
-		walls[i]->render(texProgram, player->getPosition());
-	}
-
-	// Render BlockSpikes
-	for (int i = 0; i < ballSpikes.size(); ++i)
-	{
-		ballSpikes[i]->render(texProgram, player->getPosition(), viewMatrix);
-
-		//se podria poner al final...
-		normalMatrix = glm::transpose(glm::inverse(glm::mat3(viewMatrix * modelMatrix)));
-		texProgram.setUniformMatrix3f("normalmatrix", normalMatrix);
-		//se podria poner al final...
-	}
-
-	// Render Buttons
-	for (int i = 0; i < buttons.size(); ++i)
-	{
-		buttons[i]->render(texProgram);
-	}
+	// Render Player, see-through in god mode
+	snapshot.setPass(RenderStats::ENTITIES);
+	player->addToSnapshot(snapshot, rotation, PlayGameState::instance().getGodMode() ? 0.3f : 1.f);
 
-	// Render Switchs
-	for (int i = 0; i < switchs.size(); ++i)
-	{
-		switchs[i]->render(texProgram);
-	}
+	// Render Walls, BlockSpikes, Buttons and Switchs
+	float interpolation = Game::instance().getInterpolation();
+	EntitySystems::addWallsToSnapshot(entities, snapshot, activeWalls.data(), activeWalls.size(), interpolation);
+	EntitySystems::addBallSpikesToSnapshot(entities, snapshot, activeBallSpikes.data(), activeBallSpikes.size(), interpolation);
+	EntitySystems::addButtonsToSnapshot(entities, snapshot);
+	EntitySystems::addSwitchsToSnapshot(entities, snapshot);
 
 	// Render crown
 	if (lastLevel) {
@@ -435,59 +471,35 @@ void Scene::render()
 		modelMatrix = glm::translate(modelMatrix, crown->getCenter());
 		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation), glm::vec3(0, -1, 0));
 		modelMatrix = glm::translate(modelMatrix, -crown->getCenter());
-		texProgram.setUniformMatrix4f("model", modelMatrix);
-		crown->render(texProgram);
+		snapshot.addModel(crown, modelMatrix);
+
+		if (fireworks_particles != NULL)
+			snapshot.addParticles(fireworks_particles);
 	}
 
 
 	// LO ULTIMO (2D)
 
 	if (PlayGameState::instance().getGodMode()) {
-		texProgram.setUniformMatrix4f("projection", glm::ortho(0.f, float(SCREEN_WIDTH - 1), float(SCREEN_HEIGHT - 1), 0.f));
-		texProgram.setUniformMatrix4f("view", glm::mat4(1.0f));
-		texProgram.setUniform2f("texCoordDispl", 0.f, 0.f);
-		texProgram.setUniform1b("bLighting", false);
-		godMode_sprite->render();
+		snapshot.addSprite(godMode_sprite);
 	}
 
+	// Next to the god mode sprite, it grows up
+	if (PlayGameState::instance().getRenderStats())
+		snapshot.showRenderStats(glm::vec2(194, 706));
+	if (PlayGameState::instance().getMemoryHud())
+		snapshot.showMemory(glm::vec2(SCREEN_WIDTH - 410, 20));
+
 	if (fadeIn)
 	{
-		glDepthMask(GL_FALSE);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		texProgram.setUniformMatrix4f("projection", glm::ortho(0.f, float(SCREEN_WIDTH - 1), float(SCREEN_HEIGHT - 1), 0.f));
-		texProgram.setUniformMatrix4f("view", glm::mat4(1.0f));
-		texProgram.setUniform2f("texCoordDispl", 0.f, 0.f);
-		texProgram.setUniform1b("bLighting", false);
 		float alpha = min(1.0f, fadeTime / totalFadeTime);
-		texProgram.setUniform1f("alpha", 1 - alpha);
-		fade_sprite->render();
-
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-		glDisable(GL_BLEND);
-		glDepthMask(GL_TRUE);
+		snapshot.addSprite(fade_sprite, 1 - alpha);
 	}
 
 	else if (fadeOut)
 	{
-		if (!lastLevel) player->setVelocity(glm::vec3(0.f, 0.f, 0.f));
-
-		glDepthMask(GL_FALSE);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		texProgram.setUniformMatrix4f("projection", glm::ortho(0.f, float(SCREEN_WIDTH - 1), float(SCREEN_HEIGHT - 1), 0.f));
-		texProgram.setUniformMatrix4f("view", glm::mat4(1.0f));
-		texProgram.setUniform2f("texCoordDispl", 0.f, 0.f);
-		texProgram.setUniform1b("bLighting", false);
 		float alpha = min(1.0f, fadeTime / totalFadeTime);
-		texProgram.setUniform1f("alpha", alpha);
-		fade_sprite->render();
-
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-		glDisable(GL_BLEND);
-		glDepthMask(GL_TRUE);
+		snapshot.addSprite(fade_sprite, alpha);
 	}
 }
 
@@ -517,6 +529,142 @@ void Scene::setEscape(bool b) {
 	escape = b;
 }
 
+// The fade out is over, the game state goes on to the next level or the menu
+
+bool Scene::isFinished() const
+{
+	return fadeOut && fadeTime >= totalFadeTime;
+}
+
+
+void Scene::setMusicVolume(float volume)
+{
+	musicVolume = volume;
+	if (channel != 0)
+		SoundManager::instance().setVolume(channel, volume);
+}
+
+void Scene::setFireworksVolume(float volume)
+{
+	fireworksVolume = volume;
+	if (fireworks_channel != 0)
+		SoundManager::instance().setVolume(fireworks_channel, volume);
+}
+
+
+// A burst somewhere above the player, every particle flies out in a random direction
+
+void Scene::launchFirework()
+{
+	ParticleSystem::Particle particle;
+	glm::vec3 playerPos = player->getPosition();
+	glm::vec3 center;
+
+	center.x = playerPos.x + 16.f * (fireworks_particles->random() - 0.5f);
+	center.y = -playerPos.y + 4.f + 5.f * fireworks_particles->random();
+	center.z = -2.f * fireworks_particles->random();
+
+	for (int i = 0; i < FIREWORKS_BURST; i++)
+	{
+		float angle = 2.f * PI * fireworks_particles->random();
+		float z = 2.f * fireworks_particles->random() - 1.f;
+		float r = sqrt(1.f - z * z);
+
+		particle.lifetime = 1.f + fireworks_particles->random();
+		particle.position = center;
+		particle.speed = (3.f + 3.f * fireworks_particles->random()) * glm::vec3(r * cos(angle), r * sin(angle), z);
+		fireworks_particles->addParticle(particle);
+	}
+}
+
+
+void Scene::initSpatialHash()
+{
+	spatialHash.clear();
+	wallProxies.clear();
+	ballSpikeProxies.clear();
+	activeWalls.clear();
+	activeBallSpikes.clear();
+
+	const EntityStore::Walls& walls = entities.walls;
+	for (int i = 0; i < walls.count(); ++i)
+	{
+		wallProxies.push_back(spatialHash.insert(SpatialHash::WALL, i, walls.position[i], walls.position[i] + walls.size[i]));
+		activeWalls.push_back(i);
+	}
+	const EntityStore::BallSpikes& ballSpikes = entities.ballSpikes;
+	for (int i = 0; i < ballSpikes.count(); ++i)
+	{
+		glm::vec2 corner = ballSpikes.position[i] - 0.5f;
+		ballSpikeProxies.push_back(spatialHash.insert(SpatialHash::BALL_SPIKE, i, corner, corner + ballSpikes.size[i]));
+		activeBallSpikes.push_back(i);
+	}
+
+	// Buttons can be rotated and pushed half a tile, their box covers every case
+	const EntityStore::Buttons& buttons = entities.buttons;
+	for (int i = 0; i < buttons.count(); ++i)
+	{
+		glm::vec2 size = buttons.size[i];
+		spatialHash.insert(SpatialHash::BUTTON, i, buttons.position[i], buttons.position[i] + glm::max(size.x, size.y) + 0.5f);
+	}
+	const EntityStore::Switchs& switchs = entities.switchs;
+	for (int i = 0; i < switchs.count(); ++i)
+	{
+		spatialHash.insert(SpatialHash::SWITCH, i, switchs.position[i], switchs.position[i] + switchs.size[i]);
+	}
+}
+
+void Scene::updateActive(SpatialHash::Type type, vector<int>& active)
+{
+	glm::vec2 center = glm::vec2(player->getPosition() + player->getSize() / 2.f);
+	glm::vec2 range = map->getMovementCamera() + float(SCENE_ACTIVE_MARGIN);
+
+	// Entities active in the last frame are kept so that they notice they left
+	spatialHash.query(type, center - range, center + range, nearby);
+	int* merged = FrameScratch::instance().allocate<int>(int(active.size() + nearby.size()));
+	int* mergedEnd = set_union(active.begin(), active.end(), nearby.begin(), nearby.end(), merged);
+	active.assign(merged, mergedEnd);
+}
+
+// Every sound is played once per step, however many times it was hit
+
+void Scene::dispatchEvents()
+{
+	const vector<GameEvent>& batch = events.getEvents();
+
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		const GameEvent& event = batch[i];
+
+		switch (event.type)
+		{
+		case GameEvent::SOUND:
+		{
+			bool bRepeated = false;
+			for (unsigned int j = 0; j < i && !bRepeated; j++)
+				bRepeated = batch[j].type == GameEvent::SOUND && batch[j].sound == event.sound;
+			if (bRepeated)
+				break;
+			AudioVoice voice = SoundManager::instance().playSound(event.sound);
+			if (voice != 0 && event.volume != 1.f)
+				SoundManager::instance().setVolume(voice, event.volume);
+			break;
+		}
+		case GameEvent::DEATH:
+			bPlayerDead = true;
+			break;
+		case GameEvent::CHECKPOINT:
+			bNewCheckPoint = true;
+			break;
+		case GameEvent::LEVEL_END:
+			setFade(true);
+			break;
+		default:
+			break;
+		}
+	}
+	events.clear();
+}
 
 void Scene::initShaders()
 {
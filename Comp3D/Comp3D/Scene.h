@@ -6,20 +6,29 @@
 #include "ShaderProgram.h"
 #include "TileMap.h"
 #include "Player.h"
-#include "Wall.h"
-#include "BallSpike.h"
-#include "Button.h"
-#include "Switch.h"
+#include "EntityStore.h"
+#include "EntitySystems.h"
 #include "Sprite.h"
+#include "SpatialHash.h"
+#include "EventBus.h"
+#include "RenderSnapshot.h"
+#include "GpuParticleSystem.h"
 
 
 
 #define CAMERA_WIDTH 640
 #define CAMERA_HEIGHT 480
+#define SCENE_ACTIVE_MARGIN 4		// Tiles beyond the camera movement where entities still update
+#define SCENE_JOB_GRAIN 32			// Walls or ball spikes updated by a single job
+#define FIREWORKS_CAPACITY (1 << 16)	// Particles, simulated on the GPU
+#define FIREWORKS_BURST 6000			// Particles of a single firework
+#define FIREWORKS_PERIOD 700			// ms between fireworks on the last level
 
 
 // Scene contains all the entities of our game.
 // It is responsible for updating and render them.
+// The headless build (COMP3D_HEADLESS) only simulates it, init creates
+// no shaders, sprites or GPU particles.
 
 
 class Scene
@@ -29,21 +38,38 @@ public:
 	Scene();
 	~Scene();
 
-	void init(int numLevel);
+	// seed is the spawn randomness of the particles
+	void init(int numLevel, unsigned int seed);
 	void update(int deltaTime);
 	void render();
+	// Everything render draws, without OpenGL calls
+	void buildSnapshot(RenderSnapshot& snapshot);
 
 	void keyPressed(int key);
 	void reshape(int width, int height);
 
 	void setFade(bool b);
 	void setEscape(bool b);
+	bool isFinished() const;
+	// Compared by Replay to find where two runs of a level diverge
+	unsigned int getStateHash() const;
 
 private:
 	void initShaders();
 
+	// The music may not be playing yet, the volume is kept for when it starts
+	void setMusicVolume(float volume);
+	void setFireworksVolume(float volume);
+	void launchFirework();
+
+	void initSpatialHash();
+	void updateActive(SpatialHash::Type type, vector<int>& active);
+
+	void dispatchEvents();
+
 private:
 	ShaderProgram texProgram;
+	RenderSnapshot frameSnapshot;		// Used when the scene renders itself
 	float currentTime;
 	glm::mat4 projection;
 
@@ -53,6 +79,7 @@ private:
 	struct Camera
 	{
 		glm::vec3 position = glm::vec3(0); // 16 (half-map) * 1.6 (size-block)
+		glm::vec3 prevPosition = glm::vec3(0); // Position in the previous simulation step
 		float velocity = 0.1;
 		glm::vec2 movement;
 	} camera;
@@ -70,10 +97,20 @@ private:
 	float timeCamMove = 0.f;
 
 	Player* player;
-	vector<Wall*> walls;
-	vector<BallSpike*> ballSpikes;
-	vector<Button*> buttons;
-	vector<Switch*> switchs;
+	EntityStore entities;				// Walls, ball spikes, buttons and switchs
+
+	// Broadphase for every entity, walls and ball spikes update their proxy
+	// as they move. Only the entities in the active lists are updated.
+	SpatialHash spatialHash;
+	vector<int> wallProxies, ballSpikeProxies;
+	vector<int> activeWalls, activeBallSpikes;
+	vector<int> nearby;
+
+	// What the tile map and the player hit during the step, dispatched
+	// when the step ends. Deaths and checkpoints wait for the next step.
+	EventBus events;
+	bool bPlayerDead = false;
+	bool bNewCheckPoint = false;
 
 	struct CheckPoint
 	{
@@ -92,11 +129,13 @@ private:
 
 	int style;
 
-	FMOD::Sound* music;
-	FMOD::Channel* channel;
+	AudioSound* music;
+	AudioVoice channel;
+
+	AudioSound* fireworks;
+	AudioVoice fireworks_channel;
 
-	FMOD::Sound* fireworks;
-	FMOD::Channel* fireworks_channel;
+	float musicVolume, fireworksVolume;
 
 	vector<string> themes{
 		"sounds/sky.mp3",			// original
@@ -116,6 +155,8 @@ private:
 
 	bool lastLevel;
 	AssimpModel* crown;
+	GpuParticleSystem* fireworks_particles;		// NULL if the GPU cannot run them
+	int nextFirework;
 
 	bool bDead = false;
 	int timeDead = 0;
@@ -23,6 +23,9 @@ void Shader::initFromSource(const ShaderType type, const string &source)
 	case VERTEX_SHADER:
 		shaderId = glCreateShader(GL_VERTEX_SHADER);
 		break;
+	case GEOMETRY_SHADER:
+		shaderId = glCreateShader(GL_GEOMETRY_SHADER);
+		break;
 	case FRAGMENT_SHADER:
 		shaderId = glCreateShader(GL_FRAGMENT_SHADER);
 		break;
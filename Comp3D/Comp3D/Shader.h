@@ -10,10 +10,10 @@
 using namespace std;
 
 
-enum ShaderType { VERTEX_SHADER, FRAGMENT_SHADER };
+enum ShaderType { VERTEX_SHADER, GEOMETRY_SHADER, FRAGMENT_SHADER };
 
 
-// This class is able to load to OpenGL a vertex or fragment shader and compile it.
+// This class is able to load to OpenGL a vertex, geometry or fragment shader and compile it.
 // It can do so from a file or from a string so that shader code can be
 // procedurally modified if needed.
 
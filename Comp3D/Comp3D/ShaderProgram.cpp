@@ -1,5 +1,6 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "ShaderProgram.h"
+#include "RenderStats.h"
 
 
 ShaderProgram::ShaderProgram()
@@ -34,6 +35,15 @@ GLint ShaderProgram::bindVertexAttribute(const string &attribName, GLint size, G
 	return attribPos;
 }
 
+void ShaderProgram::setTransformFeedbackVaryings(const vector<string> &varyings)
+{
+	vector<const GLchar *> names;
+
+	for (const string &varying : varyings)
+		names.push_back(varying.c_str());
+	glTransformFeedbackVaryings(programId, GLsizei(names.size()), &names[0], GL_INTERLEAVED_ATTRIBS);
+}
+
 void ShaderProgram::link()
 {
 	GLint status;
@@ -53,7 +63,7 @@ void ShaderProgram::free()
 
 void ShaderProgram::use()
 {
-	glUseProgram(programId);
+	RenderStats::instance().useProgram(programId);
 }
 
 bool ShaderProgram::isLinked()
@@ -66,59 +76,80 @@ const string &ShaderProgram::log() const
 	return errorLog;
 }
 
-void ShaderProgram::setUniform1b(const string &uniformName, bool bValue)
+void ShaderProgram::setUniform1b(const char *uniformName, bool bValue)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if (location != -1)
+	{
 		glUniform1i(location, bValue);
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniform1f(const string& uniformName, float v0)
+void ShaderProgram::setUniform1f(const char *uniformName, float v0)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if (location != -1)
+	{
 		glUniform1f(location, v0);
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniform2f(const string &uniformName, float v0, float v1)
+void ShaderProgram::setUniform2f(const char *uniformName, float v0, float v1)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if(location != -1)
+	{
 		glUniform2f(location, v0, v1);
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniform3f(const string &uniformName, float v0, float v1, float v2)
+void ShaderProgram::setUniform3f(const char *uniformName, float v0, float v1, float v2)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if(location != -1)
+	{
 		glUniform3f(location, v0, v1, v2);
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniform4f(const string &uniformName, float v0, float v1, float v2, float v3)
+void ShaderProgram::setUniform4f(const char *uniformName, float v0, float v1, float v2, float v3)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if(location != -1)
+	{
 		glUniform4f(location, v0, v1, v2, v3);
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniformMatrix3f(const string &uniformName, glm::mat3 &mat)
+void ShaderProgram::setUniformMatrix3f(const char *uniformName, glm::mat3 &mat)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if (location != -1)
+	{
 		glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
-void ShaderProgram::setUniformMatrix4f(const string &uniformName, glm::mat4 &mat)
+void ShaderProgram::setUniformMatrix4f(const char *uniformName, glm::mat4 &mat)
 {
-	GLint location = glGetUniformLocation(programId, uniformName.c_str());
+	GLint location = glGetUniformLocation(programId, uniformName);
 
 	if(location != -1)
+	{
 		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+		RenderStats::instance().uniformUploaded();
+	}
 }
 
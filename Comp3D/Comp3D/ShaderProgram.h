@@ -4,13 +4,16 @@
 
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <vector>
 #include <glm/glm.hpp>
 #include "Shader.h"
 
 
 // Using the Shader class ShaderProgram can link a vertex and a fragment shader
 // together, bind input attributes to their corresponding vertex shader names, 
-// and bind the fragment output to a name from the fragment shader
+// and bind the fragment output to a name from the fragment shader.
+// Programs that write to transform feedback buffers name their outputs
+// before linking.
 
 
 class ShaderProgram
@@ -23,19 +26,21 @@ public:
 	void addShader(const Shader &shader);
 	void bindFragmentOutput(const string &outputName);
 	GLint bindVertexAttribute(const string &attribName, GLint size, GLsizei stride, GLvoid *firstPointer);
+	// Interleaved in a single buffer, in this order
+	void setTransformFeedbackVaryings(const vector<string> &varyings);
 	void link();
 	void free();
 
 	void use();
 
 	// Pass uniforms to the associated shaders
-	void setUniform1b(const string& uniformName, bool bValue);
-	void setUniform1f(const string &uniformName, float v0);
-	void setUniform2f(const string &uniformName, float v0, float v1);
-	void setUniform3f(const string &uniformName, float v0, float v1, float v2);
-	void setUniform4f(const string &uniformName, float v0, float v1, float v2, float v3);
-	void setUniformMatrix3f(const string &uniformName, glm::mat3 &mat);
-	void setUniformMatrix4f(const string &uniformName, glm::mat4 &mat);
+	void setUniform1b(const char *uniformName, bool bValue);
+	void setUniform1f(const char *uniformName, float v0);
+	void setUniform2f(const char *uniformName, float v0, float v1);
+	void setUniform3f(const char *uniformName, float v0, float v1, float v2);
+	void setUniform4f(const char *uniformName, float v0, float v1, float v2, float v3);
+	void setUniformMatrix3f(const char *uniformName, glm::mat3 &mat);
+	void setUniformMatrix4f(const char *uniformName, glm::mat4 &mat);
 
 	bool isLinked();
 	const string &log() const;
@@ -0,0 +1,155 @@
+#include <cmath>
+#include "SimulationThread.h"
+#include "FrameScheduler.h"
+#include "JobSystem.h"
+#include "Game.h"
+#include "InputLatency.h"
+#include "FrameScratch.h"
+#include "Profiler.h"
+
+
+SimulationThread::SimulationThread()
+{
+	bQuit = false;
+	bPlaying = true;
+	stepTime = 0;
+	maxSteps = 0;
+	writeSlot = 0;
+	exchange = 1;
+	readSlot = 2;
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+
+void SimulationThread::start(int stepTime, int maxSteps)
+{
+	stop();
+
+	this->stepTime = stepTime;
+	this->maxSteps = maxSteps;
+	bQuit = false;
+	bPlaying = true;
+	simulation = thread(&SimulationThread::threadLoop, this);
+}
+
+void SimulationThread::stop()
+{
+	bQuit = true;
+	if (simulation.joinable())
+		simulation.join();
+}
+
+
+bool SimulationThread::isRunning() const
+{
+	return simulation.joinable();
+}
+
+bool SimulationThread::isPlaying() const
+{
+	return bPlaying;
+}
+
+
+const RenderSnapshot *SimulationThread::acquireSnapshot()
+{
+	// Take the exchanged slot only if there is something new in it
+	if (exchange & SNAPSHOT_FRESH)
+		readSlot = exchange.exchange(readSlot) & ~SNAPSHOT_FRESH;
+	else
+		snapshots[readSlot].setInputTime(0);	// Drawn again, its input was already shown
+
+	if (snapshots[readSlot].empty())
+		return NULL;
+	return &snapshots[readSlot];
+}
+
+void SimulationThread::runOnRenderThread(const function<void()> &work)
+{
+	if (JobSystem::instance().isMainThread())
+	{
+		work();
+		return;
+	}
+
+	// The main thread runs it between two frames, nothing is being drawn
+	atomic<bool> bDone(false);
+	JobSystem::instance().runOnMainThread([this, &work, &bDone]() {
+		invalidate();
+		work();
+		bDone = true;
+	});
+	while (!bDone && !bQuit)
+		this_thread::sleep_for(chrono::milliseconds(1));
+}
+
+
+void SimulationThread::threadLoop()
+{
+	FrameScheduler scheduler;
+	double simulationTime = 0;
+
+	PROFILE_THREAD("simulation");
+	scheduler.init(1000.0 / stepTime);
+	while (!bQuit)
+	{
+		simulationTime += scheduler.waitNextFrame();
+		FrameScratch::instance().reset();
+
+		// The main thread updates the states that cannot run here
+		if (!Game::instance().supportsSnapshots())
+		{
+			simulationTime = 0;
+			continue;
+		}
+
+		for (int step = 0; step < maxSteps && simulationTime >= stepTime; step++)
+		{
+			if (!Game::instance().update(stepTime))
+			{
+				bPlaying = false;
+				return;
+			}
+			simulationTime -= stepTime;
+			// The step may have gone back to the menu, which the main
+			// thread updates from now on
+			if (!Game::instance().supportsSnapshots())
+				break;
+		}
+		simulationTime = fmod(simulationTime, stepTime);
+		if (!Game::instance().supportsSnapshots())
+			continue;
+
+		// The main thread draws the last step as it is, there is no
+		// previous one to interpolate from
+		Game::instance().setInterpolation(1.f);
+		RenderSnapshot &snapshot = snapshots[writeSlot];
+		snapshot.clear();
+		Game::instance().buildSnapshot(snapshot);
+		if (!snapshot.empty())
+			publish();
+	}
+}
+
+void SimulationThread::publish()
+{
+	int previous = exchange.exchange(writeSlot | SNAPSHOT_FRESH);
+
+	writeSlot = previous & ~SNAPSHOT_FRESH;
+
+	// The replaced frame was never drawn, the next one shows its input
+	if ((previous & SNAPSHOT_FRESH) && snapshots[writeSlot].getInputTime() > 0)
+		InputLatency::instance().reflected(snapshots[writeSlot].getInputTime());
+}
+
+void SimulationThread::invalidate()
+{
+	// Called from the main thread while the simulation waits for it
+	for (int i = 0; i < 3; i++)
+		snapshots[i].clear();
+	exchange = exchange & ~SNAPSHOT_FRESH;
+}
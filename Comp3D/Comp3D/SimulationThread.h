@@ -0,0 +1,78 @@
+#ifndef _SIMULATION_THREAD_INCLUDE
+#define _SIMULATION_THREAD_INCLUDE
+
+
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "RenderSnapshot.h"
+
+
+using namespace std;
+
+
+#define SNAPSHOT_FRESH 4			// Flag of the exchanged slot: published and not read yet
+
+
+// SimulationThread is a singleton that updates the game in its own thread
+// while the main thread only draws, so that both overlap. After its steps
+// the simulation describes the frame in a RenderSnapshot and publishes it.
+//
+// Snapshots are triple buffered: the simulation writes one, the main
+// thread draws another, and the third is exchanged between them with a
+// single atomic operation. Neither thread ever waits for the other and the
+// main thread always gets the latest complete frame.
+//
+// Only game states that support snapshots run here. Anything that needs
+// OpenGL (loading a level, going back to the menu) is sent to the main
+// thread with runOnRenderThread, which also drops the snapshots because
+// they may point to what is about to be freed.
+
+
+class SimulationThread
+{
+
+private:
+	SimulationThread();
+
+public:
+	static SimulationThread &instance()
+	{
+		static SimulationThread S;
+
+		return S;
+	}
+
+	~SimulationThread();
+
+	void start(int stepTime, int maxSteps);
+	void stop();
+
+	bool isRunning() const;
+	// False once the game has asked to quit
+	bool isPlaying() const;
+
+	// Main thread side, NULL until a frame has been published
+	const RenderSnapshot *acquireSnapshot();
+
+	// Runs work in the main thread and waits for it
+	void runOnRenderThread(const function<void()> &work);
+
+private:
+	void threadLoop();
+	void publish();
+	void invalidate();
+
+private:
+	thread simulation;
+	atomic<bool> bQuit, bPlaying;
+	int stepTime, maxSteps;
+
+	RenderSnapshot snapshots[3];
+	atomic<int> exchange;
+	int writeSlot, readSlot;
+
+};
+
+
+#endif // _SIMULATION_THREAD_INCLUDE
@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdint.h>
+#include "SoftwareMixer.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIXER_SSE
+#endif
+
+
+#define MIXER_HANDLE_BITS 12				// Bits of a voice handle used by the slot
+
+
+// out += in * gain, count floats
+
+static void mixInto(float* out, const float* in, int count, float gain)
+{
+	int i = 0;
+
+#ifdef MIXER_SSE
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+#endif
+	for (; i < count; i++)
+		out[i] += in[i] * gain;
+}
+
+// Float samples to 16 bit, clipping what goes beyond full scale
+
+static void toPCM16(short* out, const float* in, int count)
+{
+	int i = 0;
+
+#ifdef MIXER_SSE
+	__m128 scale = _mm_set1_ps(32767.f), low = _mm_set1_ps(-1.f), high = _mm_set1_ps(1.f);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high);
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high);
+		__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+		_mm_storeu_si128((__m128i*)(out + i), packed);
+	}
+#endif
+	for (; i < count; i++)
+		out[i] = short(int(floorf(min(max(in[i], -1.f), 1.f) * 32767.f + 0.5f)));
+}
+
+static double nowMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+SoftwareMixer::SoftwareMixer(const string& outputFile)
+{
+	this->outputFile = outputFile;
+	output = NULL;
+	outputBytes = 0;
+	realVoices = 0;
+	pendingFrames = 0;
+	stats.mixTime = 0;
+	stats.mixedFrames = 0;
+	stats.voiceFrames = 0;
+}
+
+SoftwareMixer::~SoftwareMixer()
+{
+	shutdown();
+}
+
+
+bool SoftwareMixer::init(int maxVoices, int realVoices)
+{
+	voices.resize(min(maxVoices, (1 << MIXER_HANDLE_BITS) - 1));
+	playing.reserve(voices.size());
+	for (Voice& voice : voices)
+	{
+		voice.sound = NULL;
+		voice.generation = 0;
+		voice.bActive = false;
+	}
+	this->realVoices = realVoices;
+
+	if (outputFile.empty())
+		return true;
+
+	// The sizes of the header are written when the file is closed
+	output = fopen(outputFile.c_str(), "wb");
+	if (output == NULL)
+	{
+		printf("Could not create %s\n", outputFile.c_str());
+		return false;
+	}
+	char header[44] = {};
+	fwrite(header, 1, sizeof(header), output);
+	outputBytes = 0;
+
+	return true;
+}
+
+void SoftwareMixer::shutdown()
+{
+	if (output == NULL)
+		return;
+
+	int32_t chunkSize = 36 + outputBytes, dataSize = outputBytes, fmtSize = 16, rate = MIXER_RATE, byteRate = MIXER_RATE * 4;
+	int16_t format = 1, channels = 2, blockAlign = 4, bits = 16;
+
+	fseek(output, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, output); fwrite(&chunkSize, 4, 1, output); fwrite("WAVE", 1, 4, output);
+	fwrite("fmt ", 1, 4, output); fwrite(&fmtSize, 4, 1, output);
+	fwrite(&format, 2, 1, output); fwrite(&channels, 2, 1, output);
+	fwrite(&rate, 4, 1, output); fwrite(&byteRate, 4, 1, output);
+	fwrite(&blockAlign, 2, 1, output); fwrite(&bits, 2, 1, output);
+	fwrite("data", 1, 4, output); fwrite(&dataSize, 4, 1, output);
+	fclose(output);
+	output = NULL;
+}
+
+void SoftwareMixer::update(int deltaTime)
+{
+	int numFrames;
+
+	pendingFrames += deltaTime * MIXER_RATE / 1000.0;
+	numFrames = int(pendingFrames);
+	pendingFrames -= numFrames;
+	mix(numFrames);
+}
+
+
+AudioSound* SoftwareMixer::createSound(const string& file, bool bStream, bool bLoop)
+{
+	MixerSound* sound = new MixerSound();
+
+	sound->bLoop = bLoop;
+	sound->state = LOADING;
+
+	// Decoding does not fail, what cannot be decoded plays as silence
+	function<void()> decode = [sound, file]() {
+		if (!decodeWav(file, sound->frames))
+			sound->frames.assign(2 * MIXER_RATE * MIXER_PLACEHOLDER_LENGTH / 1000, 0.f);
+		sound->state = READY;
+	};
+
+	// Without workers nobody would run the job until somebody waits for it
+	if (JobSystem::instance().getNumThreads() > 1)
+	{
+		sound->decode = JobSystem::instance().create(decode);
+		JobSystem::instance().submit(sound->decode);
+	}
+	else
+		decode();
+
+	return sound;
+}
+
+AudioSound* SoftwareMixer::createSound(const vector<float>& frames, bool bLoop)
+{
+	MixerSound* sound = new MixerSound();
+
+	sound->frames = frames;
+	sound->bLoop = bLoop;
+	sound->state = READY;
+
+	return sound;
+}
+
+void SoftwareMixer::releaseSound(AudioSound* sound)
+{
+	MixerSound* mixerSound = static_cast<MixerSound*>(sound);
+
+	if (mixerSound->decode != NULL)
+		JobSystem::instance().wait(mixerSound->decode);
+	for (Voice& voice : voices)
+		if (voice.bActive && voice.sound == mixerSound)
+			voice.bActive = false;
+	delete mixerSound;
+}
+
+AudioBackend::State SoftwareMixer::getState(AudioSound* sound)
+{
+	return State(static_cast<MixerSound*>(sound)->state.load());
+}
+
+unsigned int SoftwareMixer::getSampleBytes(AudioSound* sound)
+{
+	if (getState(sound) != READY)
+		return 0;
+	return (unsigned int)(static_cast<MixerSound*>(sound)->frames.size() * sizeof(float));
+}
+
+
+AudioVoice SoftwareMixer::play(AudioSound* sound, int priority)
+{
+	MixerSound* mixerSound = static_cast<MixerSound*>(sound);
+
+	if (mixerSound->state != READY)
+		return 0;
+
+	for (unsigned int slot = 0; slot < voices.size(); slot++)
+	{
+		Voice& voice = voices[slot];
+		if (voice.bActive)
+			continue;
+
+		voice.sound = mixerSound;
+		voice.position = 0;
+		voice.volume = 1.f;
+		voice.priority = priority;
+		voice.generation++;
+		voice.bActive = true;
+
+		return (AudioVoice(voice.generation) << MIXER_HANDLE_BITS) | (slot + 1);
+	}
+
+	// No free slot, the voice is lost
+	return 0;
+}
+
+void SoftwareMixer::stop(AudioVoice voice)
+{
+	Voice* v = voiceOf(voice);
+
+	if (v != NULL)
+		v->bActive = false;
+}
+
+void SoftwareMixer::setVolume(AudioVoice voice, float volume)
+{
+	Voice* v = voiceOf(voice);
+
+	if (v != NULL)
+		v->volume = volume;
+}
+
+bool SoftwareMixer::isPlaying(AudioVoice voice)
+{
+	return voiceOf(voice) != NULL;
+}
+
+
+void SoftwareMixer::getVoices(int& numVoices, int& numRealVoices)
+{
+	numVoices = 0;
+	for (const Voice& voice : voices)
+		if (voice.bActive)
+			numVoices++;
+	numRealVoices = min(numVoices, realVoices);
+}
+
+int SoftwareMixer::getMemoryBytes()
+{
+	// Decoded sounds are counted by getSampleBytes
+	return int(voices.capacity() * sizeof(Voice) + mixBuffer.capacity() * sizeof(float) + outputBuffer.capacity() * sizeof(short));
+}
+
+
+void SoftwareMixer::mix(int numFrames)
+{
+	double start = nowMs();
+
+	mixBuffer.assign(2 * numFrames, 0.f);
+
+	playing.clear();
+	for (unsigned int slot = 0; slot < voices.size(); slot++)
+		if (voices[slot].bActive)
+			playing.push_back(slot);
+
+	// Best priority first and, within the same priority, the loudest
+	if (int(playing.size()) > realVoices)
+	{
+		partial_sort(playing.begin(), playing.begin() + realVoices, playing.end(), [this](int a, int b) {
+			if (voices[a].priority != voices[b].priority)
+				return voices[a].priority < voices[b].priority;
+			return voices[a].volume > voices[b].volume;
+		});
+	}
+
+	for (unsigned int k = 0; k < playing.size(); k++)
+	{
+		Voice& voice = voices[playing[k]];
+		int length = int(voice.sound->frames.size() / 2);
+		// Virtual voices and silent ones only move forward
+		bool bMixed = int(k) < realVoices && voice.volume > 0.f;
+
+		for (int done = 0; done < numFrames && voice.bActive; )
+		{
+			int count = min(length - voice.position, numFrames - done);
+
+			if (bMixed && count > 0)
+			{
+				mixInto(&mixBuffer[2 * done], &voice.sound->frames[2 * voice.position], 2 * count, voice.volume);
+				stats.voiceFrames += count;
+			}
+			voice.position += count;
+			done += count;
+			if (voice.position >= length)
+			{
+				if (voice.sound->bLoop && length > 0)
+					voice.position = 0;
+				else
+					voice.bActive = false;
+			}
+		}
+	}
+
+	writeOutput(numFrames);
+	stats.mixedFrames += numFrames;
+	stats.mixTime += nowMs() - start;
+}
+
+
+bool SoftwareMixer::decodeWav(const string& file, vector<float>& frames)
+{
+	ifstream fin(file.c_str(), ios::binary);
+	char id[4];
+	uint32_t size;
+	uint16_t format = 0, channels = 0, bits = 0;
+	uint32_t rate = 0;
+	vector<char> data;
+
+	if (!fin.read(id, 4) || strncmp(id, "RIFF", 4) != 0 || !fin.read((char*)&size, 4) || !fin.read(id, 4) || strncmp(id, "WAVE", 4) != 0)
+		return false;
+
+	// Chunks in any order, only fmt and data matter
+	while (fin.read(id, 4) && fin.read((char*)&size, 4))
+	{
+		if (strncmp(id, "fmt ", 4) == 0 && size >= 16)
+		{
+			vector<char> fmt(size);
+			fin.read(&fmt[0], size);
+			memcpy(&format, &fmt[0], 2);
+			memcpy(&channels, &fmt[2], 2);
+			memcpy(&rate, &fmt[4], 4);
+			memcpy(&bits, &fmt[14], 2);
+		}
+		else if (strncmp(id, "data", 4) == 0)
+		{
+			data.resize(size);
+			if (size > 0)
+				fin.read(&data[0], size);
+			break;
+		}
+		else
+			fin.seekg(size + (size & 1), ios::cur);
+	}
+
+	bool bPCM = format == 1 && (bits == 8 || bits == 16);
+	bool bFloat = format == 3 && bits == 32;
+	if (!(bPCM || bFloat) || channels < 1 || channels > 2 || rate == 0 || data.empty())
+		return false;
+
+	int bytesPerSample = bits / 8;
+	int numInput = int(data.size() / (bytesPerSample * channels));
+	int numOutput = int((long long)numInput * MIXER_RATE / rate);
+
+	// Every sample to float, then resampled linearly to the output rate
+	vector<float> input(2 * numInput);
+	for (int i = 0; i < numInput; i++)
+		for (int c = 0; c < 2; c++)
+		{
+			const char* p = &data[(i * channels + min(c, channels - 1)) * bytesPerSample];
+			float value;
+			if (bits == 8)
+				value = ((unsigned char)*p - 128) / 128.f;
+			else if (bits == 16)
+			{
+				int16_t s;
+				memcpy(&s, p, 2);
+				value = s / 32768.f;
+			}
+			else
+				memcpy(&value, p, 4);
+			input[2 * i + c] = value;
+		}
+
+	frames.resize(2 * numOutput);
+	for (int i = 0; i < numOutput; i++)
+	{
+		double t = double(i) * rate / MIXER_RATE;
+		int i0 = min(int(t), numInput - 1), i1 = min(i0 + 1, numInput - 1);
+		float f = float(t - i0);
+		for (int c = 0; c < 2; c++)
+			frames[2 * i + c] = input[2 * i0 + c] + (input[2 * i1 + c] - input[2 * i0 + c]) * f;
+	}
+
+	return true;
+}
+
+
+SoftwareMixer::Voice* SoftwareMixer::voiceOf(AudioVoice voice)
+{
+	int slot = int(voice & ((1 << MIXER_HANDLE_BITS) - 1)) - 1;
+
+	if (voice == 0 || slot < 0 || slot >= int(voices.size()))
+		return NULL;
+
+	Voice& v = voices[slot];
+	if (!v.bActive || AudioVoice(v.generation) != (voice >> MIXER_HANDLE_BITS))
+		return NULL;
+	return &v;
+}
+
+void SoftwareMixer::writeOutput(int numFrames)
+{
+	if (output == NULL)
+		return;
+
+	outputBuffer.resize(2 * numFrames);
+	toPCM16(outputBuffer.empty() ? NULL : &outputBuffer[0], mixBuffer.empty() ? NULL : &mixBuffer[0], 2 * numFrames);
+	fwrite(outputBuffer.data(), sizeof(short), outputBuffer.size(), output);
+	outputBytes += (unsigned int)(outputBuffer.size() * sizeof(short));
+}
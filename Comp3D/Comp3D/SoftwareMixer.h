@@ -0,0 +1,112 @@
+#ifndef _SOFTWARE_MIXER_INCLUDE
+#define _SOFTWARE_MIXER_INCLUDE
+
+
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include "AudioBackend.h"
+#include "JobSystem.h"
+
+
+#define MIXER_RATE 44100				// Output frames per second, always stereo
+#define MIXER_PLACEHOLDER_LENGTH 500	// ms of silence played for files it cannot decode
+
+
+// SoftwareMixer is an audio backend that needs no device or library. Sounds
+// are decoded in a job to stereo float PCM at the output rate, and every
+// update mixes the time of the step with SSE (or plain C++ where it is
+// not available). The mix is written to a 16 bit WAV file, or discarded
+// when no file is given, so benchmarks and replays go through the whole
+// audio path without hearing it.
+//
+// Only PCM WAV files can be decoded. Other formats (the game ships MP3)
+// play as MIXER_PLACEHOLDER_LENGTH ms of silence, so the mixing work is
+// still the same. Streams are decoded like the rest.
+//
+// When more than realVoices are playing, the voices with the worst
+// priority and the lowest volume are virtual: their position advances but
+// they are not mixed.
+
+
+class SoftwareMixer : public AudioBackend
+{
+
+public:
+	struct Stats
+	{
+		double mixTime;						// ms spent mixing
+		long long mixedFrames;				// Output frames produced
+		long long voiceFrames;				// Frames mixed summed over all the real voices
+	};
+
+	// outputFile can be empty, then the mix is discarded
+	SoftwareMixer(const string& outputFile = "");
+	~SoftwareMixer();
+
+	bool init(int maxVoices, int realVoices);
+	void shutdown();
+	void update(int deltaTime);
+
+	AudioSound* createSound(const string& file, bool bStream, bool bLoop);
+	void releaseSound(AudioSound* sound);
+	State getState(AudioSound* sound);
+	unsigned int getSampleBytes(AudioSound* sound);
+
+	AudioVoice play(AudioSound* sound, int priority);
+	void stop(AudioVoice voice);
+	void setVolume(AudioVoice voice, float volume);
+	bool isPlaying(AudioVoice voice);
+
+	void getVoices(int& numVoices, int& numRealVoices);
+	int getMemoryBytes();
+
+	// A sound made of stereo frames already at the output rate, ready at once
+	AudioSound* createSound(const vector<float>& frames, bool bLoop);
+	// Mixes numFrames output frames, update calls it with the frames of the step
+	void mix(int numFrames);
+
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct MixerSound : public AudioSound
+	{
+		vector<float> frames;				// Interleaved stereo
+		bool bLoop;
+		atomic<int> state;
+		JobSystem::JobHandle decode;
+	};
+
+	struct Voice
+	{
+		MixerSound* sound;
+		int position;						// Frame
+		float volume;
+		int priority;
+		unsigned int generation;			// Makes old handles of the slot invalid
+		bool bActive;
+	};
+
+	static bool decodeWav(const string& file, vector<float>& frames);
+
+	Voice* voiceOf(AudioVoice voice);
+	void writeOutput(int numFrames);
+
+private:
+	string outputFile;
+	FILE* output;
+	unsigned int outputBytes;
+
+	vector<Voice> voices;
+	int realVoices;
+	vector<int> playing;
+	vector<float> mixBuffer;
+	vector<short> outputBuffer;
+	double pendingFrames;					// Fraction of a frame left by the last step
+
+	Stats stats;
+
+};
+
+
+#endif // _SOFTWARE_MIXER_INCLUDE
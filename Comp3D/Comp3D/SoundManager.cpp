@@ -1,46 +1,346 @@
 #include "SoundManager.h"
+#include "SoftwareMixer.h"
+#include "Profiler.h"
+#include "MemoryAccounting.h"
+#ifndef COMP3D_NO_FMOD
+#include "FmodBackend.h"
+#endif
 #include <stdio.h>
+#include <algorithm>
 
 
 
-void SoundManager::init()
+SoundManager::~SoundManager()
 {
-    FMOD_RESULT result;
+    if (backend != nullptr)
+    {
+        backend->shutdown();
+        delete backend;
+    }
+}
 
-    result = FMOD::System_Create(&system);      // Create the main system object.
-    if (result != FMOD_OK)
+
+void SoundManager::setBackend(AudioBackend* backend)
+{
+    if (this->backend != nullptr)
+        delete this->backend;
+    this->backend = backend;
+}
+
+
+void SoundManager::init()
+{
+    // Builds without FMOD mix in software and discard the result
+    if (backend == nullptr)
     {
-        printf("FMOD error! (%d) %s\n", result, FMOD_ErrorString(result));
-        //exit(-1);
+#ifndef COMP3D_NO_FMOD
+        backend = new FmodBackend();
+#else
+        backend = new SoftwareMixer();
+#endif
     }
 
-    result = system->init(512, FMOD_INIT_NORMAL, 0);    // Initialize FMOD.
-    if (result != FMOD_OK)
+    step = 0;
+    time = 0;
+    numCoalesced = numCooledDown = numStolen = 0;
+
+    if (!backend->init(SOUND_MAX_VOICES, SOUND_REAL_VOICES))
     {
-        printf("FMOD error! (%d) %s\n", result, FMOD_ErrorString(result));
+        printf("Audio error! Could not initialize the backend\n");
         //exit(-1);
     }
 }
 
 
-FMOD::Sound* SoundManager::loadSound(const std::string& file, FMOD_MODE mode) const
+AudioSound* SoundManager::loadSound(const std::string& file, Mode mode, const VoiceLimits& limits)
 {
-    FMOD::Sound* sound;
-    system->createSound(file.c_str(), mode, nullptr, &sound);
+    return load(file, mode, false, limits);
+}
+
+
+AudioSound* SoundManager::loadStream(const std::string& file, Mode mode)
+{
+    // Music is never made virtual
+    return load(file, mode, true, VoiceLimits(1, 0, 0));
+}
+
+
+AudioSound* SoundManager::load(const std::string& file, Mode mode, bool bStream, const VoiceLimits& limits)
+{
+    PROFILE_ZONE("SoundManager::load");
+    std::lock_guard<std::mutex> guard(lock);
+    AudioSound* sound = nullptr;
+
+    // Already in the bank, share it
+    if (!bStream)
+    {
+        std::map<SampleKey, AudioSound*>::iterator it = samples.find(SampleKey(file, mode));
+        if (it != samples.end())
+        {
+            BankEntry& entry = bank[it->second];
+            entry.references++;
+
+            // Loaders that ask for different limits get the loosest of
+            // each, whatever the order they load in
+            VoiceLimits& shared = entry.limits;
+            if (shared.maxVoices != limits.maxVoices || shared.cooldown != limits.cooldown || shared.priority != limits.priority)
+            {
+                printf("Audio warning! %s is loaded with different voice limits, merging them\n", file.c_str());
+                shared.maxVoices = std::max(shared.maxVoices, limits.maxVoices);
+                shared.cooldown = std::min(shared.cooldown, limits.cooldown);
+                shared.priority = std::min(shared.priority, limits.priority);
+                entry.voices.reserve(shared.maxVoices);
+            }
+            return it->second;
+        }
+    }
+
+    sound = backend->createSound(file, bStream, mode == LOOP);
+    if (sound == nullptr)
+    {
+        printf("Audio error! Could not open %s\n", file.c_str());
+        return nullptr;
+    }
+
+    BankEntry entry;
+    entry.file = file;
+    entry.mode = mode;
+    entry.bStream = bStream;
+    entry.references = 1;
+    entry.sampleBytes = 0;
+    entry.limits = limits;
+    entry.lastVoice = 0;
+    entry.lastStep = entry.lastTime = -1;
+    bank[sound] = entry;
+    // A copied vector does not keep its capacity, room is made in the bank
+    bank[sound].voices.reserve(limits.maxVoices);
+    if (!bStream)
+    {
+        samples[SampleKey(file, mode)] = sound;
+        decoding.push_back(sound);
+    }
+
     return sound;
 }
 
 
-FMOD::Channel* SoundManager::playSound(FMOD::Sound* sound) const
+void SoundManager::releaseSound(AudioSound* sound)
+{
+    if (sound == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unordered_map<AudioSound*, BankEntry>::iterator it = bank.find(sound);
+
+    // Not ours or already freed
+    if (it == bank.end())
+        return;
+    if (--it->second.references > 0)
+        return;
+
+    if (!it->second.bStream)
+        samples.erase(SampleKey(it->second.file, it->second.mode));
+    if (it->second.sampleBytes > 0)
+        MemoryAccounting::instance().release(MemoryAccounting::SOUNDS, MemoryAccounting::CPU, it->second.file, it->second.sampleBytes);
+    bank.erase(it);
+    decoding.erase(std::remove(decoding.begin(), decoding.end(), sound), decoding.end());
+
+    // Nobody is waiting for it any more
+    for (unsigned int i = 0; i < pending.size(); )
+    {
+        if (pending[i].sound == sound)
+            pending.erase(pending.begin() + i);
+        else
+            i++;
+    }
+    backend->releaseSound(sound);
+}
+
+
+bool SoundManager::isReady(AudioSound* sound) const
+{
+    return sound != nullptr && backend->getState(sound) == AudioBackend::READY;
+}
+
+
+void SoundManager::whenReady(AudioSound* sound, const ReadyCallback& callback)
+{
+    if (sound == nullptr)
+        return;
+    if (isReady(sound))
+    {
+        callback(sound);
+        return;
+    }
+
+    PendingSound p;
+    p.sound = sound;
+    p.callback = callback;
+
+    std::lock_guard<std::mutex> guard(lock);
+    pending.push_back(p);
+}
+
+
+AudioVoice SoundManager::playSound(AudioSound* sound)
 {
-    FMOD::Channel* channel;
-    system->playSound(sound, nullptr, false, &channel);
-    return channel;
+    std::lock_guard<std::mutex> guard(lock);
+    AudioVoice voice;
+
+    if (sound == nullptr)
+        return 0;
+
+    std::unordered_map<AudioSound*, BankEntry>::iterator it = bank.find(sound);
+    if (it == bank.end())
+        return 0;
+    BankEntry& entry = it->second;
+    if (backend->getState(sound) != AudioBackend::READY)
+        return 0;
+
+    // Several contacts in the same step sound as one
+    if (entry.lastStep == step && entry.lastVoice != 0)
+    {
+        numCoalesced++;
+        return entry.lastVoice;
+    }
+    if (entry.lastTime >= 0 && time - entry.lastTime < entry.limits.cooldown && entry.lastVoice != 0)
+    {
+        numCooledDown++;
+        return entry.lastVoice;
+    }
+
+    // Forget the voices that have finished, then steal the oldest if there are too many
+    for (unsigned int i = 0; i < entry.voices.size(); )
+    {
+        if (backend->isPlaying(entry.voices[i]))
+            i++;
+        else
+            entry.voices.erase(entry.voices.begin() + i);
+    }
+    if (int(entry.voices.size()) >= entry.limits.maxVoices && !entry.voices.empty())
+    {
+        backend->stop(entry.voices.front());
+        entry.voices.erase(entry.voices.begin());
+        numStolen++;
+    }
+
+    voice = backend->play(sound, entry.limits.priority);
+    if (voice == 0)
+        return 0;
+
+    entry.voices.push_back(voice);
+    entry.lastVoice = voice;
+    entry.lastStep = step;
+    entry.lastTime = time;
+
+    return voice;
 }
 
 
-void SoundManager::update()
+void SoundManager::stop(AudioVoice voice)
 {
-    system->update();
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (voice != 0)
+        backend->stop(voice);
 }
 
+
+void SoundManager::setVolume(AudioVoice voice, float volume)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (voice != 0)
+        backend->setVolume(voice, volume);
+}
+
+
+bool SoundManager::isPlaying(AudioVoice voice) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return voice != 0 && backend->isPlaying(voice);
+}
+
+
+void SoundManager::update(int deltaTime)
+{
+    std::vector<PendingSound> ready;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        backend->update(deltaTime);
+        step++;
+        time += deltaTime;
+
+        // Samples are decoded in the background, their size is known once they are ready
+        for (unsigned int i = 0; i < decoding.size(); )
+        {
+            AudioBackend::State state = backend->getState(decoding[i]);
+            if (state == AudioBackend::LOADING)
+            {
+                i++;
+                continue;
+            }
+            if (state == AudioBackend::READY)
+            {
+                BankEntry& entry = bank[decoding[i]];
+                entry.sampleBytes = backend->getSampleBytes(decoding[i]);
+                MemoryAccounting::instance().allocate(MemoryAccounting::SOUNDS, MemoryAccounting::CPU, entry.file, entry.sampleBytes);
+            }
+            decoding.erase(decoding.begin() + i);
+        }
+    }
+
+    // Callbacks run outside the lock, they may load or wait for other sounds
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (unsigned int i = 0; i < pending.size(); )
+        {
+            AudioBackend::State state = backend->getState(pending[i].sound);
+            if (state != AudioBackend::LOADING)
+            {
+                if (state == AudioBackend::READY)
+                    ready.push_back(pending[i]);
+                else
+                    printf("Audio error! Could not open a sound\n");
+                pending.erase(pending.begin() + i);
+            }
+            else
+                i++;
+        }
+    }
+    for (const PendingSound& p : ready)
+        p.callback(p.sound);
+}
+
+
+SoundManager::Stats SoundManager::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Stats stats;
+
+    stats.numSamples = 0;
+    stats.numStreams = 0;
+    stats.numReferences = 0;
+    stats.sampleBytes = 0;
+    for (const std::pair<AudioSound* const, BankEntry>& it : bank)
+    {
+        stats.numReferences += it.second.references;
+        if (it.second.bStream)
+        {
+            stats.numStreams++;
+            continue;
+        }
+        stats.numSamples++;
+        // Samples still opening have nothing decoded yet
+        stats.sampleBytes += backend->getSampleBytes(it.first);
+    }
+    stats.backendBytes = backend->getMemoryBytes();
+    backend->getVoices(stats.numVoices, stats.numRealVoices);
+    stats.numCoalesced = numCoalesced;
+    stats.numCooledDown = numCooledDown;
+    stats.numStolen = numStolen;
+
+    return stats;
+}
@@ -1,16 +1,75 @@
 #ifndef _SOUNDMANAGER_INCLUDE
 #define _SOUNDMANAGER_INCLUDE
 
-#include "fmod.hpp"
-#include "fmod_errors.h"
+#include "AudioBackend.h"
 #include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
 
 
+// SoundManager plays the sounds of the game through an AudioBackend, FMOD
+// unless another one is set before init. Nothing is decoded while loading:
+// sounds open in the background and cannot be played until they are
+// ready, whenReady calls back from update once they are. Short effects
+// are decoded in memory when they finish opening, music is streamed from
+// disk so only a small decode buffer stays resident.
+//
+// Loaded sounds live in a bank. Effects loaded twice with the same file
+// and mode share one sample, every load counts as a reference and the
+// owner gives it back with releaseSound. The sample is freed when the
+// last reference goes. Streams can only play once at a time, so they are
+// never shared. The decoded samples are counted by MemoryAccounting.
+//
+// Every sound has voice limits. Triggers of the same sound in the same
+// update share one voice, a trigger within the cooldown of the previous one
+// is dropped, and a sound already playing maxVoices times stops its oldest
+// voice to start the new one. A shared sample has one set of limits: when
+// its loaders ask for different ones, it keeps the most voices, the
+// shortest cooldown and the highest priority any of them asked for, so no
+// loader gets less than it wanted. Only SOUND_REAL_VOICES voices are mixed;
+// the backend makes the rest virtual (silent and almost free) by priority
+// and volume, and they come back if a real voice frees up.
+
+
+#define SOUND_MAX_VOICES 512		// Real plus virtual
+#define SOUND_REAL_VOICES 32		// Voices actually mixed
+
 
 class SoundManager
 {
 public:
-	SoundManager() {}
+	typedef std::function<void(AudioSound*)> ReadyCallback;
+
+	enum Mode
+	{
+		ONCE,
+		LOOP
+	};
+
+	struct VoiceLimits
+	{
+		int maxVoices;					// Instances of the sound playing at the same time
+		int cooldown;					// ms after a trigger during which new ones are dropped
+		int priority;					// 0 is the most important, 256 the least
+
+		VoiceLimits(int maxVoices = 4, int cooldown = 0, int priority = 128) : maxVoices(maxVoices), cooldown(cooldown), priority(priority) {}
+	};
+
+	struct Stats
+	{
+		int numSamples, numStreams;
+		int numReferences;
+		unsigned int sampleBytes;		// PCM resident in the samples that are open
+		int backendBytes;				// Everything the backend has allocated
+		int numVoices, numRealVoices;
+		int numCoalesced, numCooledDown, numStolen;
+	};
+
+	SoundManager() : backend(nullptr) {}
+	~SoundManager();
 
 
 	static SoundManager& instance()
@@ -20,13 +79,69 @@ public:
 		return S;
 	}
 
+	// Takes ownership of backend, must be called before init
+	void setBackend(AudioBackend* backend);
+	AudioBackend* getBackend() const { return backend; }
+
 	void init();
-	void update();
-	FMOD::Sound* loadSound(const std::string& file, FMOD_MODE mode) const;
-	FMOD::Channel* playSound(FMOD::Sound* sound) const;
+	// Called once per simulation step
+	void update(int deltaTime);
+
+	// Sound effects
+	AudioSound* loadSound(const std::string& file, Mode mode, const VoiceLimits& limits = VoiceLimits());
+	// Music and other long sounds
+	AudioSound* loadStream(const std::string& file, Mode mode);
+	// Every load must be paired with a release
+	void releaseSound(AudioSound* sound);
+
+	bool isReady(AudioSound* sound) const;
+	// Calls callback as soon as sound can be played, right away if it already can
+	void whenReady(AudioSound* sound, const ReadyCallback& callback);
+
+	// Returns 0 if sound is not ready yet. A coalesced or dropped
+	// trigger returns the voice of the previous one.
+	AudioVoice playSound(AudioSound* sound);
+	void stop(AudioVoice voice);
+	void setVolume(AudioVoice voice, float volume);
+	bool isPlaying(AudioVoice voice) const;
+
+	Stats getStats() const;
 
 private:
-	FMOD::System* system;
+	struct PendingSound
+	{
+		AudioSound* sound;
+		ReadyCallback callback;
+	};
+
+	struct BankEntry
+	{
+		std::string file;
+		Mode mode;
+		bool bStream;
+		int references;
+		unsigned int sampleBytes;			// Counted once it is decoded
+
+		VoiceLimits limits;
+		std::vector<AudioVoice> voices;		// Oldest first
+		AudioVoice lastVoice;
+		int lastStep, lastTime;
+	};
+
+	AudioSound* load(const std::string& file, Mode mode, bool bStream, const VoiceLimits& limits);
+
+	typedef std::pair<std::string, Mode> SampleKey;
+
+	AudioBackend* backend;
+
+	mutable std::mutex lock;			// Sounds are loaded and updated from different threads
+	std::vector<PendingSound> pending;
+	std::vector<AudioSound*> decoding;	// Samples not counted yet
+	std::unordered_map<AudioSound*, BankEntry> bank;
+	std::map<SampleKey, AudioSound*> samples;
+
+	int step, time;
+	int numCoalesced, numCooledDown, numStolen;
 
 };
 
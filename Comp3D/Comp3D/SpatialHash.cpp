@@ -0,0 +1,146 @@
+#include <cmath>
+#include <algorithm>
+#include "SpatialHash.h"
+
+
+SpatialHash::SpatialHash()
+{
+	for (int b = 0; b < SPATIAL_HASH_BUCKETS; b++)
+		buckets[b].reserve(SPATIAL_HASH_BUCKET_RESERVE);
+}
+
+
+void SpatialHash::clear()
+{
+	proxies.clear();
+	freeProxies.clear();
+	for (int b = 0; b < SPATIAL_HASH_BUCKETS; b++)
+		buckets[b].clear();
+}
+
+
+int SpatialHash::insert(Type type, int index, const glm::vec2& minCorner, const glm::vec2& maxCorner)
+{
+	int proxy;
+
+	if (freeProxies.empty())
+	{
+		proxy = int(proxies.size());
+		proxies.push_back(Proxy());
+	}
+	else
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+
+	proxies[proxy].type = type;
+	proxies[proxy].index = index;
+	proxies[proxy].cellMin = cellOf(minCorner);
+	proxies[proxy].cellMax = cellOf(maxCorner);
+	proxies[proxy].bAlive = true;
+	addToCells(proxy);
+
+	return proxy;
+}
+
+void SpatialHash::update(int proxy, const glm::vec2& minCorner, const glm::vec2& maxCorner)
+{
+	glm::ivec2 cellMin = cellOf(minCorner);
+	glm::ivec2 cellMax = cellOf(maxCorner);
+
+	// Most frames the box stays in the same cells
+	if (cellMin == proxies[proxy].cellMin && cellMax == proxies[proxy].cellMax)
+		return;
+
+	removeFromCells(proxy);
+	proxies[proxy].cellMin = cellMin;
+	proxies[proxy].cellMax = cellMax;
+	addToCells(proxy);
+}
+
+void SpatialHash::remove(int proxy)
+{
+	removeFromCells(proxy);
+	proxies[proxy].bAlive = false;
+	freeProxies.push_back(proxy);
+}
+
+
+void SpatialHash::query(Type type, const glm::vec2& minCorner, const glm::vec2& maxCorner, vector<int>& indices) const
+{
+	glm::ivec2 cellMin = cellOf(minCorner);
+	glm::ivec2 cellMax = cellOf(maxCorner);
+
+	// Every proxy is found once at most, so with room for all of them the
+	// callers' vectors never grow again
+	indices.clear();
+	if (indices.capacity() < proxies.size())
+		indices.reserve(proxies.size());
+
+	for (int cy = cellMin.y; cy <= cellMax.y; cy++)
+		for (int cx = cellMin.x; cx <= cellMax.x; cx++)
+		{
+			const vector<int>& bucket = buckets[bucketOf(cx, cy)];
+			for (unsigned int k = 0; k < bucket.size(); k++)
+			{
+				int proxy = bucket[k];
+				const Proxy& p = proxies[proxy];
+
+				if (p.type != type)
+					continue;
+				// Buckets are shared by distant cells, check the real ranges
+				if (p.cellMax.x < cellMin.x || p.cellMin.x > cellMax.x || p.cellMax.y < cellMin.y || p.cellMin.y > cellMax.y)
+					continue;
+				// Boxes that span several cells are only taken in the first
+				// cell they share with the query
+				if (cx != max(cellMin.x, p.cellMin.x) || cy != max(cellMin.y, p.cellMin.y))
+					continue;
+				indices.push_back(p.index);
+			}
+		}
+
+	sort(indices.begin(), indices.end());
+}
+
+
+glm::ivec2 SpatialHash::cellOf(const glm::vec2& point)
+{
+	return glm::ivec2(int(floor(point.x / SPATIAL_HASH_CELL)), int(floor(point.y / SPATIAL_HASH_CELL)));
+}
+
+int SpatialHash::bucketOf(int cx, int cy)
+{
+	return int(((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u)) & (SPATIAL_HASH_BUCKETS - 1);
+}
+
+void SpatialHash::addToCells(int proxy)
+{
+	const Proxy& p = proxies[proxy];
+
+	for (int cy = p.cellMin.y; cy <= p.cellMax.y; cy++)
+		for (int cx = p.cellMin.x; cx <= p.cellMax.x; cx++)
+		{
+			vector<int>& bucket = buckets[bucketOf(cx, cy)];
+			// Two cells of the same box may land in the same bucket
+			if (find(bucket.begin(), bucket.end(), proxy) == bucket.end())
+				bucket.push_back(proxy);
+		}
+}
+
+void SpatialHash::removeFromCells(int proxy)
+{
+	const Proxy& p = proxies[proxy];
+
+	for (int cy = p.cellMin.y; cy <= p.cellMax.y; cy++)
+		for (int cx = p.cellMin.x; cx <= p.cellMax.x; cx++)
+		{
+			vector<int>& bucket = buckets[bucketOf(cx, cy)];
+			vector<int>::iterator it = find(bucket.begin(), bucket.end(), proxy);
+			if (it != bucket.end())
+			{
+				*it = bucket.back();
+				bucket.pop_back();
+			}
+		}
+}
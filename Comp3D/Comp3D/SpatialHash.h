@@ -0,0 +1,77 @@
+#ifndef _SPATIAL_HASH_INCLUDE
+#define _SPATIAL_HASH_INCLUDE
+
+
+#include <vector>
+#include <glm/glm.hpp>
+
+
+using namespace std;
+
+
+#define SPATIAL_HASH_CELL 4				// Cell size in tiles
+#define SPATIAL_HASH_BUCKETS 1024		// Must be a power of two
+#define SPATIAL_HASH_BUCKET_RESERVE 32	// Proxies every bucket has room for from the start
+
+
+// SpatialHash is a uniform grid over the tile map used as a broadphase.
+// Every entity registers its bounding box (in tile coordinates) and gets
+// a proxy back. Moving entities update their proxy, which only touches
+// the grid when the box crosses into other cells. Queries return the
+// indices of the entities of one type whose box may overlap the queried
+// one, sorted so that callers visit them in the same order as before.
+// Queries do not modify the grid and can run from several threads.
+//
+// Buckets keep their memory, and start with room for more proxies than
+// a level puts in one, so moving entities do not allocate. The vector a
+// query fills gets room for every proxy the first time, so queries do not
+// allocate either once the level is running.
+
+
+class SpatialHash
+{
+
+public:
+	enum Type
+	{
+		WALL,
+		BALL_SPIKE,
+		BUTTON,
+		SWITCH,
+		NUM_TYPES
+	};
+
+	SpatialHash();
+
+	void clear();
+
+	int insert(Type type, int index, const glm::vec2& minCorner, const glm::vec2& maxCorner);
+	void update(int proxy, const glm::vec2& minCorner, const glm::vec2& maxCorner);
+	void remove(int proxy);
+
+	void query(Type type, const glm::vec2& minCorner, const glm::vec2& maxCorner, vector<int>& indices) const;
+
+private:
+	struct Proxy
+	{
+		Type type;
+		int index;
+		glm::ivec2 cellMin, cellMax;
+		bool bAlive;
+	};
+
+	static glm::ivec2 cellOf(const glm::vec2& point);
+	static int bucketOf(int cx, int cy);
+
+	void addToCells(int proxy);
+	void removeFromCells(int proxy);
+
+private:
+	vector<Proxy> proxies;
+	vector<int> freeProxies;
+	vector<int> buckets[SPATIAL_HASH_BUCKETS];
+
+};
+
+
+#endif // _SPATIAL_HASH_INCLUDE
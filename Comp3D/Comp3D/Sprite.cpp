@@ -2,6 +2,8 @@
 #include <GL/gl.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Sprite.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
 
 
 Sprite* Sprite::createSprite(const glm::vec2& quadSize, const glm::vec2& sizeInSpritesheet, Texture* spritesheet, ShaderProgram* program)
@@ -20,10 +22,11 @@ Sprite::Sprite(const glm::vec2& quadSize, const glm::vec2& sizeInSpritesheet, Te
 												0.f, quadSize.y, 0.f, sizeInSpritesheet.y };
 
 	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	RenderStats::instance().bindVertexArray(vao);
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), vertices, GL_STATIC_DRAW);
+	RenderStats::instance().bufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), vertices, GL_STATIC_DRAW);
+	MemoryAccounting::instance().allocate(MemoryAccounting::SPRITES, MemoryAccounting::GPU, spritesheet->getFilename(), 24 * sizeof(float));
 	posLocation = program->bindVertexAttribute("position", 2, 4 * sizeof(float), 0);
 	texCoordLocation = program->bindVertexAttribute("texCoord", 2, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 	texture = spritesheet;
@@ -53,16 +56,17 @@ void Sprite::render() const
 	shaderProgram->setUniform2f("texCoordDispl", texCoordDispl.x, texCoordDispl.y);
 	glEnable(GL_TEXTURE_2D);
 	texture->use();
-	glBindVertexArray(vao);
+	RenderStats::instance().bindVertexArray(vao);
 	glEnableVertexAttribArray(posLocation);
 	glEnableVertexAttribArray(texCoordLocation);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	RenderStats::instance().drawArrays(GL_TRIANGLES, 0, 6);
 	glDisable(GL_TEXTURE_2D);
 }
 
 void Sprite::free()
 {
 	glDeleteBuffers(1, &vbo);
+	MemoryAccounting::instance().release(MemoryAccounting::SPRITES, MemoryAccounting::GPU, texture->getFilename(), 24 * sizeof(float));
 }
 
 void Sprite::setNumberAnimations(int nAnimations)
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cmath>
+#include "Sweep.h"
+
+
+using namespace std;
+
+
+bool sweepAABB(const glm::vec2& minA, const glm::vec2& maxA, const glm::vec2& delta, const glm::vec2& minB, const glm::vec2& maxB, SweepHit& hit)
+{
+	float enter = 0.f, exit = 1.f;
+	glm::vec2 normal(0.f);
+
+	// Intersect the intervals of time in which both axes overlap
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (delta[axis] == 0.f)
+		{
+			if (maxA[axis] <= minB[axis] || minA[axis] >= maxB[axis])
+				return false;
+			continue;
+		}
+
+		float t0 = (minB[axis] - maxA[axis]) / delta[axis];
+		float t1 = (maxB[axis] - minA[axis]) / delta[axis];
+		if (t0 > t1)
+			swap(t0, t1);
+
+		if (t0 > enter)
+		{
+			enter = t0;
+			normal = glm::vec2(0.f);
+			normal[axis] = (delta[axis] > 0.f) ? -1.f : 1.f;
+		}
+		exit = min(exit, t1);
+		if (enter >= exit)
+			return false;
+	}
+
+	// Already overlapping, push back against the main direction of movement
+	if (normal == glm::vec2(0.f))
+	{
+		int axis = (abs(delta.x) >= abs(delta.y)) ? 0 : 1;
+		normal[axis] = (delta[axis] > 0.f) ? -1.f : 1.f;
+	}
+
+	hit.time = enter;
+	hit.normal = normal;
+	return true;
+}
@@ -0,0 +1,29 @@
+#ifndef _SWEEP_INCLUDE
+#define _SWEEP_INCLUDE
+
+
+#include <glm/glm.hpp>
+
+
+#define SWEEP_SKIN 0.001f		// Gap left when stopping against a tile
+
+
+// Result of moving a box along a segment: the fraction of the movement
+// done before the contact (time of impact) and the normal of the surface
+// that was hit, pointing towards the moving box.
+
+struct SweepHit
+{
+	float time;
+	glm::vec2 normal;
+};
+
+
+// Moves the box [minA, maxA] by delta against the static box [minB, maxB].
+// Boxes that already overlap are hit at time 0, with the normal opposing
+// the movement. Boxes that only touch do not collide.
+
+bool sweepAABB(const glm::vec2& minA, const glm::vec2& maxA, const glm::vec2& delta, const glm::vec2& minB, const glm::vec2& maxB, SweepHit& hit);
+
+
+#endif // _SWEEP_INCLUDE
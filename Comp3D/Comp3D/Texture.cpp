@@ -1,6 +1,9 @@
 #include <iostream>
 #include <SOIL.h>
 #include "Texture.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
 
 
 using namespace std;
@@ -12,44 +15,113 @@ Texture::Texture()
 	wrapT = GL_REPEAT;
 	minFilter = GL_LINEAR_MIPMAP_LINEAR;
 	magFilter = GL_LINEAR;
+	pixels = NULL;
+	texId = 0;
+	textureBytes = 0;
+}
+
+Texture::~Texture()
+{
+	free();
 }
 
 
 bool Texture::loadFromFile(const string &filename, PixelFormat format)
 {
-	unsigned char *image = NULL;
-	
+	return decodeFile(filename, format) && upload();
+}
+
+bool Texture::decodeFile(const string &filename, PixelFormat format)
+{
+	PROFILE_ZONE("Texture::decodeFile");
+
+	// The image waiting for upload is replaced, the texture is kept until then
+	freePixels();
 	switch(format)
 	{
 	case TEXTURE_PIXEL_FORMAT_RGB:
-		image = SOIL_load_image(filename.c_str(), &widthTex, &heightTex, 0, SOIL_LOAD_RGB);
+		pixels = SOIL_load_image(filename.c_str(), &widthTex, &heightTex, 0, SOIL_LOAD_RGB);
 		break;
 	case TEXTURE_PIXEL_FORMAT_RGBA:
-		image = SOIL_load_image(filename.c_str(), &widthTex, &heightTex, 0, SOIL_LOAD_RGBA);
+		pixels = SOIL_load_image(filename.c_str(), &widthTex, &heightTex, 0, SOIL_LOAD_RGBA);
 		break;
 	}
-	if(image == NULL)
+	pixelFormat = format;
+	this->filename = filename;
+	if (pixels != NULL)
+		MemoryAccounting::instance().allocate(MemoryAccounting::TEXTURES, MemoryAccounting::CPU, filename, imageBytes());
+
+	return pixels != NULL;
+}
+
+bool Texture::upload()
+{
+	PROFILE_ZONE("Texture::upload");
+
+	if(pixels == NULL)
 		return false;
+	deleteTexture();
 	glGenTextures(1, &texId);
-	glBindTexture(GL_TEXTURE_2D, texId);
-	switch(format)
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
+	switch(pixelFormat)
 	{
 	case TEXTURE_PIXEL_FORMAT_RGB:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widthTex, heightTex, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widthTex, heightTex, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
 		break;
 	case TEXTURE_PIXEL_FORMAT_RGBA:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthTex, heightTex, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthTex, heightTex, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 		break;
 	}
 	glGenerateMipmap(GL_TEXTURE_2D);
+	// The mipmaps add a third
+	textureFile = filename;
+	textureBytes = imageBytes() * 4 / 3;
+	MemoryAccounting::instance().allocate(MemoryAccounting::TEXTURES, MemoryAccounting::GPU, textureFile, textureBytes);
+
+	// OpenGL keeps its own copy
+	freePixels();
 	
 	return true;
 }
 
+void Texture::free()
+{
+	freePixels();
+	deleteTexture();
+}
+
+void Texture::freePixels()
+{
+	if (pixels == NULL)
+		return;
+	SOIL_free_image_data(pixels);
+	pixels = NULL;
+	MemoryAccounting::instance().release(MemoryAccounting::TEXTURES, MemoryAccounting::CPU, filename, imageBytes());
+}
+
+// Textures are only created in the main thread, with OpenGL, so the ones
+// of the headless build have nothing to delete
+
+void Texture::deleteTexture()
+{
+	if (texId == 0)
+		return;
+	glDeleteTextures(1, &texId);
+	texId = 0;
+	MemoryAccounting::instance().release(MemoryAccounting::TEXTURES, MemoryAccounting::GPU, textureFile, textureBytes);
+	textureBytes = 0;
+}
+
+size_t Texture::imageBytes() const
+{
+	return size_t(widthTex) * heightTex * ((pixelFormat == TEXTURE_PIXEL_FORMAT_RGBA) ? 4 : 3);
+}
+
 void Texture::loadFromGlyphBuffer(unsigned char *buffer, int width, int height)
 {
+	deleteTexture();
 	glGenTextures(1, &texId);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, buffer);
 	glGenerateMipmap(GL_TEXTURE_2D);
@@ -58,8 +130,9 @@ void Texture::loadFromGlyphBuffer(unsigned char *buffer, int width, int height)
 
 void Texture::createEmptyTexture(int width, int height)
 {
+	deleteTexture();
 	glGenTextures(1, &texId);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -67,7 +140,7 @@ void Texture::createEmptyTexture(int width, int height)
 
 void Texture::loadSubtextureFromGlyphBuffer(unsigned char *buffer, int x, int y, int width, int height)
 {
-	glBindTexture(GL_TEXTURE_2D, texId);
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_UNSIGNED_BYTE, buffer);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -75,7 +148,7 @@ void Texture::loadSubtextureFromGlyphBuffer(unsigned char *buffer, int x, int y,
 
 void Texture::generateMipmap()
 {
-	glBindTexture(GL_TEXTURE_2D, texId);
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glGenerateMipmap(GL_TEXTURE_2D);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -104,7 +177,7 @@ void Texture::setMagFilter(GLint value)
 void Texture::use() const
 {
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	RenderStats::instance().bindTexture(GL_TEXTURE_2D, texId);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
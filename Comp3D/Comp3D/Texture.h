@@ -13,7 +13,12 @@ enum PixelFormat {TEXTURE_PIXEL_FORMAT_RGB, TEXTURE_PIXEL_FORMAT_RGBA};
 
 
 // The texture class loads images an passes them to OpenGL
-// storing the returned id so that it may be applied to any drawn primitives
+// storing the returned id so that it may be applied to any drawn primitives.
+// Loading can also be done in two steps: decodeFile does not need OpenGL
+// and can run in any thread, upload must run in the main thread.
+// The decoded image and the texture are counted by MemoryAccounting.
+// The texture is deleted with the object, from the main thread, so it
+// cannot be copied.
 
 
 class Texture
@@ -21,8 +26,15 @@ class Texture
 
 public:
 	Texture();
+	~Texture();
+	Texture(const Texture &) = delete;
+	Texture &operator=(const Texture &) = delete;
 
 	bool loadFromFile(const string &filename, PixelFormat format);
+	bool decodeFile(const string &filename, PixelFormat format);
+	bool upload();
+	// Frees the decoded image and deletes the texture
+	void free();
 	void loadFromGlyphBuffer(unsigned char *buffer, int width, int height);
 
 	void createEmptyTexture(int width, int height);
@@ -38,10 +50,21 @@ public:
 	
 	int width() const { return widthTex; }
 	int height() const { return heightTex; }
+	const string &getFilename() const { return filename; }
 
 private:
+	size_t imageBytes() const;
+	void freePixels();
+	void deleteTexture();
+
+private:
+	string filename;
 	int widthTex, heightTex;
+	unsigned char *pixels;
+	PixelFormat pixelFormat;
 	GLuint texId;
+	string textureFile;					// The texture counted in MemoryAccounting, if any
+	size_t textureBytes;
 	GLint wrapS, wrapT, minFilter, magFilter;
 
 };
@@ -1,10 +1,12 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
+#include <cstring>
 #include "TileMap.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "PlayGameState.h"
+#include "JobSystem.h"
+#include "LevelArena.h"
+#include "Profiler.h"
 #include <math.h>
 
 
@@ -15,33 +17,41 @@ using namespace std;
 
 TileMap* TileMap::createTileMap(const string& levelFile, const glm::vec2& minCoords, ShaderProgram& program)
 {
-	TileMap* map = new TileMap(levelFile, minCoords, program);
+	TileMap* map = LevelArena::instance().create<TileMap>(levelFile, minCoords, program);
 	return map;
 }
 
 
 TileMap::TileMap(const string& levelFile, const glm::vec2& minCoords, ShaderProgram& program)
 {
+	map = NULL;
+	pager = NULL;
 	loadLevel(levelFile, program);
 	currentTime = 0.0f;
 
 	// Init Sound
-	checkpoint_sound = SoundManager::instance().loadSound("sounds/checkpoint.mp3", FMOD_DEFAULT);
-	chain_sound = SoundManager::instance().loadSound("sounds/chain.mp3", FMOD_DEFAULT);
-	key_sound = SoundManager::instance().loadSound("sounds/key.mp3", FMOD_DEFAULT);
-	death_sound = SoundManager::instance().loadSound("sounds/death.mp3", FMOD_DEFAULT);
-	basic_sound = SoundManager::instance().loadSound("sounds/basic.mp3", FMOD_DEFAULT);
+	// Voices, cooldown (ms) and priority, see Player::init
+	checkpoint_sound = SoundManager::instance().loadSound("sounds/checkpoint.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(1, 250, 96));
+	chain_sound = SoundManager::instance().loadSound("sounds/chain.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 60, 128));
+	key_sound = SoundManager::instance().loadSound("sounds/key.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(1, 100, 64));
+	death_sound = SoundManager::instance().loadSound("sounds/death.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(1, 250, 32));
+	basic_sound = SoundManager::instance().loadSound("sounds/basic.mp3", SoundManager::ONCE, SoundManager::VoiceLimits(2, 40, 192));
 }
 
 TileMap::~TileMap()
 {
-	if (map != NULL)
-		delete map;
+	// The tiles, the pager and the models belong to the level arena
+	SoundManager::instance().releaseSound(checkpoint_sound);
+	SoundManager::instance().releaseSound(chain_sound);
+	SoundManager::instance().releaseSound(key_sound);
+	SoundManager::instance().releaseSound(death_sound);
+	SoundManager::instance().releaseSound(basic_sound);
 }
 
 
-void TileMap::render(ShaderProgram& program, const glm::ivec3& posPlayer)
+void TileMap::addToSnapshot(RenderSnapshot& snapshot, const glm::ivec3& posPlayer)
 {
+	PROFILE_ZONE("TileMap::addToSnapshot");
 
 	glm::mat4 modelMatrix;
 	//glm::mat3 normalMatrix;
@@ -50,58 +60,58 @@ void TileMap::render(ShaderProgram& program, const glm::ivec3& posPlayer)
 
 	char tile;
 
-	for (int j = 0; j < mapSize.y; j++)
+	// Only the tiles near the player are visited, not the whole map
+	int rangeX = int(movementCamera.x + 2), rangeY = int(movementCamera.y + 2);
+	int i0 = max(0, posPlayer.x - rangeX), i1 = min(mapSize.x - 1, posPlayer.x + rangeX);
+	int j0 = max(0, posPlayer.y - rangeY), j1 = min(mapSize.y - 1, posPlayer.y + rangeY);
+
+	for (int j = j0; j <= j1; j++)
 	{
-		for (int i = 0; i < mapSize.x; i++)
+		for (int i = i0; i <= i1; i++)
 		{
-			if (abs(i - posPlayer.x) <= movementCamera.x+2 && abs(j - posPlayer.y) <= movementCamera.y+2)
+			tile = getTile(j * mapSize.x + i);
+			if (tile != ' ' && tile != 'x')
 			{
+				unordered_map<char, AssimpModel*>::const_iterator it = models.find(tile);
+
+				// Si el model encara no ha estat creat (millor fer-ho abans)
+				/*if (it == models.end()) {
+					AssimpModel* new_model = new AssimpModel();
+					string path = (paths->find(tile))->second;
+					new_model->loadFromFile(path, program);
+					models.insert(pair<char, AssimpModel*>(tile, new_model));
+					it = models.find(tile);
+				}*/
+
+				// Es renderitza el model a la posici corresponent
+				modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(i, -j, 0.f));
+				if (it->first == 'j' || it->first == 'q' || it->first == '2' || it->first == '3' || it->first == '4' || it->first == '5') {
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(0.f, 0.25f, 0.f));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, -0.5));
+					modelMatrix = glm::rotate(modelMatrix, float((M_PI / 4.0f)), glm::vec3(-1, 0, 0));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, 0.5));
+				}
+				else if (it->first == '6' || it->first == '7' || it->first == '8' || it->first == '9' || it->first == '(' || it->first == ')') {
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.35f, 0.f, 0.f));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, -0.5));
+					modelMatrix = glm::rotate(modelMatrix, float((M_PI / 5.0f)), glm::vec3(0, -1, 0));
+					modelMatrix = glm::rotate(modelMatrix, float((M_PI / 2.0f)), glm::vec3(0, 0, -1));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, 0.5));
+				}
+				if (it->first == '5' || it->first == ')') {
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, 0.5));
+					modelMatrix = glm::rotate(modelMatrix, float((M_PI / 2.0f) * 2), glm::vec3(0, 0, 1));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, -0.5));
+				}
 
-				tile = map[j * mapSize.x + i];
-				if (tile != ' ' && tile != 'x')
-				{
-					unordered_map<char, AssimpModel*>::const_iterator it = models.find(tile);
-
-					// Si el model encara no ha estat creat (millor fer-ho abans)
-					/*if (it == models.end()) {
-						AssimpModel* new_model = new AssimpModel();
-						string path = (paths->find(tile))->second;
-						new_model->loadFromFile(path, program);
-						models.insert(pair<char, AssimpModel*>(tile, new_model));
-						it = models.find(tile);
-					}*/
-
-					// Es renderitza el model a la posici corresponent
-					modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(i, -j, 0.f));
-					if (it->first == 'j' || it->first == 'q' || it->first == '2' || it->first == '3' || it->first == '4' || it->first == '5') {
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(0.f, 0.25f, 0.f));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, -0.5));
-						modelMatrix = glm::rotate(modelMatrix, float((M_PI / 4.0f)), glm::vec3(-1, 0, 0));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, 0.5));
-					}
-					else if (it->first == '6' || it->first == '7' || it->first == '8' || it->first == '9' || it->first == '(' || it->first == ')') {
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.35f, 0.f, 0.f));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, -0.5));
-						modelMatrix = glm::rotate(modelMatrix, float((M_PI / 5.0f)), glm::vec3(0, -1, 0));
-						modelMatrix = glm::rotate(modelMatrix, float((M_PI / 2.0f)), glm::vec3(0, 0, -1));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, 0.5));
-					}
-					if (it->first == '5' || it->first == ')') {
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, 0.5));
-						modelMatrix = glm::rotate(modelMatrix, float((M_PI / 2.0f) * 2), glm::vec3(0, 0, 1));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, -0.5));
-					}
-
-					if (it->first == 'f') {
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, 0.5));
-						float miau = 0.9 + 0.2*sin(6.275 * currentTime);
-						modelMatrix = glm::scale(modelMatrix, glm::vec3(miau, miau, 1));
-						modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, -0.5));
-					}
-
-					program.setUniformMatrix4f("model", modelMatrix);
-					it->second->render(program);
+				if (it->first == 'f') {
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(0.5, -0.5, 0.5));
+					float miau = 0.9 + 0.2*sin(6.275 * currentTime);
+					modelMatrix = glm::scale(modelMatrix, glm::vec3(miau, miau, 1));
+					modelMatrix = glm::translate(modelMatrix, glm::vec3(-0.5, 0.5, -0.5));
 				}
+
+				snapshot.addModel(it->second, modelMatrix);
 			}
 		}
 	}
@@ -111,6 +121,18 @@ void TileMap::render(ShaderProgram& program, const glm::ivec3& posPlayer)
 void TileMap::update(int deltaTime)
 {
 	currentTime += deltaTime;
+
+	if (pager != NULL)
+		pager->update();
+}
+
+// Keeps the pages of the room around the given tile resident, plus one
+// room in every direction so that camera transitions find them loaded
+
+void TileMap::setFocus(const glm::ivec2& tile)
+{
+	if (pager != NULL)
+		pager->setFocus(tile, glm::ivec2(roomSize) + glm::ivec2(movementCamera) + 2);
 }
 
 void TileMap::free()
@@ -120,37 +142,22 @@ void TileMap::free()
 
 bool TileMap::loadLevel(const string& levelFile, ShaderProgram& program)
 {
-	ifstream fin;
-	string line, tilesheetFile;
-	stringstream sstream;
-	char tile;
+	PROFILE_ZONE("TileMap::loadLevel");
+	LevelFile file;
+	const char* row;
 
-	fin.open(levelFile.c_str());
-	if (!fin.is_open())
-		return false;
-	getline(fin, line);
-	if (line.compare(0, 7, "TILEMAP") != 0)
+	// Shipped levels are binary, the text file is only read when there is none
+	// or it was edited after the conversion
+	if (!file.open(LevelFile::binaryPath(levelFile), levelFile) && !file.open(levelFile))
 		return false;
-	getline(fin, line);
-	sstream.str(line);
-	sstream >> mapSize.x >> mapSize.y;
-	getline(fin, line);
-	sstream.str(line);
-	sstream >> roomSize.x >> roomSize.y;
-	getline(fin, line);
-	sstream.str(line);
-	sstream >> centerCamera.x >> centerCamera.y >> centerCamera.z;
-	getline(fin, line);
-	sstream.str(line);
-	sstream >> movementCamera.x >> movementCamera.y;
-	getline(fin, line);
-	sstream.str(line);
-	sstream >> checkpointPlayer.x >> checkpointPlayer.y >> checkpointPlayer.z;
-	getline(fin, line);
-
-	style;
-	sstream.str(line);
-	sstream >> style;
+
+	LevelData& level = file.getLevel();
+	mapSize = level.mapSize;
+	roomSize = level.roomSize;
+	centerCamera = level.centerCamera;
+	movementCamera = level.movementCamera;
+	style = level.style;
+
 	switch (style)
 	{
 	case 0:
@@ -176,142 +183,49 @@ bool TileMap::loadLevel(const string& levelFile, ShaderProgram& program)
 		break;
 	}
 	
-	map = new char[mapSize.x * mapSize.y];
+	if (mapSize.x * mapSize.y >= TILEMAP_PAGED_MIN_TILES)
+	{
+		pager = LevelArena::instance().create<TilePager>();
+		// Tiles that are not paged in yet block like walls
+		if (!pager->create(mapSize, '1'))
+		{
+			pager = NULL;
+			return false;
+		}
+	}
+	else
+		map = LevelArena::instance().createArray<char>(mapSize.x * mapSize.y);
+
 	for (int j = 0; j < mapSize.y; j++)
 	{
-		for (int i = 0; i < mapSize.x; i++)
+		row = file.readRow();
+		if (row == NULL)
+			return false;
+
+		if (pager != NULL)
 		{
-			fin.get(tile);
-
-			switch (tile) {
-
-				case('0'):
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('$'):
-					checkpointPlayer = glm::vec3(i, j, 0);
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('v'): {		// easy vertical wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = true;
-					wall.type = 0;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('V'): {		// hard vertical wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = true;
-					wall.type = 1;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('|'): {		// impossible vertical wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = true;
-					wall.type = 2;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('h'): {		// easy horizontal wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = false;
-					wall.type = 0;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('H'): {		// hard horizontal wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = false;
-					wall.type = 1;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('-'): {		// impossible horizontal wall
-					Wall wall;
-					wall.position = glm::vec2(i, j);
-					wall.bVertical = false;
-					wall.type = 2;
-					walls.push_back(wall);
-					map[j * mapSize.x + i] = ' ';
-					break; }
-
-				case('o'):			// easy vertical ballSpike
-					ballSpikes.push_back({ true, glm::vec2(i, j) });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('O'):			// horizontal ballSpike
-					ballSpikes.push_back({ false, glm::vec2(i, j) });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('d'):		// door
-				case('j'):		// chain
-				case('q'):		// lock
-				case('2'):
-				case('3'):
-				case('6'):
-				case('7'):
-				case('8'):
-				case('9'):
-					map[j * mapSize.x + i] = tile;
-					doors.push_back(j * mapSize.x + i);
-					break;
-
-				case('U'):		// button up
-					buttons.push_back({ false, glm::vec2(i, j), up });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('D'):		// button down
-					buttons.push_back({ false, glm::vec2(i, j), down });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('R'):		// button right
-					buttons.push_back({ false, glm::vec2(i, j), right });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('L'):		// button left
-					buttons.push_back({ false, glm::vec2(i, j), left });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('y'):		// yes swicth
-					switchs.push_back({ true, glm::vec2(i, j) });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				case('n'):		// no switch
-					switchs.push_back({ false, glm::vec2(i, j) });
-					map[j * mapSize.x + i] = ' ';
-					break;
-
-				default:
-					map[j * mapSize.x + i] = tile;
-					break;
-			}
+			for (int i = 0; i < mapSize.x; i++)
+				pager->set(i, j, row[i]);
+			pager->rowsWritten(j + 1);
 		}
-		fin.get(tile);
-#ifndef _WIN32
-		fin.get(tile);
-#endif
+		else
+			memcpy(map + j * mapSize.x, row, mapSize.x);
+	}
+
+	// Text levels only know all their entities after the last row
+	checkpointPlayer = level.checkpointPlayer;
+	walls.swap(level.walls);
+	ballSpikes.swap(level.ballSpikes);
+	buttons.swap(level.buttons);
+	switchs.swap(level.switchs);
+	doors.swap(level.doors);
+	lastCheckpoint = level.lastCheckpoint;
+
+	if (pager != NULL)
+	{
+		setFocus(glm::ivec2(centerCamera.x, -centerCamera.y));
+		pager->update(TILE_PAGE_SLOTS);
 	}
-	fin.close();
 
 	return true;
 }
@@ -323,64 +237,103 @@ bool TileMap::loadLevel(const string& levelFile, ShaderProgram& program)
 
 bool TileMap::collisionMoveLeft(const glm::ivec3& pos, const glm::ivec3& size, int type)
 {
-	int x, y0, y1;
+	return collisionColumn(pos.x, pos.y, pos.y + size.y, type);
+}
 
-	x = pos.x;
-	y0 = pos.y;
-	y1 = (pos.y + size.y);
-	for (int y = y0; y <= y1; y++)
+bool TileMap::collisionMoveRight(const glm::ivec3& pos, const glm::ivec3& size, int type)
+{
+	// tileSize  == 1
+	return collisionColumn(pos.x + size.x, pos.y, pos.y + size.y, type);
+}
+
+
+bool TileMap::collisionMoveDown(const glm::ivec3& pos, const glm::ivec3& size, int type)
+{
+	return collisionRow(pos.y + size.y, pos.x, pos.x + size.x, type);
+}
+
+bool TileMap::collisionMoveUp(const glm::ivec3& pos, const glm::ivec3& size, int type)
+{
+	return collisionRow(pos.y, pos.x, pos.x + size.x, type);
+}
+
+
+// Swept versions of the collision tests. The box moves delta along one axis
+// and every column (or row) it enters is tested in order, so a big delta
+// cannot jump over a tile. On a collision hit tells how much of delta can be
+// done before touching the tile.
+
+bool TileMap::sweepX(const glm::vec3& pos, const glm::vec3& size, float delta, SweepHit& hit, int type)
+{
+	float edge = (delta > 0) ? pos.x + size.x : pos.x;
+	int step = (delta > 0) ? 1 : -1;
+	int first = edge, last = edge + delta;
+
+	if (delta == 0.f)
+		return false;
+
+	for (int x = first; x != last + step; x += step)
 	{
-		if (map[y * mapSize.x + x] != ' ')
-			return treatCollision(y * mapSize.x + x, type);
+		if (collisionColumn(x, pos.y, pos.y + size.y, type))
+		{
+			float border = (delta > 0) ? x - SWEEP_SKIN : x + 1;
+			hit.time = glm::clamp((border - edge) / delta, 0.f, 1.f);
+			hit.normal = glm::vec2(-step, 0);
+			return true;
+		}
 	}
 
 	return false;
 }
 
-bool TileMap::collisionMoveRight(const glm::ivec3& pos, const glm::ivec3& size, int type)
+bool TileMap::sweepY(const glm::vec3& pos, const glm::vec3& size, float delta, SweepHit& hit, int type)
 {
-	int x, y0, y1;
+	float edge = (delta > 0) ? pos.y + size.y : pos.y;
+	int step = (delta > 0) ? 1 : -1;
+	int first = edge, last = edge + delta;
 
-	// tileSize  == 1
-	x = (pos.x + size.x);
-	y0 = pos.y;
-	y1 = (pos.y + size.y);
-	for (int y = y0; y <= y1; y++)
+	if (delta == 0.f)
+		return false;
+
+	for (int y = first; y != last + step; y += step)
 	{
-		if (map[y * mapSize.x + x] != ' ')
-			return treatCollision(y * mapSize.x + x, type);
+		if (collisionRow(y, pos.x, pos.x + size.x, type))
+		{
+			float border = (delta > 0) ? y - SWEEP_SKIN : y + 1;
+			hit.time = glm::clamp((border - edge) / delta, 0.f, 1.f);
+			hit.normal = glm::vec2(0, -step);
+			return true;
+		}
 	}
 
 	return false;
 }
 
+// The first tile found in the column decides, like it always did.
+// Outside of the map everything is solid.
 
-bool TileMap::collisionMoveDown(const glm::ivec3& pos, const glm::ivec3& size, int type)
+bool TileMap::collisionColumn(int x, int y0, int y1, int type)
 {
-	int x0, x1, y;
+	if (x < 0 || x >= mapSize.x)
+		return true;
 
-	x0 = pos.x;
-	x1 = (pos.x + size.x);
-	y = (pos.y + size.y);
-	for (int x = x0; x <= x1; x++)
+	for (int y = glm::max(y0, 0); y <= glm::min(y1, mapSize.y - 1); y++)
 	{
-		if (map[y * mapSize.x + x] != ' ')
+		if (getTile(y * mapSize.x + x) != ' ')
 			return treatCollision(y * mapSize.x + x, type);
 	}
 
 	return false;
 }
 
-bool TileMap::collisionMoveUp(const glm::ivec3& pos, const glm::ivec3& size, int type)
+bool TileMap::collisionRow(int y, int x0, int x1, int type)
 {
-	int x0, x1, y;
+	if (y < 0 || y >= mapSize.y)
+		return true;
 
-	x0 = pos.x;
-	x1 = (pos.x + size.x);
-	y = pos.y;
-	for (int x = x0; x <= x1; x++)
+	for (int x = glm::max(x0, 0); x <= glm::min(x1, mapSize.x - 1); x++)
 	{
-		if (map[y * mapSize.x + x] != ' ')
+		if (getTile(y * mapSize.x + x) != ' ')
 			return treatCollision(y * mapSize.x + x, type);
 	}
 
@@ -415,12 +368,12 @@ int TileMap::checkBlock(int block)
 
 bool TileMap::treatCollision(int pos, int type)
 {
-	int block = checkBlock(map[pos]);
+	int block = checkBlock(getTile(pos));
 
 	if (block == basic)
 	{
 		if (type == 1) {
-			channel = SoundManager::instance().playSound(basic_sound);
+			events->playSound(basic_sound);
 		}
 		return true;
 	}
@@ -428,36 +381,37 @@ bool TileMap::treatCollision(int pos, int type)
 	{
 		if (type == 1)
 		{
-			map[pos] = ' ';
+			setTile(pos, ' ');
 			for (int i = 0; i < doors.size(); ++i) {
-				if (map[doors[i]] == '2')
-					map[doors[i]] = '4';
-				else if (map[doors[i]] == '3')
-					map[doors[i]] = '5';
-				else if (map[doors[i]] == '6')
-					map[doors[i]] = '(';
-				else if (map[doors[i]] == '9')
-					map[doors[i]] = ')';
+				char door = getTileExact(doors[i]);
+				if (door == '2')
+					setTile(doors[i], '4');
+				else if (door == '3')
+					setTile(doors[i], '5');
+				else if (door == '6')
+					setTile(doors[i], '(');
+				else if (door == '9')
+					setTile(doors[i], ')');
 				else
-					map[doors[i]] = ' ';
+					setTile(doors[i], ' ');
 			}
-			channel = SoundManager::instance().playSound(key_sound);
-			channel->setVolume(5.0f);
+			events->emit(GameEvent::KEY, pos);
+			events->playSound(key_sound, 5.0f);
 		}
 		return false;
 	}
 	else if (block == fin)
 	{
 		if (type == 1) {
-			PlayGameState::instance().startFade();
-			channel = SoundManager::instance().playSound(checkpoint_sound);
+			events->emit(GameEvent::LEVEL_END, pos);
+			events->playSound(checkpoint_sound);
 		}
 		return false;
 	}
 	else if (block == door)
 	{
 		if (type == 1)
-			channel = SoundManager::instance().playSound(chain_sound);
+			events->playSound(chain_sound);
 		return true;
 	}
 	else if (block == broken_chain)
@@ -472,22 +426,22 @@ bool TileMap::treatCollision(int pos, int type)
 	{
 		if (!PlayGameState::instance().getGodMode() && type == 1)
 		{
-			channel = SoundManager::instance().playSound(death_sound);
-			bPlayerDead = true;
+			events->emit(GameEvent::DEATH, pos);
+			events->playSound(death_sound);
 			return false;
 		}	
 	}
 	else if (block == checkpoint)
 	{
 		if (type == 1) {
-			channel = SoundManager::instance().playSound(checkpoint_sound);
-			bNewCheckPoint = true;
-			for (int j = 0; j < mapSize.y; j++)
-				for (int i = 0; i < mapSize.x; i++)
-					if (map[j * mapSize.x + i] == 'C')
-						map[j * mapSize.x + i] = ' ';
+			events->emit(GameEvent::CHECKPOINT, pos);
+			events->playSound(checkpoint_sound);
+			// Only one checkpoint can be active
+			if (lastCheckpoint >= 0 && getTileExact(lastCheckpoint) == 'C')
+				setTile(lastCheckpoint, ' ');
 
-			map[pos] = 'C';
+			setTile(pos, 'C');
+			lastCheckpoint = pos;
 
 			checkpointPlayer.y = pos / mapSize.x;
 			checkpointPlayer.x = pos % mapSize.x;
@@ -500,27 +454,29 @@ bool TileMap::treatCollision(int pos, int type)
 	}
 	else if (block == x_space)
 	{
-		if (map[pos + 1] == 'c')
+		if (getTile(pos + 1) == 'c')
 			return treatCollision(pos + 1, type);
-		else if (map[pos - 1] == 'c')
+		else if (getTile(pos - 1) == 'c')
 			return treatCollision(pos - 1, type);
 
-		if (map[pos + mapSize.x] == 'c')
+		if (getTile(pos + mapSize.x) == 'c')
 			return treatCollision(pos + mapSize.x, type);
-		else if (map[pos + mapSize.x + 1] == 'c')
+		else if (getTile(pos + mapSize.x + 1) == 'c')
 			return treatCollision(pos + mapSize.x + 1, type);
-		else if (map[pos + mapSize.x - 1] == 'c')
+		else if (getTile(pos + mapSize.x - 1) == 'c')
 			return treatCollision(pos + mapSize.x - 1, type);
 
-		else if (map[pos - mapSize.x] == 'c')
+		else if (getTile(pos - mapSize.x) == 'c')
 			return treatCollision(pos - mapSize.x, type);
-		else if (map[pos - mapSize.x + 1] == 'c')
+		else if (getTile(pos - mapSize.x + 1) == 'c')
 			return treatCollision(pos - mapSize.x + 1, type);
-		else if (map[pos - mapSize.x - 1] == 'c')
+		else if (getTile(pos - mapSize.x - 1) == 'c')
 			return treatCollision(pos - mapSize.x - 1, type);
 
-		else
-			map[pos] = ' ';
+		// Walls and ball spikes collide from the job threads, only the
+		// player clears the tile
+		else if (type == 1)
+			setTile(pos, ' ');
 		return false;
 	}
 
@@ -534,14 +490,14 @@ bool TileMap::lineCollision(glm::vec3 &pos, glm::vec3 size, bool vertical)
 	bool c1, c2;
 
 	if (vertical) {
-		c1 = map[y0 * mapSize.x + x0] == 'm' && map[y0 * mapSize.x + x1] == 'm';
-		c2 = map[y1 * mapSize.x + x0] == 'm' && map[y1 * mapSize.x + x1] == 'm';
+		c1 = getTile(y0 * mapSize.x + x0) == 'm' && getTile(y0 * mapSize.x + x1) == 'm';
+		c2 = getTile(y1 * mapSize.x + x0) == 'm' && getTile(y1 * mapSize.x + x1) == 'm';
 		if (c1 || c2)
 			pos = glm::vec3(floor(x0), pos.y, pos.z);
 	}
 	else {
-		c1 = map[y0 * mapSize.x + x0] == 'l' && map[y1 * mapSize.x + x0] == 'l';
-		c2 = map[y0 * mapSize.x + x1] == 'l' && map[y1 * mapSize.x + x1] == 'l';
+		c1 = getTile(y0 * mapSize.x + x0) == 'l' && getTile(y1 * mapSize.x + x0) == 'l';
+		c2 = getTile(y0 * mapSize.x + x1) == 'l' && getTile(y1 * mapSize.x + x1) == 'l';
 		if (c1 || c2)
 			pos = glm::vec3(pos.x, floor(y0), pos.z);
 	}
@@ -551,34 +507,29 @@ bool TileMap::lineCollision(glm::vec3 &pos, glm::vec3 size, bool vertical)
 
 /// END COLLISION
 
-vector<TileMap::Wall> TileMap::getWalls()
+const vector<TileMap::Wall> &TileMap::getWalls() const
 {
 	return walls;
 }
 
-vector<tuple<bool, glm::vec2, int>> TileMap::getButtons() const
+const vector<tuple<bool, glm::vec2, int>> &TileMap::getButtons() const
 {
 	return buttons;
 }
 
-vector<pair<bool, glm::vec2>> TileMap::getSwitchs() const
+const vector<pair<bool, glm::vec2>> &TileMap::getSwitchs() const
 {
 	return switchs;
 }
 
-vector<pair<bool, glm::vec2>> TileMap::getBallSpikes() const
+const vector<pair<bool, glm::vec2>> &TileMap::getBallSpikes() const
 {
 	return ballSpikes;
 }
 
-bool TileMap::getPlayerDead()
-{
-	return bPlayerDead;
-}
-
-void TileMap::setPlayerDead(bool bDead)
+void TileMap::setEventBus(EventBus* eventBus)
 {
-	bPlayerDead = bDead;
+	events = eventBus;
 }
 
 
@@ -597,16 +548,6 @@ glm::vec3 TileMap::getCheckPointPlayer()
 	return checkpointPlayer;
 }
 
-bool TileMap::getNewCheckPoint()
-{
-	return bNewCheckPoint;
-}
-
-void TileMap::setNewCheckPoint(bool b)
-{
-	bNewCheckPoint = b;
-}
-
 
 glm::vec2 TileMap::getRoomSize()
 {
@@ -624,13 +565,27 @@ int TileMap::getStyle()
 	return style;
 }
 
+// Models are parsed in parallel, each one is uploaded by the main thread
+// as soon as it is ready
+
 void TileMap::loadModels(const unordered_map<char, string>& paths, ShaderProgram& program)
 {
-	for (auto const& x : paths)
-	{
-		AssimpModel* new_model = new AssimpModel();
-		string path = x.second;
-		new_model->loadFromFile(x.second, program);
-		models[x.first] = new_model;
-	}
+	vector<pair<char, string>> files(paths.begin(), paths.end());
+	vector<AssimpModel*> newModels(files.size());
+
+	for (int i = 0; i < files.size(); ++i)
+		newModels[i] = LevelArena::instance().create<AssimpModel>();
+
+	JobSystem::instance().parallelFor(files.size(), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i)
+		{
+			AssimpModel* new_model = newModels[i];
+			new_model->parseFile(files[i].second);
+			JobSystem::instance().runOnMainThread([new_model, &program]() { new_model->upload(program); });
+		}
+	});
+	JobSystem::instance().runMainThreadJobs();
+
+	for (int i = 0; i < files.size(); ++i)
+		models[files[i].first] = newModels[i];
 }
\ No newline at end of file
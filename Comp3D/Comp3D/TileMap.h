@@ -8,13 +8,24 @@
 #include "ShaderProgram.h"
 #include "AssimpModel.h"
 #include "SoundManager.h"
+#include "TilePager.h"
+#include "LevelFile.h"
+#include "Sweep.h"
+#include "RenderSnapshot.h"
+#include "EventBus.h"
 #include <tuple>
 
 
+#define TILEMAP_PAGED_MIN_TILES (512 * 512)	// Bigger maps are paged from disk
+
+
 // Class Tilemap is capable of loading a tile map from a text file in a very
-// simple format (see level01.txt for an example). With this information
+// simple format (see level01.txt for an example), or from the binary file
+// converted from it (see LevelFile). With this information
 // it builds a single VBO that contains all tiles. As a result the render
 // method draws the whole map independently of what is visible.
+// Maps with more than TILEMAP_PAGED_MIN_TILES tiles are not kept in memory,
+// they are paged around the current room by a TilePager instead.
 
 
 class TileMap
@@ -22,29 +33,30 @@ class TileMap
 
 public:
 
-	struct Wall {
-		glm::vec2 position;
-		bool bVertical;
-		int type;
-	};
+	typedef LevelWall Wall;
 
-	// Tile maps can only be created inside an OpenGL context
+	// Tile maps can only be created inside an OpenGL context, they live in the LevelArena
 	static TileMap* createTileMap(const string& levelFile, const glm::vec2& minCoords, ShaderProgram& program);
 
 	TileMap(const string& levelFile, const glm::vec2& minCoords, ShaderProgram& program);
 	~TileMap();
 
-	void render(ShaderProgram& program, const glm::ivec3& posPlayer);
+	void addToSnapshot(RenderSnapshot& snapshot, const glm::ivec3& posPlayer);
 	void update(int deltaTime);
+	void setFocus(const glm::ivec2& tile);
 	void free();
 
 	int getTileSize() const { return tileSize; }
+	glm::ivec2 getMapSize() const { return mapSize; }
 
 	bool collisionMoveLeft(const glm::ivec3& pos, const glm::ivec3& size, int type = 0);
 	bool collisionMoveRight(const glm::ivec3& pos, const glm::ivec3& size, int type = 0);
 	bool collisionMoveDown(const glm::ivec3& pos, const glm::ivec3& size, int type = 0);
 	bool collisionMoveUp(const glm::ivec3& pos, const glm::ivec3& size, int type = 0);
 
+	bool sweepX(const glm::vec3& pos, const glm::vec3& size, float delta, SweepHit& hit, int type = 0);
+	bool sweepY(const glm::vec3& pos, const glm::vec3& size, float delta, SweepHit& hit, int type = 0);
+
 	enum block
 	{
 		basic,
@@ -68,22 +80,20 @@ public:
 		right
 	};
 
-	vector<tuple<bool, glm::vec2, int>> getButtons() const;
-	vector<pair<bool, glm::vec2>> getSwitchs() const;
-	vector<pair<bool, glm::vec2>> getBallSpikes() const;
-	vector<TileMap::Wall> getWalls();
+	const vector<tuple<bool, glm::vec2, int>> &getButtons() const;
+	const vector<pair<bool, glm::vec2>> &getSwitchs() const;
+	const vector<pair<bool, glm::vec2>> &getBallSpikes() const;
+	const vector<TileMap::Wall> &getWalls() const;
 
 	bool lineCollision(glm::vec3 &pos, glm::vec3 size, bool vertical);
 
-	bool getPlayerDead();
-	void setPlayerDead(bool bDead);
+	// Sounds, deaths, keys, checkpoints and the end of the level go there
+	void setEventBus(EventBus* eventBus);
 
 	glm::vec3 getCenterCamera();
 	glm::vec2 getMovementCamera();
 
 	glm::vec3 getCheckPointPlayer();
-	bool getNewCheckPoint();
-	void setNewCheckPoint(bool b);
 
 	glm::vec2 getRoomSize();
 
@@ -96,8 +106,15 @@ private:
 	//void prepareArrays(const glm::vec2& minCoords, ShaderProgram& program);
 	int checkBlock(int block);
 	bool treatCollision(int pos, int type);
+	bool collisionColumn(int x, int y0, int y1, int type);
+	bool collisionRow(int y, int x0, int x1, int type);
 	void loadModels(const unordered_map<char, string>& paths, ShaderProgram& program);
 
+	char getTile(int pos) const { return (pager != NULL) ? pager->get(pos % mapSize.x, pos / mapSize.x) : map[pos]; }
+	// For tiles that may be far from the player, like doors and old checkpoints
+	char getTileExact(int pos) const { return (pager != NULL) ? pager->getExact(pos % mapSize.x, pos / mapSize.x) : map[pos]; }
+	void setTile(int pos, char tile) { if (pager != NULL) pager->set(pos % mapSize.x, pos / mapSize.x, tile); else map[pos] = tile; }
+
 private:
 	GLuint vao;
 	GLuint vbo;
@@ -107,6 +124,7 @@ private:
 	Texture tilesheet;
 	glm::vec2 tileTexSize;
 	char* map;
+	TilePager* pager;
 	float currentTime;
 
 	glm::vec2 roomSize;
@@ -262,23 +280,21 @@ private:
 	vector<pair<bool, glm::vec2>> ballSpikes;
 
 	vector<int> doors;
+	int lastCheckpoint = -1;
   
 	vector<tuple<bool, glm::vec2, int>> buttons;
 	vector<pair<bool, glm::vec2>> switchs;
 
-	bool bPlayerDead = false;
-	bool bNewCheckPoint = false;
+	EventBus* events = NULL;
 
 	glm::vec3 colorBackground;
 
 
-	FMOD::Sound* basic_sound;
-	FMOD::Sound* death_sound;
-	FMOD::Sound* checkpoint_sound;
-	FMOD::Sound* chain_sound;
-	FMOD::Sound* key_sound;
-
-	FMOD::Channel* channel;
+	AudioSound* basic_sound;
+	AudioSound* death_sound;
+	AudioSound* checkpoint_sound;
+	AudioSound* chain_sound;
+	AudioSound* key_sound;
 
 	int style;
 };
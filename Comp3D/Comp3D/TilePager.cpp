@@ -0,0 +1,301 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include "TilePager.h"
+
+
+using namespace std;
+
+
+// A new empty file in the temporary directory, with a name that no other
+// game running at the same time can get
+
+static string createScratchFile()
+{
+#ifdef _WIN32
+	char dir[MAX_PATH], name[MAX_PATH];
+
+	if (GetTempPathA(MAX_PATH, dir) == 0 || GetTempFileNameA(dir, "c3d", 0, name) == 0)
+		return "";
+	return name;
+#else
+	const char* dir = getenv("TMPDIR");
+	string name = string((dir != NULL && dir[0] != '\0') ? dir : "/tmp") + "/comp3d-pages-XXXXXX";
+
+	int fd = mkstemp(&name[0]);
+	if (fd < 0)
+		return "";
+	::close(fd);
+	return name;
+#endif
+}
+
+
+TilePager::TilePager()
+{
+	mapSize = glm::ivec2(0);
+	numPages = glm::ivec2(0);
+	windowOrigin = glm::ivec2(0);
+	windowSize = glm::ivec2(0);
+	for (int s = 0; s < TILE_PAGE_SLOTS; s++)
+	{
+		windowSlot[s] = -1;
+		slotPage[s] = -1;
+	}
+	missTile = ' ';
+	misses = 0;
+	for (int q = 0; q < TILE_PAGE_MISS_QUEUE; q++)
+		missQueue[q] = -1;
+	missHead = 0;
+}
+
+TilePager::~TilePager()
+{
+	close();
+}
+
+
+bool TilePager::create(const glm::ivec2& mapSize, char missTile)
+{
+	ofstream fout;
+	char blank[TILE_PAGE_BYTES];
+
+	close();
+	this->mapSize = mapSize;
+	this->missTile = missTile;
+	numPages = (mapSize + TILE_PAGE_SIZE - 1) / TILE_PAGE_SIZE;
+
+	pageFile = createScratchFile();
+	if (pageFile.empty())
+		return false;
+
+	// Every tile starts as empty space
+	fout.open(pageFile.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!fout.is_open())
+		return false;
+	memset(blank, ' ', TILE_PAGE_BYTES);
+	for (int p = 0; p < numPages.x * numPages.y; p++)
+		fout.write(blank, TILE_PAGE_BYTES);
+	fout.close();
+
+	return file.open(pageFile, true);
+}
+
+void TilePager::close()
+{
+	for (int s = 0; s < TILE_PAGE_SLOTS; s++)
+	{
+		windowSlot[s] = -1;
+		slotPage[s] = -1;
+	}
+	for (int q = 0; q < TILE_PAGE_MISS_QUEUE; q++)
+		missQueue[q] = -1;
+	windowSize = glm::ivec2(0);
+	file.close();
+
+	// The mapping is gone, so the scratch file can be deleted on any OS
+	if (!pageFile.empty())
+	{
+		remove(pageFile.c_str());
+		pageFile.clear();
+	}
+}
+
+
+char TilePager::get(int i, int j) const
+{
+	int px = i / TILE_PAGE_SIZE, py = j / TILE_PAGE_SIZE;
+	int w = windowIndex(px, py);
+	int local = (j % TILE_PAGE_SIZE) * TILE_PAGE_SIZE + i % TILE_PAGE_SIZE;
+
+	if (w >= 0 && windowSlot[w] >= 0)
+		return slots[windowSlot[w]][local];
+
+	// Not resident yet. Reading the mapped file could wait for the disk, so
+	// the tile is solid until the next update copies the page in. Requests
+	// can overwrite each other, a lost one is asked for again on the next miss.
+	misses++;
+	missQueue[missHead++ % TILE_PAGE_MISS_QUEUE] = py * numPages.x + px;
+	return missTile;
+}
+
+char TilePager::getExact(int i, int j) const
+{
+	int px = i / TILE_PAGE_SIZE, py = j / TILE_PAGE_SIZE;
+	int local = (j % TILE_PAGE_SIZE) * TILE_PAGE_SIZE + i % TILE_PAGE_SIZE;
+
+	// set always writes the file, so it is never behind the slots
+	return file.data()[pageOffset(px, py) + local];
+}
+
+void TilePager::set(int i, int j, char tile)
+{
+	int px = i / TILE_PAGE_SIZE, py = j / TILE_PAGE_SIZE;
+	int w = windowIndex(px, py);
+	int local = (j % TILE_PAGE_SIZE) * TILE_PAGE_SIZE + i % TILE_PAGE_SIZE;
+
+	file.data()[pageOffset(px, py) + local] = tile;
+	if (w >= 0 && windowSlot[w] >= 0)
+		slots[windowSlot[w]][local] = tile;
+}
+
+void TilePager::rowsWritten(int numRows)
+{
+	// Once a whole band of pages is written it can leave memory
+	if (numRows % TILE_PAGE_SIZE == 0 || numRows == mapSize.y)
+	{
+		int band = (numRows - 1) / TILE_PAGE_SIZE;
+		file.adviseDontNeed(pageOffset(0, band), size_t(numPages.x) * TILE_PAGE_BYTES);
+	}
+}
+
+
+void TilePager::setFocus(const glm::ivec2& center, const glm::ivec2& radius)
+{
+	glm::ivec2 centerPage = glm::clamp(center, glm::ivec2(0), mapSize - 1) / TILE_PAGE_SIZE;
+	glm::ivec2 first = glm::max(center - radius, glm::ivec2(0)) / TILE_PAGE_SIZE;
+	glm::ivec2 last = glm::min(center + radius, mapSize - 1) / TILE_PAGE_SIZE;
+	glm::ivec2 size;
+	int newWindowSlot[TILE_PAGE_SLOTS];
+
+	first = glm::min(first, centerPage);
+	last = glm::max(last, centerPage);
+
+	// Shrink the window around the center until it fits in the slots
+	size = last - first + 1;
+	while (size.x * size.y > TILE_PAGE_SLOTS)
+	{
+		if (size.x >= size.y)
+		{
+			if (centerPage.x - first.x > last.x - centerPage.x)
+				first.x++;
+			else
+				last.x--;
+		}
+		else
+		{
+			if (centerPage.y - first.y > last.y - centerPage.y)
+				first.y++;
+			else
+				last.y--;
+		}
+		size = last - first + 1;
+	}
+
+	if (first == windowOrigin && size == windowSize)
+		return;
+
+	// Pages that stay in the window keep their slot, the rest are evicted
+	for (int w = 0; w < TILE_PAGE_SLOTS; w++)
+		newWindowSlot[w] = -1;
+	for (int s = 0; s < TILE_PAGE_SLOTS; s++)
+	{
+		if (slotPage[s] < 0)
+			continue;
+		int wx = slotPage[s] % numPages.x - first.x;
+		int wy = slotPage[s] / numPages.x - first.y;
+		if (wx >= 0 && wy >= 0 && wx < size.x && wy < size.y)
+			newWindowSlot[wy * size.x + wx] = s;
+		else
+			evictSlot(s);
+	}
+
+	windowOrigin = first;
+	windowSize = size;
+	memcpy(windowSlot, newWindowSlot, sizeof(windowSlot));
+
+	// Ask the OS to start reading the new window in the background
+	for (int py = first.y; py <= last.y; py++)
+		file.adviseWillNeed(pageOffset(first.x, py), size_t(size.x) * TILE_PAGE_BYTES);
+}
+
+// Pages that were missed go first. Missed pages outside the window are
+// dropped, the window only follows the focus.
+
+void TilePager::update(int maxPageIns)
+{
+	for (int q = 0; q < TILE_PAGE_MISS_QUEUE && maxPageIns > 0; q++)
+	{
+		int page = missQueue[q].exchange(-1);
+		if (page < 0)
+			continue;
+
+		int w = windowIndex(page % numPages.x, page / numPages.x);
+		if (w >= 0 && windowSlot[w] < 0)
+		{
+			if (!pageIn(w))
+				return;
+			maxPageIns--;
+		}
+	}
+
+	for (int w = 0; w < windowSize.x * windowSize.y && maxPageIns > 0; w++)
+	{
+		if (windowSlot[w] >= 0)
+			continue;
+		if (!pageIn(w))
+			return;
+		maxPageIns--;
+	}
+}
+
+
+int TilePager::getResidentPages() const
+{
+	int resident = 0;
+
+	for (int s = 0; s < TILE_PAGE_SLOTS; s++)
+		if (slotPage[s] >= 0)
+			resident++;
+
+	return resident;
+}
+
+size_t TilePager::pageOffset(int px, int py) const
+{
+	return (size_t(py) * numPages.x + px) * TILE_PAGE_BYTES;
+}
+
+int TilePager::windowIndex(int px, int py) const
+{
+	int wx = px - windowOrigin.x, wy = py - windowOrigin.y;
+
+	if (wx < 0 || wy < 0 || wx >= windowSize.x || wy >= windowSize.y)
+		return -1;
+	return wy * windowSize.x + wx;
+}
+
+// Copies the page at window position w into a free slot, if there is one
+
+bool TilePager::pageIn(int w)
+{
+	int slot = 0;
+
+	while (slot < TILE_PAGE_SLOTS && slotPage[slot] >= 0)
+		slot++;
+	if (slot == TILE_PAGE_SLOTS)
+		return false;
+
+	int px = windowOrigin.x + w % windowSize.x;
+	int py = windowOrigin.y + w / windowSize.x;
+	memcpy(slots[slot], file.data() + pageOffset(px, py), TILE_PAGE_BYTES);
+	slotPage[slot] = py * numPages.x + px;
+	windowSlot[w] = slot;
+
+	return true;
+}
+
+void TilePager::evictSlot(int slot)
+{
+	int page = slotPage[slot];
+
+	slotPage[slot] = -1;
+	file.adviseDontNeed(pageOffset(page % numPages.x, page / numPages.x), TILE_PAGE_BYTES);
+}
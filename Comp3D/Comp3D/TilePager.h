@@ -0,0 +1,82 @@
+#ifndef _TILE_PAGER_INCLUDE
+#define _TILE_PAGER_INCLUDE
+
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <string>
+#include "MappedFile.h"
+
+
+#define TILE_PAGE_SIZE 64				// Pages are TILE_PAGE_SIZE x TILE_PAGE_SIZE tiles (4 KB)
+#define TILE_PAGE_BYTES (TILE_PAGE_SIZE * TILE_PAGE_SIZE)
+#define TILE_PAGE_SLOTS 48				// Resident pages, the same for any level size
+#define TILE_PAGE_INS_PER_UPDATE 4		// Pages copied in per frame at most
+#define TILE_PAGE_MISS_QUEUE 8			// Missed pages remembered until the next update
+
+
+// TilePager stores the tiles of a very large map in a page file, one page
+// after the other, that is memory mapped. The page file is a scratch file in
+// the temporary directory, deleted when the pager is closed. Only a fixed
+// window of pages around the focus (the current room) is kept resident.
+// Pages enter the window a few at a time in update(). Until a page is
+// resident its tiles read as the miss tile (a solid block) and the page is
+// queued to be copied in first, so get never touches the mapped file and
+// never waits for the disk. getExact reads the file instead, for the rare
+// lookups whose answer must be right wherever the tile is.
+
+
+class TilePager
+{
+
+public:
+	TilePager();
+	~TilePager();
+
+	// Creates an empty page file for a map of the given size and maps it.
+	// Tiles that are not resident read as missTile.
+	bool create(const glm::ivec2& mapSize, char missTile);
+	void close();
+
+	char get(int i, int j) const;
+	// The real tile even if its page is not resident, read from the mapped
+	// file. It can wait for the disk, so it is only for rare lookups of
+	// tiles that may be far from the focus, never for collisions or drawing.
+	char getExact(int i, int j) const;
+	void set(int i, int j, char tile);
+
+	// Tells the pager that rows before numRows will not be written again
+	// while the page file is being filled
+	void rowsWritten(int numRows);
+
+	void setFocus(const glm::ivec2& center, const glm::ivec2& radius);
+	void update(int maxPageIns = TILE_PAGE_INS_PER_UPDATE);
+
+	int getResidentPages() const;
+	int getMisses() const { return misses; }
+
+private:
+	size_t pageOffset(int px, int py) const;
+	int windowIndex(int px, int py) const;
+	bool pageIn(int w);
+	void evictSlot(int slot);
+
+private:
+	MappedFile file;
+	string pageFile;
+	char missTile;
+	glm::ivec2 mapSize, numPages;
+
+	glm::ivec2 windowOrigin, windowSize;
+	int windowSlot[TILE_PAGE_SLOTS];		// Slot of every window page or -1
+	int slotPage[TILE_PAGE_SLOTS];			// Page held by every slot or -1
+	char slots[TILE_PAGE_SLOTS][TILE_PAGE_BYTES];
+
+	mutable atomic<int> misses;			// Entities read tiles from several threads
+	mutable atomic<int> missQueue[TILE_PAGE_MISS_QUEUE];	// Missed pages or -1
+	mutable atomic<unsigned> missHead;
+
+};
+
+
+#endif // _TILE_PAGER_INCLUDE
@@ -1,16 +1,59 @@
 #include <GL/glew.h>
 #include <GL/glut.h>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
 #include "Game.h"
+#include "LevelFile.h"
+#include "ModelBounds.h"
+#include "AssimpModel.h"
+#include "Benchmark.h"
+#include "FrameScheduler.h"
+#include "JobSystem.h"
+#include "SimulationThread.h"
+#include "InputLatency.h"
+#include "LevelArena.h"
+#include "AllocationTracker.h"
+#include "FrameScratch.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryAccounting.h"
+#include "NullAudioBackend.h"
+#include "SoftwareMixer.h"
+#ifndef COMP3D_NO_FMOD
+#include "FmodBackend.h"
+#endif
 
 
 //Remove console (only works in Visual Studio)
 //#pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
 
 
-#define TIME_PER_FRAME 1000.f / 60.f // Approx. 60 fps
-
-
-static int prevTime;
+#define FRAMES_PER_SECOND 60.0
+#define SIMULATION_STEP 8 // ms, the simulation always runs at 125 Hz
+#define MAX_STEPS_PER_FRAME 10 // Catch-up steps after a long frame, the rest of the time is dropped
+#define NUM_LEVEL_FILES 6
+#define FRAME_STATS_PERIOD 5000.0 // ms between frame statistics with --frame-stats
+#define ZERO_ALLOC_WARMUP 120 // Frames of every level that may still allocate with --zero-alloc
+#define PROFILE_FILE "profile.json" // Trace written by F4 without --profile
+#define MEMORY_FILE "memory.json" // Memory breakdown written by F5 without --memory
+
+
+static FrameScheduler scheduler;
+static double simulationTime; // Time not simulated yet
+static bool bFrameStats = false;
+static bool bThreaded = false; // Simulation in its own thread, see SimulationThread
+static bool bInputLatency = false;
+static bool bZeroAlloc = false; // Frames after the warm-up must not allocate, see AllocationTracker
+static bool bReplay = false; // Input comes from a recording, see Replay
+static bool bProfile = false; // Trace written when the game quits, see Profiler
+static string profileFile = PROFILE_FILE;
+static bool bMemory = false; // Memory breakdown written when the game quits, see MemoryAccounting
+static bool bMemoryBudget = false; // Going over it makes the game fail when it quits
+static string memoryFile = MEMORY_FILE;
+static int warmupFrames, warmupLevel;
+static double frameStatsTime;
 static Game game; // This object represents our whole game
 
 
@@ -28,11 +71,36 @@ static void keyboardUpCallback(unsigned char key, int x, int y)
 	Game::instance().keyReleased(key);
 }
 
-// If a special key is pressed this callback is called
+static void exportProfile()
+{
+	if(Profiler::instance().exportTrace(profileFile))
+		cout << "Profile -> " << profileFile << endl;
+	else
+		cerr << "Could not write '" << profileFile << "'" << endl;
+}
+
+static void exportMemory()
+{
+	if(MemoryAccounting::instance().exportJson(memoryFile))
+		cout << "Memory -> " << memoryFile << endl;
+	else
+		cerr << "Could not write '" << memoryFile << "'" << endl;
+}
+
+// If a special key is pressed this callback is called. F3 and F4 show the
+// profiler and write its trace, F5 writes the memory breakdown. They never
+// reach the game.
 
 static void specialDownCallback(int key, int x, int y)
 {
-	Game::instance().specialKeyPressed(key);
+	if(Profiler::isEnabled() && key == GLUT_KEY_F3)
+		Profiler::instance().toggleOverlay();
+	else if(Profiler::isEnabled() && key == GLUT_KEY_F4)
+		exportProfile();
+	else if(key == GLUT_KEY_F5)
+		exportMemory();
+	else
+		Game::instance().specialKeyPressed(key);
 }
 
 // If a special key is released this callback is called
@@ -77,30 +145,360 @@ static void mouseCallback(int button, int state, int x, int y)
 
 static void drawCallback()
 {
-	Game::instance().render();
+	PROFILE_ZONE("draw");
+
+	if(bThreaded && Game::instance().supportsSnapshots())
+	{
+		// Nothing to draw until the simulation publishes its first frame
+		const RenderSnapshot *snapshot = SimulationThread::instance().acquireSnapshot();
+		if(snapshot == NULL)
+			return;
+		Game::instance().render(*snapshot);
+	}
+	else
+		Game::instance().render();
+	if(Profiler::isEnabled())
+		Profiler::instance().renderOverlay();
 	glutSwapBuffers();
+	Game::instance().framePresented();
+	RenderStats::instance().beginFrame();
+}
+
+static void printFrameStats()
+{
+	cout << "Frame " << scheduler.getAverageFrameTime() << " ms, jitter " << scheduler.getJitter()
+		<< " ms, CPU " << int(100.0 * scheduler.getCpuUtilisation()) << "%";
+	if(InputLatency::instance().getNumSamples() > 0)
+		cout << ", input " << InputLatency::instance().getPercentile(0.5) << " ms";
+	cout << endl;
+
+	SoundManager::Stats audio = SoundManager::instance().getStats();
+	cout << "Audio " << audio.numSamples << " samples (" << audio.sampleBytes / 1024 << " KB), "
+		<< audio.numStreams << " streams, " << audio.numReferences << " references, backend "
+		<< audio.backendBytes / 1024 << " KB, voices " << audio.numRealVoices << "/" << audio.numVoices
+		<< " (coalesced " << audio.numCoalesced << ", cooled down " << audio.numCooledDown << ", stolen " << audio.numStolen << ")" << endl;
+
+	LevelArena::Stats arena = LevelArena::instance().getStats();
+	cout << "Level arena " << arena.levelAllocations << " allocations (" << arena.levelBytes / 1024 << " KB), "
+		<< arena.numObjects << " objects, last frame " << arena.frameAllocations << " (" << arena.frameBytes << " bytes), "
+		<< arena.numBlocks << " blocks (" << arena.reservedBytes / 1024 << " KB), level " << arena.numLevels << endl;
+
+	if(AllocationTracker::isEnabled())
+	{
+		AllocationTracker::Stats allocations = AllocationTracker::instance().getStats();
+		cout << "Heap last frame " << allocations.frameAllocations << " allocations (" << allocations.frameBytes << " bytes), total "
+			<< allocations.totalAllocations << " allocations, " << allocations.totalFrees << " frees, scratch peak "
+			<< FrameScratch::instance().getPeak() << " bytes" << endl;
+		AllocationTracker::instance().print(cout);
+	}
+}
+
+// Every level starts allocating while it warms up, after that the frames
+// are expected not to touch the heap
+
+static void checkAllocations()
+{
+	int level = LevelArena::instance().getStats().numLevels;
+
+	AllocationTracker::instance().beginFrame();
+	if(level != warmupLevel)
+	{
+		warmupLevel = level;
+		warmupFrames = 0;
+		AllocationTracker::instance().expectNoAllocations(false);
+	}
+	else if(++warmupFrames == ZERO_ALLOC_WARMUP)
+		AllocationTracker::instance().expectNoAllocations(true);
+}
+
+// --audio fmod, null, mixer or a .wav file where the mix is written
+
+static AudioBackend* createAudioBackend(const string& name)
+{
+#ifndef COMP3D_NO_FMOD
+	if (name == "fmod")
+		return new FmodBackend();
+#endif
+	if (name == "null")
+		return new NullAudioBackend();
+	if (name == "mixer")
+		return new SoftwareMixer();
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0)
+		return new SoftwareMixer(name);
+	return NULL;
+}
+
+// Also when GLUT exits because the window was closed, so that the level
+// being recorded is not lost
+
+static void saveRecording()
+{
+	Replay::instance().stop();
+}
+
+static void quit()
+{
+	SimulationThread::instance().stop();
+	if(bFrameStats)
+		printFrameStats();
+	if(bInputLatency)
+		InputLatency::instance().print(cout);
+	if(bProfile)
+		exportProfile();
+	// The level being played ends too, and its render stats are printed
+	RenderStats::instance().setLevel(0);
+	RenderStats::instance().beginFrame();
+	if(bMemory)
+	{
+		MemoryAccounting::instance().print(cout);
+		exportMemory();
+	}
+	if(bReplay)
+	{
+		int divergences = Replay::instance().getNumDivergences();
+		cout << "Replay " << (divergences == 0 ? "matched the recording" : "diverged from the recording") << endl;
+		if(divergences > 0)
+			exit(1);
+	}
+	if(bZeroAlloc && AllocationTracker::instance().getStats().numViolations > 0)
+	{
+		cerr << AllocationTracker::instance().getStats().numViolations << " frames allocated after the warm-up" << endl;
+		exit(1);
+	}
+	if(bMemoryBudget && MemoryAccounting::instance().getNumOverBudget() > 0)
+	{
+		cerr << "Over the memory budget " << MemoryAccounting::instance().getNumOverBudget() << " times" << endl;
+		exit(1);
+	}
+	exit(0);
 }
 
 static void idleCallback()
 {
-	int currentTime = glutGet(GLUT_ELAPSED_TIME);
-	int deltaTime = currentTime - prevTime;
-	
-	if(deltaTime > TIME_PER_FRAME)
+	// Every time we enter here is equivalent to a game loop execution.
+	// The scheduler sleeps until the frame is due.
+	double deltaTime = scheduler.waitNextFrame();
+	PROFILE_ZONE("main loop");
+	if(Profiler::isEnabled())
+		Profiler::instance().beginFrame();
+	LevelArena::instance().beginFrame();
+	FrameScratch::instance().reset();
+	if(bZeroAlloc)
+		checkAllocations();
+	else
+		AllocationTracker::instance().beginFrame();
+
+	// OpenGL work queued by the jobs and the simulation thread
+	JobSystem::instance().runMainThreadJobs();
+
+	if(bThreaded && Game::instance().supportsSnapshots())
+	{
+		// The simulation thread updates the game, only draw
+		if(!SimulationThread::instance().isPlaying())
+			quit();
+		simulationTime = 0;
+	}
+	else
+	{
+		// The simulation advances in fixed steps, whatever the frame rate
+		simulationTime += deltaTime;
+		for(int step = 0; step < MAX_STEPS_PER_FRAME && simulationTime >= SIMULATION_STEP; step++)
+		{
+			if(!Game::instance().update(SIMULATION_STEP))
+				quit();
+			simulationTime -= SIMULATION_STEP;
+		}
+		simulationTime = fmod(simulationTime, SIMULATION_STEP);
+
+		// Render between the last two steps
+		Game::instance().setInterpolation(float(simulationTime / SIMULATION_STEP));
+	}
+	glutPostRedisplay();
+
+	if(bFrameStats && FrameScheduler::now() > frameStatsTime)
+	{
+		printFrameStats();
+		frameStatsTime = FrameScheduler::now() + FRAME_STATS_PERIOD;
+	}
+}
+
+
+// Converts text levels into the binary files the game loads.
+// Without arguments all the levels of the game are converted.
+
+static int convertLevels(int argc, char **argv)
+{
+	vector<string> textFiles(argv, argv + argc);
+	vector<char> converted;
+	int failed = 0;
+
+	if (textFiles.empty())
+		for (int i = 1; i <= NUM_LEVEL_FILES; i++)
+			textFiles.push_back("levels/level0" + to_string(i) + ".txt");
+
+	// Levels are independent, convert them in parallel
+	converted.resize(textFiles.size());
+	JobSystem::instance().init();
+	JobSystem::instance().parallelFor(textFiles.size(), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+			converted[i] = LevelFile::convert(textFiles[i], LevelFile::binaryPath(textFiles[i]));
+	});
+
+	for (int i = 0; i < textFiles.size(); i++)
+	{
+		const string& textFile = textFiles[i];
+		string binaryFile = LevelFile::binaryPath(textFile);
+		if (converted[i])
+			cout << textFile << " -> " << binaryFile << endl;
+		else
+		{
+			cerr << "Could not convert '" << textFile << "'" << endl;
+			failed++;
+		}
+	}
+
+	return (failed == 0) ? 0 : 1;
+}
+
+// Runs the benchmarks whose name starts with the filter, all of them
+// without one, and writes the results as JSON after --json.
+
+static int runBenchmarks(int argc, char **argv)
+{
+	string filter, jsonFile;
+
+	for (int i = 0; i < argc; i++)
 	{
-		// Every time we enter here is equivalent to a game loop execution
-		if(!Game::instance().update(deltaTime))
-			exit(0);
-		prevTime = currentTime;
-		glutPostRedisplay();
+		string arg = argv[i];
+		if (arg == "--json" && i + 1 < argc)
+			jsonFile = argv[++i];
+		else
+			filter = arg;
 	}
+
+	return Benchmark::instance().run(filter, jsonFile);
+}
+
+// Parses models and writes their bounding boxes to the cache the headless
+// build reads. Without arguments the models already in the cache are
+// parsed again.
+
+static int cacheBounds(int argc, char **argv)
+{
+	vector<string> modelFiles(argv, argv + argc);
+	vector<char> parsed;
+	int failed = 0;
+
+	ModelBounds::instance().load();
+	if (modelFiles.empty())
+		ModelBounds::instance().getModels(modelFiles);
+
+	// Reading the models does not need OpenGL, they are parsed in parallel
+	parsed.resize(modelFiles.size());
+	JobSystem::instance().init();
+	JobSystem::instance().parallelFor(modelFiles.size(), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			AssimpModel model;
+			parsed[i] = model.parseFile(modelFiles[i]);
+			if (parsed[i])
+				ModelBounds::instance().store(modelFiles[i], model.getCenter(), model.getSize());
+		}
+	});
+
+	for (int i = 0; i < modelFiles.size(); i++)
+		if (!parsed[i])
+		{
+			cerr << "Could not parse '" << modelFiles[i] << "'" << endl;
+			failed++;
+		}
+	if (!ModelBounds::instance().save())
+	{
+		cerr << "Could not write '" << MODEL_BOUNDS_FILE << "'" << endl;
+		return 1;
+	}
+	cout << modelFiles.size() - failed << " models -> " << MODEL_BOUNDS_FILE << endl;
+
+	return (failed == 0) ? 0 : 1;
 }
 
 
 int main(int argc, char **argv)
 {
+	// Offline tools, no window needed
+	if (argc > 1 && string(argv[1]) == "--convert-levels")
+		return convertLevels(argc - 2, argv + 2);
+	if (argc > 1 && string(argv[1]) == "--cache-bounds")
+		return cacheBounds(argc - 2, argv + 2);
+	if (argc > 1 && string(argv[1]) == "--bench")
+		return runBenchmarks(argc - 2, argv + 2);
+
 	// GLUT initialization
 	glutInit(&argc, argv);
+	PROFILE_THREAD("main");
+
+	bool bUncapped = false, bVsync = false;
+	for(int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg == "--uncapped")
+			bUncapped = true;
+		else if(arg == "--vsync")
+			bVsync = true;
+		else if(arg == "--frame-stats")
+			bFrameStats = true;
+		else if(arg == "--threaded")
+			bThreaded = true;
+		else if(arg == "--input-latency")
+			bInputLatency = true;
+		else if(arg == "--zero-alloc")
+		{
+			bZeroAlloc = AllocationTracker::isEnabled();
+			if(!bZeroAlloc)
+				cerr << "Allocation tracking is not compiled in, build with COMP3D_TRACK_ALLOCATIONS" << endl;
+		}
+		else if(arg == "--record" && i + 1 < argc)
+		{
+			if(Replay::instance().startRecording(argv[++i]))
+				atexit(saveRecording);
+			else
+				cerr << "Could not create the recording '" << argv[i] << "'" << endl;
+		}
+		else if(arg == "--replay" && i + 1 < argc)
+		{
+			bReplay = Replay::instance().startReplay(argv[++i]);
+			if(!bReplay)
+				cerr << "Could not read the recording '" << argv[i] << "'" << endl;
+		}
+		else if(arg == "--profile" && i + 1 < argc)
+		{
+			profileFile = argv[++i];
+			bProfile = Profiler::isEnabled();
+			if(!bProfile)
+				cerr << "Profiling is not compiled in, build with COMP3D_PROFILE" << endl;
+		}
+		else if(arg == "--memory" && i + 1 < argc)
+		{
+			memoryFile = argv[++i];
+			bMemory = true;
+		}
+		else if(arg == "--memory-budget" && i + 2 < argc)
+		{
+			// In MB, the CPU one and the GPU one
+			MemoryAccounting::instance().setBudget(MemoryAccounting::CPU, atoll(argv[++i]) << 20);
+			MemoryAccounting::instance().setBudget(MemoryAccounting::GPU, atoll(argv[++i]) << 20);
+			bMemoryBudget = true;
+		}
+		else if(arg == "--audio" && i + 1 < argc)
+		{
+			AudioBackend *backend = createAudioBackend(argv[++i]);
+			if(backend != NULL)
+				SoundManager::instance().setBackend(backend);
+			else
+				cerr << "Unknown audio backend '" << argv[i] << "'" << endl;
+		}
+	}
+
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
 	glutInitWindowPosition(100, 100);
 	glutInitWindowSize(960, 720);
@@ -121,9 +519,19 @@ int main(int argc, char **argv)
 	glewExperimental = GL_TRUE;
 	glewInit();
 	
+	// Frame pacing, uncapped is meant for benchmarks
+	scheduler.setUncapped(bUncapped);
+	if(bVsync && !scheduler.setVsync(true))
+		cerr << "Vsync is not supported, using the frame scheduler" << endl;
+
 	// Game instance initialization
-	Game::instance().init();
-	prevTime = glutGet(GLUT_ELAPSED_TIME);
+	JobSystem::instance().init();
+	Game::instance().init(bReplay ? Replay::instance().getFirstLevel() : 0);
+	if(bThreaded)
+		SimulationThread::instance().start(SIMULATION_STEP, MAX_STEPS_PER_FRAME);
+	scheduler.init(FRAMES_PER_SECOND); // Loading does not count as a frame
+	simulationTime = 0;
+	frameStatsTime = FrameScheduler::now() + FRAME_STATS_PERIOD;
 	// GLUT gains control of the application
 	glutMainLoop();
 
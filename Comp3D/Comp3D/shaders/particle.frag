@@ -0,0 +1,24 @@
+#version 330
+
+uniform sampler2D tex;
+uniform float fadeOut;
+
+in vec2 texCoordFrag;
+in float lifetimeFrag;
+
+out vec4 outColor;
+
+
+void main()
+{
+	vec4 texColor = texture(tex, texCoordFrag);
+	if(texColor.a < 0.1f)
+		discard;
+
+	// Particles fade during the last fadeOut seconds of their life
+	float alpha = 1.f;
+	if(fadeOut > 0.f)
+		alpha = min(1.f, lifetimeFrag / fadeOut);
+	outColor = vec4(texColor.rgb, texColor.a * alpha);
+}
+
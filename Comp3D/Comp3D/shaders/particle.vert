@@ -0,0 +1,17 @@
+#version 330
+
+uniform mat4 view;
+
+in float lifetime;
+in vec3 position;
+
+out float lifetimeGeom;
+
+
+void main()
+{
+	// The quad is built around the particle in eye coordinates
+	lifetimeGeom = lifetime;
+	gl_Position = view * vec4(position, 1.0);
+}
+
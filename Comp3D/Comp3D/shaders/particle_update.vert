@@ -0,0 +1,22 @@
+#version 330
+
+uniform float deltaTime;
+uniform float gravity;
+
+in float lifetime;
+in vec3 position;
+in vec3 speed;
+
+out float lifetimeGeom;
+out vec3 positionGeom;
+out vec3 speedGeom;
+
+
+void main()
+{
+	// Same integration as ParticleSystem::update
+	lifetimeGeom = lifetime - deltaTime;
+	speedGeom = speed - vec3(0.0, gravity * deltaTime, 0.0);
+	positionGeom = position + speedGeom * deltaTime;
+}
+